@@ -0,0 +1,429 @@
+#include "Handlers.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include "TBatchReader.h"
+#include "TCommandRunner.h"
+#include "TDirectoryWalker.h"
+#include "TFileWriter.h"
+#include "TLog.h"
+#include "TMetrics.h"
+#include "TPathCache.h"
+#include "TStreamBody.h"
+#include "TWatchSubscription.h"
+
+void registerDefaultHandlers(TCallbackRegistry& registry, TSystemSampler& sampler, qint64 mmapThreshold,
+                             TPathCache* cache)
+{
+    // 文件类回调在每个会话中的并发上限
+    registry.setConcurrencyLimit(Models::READ_file, 4);
+    registry.setConcurrencyLimit(Models::write_file, 4);
+    registry.setConcurrencyLimit(Models::list_directory, 4);
+    registry.setConcurrencyLimit(Models::read_files, 4);
+    
+    // 1. 注册读取文件的回调函数
+    registry.registerCallback<Models::ReadFileRequest>(
+        [mmapThreshold, cache](int sequence, const Models::ReadFileRequest& request) -> Models::Response {
+            TLOG_DEBUG("rf").field("seq", sequence).field("path", request.filePath);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            // 命中缓存时直接复用已序列化的结果，不访问文件系统
+            TPathCache::Ticket ticket;
+            if (cache && !request.stream && cache->lookupFile(request.filePath, &response.rawResult, &ticket)) {
+                response.statusCode = 200;
+                return response;
+            }
+            
+            // 大文件走内存映射，映射页直接作为二进制数据块发送，不做文本解码
+            if (mmapThreshold > 0 && QFileInfo(request.filePath).size() >= mmapThreshold) {
+                response.statusCode = 200;
+                response.stream = std::make_shared<TMappedFileStreamBody>(
+                    request.filePath, request.offset, request.length, request.chunkSize);
+                return response;
+            }
+            
+            // 流式读取：由会话按块发送，内存占用与文件大小无关
+            if (request.stream) {
+                response.statusCode = 200;
+                response.stream = std::make_shared<TFileStreamBody>(
+                    request.filePath, request.offset, request.length, request.chunkSize);
+                return response;
+            }
+            
+            QFile file(request.filePath);
+            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                QTextStream in(&file);
+                QString content = in.readAll();
+                
+                Models::ReadFileResponse fileResponse;
+                fileResponse.content = content;
+                
+                response.statusCode = 200;
+                response.setResult(fileResponse);
+                if (cache && file.size() <= cache->maxFileSize()) {
+                    cache->insert(ticket, response.resultJsonBytes());
+                }
+            } else {
+                response.statusCode = 500;
+                response.error = "File read error";
+                response.errorReason = QString("Cannot read file: %1").arg(request.filePath);
+            }
+            
+            return response;
+        });
+    
+    // 2. 注册写入文件的回调函数
+    registry.registerCallback<Models::WriteFileRequest>(
+        [](int sequence, const Models::WriteFileRequest& request) -> Models::Response {
+            TLOG_DEBUG("wf").field("seq", sequence).field("path", request.filePath);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            TFileWriter::Durability durability;
+            if (!TFileWriter::durabilityFromName(request.durability, &durability)) {
+                response.statusCode = 400;
+                response.error = "Invalid durability";
+                response.errorReason = QString("Unknown durability: %1").arg(request.durability);
+                return response;
+            }
+            if (request.atomic && request.append) {
+                response.statusCode = 400;
+                response.error = "Invalid request";
+                response.errorReason = "atomic cannot be combined with append";
+                return response;
+            }
+            
+            QString errorReason;
+            auto writer = std::make_unique<TFileWriter>(request.filePath, request.append, request.atomic, durability);
+            
+            // 分块上传：数据由对端以上传数据块帧发送，流结束时返回完成响应
+            if (request.chunked) {
+                if (!writer->open(request.size, &errorReason)) {
+                    response.statusCode = 500;
+                    response.error = "File write error";
+                    response.errorReason = errorReason;
+                    return response;
+                }
+                
+                response.statusCode = 200;
+                response.stream = std::make_shared<TUploadStreamBody>(std::move(writer), request.size);
+                return response;
+            }
+            
+            QByteArray bytes = request.content.toUtf8();
+            if (writer->open(bytes.size(), &errorReason)
+                && writer->write(0, bytes.constData(), bytes.size(), &errorReason)
+                && writer->commit(&errorReason)) {
+                Models::WriteFileResponse writeResponse;
+                writeResponse.message = "File written successfully";
+                writeResponse.bytesWritten = bytes.size();
+                
+                response.statusCode = 200;
+                response.setResult(writeResponse);
+            } else {
+                response.statusCode = 500;
+                response.error = "File write error";
+                response.errorReason = errorReason;
+            }
+            
+            return response;
+        });
+    
+    // 3. 注册列出目录的回调函数
+    // 支持递归、通配符过滤、分页续传和流式返回；子目录在线程池中并行读取，未请求的字段不做 stat
+    registry.registerCallback<Models::ListDirectoryRequest>(
+        [cache](int sequence, const Models::ListDirectoryRequest& request) -> Models::Response {
+            TLOG_DEBUG("ld").field("seq", sequence).field("path", request.directoryPath)
+                .field("depth", request.depth).field("cursor", request.cursor);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            // 只缓存单层的非流式列表：递归结果依赖多个目录，监视不到子目录的变化
+            TPathCache::Ticket ticket;
+            if (cache && request.depth == 0 && !request.stream) {
+                QByteArray variant = (request.includeHidden ? "h\n" : "\n")
+                    + request.patterns.join(QLatin1Char('/')).toUtf8() + '\n'
+                    + request.requestedFields.join(QLatin1Char(',')).toUtf8() + '\n'
+                    + QByteArray::number(request.pageSize) + '\n' + request.cursor.toUtf8();
+                if (cache->lookupDirectory(request.directoryPath, variant, &response.rawResult, &ticket)) {
+                    response.statusCode = 200;
+                    return response;
+                }
+            }
+            
+            TDirectoryWalker::Options options;
+            options.root = request.directoryPath;
+            options.depth = request.depth;
+            options.patterns = request.patterns;
+            options.includeHidden = request.includeHidden;
+            options.wantType = request.wants("type");
+            options.wantSize = request.wants("size");
+            options.wantModified = request.wants("lastModified");
+            options.cursor = request.cursor;
+            
+            // 非流式分页优先续用上一页暂存的遍历器
+            std::unique_ptr<TDirectoryWalker> walker = request.stream ? nullptr : TDirectoryWalker::resume(options);
+            if (!walker) {
+                walker.reset(new TDirectoryWalker(options));
+                QString errorReason;
+                bool notFound = false;
+                if (!walker->start(&errorReason, &notFound)) {
+                    if (notFound) {
+                        response.statusCode = 404;
+                        response.error = "Directory not found";
+                        response.errorReason = QString("Directory does not exist: %1").arg(request.directoryPath);
+                    } else {
+                        response.statusCode = 500;
+                        response.error = "Directory read error";
+                        response.errorReason = errorReason;
+                    }
+                    return response;
+                }
+            }
+            
+            // 流式返回：所有页以数据块帧发送，内存占用与条目总数无关
+            if (request.stream) {
+                response.statusCode = 200;
+                response.stream = std::make_shared<TDirectoryStreamBody>(
+                    std::move(walker), request.pageSize > 0 ? request.pageSize : 1000);
+                return response;
+            }
+            
+            Models::ListDirectoryResponse dirResponse;
+            TDirectoryWalker::Entry entry;
+            while ((request.pageSize <= 0 || dirResponse.files.size() < request.pageSize) && walker->next(&entry)) {
+                dirResponse.files.append(walker->fileInfo(entry));
+            }
+            // 本页已满且还有条目时返回续传游标，并暂存遍历器供下一页续用
+            if (request.pageSize > 0 && dirResponse.files.size() == request.pageSize && walker->hasMore()) {
+                dirResponse.nextCursor = dirResponse.files.last().name;
+                TDirectoryWalker::suspend(std::move(walker), *dirResponse.nextCursor);
+            }
+            
+            response.statusCode = 200;
+            response.setResult(dirResponse);
+            if (cache) {
+                cache->insert(ticket, response.resultJsonBytes());
+            }
+            
+            return response;
+        });
+    
+    // 4. 注册执行命令的回调函数
+    // 进程由全局 TCommandRunner 限流排队，在会话线程异步运行，输出边产生边发送
+    registry.registerCallback<Models::ExecuteCommandRequest>(
+        [](int sequence, const Models::ExecuteCommandRequest& request) -> Models::Response {
+            TLOG_DEBUG("ec").field("seq", sequence).field("command", request.command);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            if (request.command.isEmpty()) {
+                response.statusCode = 400;
+                response.error = "Invalid command";
+                response.errorReason = "Command must not be empty";
+                return response;
+            }
+            
+            response.statusCode = 200;
+            response.stream = std::make_shared<TProcessStreamBody>(
+                request.command, request.arguments, request.workingDirectory, request.timeoutMs);
+            return response;
+        });
+    
+    // 5. 注册获取系统信息的回调函数
+    // 指标由后台采样线程定期刷新，请求只读取快照，不产生系统调用
+    registry.registerCallback<Models::GetSystemInfoRequest>(
+        [sampler = &sampler](int sequence, const Models::GetSystemInfoRequest& request) -> Models::Response {
+            TLOG_DEBUG("gsi").field("seq", sequence);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            const TSystemSampler::Snapshot snapshot = sampler->snapshot();
+            Models::GetSystemInfoResponse sysResponse;
+            Models::GetSystemInfoResponse::SystemInfo& info = sysResponse.systemInfo;
+            
+            if (request.wants("os")) {
+                info.osName = sampler->osName();
+                info.osVersion = sampler->osVersion();
+            }
+            if (request.wants("cpu")) {
+                info.cpuInfo = sampler->cpuArchitecture();
+                info.cpuCount = sampler->cpuCount();
+                info.cpuUsage = snapshot.cpuUsage;
+            }
+            if (request.wants("memory")) {
+                info.totalMemory = snapshot.totalMemory;
+                info.availableMemory = snapshot.availableMemory;
+            }
+            if (request.wants("disk")) {
+                qint64 totalDisk = 0;
+                qint64 availableDisk = 0;
+                QList<Models::GetSystemInfoResponse::DiskInfo> disks;
+                for (int i = 0; i < snapshot.diskCount; ++i) {
+                    Models::GetSystemInfoResponse::DiskInfo disk;
+                    disk.mount = sampler->mounts().at(i);
+                    disk.total = snapshot.disks[i].total;
+                    disk.available = snapshot.disks[i].available;
+                    totalDisk += disk.total;
+                    availableDisk += disk.available;
+                    disks.append(disk);
+                }
+                info.totalDisk = totalDisk;
+                info.availableDisk = availableDisk;
+                info.disks = disks;
+            }
+            if (request.wants("load")) {
+                info.loadAverage = QList<double>() << snapshot.loadAverage[0]
+                                                   << snapshot.loadAverage[1]
+                                                   << snapshot.loadAverage[2];
+            }
+            info.sampledAt = snapshot.sampledAt;
+            
+            response.statusCode = 200;
+            response.setResult(sysResponse);
+            
+            return response;
+        });
+    
+    // 6. 注册运行指标的回调函数
+    // 指标在各线程的分片中记录，读取时合并并计算分位数
+    registry.registerCallback<Models::MetricsRequest>(
+        [cache](int sequence, const Models::MetricsRequest& request) -> Models::Response {
+            Models::Response response;
+            response.sequence = sequence;
+            response.statusCode = 200;
+            Models::MetricsResponse report = TMetrics::instance().report(request.functions);
+            if (cache) {
+                report.cache = cache->stats();
+            }
+            response.setResult(report);
+            return response;
+        });
+    
+    // 7. 注册订阅文件变化的回调函数
+    // 变化由 inotify 推送，按批以数据块帧发送，直到 "unsub" 取消或连接断开，取代反复调用 "ld"/"rf" 轮询
+    registry.registerCallback<Models::SubscribeRequest>(
+        [](int sequence, const Models::SubscribeRequest& request) -> Models::Response {
+            TLOG_DEBUG("sub").field("seq", sequence).field("id", request.id).field("recursive", request.recursive);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            if (request.paths.isEmpty()) {
+                response.statusCode = 400;
+                response.error = "Invalid subscription";
+                response.errorReason = "Paths must not be empty";
+                return response;
+            }
+            
+            // 在回调中占用标识，流打开之前到达的 "unsub" 也能找到它；
+            // 默认标识是本会话的 sequence，其它会话的 sequence 可能相同，按会话区分
+            QString id = request.id.isEmpty() ? QString::number(sequence) : request.id;
+            QString key = request.id.isEmpty()
+                ? TSubscriptionRegistry::sessionKey(TCallbackRegistry::currentSession(), id) : id;
+            QString errorReason;
+            if (!TSubscriptionRegistry::instance().reserve(key, &errorReason)) {
+                response.statusCode = 409;
+                response.error = "Subscription rejected";
+                response.errorReason = errorReason;
+                return response;
+            }
+            
+            response.statusCode = 200;
+            response.stream = std::make_shared<TWatchStreamBody>(
+                id, key, request.paths, request.recursive, request.debounceMs, request.maxBatch);
+            return response;
+        });
+    
+    // 8. 注册取消订阅的回调函数
+    // 订阅流在其会话线程中结束：先发出尚未发送的事件，再发送完成响应
+    registry.registerCallback<Models::UnsubscribeRequest>(
+        [](int sequence, const Models::UnsubscribeRequest& request) -> Models::Response {
+            TLOG_DEBUG("unsub").field("seq", sequence).field("id", request.id);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            // 先找本会话以默认标识发起的订阅，再找显式标识
+            TSubscriptionRegistry& subscriptions = TSubscriptionRegistry::instance();
+            if (!subscriptions.cancel(TSubscriptionRegistry::sessionKey(TCallbackRegistry::currentSession(), request.id))
+                && !subscriptions.cancel(request.id)) {
+                response.statusCode = 404;
+                response.error = "Subscription not found";
+                response.errorReason = QString("No active subscription: %1").arg(request.id);
+                return response;
+            }
+            
+            Models::UnsubscribeResponse unsubResponse;
+            unsubResponse.id = request.id;
+            unsubResponse.message = "Unsubscribed";
+            
+            response.statusCode = 200;
+            response.setResult(unsubResponse);
+            return response;
+        });
+    
+    // 9. 注册批量读取文件的回调函数
+    // 单个文件的上限与 "rf" 改走内存映射的阈值相同，更大的文件报告 413，应改用 "rf"
+    registry.registerCallback<Models::ReadFilesRequest>(
+        [mmapThreshold](int sequence, const Models::ReadFilesRequest& request) -> Models::Response {
+            TLOG_DEBUG("rfs").field("seq", sequence).field("files", request.files.size())
+                .field("content", request.content);
+            
+            Models::Response response;
+            response.sequence = sequence;
+            
+            if (request.files.isEmpty() || request.files.size() > 1024) {
+                response.statusCode = 400;
+                response.error = "Invalid request";
+                response.errorReason = QString("Expected 1 to 1024 files, got %1").arg(request.files.size());
+                return response;
+            }
+            
+            std::vector<TBatchReader::Item> items(request.files.size());
+            for (int i = 0; i < request.files.size(); ++i) {
+                items[i].path = request.files[i].path;
+                items[i].offset = qMax<qint64>(0, request.files[i].offset);
+                items[i].length = request.files[i].length;
+            }
+            
+            TBatchReader::Options options;
+            options.readContent = request.content;
+            options.queueDepth = request.queueDepth;
+            if (mmapThreshold > 0) {
+                options.maxFileBytes = mmapThreshold;
+            }
+            
+            Models::ReadFilesResponse result;
+            TBatchReader::Engine engine = TBatchReader::run(items, options, &result.submissions);
+            result.engine = engine == TBatchReader::Engine::IoUring ? "io_uring" : "threads";
+            
+            for (const TBatchReader::Item& item : items) {
+                Models::ReadFilesResponse::File file;
+                file.path = item.path;
+                if (!item.error.isEmpty()) {
+                    file.status = item.notFound ? 404 : item.isDirectory ? 400 : item.tooLarge ? 413 : 500;
+                    file.error = item.error;
+                }
+                if (item.error.isEmpty() || item.isDirectory || item.tooLarge) {
+                    file.size = item.size;
+                    file.lastModified = QDateTime::fromMSecsSinceEpoch(item.lastModified).toString(Qt::ISODate);
+                }
+                if (item.error.isEmpty() && request.content) {
+                    file.content = QString::fromUtf8(item.data);
+                }
+                result.files.append(file);
+            }
+            
+            response.statusCode = 200;
+            response.setResult(result);
+            return response;
+        });
+}
@@ -0,0 +1,17 @@
+#ifndef HANDLERS_H
+#define HANDLERS_H
+
+#include "TCallbackRegistry.h"
+#include "TSystemSampler.h"
+
+class TPathCache;
+
+// 注册内置回调（rf、wf、ld、ec、gsi、metrics、sub、unsub）及其默认并发限制
+// 供主程序与基准测试共用；内置回调会阻塞在文件 I/O 上，使用它们的会话应设置为 ThreadPool 模式
+// sampler 为 "gsi" 提供指标快照，须在使用该注册表的会话的生命周期内有效
+// mmapThreshold 为 "rf" 使用内存映射读取的文件大小阈值（字节），<= 0 表示禁用
+// cache 非空时 "rf"/"ld" 的非流式结果按路径缓存，由 inotify 失效，须在注册表的生命周期内有效
+void registerDefaultHandlers(TCallbackRegistry& registry, TSystemSampler& sampler,
+                             qint64 mmapThreshold = 16 * 1024 * 1024, TPathCache* cache = nullptr);
+
+#endif // HANDLERS_H
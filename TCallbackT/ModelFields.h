@@ -0,0 +1,704 @@
+#ifndef MODELFIELDS_H
+#define MODELFIELDS_H
+
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include "TJsonReader.h"
+#include "TJsonWriter.h"
+
+namespace Models {
+
+// =================== 编译期字段表 ===================
+//
+// 模型通过静态 constexpr 函数 fields() 声明一次字段：
+//
+//     static constexpr auto fields() {
+//         return std::make_tuple(field("path", &WriteFileRequest::filePath),
+//                                field("append", &WriteFileRequest::append));
+//     }
+//
+// RequestBase / ResponseBase 据此生成直接读写 UTF-8 字节的解析器和序列化器、
+// 经 QCborStreamReader / QCborStreamWriter 直接读写 CBOR 的版本，以及 QJsonObject 版本
+
+// 字段描述：JSON 键名 + 成员指针
+template<typename Class, typename Member>
+struct Field {
+    const char* name;  // nullptr 表示内联字段：成员自身的字段直接展开到外层对象
+    Member Class::* member;
+};
+
+template<typename Class, typename Member>
+constexpr Field<Class, Member> field(const char* name, Member Class::* member) {
+    return Field<Class, Member>{name, member};
+}
+
+template<typename Class, typename Member>
+constexpr Field<Class, Member> inlineField(Member Class::* member) {
+    return Field<Class, Member>{nullptr, member};
+}
+
+// 是否声明了字段表
+template<typename T, typename = void>
+struct HasFields : std::false_type {};
+
+template<typename T>
+struct HasFields<T, std::void_t<decltype(T::fields())>> : std::true_type {};
+
+inline bool isNumberStart(char c) {
+    return c == '-' || (c >= '0' && c <= '9');
+}
+
+// 读取一个 CBOR 文本串（可能分段），完成后 reader 位于下一个元素
+inline bool readCborString(QCborStreamReader& reader, QString* out) {
+    out->clear();
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        out->append(chunk.data);
+        chunk = reader.readString();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+// 读取 CBOR 整数或浮点数（截断），与 JSON 路径一致；超出 qint64 范围或不是数值时返回 false。
+// 无论成功与否 reader 都会移到下一个元素
+inline bool readCborInteger(QCborStreamReader& reader, qint64* out) {
+    bool ok = false;
+    if (reader.isUnsignedInteger()) {
+        quint64 value = reader.toUnsignedInteger();
+        ok = value <= static_cast<quint64>(std::numeric_limits<qint64>::max());
+        *out = ok ? static_cast<qint64>(value) : *out;
+    } else if (reader.isNegativeInteger()) {
+        // QCborNegativeInteger 为绝对值，0 表示 -2^64
+        quint64 magnitude = static_cast<quint64>(reader.toNegativeInteger());
+        constexpr quint64 limit = static_cast<quint64>(std::numeric_limits<qint64>::max()) + 1;
+        ok = magnitude != 0 && magnitude <= limit;
+        *out = !ok ? *out : (magnitude == limit ? std::numeric_limits<qint64>::min()
+                                                : -static_cast<qint64>(magnitude));
+    } else if (reader.isDouble() || reader.isFloat()) {
+        double value = reader.isDouble() ? reader.toDouble() : reader.toFloat();
+        ok = value >= -9.2233720368547758e18 && value < 9.2233720368547758e18;
+        *out = ok ? static_cast<qint64>(value) : *out;
+    }
+    reader.next();
+    return ok;
+}
+
+// =================== 字段值编解码 ===================
+// 类型不匹配时保持成员原值，与 QJsonValue::toXxx(defaultValue) 的行为一致
+
+template<typename T, typename Enable = void>
+struct FieldCodec;
+
+template<>
+struct FieldCodec<QString> {
+    static void read(TJsonReader& reader, QString* out) {
+        if (reader.peek() == '"') {
+            reader.readString(out);
+        } else {
+            reader.skipValue();
+        }
+    }
+    static void write(TJsonWriter& writer, const QString& value) { writer.value(value); }
+    static void fromJson(const QJsonValue& json, QString* out) {
+        if (json.isString()) {
+            *out = json.toString();
+        }
+    }
+    static QJsonValue toJson(const QString& value) { return value; }
+    static void readCbor(QCborStreamReader& reader, QString* out) {
+        if (reader.isString()) {
+            readCborString(reader, out);
+        } else {
+            reader.next();
+        }
+    }
+    static void writeCbor(QCborStreamWriter& writer, const QString& value) { writer.append(value); }
+    static QJsonValue fromQuery(const QJsonValue& text) { return text; }
+};
+
+template<>
+struct FieldCodec<bool> {
+    static void read(TJsonReader& reader, bool* out) {
+        char c = reader.peek();
+        if (c == 't' || c == 'f') {
+            reader.readBool(out);
+        } else {
+            reader.skipValue();
+        }
+    }
+    static void write(TJsonWriter& writer, bool value) { writer.value(value); }
+    static void fromJson(const QJsonValue& json, bool* out) {
+        if (json.isBool()) {
+            *out = json.toBool();
+        }
+    }
+    static QJsonValue toJson(bool value) { return value; }
+    static void readCbor(QCborStreamReader& reader, bool* out) {
+        if (reader.isBool()) {
+            *out = reader.toBool();
+        }
+        reader.next();
+    }
+    static void writeCbor(QCborStreamWriter& writer, bool value) { writer.append(value); }
+    static QJsonValue fromQuery(const QJsonValue& text) {
+        QString value = text.toString();
+        if (value == QLatin1String("true") || value == QLatin1String("1")) {
+            return true;
+        }
+        if (value == QLatin1String("false") || value == QLatin1String("0")) {
+            return false;
+        }
+        return text;
+    }
+};
+
+template<>
+struct FieldCodec<qint64> {
+    static void read(TJsonReader& reader, qint64* out) {
+        if (isNumberStart(reader.peek())) {
+            reader.readInteger(out);
+        } else {
+            reader.skipValue();
+        }
+    }
+    static void write(TJsonWriter& writer, qint64 value) { writer.value(value); }
+    static void fromJson(const QJsonValue& json, qint64* out) {
+        if (json.isDouble()) {
+            *out = static_cast<qint64>(json.toDouble());
+        }
+    }
+    static QJsonValue toJson(qint64 value) { return value; }
+    static void readCbor(QCborStreamReader& reader, qint64* out) { readCborInteger(reader, out); }
+    static void writeCbor(QCborStreamWriter& writer, qint64 value) { writer.append(value); }
+    static QJsonValue fromQuery(const QJsonValue& text) {
+        bool ok = false;
+        qint64 value = text.toString().toLongLong(&ok);
+        return ok ? QJsonValue(static_cast<double>(value)) : text;
+    }
+};
+
+template<>
+struct FieldCodec<int> {
+    static void read(TJsonReader& reader, int* out) {
+        qint64 value = *out;
+        FieldCodec<qint64>::read(reader, &value);
+        *out = static_cast<int>(value);
+    }
+    static void write(TJsonWriter& writer, int value) { writer.value(value); }
+    static void fromJson(const QJsonValue& json, int* out) {
+        if (json.isDouble()) {
+            *out = json.toInt();
+        }
+    }
+    static QJsonValue toJson(int value) { return value; }
+    static void readCbor(QCborStreamReader& reader, int* out) {
+        qint64 value = *out;
+        readCborInteger(reader, &value);
+        *out = static_cast<int>(value);
+    }
+    static void writeCbor(QCborStreamWriter& writer, int value) { writer.append(static_cast<qint64>(value)); }
+    static QJsonValue fromQuery(const QJsonValue& text) { return FieldCodec<qint64>::fromQuery(text); }
+};
+
+template<>
+struct FieldCodec<double> {
+    static void read(TJsonReader& reader, double* out) {
+        if (isNumberStart(reader.peek())) {
+            reader.readDouble(out);
+        } else {
+            reader.skipValue();
+        }
+    }
+    static void write(TJsonWriter& writer, double value) { writer.value(value); }
+    static void fromJson(const QJsonValue& json, double* out) {
+        if (json.isDouble()) {
+            *out = json.toDouble();
+        }
+    }
+    static QJsonValue toJson(double value) { return value; }
+    static void readCbor(QCborStreamReader& reader, double* out) {
+        if (reader.isDouble()) {
+            *out = reader.toDouble();
+        } else if (reader.isFloat()) {
+            *out = reader.toFloat();
+        } else if (reader.isInteger()) {
+            qint64 value = 0;
+            if (readCborInteger(reader, &value)) {
+                *out = static_cast<double>(value);
+            }
+            return;
+        }
+        reader.next();
+    }
+    static void writeCbor(QCborStreamWriter& writer, double value) { writer.append(value); }
+    static QJsonValue fromQuery(const QJsonValue& text) {
+        bool ok = false;
+        double value = text.toString().toDouble(&ok);
+        return ok ? QJsonValue(value) : text;
+    }
+};
+
+template<typename T>
+bool readFields(TJsonReader& reader, T* obj);
+
+template<typename T>
+void writeFields(TJsonWriter& writer, const T& obj);
+
+template<typename T>
+void fromJsonObject(const QJsonObject& json, T* obj);
+
+template<typename T>
+void toJsonObject(const T& obj, QJsonObject* json);
+
+template<typename T>
+bool readPayload(TJsonReader& reader, T* obj);
+
+template<typename T>
+void fromJsonPayload(const QJsonValue& payload, T* obj);
+
+template<typename T>
+bool readCborFields(QCborStreamReader& reader, T* obj);
+
+template<typename T>
+void writeCborFields(QCborStreamWriter& writer, const T& obj);
+
+template<typename T>
+bool readCborPayload(QCborStreamReader& reader, T* obj);
+
+template<typename T>
+void coerceQueryFields(QJsonObject* query);
+
+// 带字段表的嵌套结构，与请求负载相同：非对象的值绑定到第一个字段
+template<typename T>
+struct FieldCodec<T, std::enable_if_t<HasFields<T>::value>> {
+    static void read(TJsonReader& reader, T* out) { readPayload(reader, out); }
+    static void write(TJsonWriter& writer, const T& value) { writeFields(writer, value); }
+    static void fromJson(const QJsonValue& json, T* out) { fromJsonPayload(json, out); }
+    static QJsonValue toJson(const T& value) {
+        QJsonObject obj;
+        toJsonObject(value, &obj);
+        return obj;
+    }
+    static void readCbor(QCborStreamReader& reader, T* out) { readCborPayload(reader, out); }
+    static void writeCbor(QCborStreamWriter& writer, const T& value) { writeCborFields(writer, value); }
+    static QJsonValue fromQuery(const QJsonValue& text) { return text; }
+};
+
+template<typename T>
+struct FieldCodec<QList<T>> {
+    static void read(TJsonReader& reader, QList<T>* out) {
+        if (!reader.consume('[')) {
+            reader.skipValue();
+            return;
+        }
+        out->clear();
+        if (reader.consume(']')) {
+            return;
+        }
+        do {
+            T item{};
+            FieldCodec<T>::read(reader, &item);
+            out->append(item);
+        } while (reader.consume(','));
+        reader.expect(']');
+    }
+    static void write(TJsonWriter& writer, const QList<T>& value) {
+        writer.beginArray();
+        for (const T& item : value) {
+            FieldCodec<T>::write(writer, item);
+        }
+        writer.endArray();
+    }
+    static void fromJson(const QJsonValue& json, QList<T>* out) {
+        if (!json.isArray()) {
+            return;
+        }
+        out->clear();
+        const QJsonArray array = json.toArray();
+        for (const QJsonValue& element : array) {
+            T item{};
+            FieldCodec<T>::fromJson(element, &item);
+            out->append(item);
+        }
+    }
+    static QJsonValue toJson(const QList<T>& value) {
+        QJsonArray array;
+        for (const T& item : value) {
+            array.append(FieldCodec<T>::toJson(item));
+        }
+        return array;
+    }
+    static void readCbor(QCborStreamReader& reader, QList<T>* out) {
+        if (!reader.isArray() || !reader.enterContainer()) {
+            reader.next();
+            return;
+        }
+        out->clear();
+        while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+            T item{};
+            FieldCodec<T>::readCbor(reader, &item);
+            out->append(item);
+        }
+        reader.leaveContainer();
+    }
+    static void writeCbor(QCborStreamWriter& writer, const QList<T>& value) {
+        writer.startArray(static_cast<quint64>(value.size()));
+        for (const T& item : value) {
+            FieldCodec<T>::writeCbor(writer, item);
+        }
+        writer.endArray();
+    }
+    // 重复的键已合并为数组，只出现一次的键包装成单元素数组
+    static QJsonValue fromQuery(const QJsonValue& text) {
+        const QJsonArray values = text.isArray() ? text.toArray() : QJsonArray{text};
+        QJsonArray array;
+        for (const QJsonValue& value : values) {
+            array.append(FieldCodec<T>::fromQuery(value));
+        }
+        return array;
+    }
+};
+
+// 可选字段：为空时序列化会省略该键，读取到该键时构造值
+template<typename T>
+struct FieldCodec<std::optional<T>> {
+    static void read(TJsonReader& reader, std::optional<T>* out) {
+        if (!*out) {
+            out->emplace();
+        }
+        FieldCodec<T>::read(reader, &**out);
+    }
+    static void write(TJsonWriter& writer, const std::optional<T>& value) {
+        if (value) {
+            FieldCodec<T>::write(writer, *value);
+        } else {
+            writer.null();
+        }
+    }
+    static void fromJson(const QJsonValue& json, std::optional<T>* out) {
+        if (!*out) {
+            out->emplace();
+        }
+        FieldCodec<T>::fromJson(json, &**out);
+    }
+    static QJsonValue toJson(const std::optional<T>& value) {
+        return value ? FieldCodec<T>::toJson(*value) : QJsonValue();
+    }
+    static void readCbor(QCborStreamReader& reader, std::optional<T>* out) {
+        if (!*out) {
+            out->emplace();
+        }
+        FieldCodec<T>::readCbor(reader, &**out);
+    }
+    static void writeCbor(QCborStreamWriter& writer, const std::optional<T>& value) {
+        if (value) {
+            FieldCodec<T>::writeCbor(writer, *value);
+        } else {
+            writer.appendNull();
+        }
+    }
+    static QJsonValue fromQuery(const QJsonValue& text) { return FieldCodec<T>::fromQuery(text); }
+};
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+// Qt 5 中 QStringList 是 QList<QString> 的派生类
+template<>
+struct FieldCodec<QStringList> : FieldCodec<QList<QString>> {};
+#endif
+
+// =================== 按字段表读写 ===================
+
+namespace detail {
+
+// 序列化时是否输出该字段（空的可选字段省略）
+template<typename T>
+bool isPresent(const T&) { return true; }
+
+template<typename T>
+bool isPresent(const std::optional<T>& value) { return value.has_value(); }
+
+template<typename T>
+bool readMatchingField(TJsonReader& reader, T* obj, const char* key, int keySize);
+
+template<typename Class, typename Member>
+bool readField(TJsonReader& reader, Class* obj, const Field<Class, Member>& f, const char* key, int keySize) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            return readMatchingField(reader, &(obj->*f.member), key, keySize);
+        }
+        return false;
+    }
+    if (static_cast<int>(std::strlen(f.name)) != keySize || std::memcmp(f.name, key, keySize) != 0) {
+        return false;
+    }
+    FieldCodec<Member>::read(reader, &(obj->*f.member));
+    return true;
+}
+
+template<typename T>
+bool readMatchingField(TJsonReader& reader, T* obj, const char* key, int keySize) {
+    return std::apply([&](const auto&... f) {
+        return (readField(reader, obj, f, key, keySize) || ...);
+    }, T::fields());
+}
+
+template<typename Class, typename Member>
+void writeField(TJsonWriter& writer, const Class& obj, const Field<Class, Member>& f) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            std::apply([&](const auto&... inner) {
+                (writeField(writer, obj.*f.member, inner), ...);
+            }, Member::fields());
+        }
+        return;
+    }
+    if (!isPresent(obj.*f.member)) {
+        return;
+    }
+    writer.key(f.name);
+    FieldCodec<Member>::write(writer, obj.*f.member);
+}
+
+template<typename Class, typename Member>
+void fromJsonField(const QJsonObject& json, Class* obj, const Field<Class, Member>& f) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            fromJsonObject(json, &(obj->*f.member));
+        }
+        return;
+    }
+    QJsonObject::const_iterator it = json.constFind(QLatin1String(f.name));
+    if (it != json.constEnd()) {
+        FieldCodec<Member>::fromJson(it.value(), &(obj->*f.member));
+    }
+}
+
+template<typename Class, typename Member>
+void toJsonField(const Class& obj, QJsonObject* json, const Field<Class, Member>& f) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            toJsonObject(obj.*f.member, json);
+        }
+        return;
+    }
+    if (!isPresent(obj.*f.member)) {
+        return;
+    }
+    json->insert(QLatin1String(f.name), FieldCodec<Member>::toJson(obj.*f.member));
+}
+
+template<typename T>
+bool readMatchingCborField(QCborStreamReader& reader, T* obj, const QString& key);
+
+template<typename Class, typename Member>
+bool readCborField(QCborStreamReader& reader, Class* obj, const Field<Class, Member>& f, const QString& key) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            return readMatchingCborField(reader, &(obj->*f.member), key);
+        }
+        return false;
+    }
+    if (key != QLatin1String(f.name)) {
+        return false;
+    }
+    FieldCodec<Member>::readCbor(reader, &(obj->*f.member));
+    return true;
+}
+
+template<typename T>
+bool readMatchingCborField(QCborStreamReader& reader, T* obj, const QString& key) {
+    return std::apply([&](const auto&... f) {
+        return (readCborField(reader, obj, f, key) || ...);
+    }, T::fields());
+}
+
+// 要写出的键数（CBOR map 头需要预先给出长度）
+template<typename T>
+quint64 countPresentFields(const T& obj);
+
+template<typename Class, typename Member>
+quint64 countPresentField(const Class& obj, const Field<Class, Member>& f) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            return countPresentFields(obj.*f.member);
+        }
+        return 0;
+    }
+    return isPresent(obj.*f.member) ? 1 : 0;
+}
+
+template<typename T>
+quint64 countPresentFields(const T& obj) {
+    return std::apply([&](const auto&... f) {
+        return (quint64(0) + ... + countPresentField(obj, f));
+    }, T::fields());
+}
+
+template<typename Class, typename Member>
+void writeCborField(QCborStreamWriter& writer, const Class& obj, const Field<Class, Member>& f) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            std::apply([&](const auto&... inner) {
+                (writeCborField(writer, obj.*f.member, inner), ...);
+            }, Member::fields());
+        }
+        return;
+    }
+    if (!isPresent(obj.*f.member)) {
+        return;
+    }
+    writer.append(QLatin1String(f.name));
+    FieldCodec<Member>::writeCbor(writer, obj.*f.member);
+}
+
+template<typename Class, typename Member>
+void coerceQueryField(QJsonObject* query, const Field<Class, Member>& f) {
+    if (!f.name) {
+        if constexpr (HasFields<Member>::value) {
+            coerceQueryFields<Member>(query);
+        }
+        return;
+    }
+    QJsonObject::iterator it = query->find(QLatin1String(f.name));
+    if (it != query->end()) {
+        it.value() = FieldCodec<Member>::fromQuery(it.value());
+    }
+}
+
+} // namespace detail
+
+// 从 '{' 开始读取一个对象，未知键跳过
+template<typename T>
+bool readFields(TJsonReader& reader, T* obj) {
+    if (!reader.expect('{')) {
+        return false;
+    }
+    if (reader.consume('}')) {
+        return true;
+    }
+    do {
+        const char* keyBegin = nullptr;
+        const char* keyEnd = nullptr;
+        if (!reader.readKey(&keyBegin, &keyEnd)) {
+            return false;
+        }
+        if (!detail::readMatchingField(reader, obj, keyBegin, static_cast<int>(keyEnd - keyBegin))) {
+            reader.skipValue();
+        }
+    } while (reader.consume(','));
+    return reader.expect('}');
+}
+
+template<typename T>
+void writeFields(TJsonWriter& writer, const T& obj) {
+    writer.beginObject();
+    std::apply([&](const auto&... f) {
+        (detail::writeField(writer, obj, f), ...);
+    }, T::fields());
+    writer.endObject();
+}
+
+template<typename T>
+void fromJsonObject(const QJsonObject& json, T* obj) {
+    std::apply([&](const auto&... f) {
+        (detail::fromJsonField(json, obj, f), ...);
+    }, T::fields());
+}
+
+template<typename T>
+void toJsonObject(const T& obj, QJsonObject* json) {
+    std::apply([&](const auto&... f) {
+        (detail::toJsonField(obj, json, f), ...);
+    }, T::fields());
+}
+
+// HTTP 查询参数的值都是字符串：按字段类型把数值和布尔字段转换为对应的 JSON 值，
+// 其它字段（包括形如数字的路径）保持字符串；转换失败时保留原值，由 fromJson 按类型不匹配处理
+template<typename T>
+void coerceQueryFields(QJsonObject* query) {
+    std::apply([&](const auto&... f) {
+        (detail::coerceQueryField(query, f), ...);
+    }, T::fields());
+}
+
+// 读取请求负载：对象按字段表读取，其它值（如 "rf" 的路径字符串）绑定到第一个字段
+template<typename T>
+bool readPayload(TJsonReader& reader, T* obj) {
+    if (reader.peek() == '{') {
+        return readFields(reader, obj);
+    }
+    const auto first = std::get<0>(T::fields());
+    using Member = std::remove_reference_t<decltype(obj->*first.member)>;
+    FieldCodec<Member>::read(reader, &(obj->*first.member));
+    return !reader.hasError();
+}
+
+template<typename T>
+void fromJsonPayload(const QJsonValue& payload, T* obj) {
+    if (payload.isObject()) {
+        fromJsonObject(payload.toObject(), obj);
+        return;
+    }
+    const auto first = std::get<0>(T::fields());
+    using Member = std::remove_reference_t<decltype(obj->*first.member)>;
+    FieldCodec<Member>::fromJson(payload, &(obj->*first.member));
+}
+
+// 读取一个 CBOR map，未知键和非文本键跳过；完成后 reader 位于 map 之后
+template<typename T>
+bool readCborFields(QCborStreamReader& reader, T* obj) {
+    if (!reader.isMap() || !reader.enterContainer()) {
+        return false;
+    }
+    QString key;
+    while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+        if (!reader.isString()) {
+            reader.next();
+            reader.next();
+            continue;
+        }
+        if (!readCborString(reader, &key)) {
+            return false;
+        }
+        if (!detail::readMatchingCborField(reader, obj, key)) {
+            reader.next();
+        }
+    }
+    return reader.lastError() == QCborError::NoError && reader.leaveContainer();
+}
+
+template<typename T>
+void writeCborFields(QCborStreamWriter& writer, const T& obj) {
+    writer.startMap(detail::countPresentFields(obj));
+    std::apply([&](const auto&... f) {
+        (detail::writeCborField(writer, obj, f), ...);
+    }, T::fields());
+    writer.endMap();
+}
+
+// 与 readPayload 相同：map 按字段表读取，其它值绑定到第一个字段
+template<typename T>
+bool readCborPayload(QCborStreamReader& reader, T* obj) {
+    if (reader.isMap()) {
+        return readCborFields(reader, obj);
+    }
+    const auto first = std::get<0>(T::fields());
+    using Member = std::remove_reference_t<decltype(obj->*first.member)>;
+    FieldCodec<Member>::readCbor(reader, &(obj->*first.member));
+    return reader.lastError() == QCborError::NoError;
+}
+
+} // namespace Models
+
+#endif // MODELFIELDS_H
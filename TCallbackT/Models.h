@@ -1,28 +1,543 @@
 #ifndef MODELS_H
 #define MODELS_H
 
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QCborValue>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonParseError>
 #include <QJsonValue>
 #include <QString>
 #include <QVariant>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "ModelFields.h"
+#include "TJsonReader.h"
+#include "TJsonWriter.h"
+
+class TStreamBody;
 
 namespace Models {
 
+// 线路编码格式
+enum class WireFormat {
+    Json,  // 文本帧，JSON（旧版对端）
+    Cbor   // 二进制帧，CBOR
+};
+
+// 延迟解析的请求负载：JSON 和 CBOR 请求只记录 p 在原始消息中的字节范围，
+// 在 RequestBase::fromPayload 中才真正解析
+class Payload {
+public:
+    Payload() = default;
+    Payload(const QJsonValue& value) : m_value(value) {}
+    
+    // 引用 message 中 [offset, offset + length) 的原始 JSON 字节（共享 message，不拷贝）
+    static Payload fromJsonSpan(const QByteArray& message, int offset, int length) {
+        Payload payload;
+        payload.m_source = message;
+        payload.m_offset = offset;
+        payload.m_length = length;
+        payload.m_hasRaw = true;
+        return payload;
+    }
+    
+    // 引用 message 中一个完整的 CBOR 值
+    static Payload fromCborSpan(const QByteArray& message, int offset, int length) {
+        Payload payload = fromJsonSpan(message, offset, length);
+        payload.m_hasRaw = false;
+        payload.m_hasCbor = true;
+        return payload;
+    }
+    
+    bool hasRawJson() const { return m_hasRaw; }
+    bool hasRawCbor() const { return m_hasCbor; }
+    const char* rawBegin() const { return m_source.constData() + m_offset; }
+    const char* rawEnd() const { return rawBegin() + m_length; }
+    int rawSize() const { return m_length; }
+    
+    // 解析为 QJsonValue，ok 为 false 表示原始字节不是合法 JSON
+    QJsonValue toJsonValue(bool* ok = nullptr) const {
+        if (ok) {
+            *ok = true;
+        }
+        if (m_hasCbor) {
+            // 只有未声明字段表、自行实现 parseFromPayload 的模型才会走到这里
+            QCborParserError parseError;
+            QCborValue value = QCborValue::fromCbor(QByteArray::fromRawData(rawBegin(), m_length), &parseError);
+            if (ok) {
+                *ok = parseError.error == QCborError::NoError;
+            }
+            return value.toJsonValue();
+        }
+        if (!m_hasRaw) {
+            return m_value;
+        }
+        
+        QJsonParseError parseError;
+        QByteArray raw = QByteArray::fromRawData(rawBegin(), m_length);
+        if (raw.startsWith('{') || raw.startsWith('[')) {
+            QJsonDocument doc = QJsonDocument::fromJson(raw, &parseError);
+            if (parseError.error == QJsonParseError::NoError) {
+                return doc.isObject() ? QJsonValue(doc.object()) : QJsonValue(doc.array());
+            }
+        } else {
+            // QJsonDocument 只接受对象或数组，标量包一层数组再解析
+            QByteArray wrapped;
+            wrapped.reserve(m_length + 2);
+            wrapped.append('[').append(raw).append(']');
+            QJsonDocument doc = QJsonDocument::fromJson(wrapped, &parseError);
+            if (parseError.error == QJsonParseError::NoError) {
+                return doc.array().at(0);
+            }
+        }
+        
+        if (ok) {
+            *ok = false;
+        }
+        return QJsonValue();
+    }
+    
+private:
+    QJsonValue m_value{QJsonValue::Undefined};
+    QByteArray m_source;
+    int m_offset = 0;
+    int m_length = 0;
+    bool m_hasRaw = false;
+    bool m_hasCbor = false;
+};
+
+// 函数名：UTF-8 字节内联存储，常见的短函数名不分配堆内存
+class FunctionName {
+public:
+    static constexpr int InlineCapacity = 15;
+    
+    FunctionName() = default;
+    FunctionName(const char* data, int size) { assign(data, size); }
+    FunctionName(const QString& name) {
+        QByteArray utf8 = name.toUtf8();
+        assign(utf8.constData(), utf8.size());
+    }
+    
+    const char* data() const { return m_size <= InlineCapacity ? m_inline : m_heap.constData(); }
+    int size() const { return m_size; }
+    QString toString() const { return QString::fromUtf8(data(), m_size); }
+    
+private:
+    void assign(const char* data, int size) {
+        m_size = size;
+        if (size <= InlineCapacity) {
+            std::memcpy(m_inline, data, size);
+            m_inline[size] = '\0';
+        } else {
+            m_heap = QByteArray(data, size);
+        }
+    }
+    
+    char m_inline[InlineCapacity + 1] = {};
+    int m_size = 0;
+    QByteArray m_heap;
+};
+
 // 通用请求结构
 struct Request {
-    QString functionName;  // n
-    QJsonValue payload;    // p
-    int sequence;          // s
+    FunctionName functionName;  // n
+    Payload payload;       // p
+    int sequence = 0;      // s
+    WireFormat format = WireFormat::Json;  // 请求的编码格式，响应沿用该格式
+    qint64 receivedAt = 0;  // 收到消息的单调时钟时间（纳秒），用于统计排队时间
+    int wireSize = 0;       // 消息字节数（批量帧中按项数均摊）
+    
+    // 批量请求帧中的最大请求数
+    static constexpr int MaxBatchSize = 1024;
     
     static Request fromJson(const QJsonObject& json) {
         Request req;
         req.functionName = json["n"].toString();
         req.payload = json["p"];
         req.sequence = json["s"].toInt();
+        req.format = WireFormat::Json;
         return req;
     }
+    
+    // 直接扫描 UTF-8 字节：只解码 n 和 s，p 保留为原始字节范围
+    static bool fromJsonBytes(const QByteArray& message, Request* out, QString* errorReason) {
+        TJsonReader reader(message);
+        Request req;
+        if (!readJsonObject(reader, message, &req, errorReason)) {
+            return false;
+        }
+        
+        if (!reader.atEnd()) {
+            *errorReason = "JSON 对象之后存在多余数据";
+            return false;
+        }
+        
+        *out = req;
+        return true;
+    }
+    
+    // 批量请求帧：[{...}, {...}]，每一项与单个请求的格式相同
+    static bool fromJsonBatchBytes(const QByteArray& message, std::vector<Request>* out, QString* errorReason) {
+        TJsonReader reader(message);
+        if (!reader.consume('[')) {
+            *errorReason = "消息不是 JSON 数组";
+            return false;
+        }
+        
+        std::vector<Request> requests;
+        if (!reader.consume(']')) {
+            do {
+                if (static_cast<int>(requests.size()) >= MaxBatchSize) {
+                    *errorReason = QString("批量请求超过 %1 项").arg(MaxBatchSize);
+                    return false;
+                }
+                Request req;
+                if (!readJsonObject(reader, message, &req, errorReason)) {
+                    return false;
+                }
+                requests.push_back(std::move(req));
+            } while (reader.consume(','));
+            
+            if (!reader.expect(']')) {
+                *errorReason = reader.errorString();
+                return false;
+            }
+        }
+        
+        if (!reader.atEnd()) {
+            *errorReason = "JSON 数组之后存在多余数据";
+            return false;
+        }
+        
+        *out = std::move(requests);
+        return true;
+    }
+    
+    // 读取一个请求对象，reader 停在对象之后
+    static bool readJsonObject(TJsonReader& reader, const QByteArray& message, Request* req, QString* errorReason) {
+        req->format = WireFormat::Json;
+        
+        if (!reader.consume('{')) {
+            *errorReason = "消息不是 JSON 对象";
+            return false;
+        }
+        
+        if (!reader.consume('}')) {
+            do {
+                const char* keyBegin = nullptr;
+                const char* keyEnd = nullptr;
+                if (!reader.readKey(&keyBegin, &keyEnd)) {
+                    break;
+                }
+                
+                char key = keyEnd - keyBegin == 1 ? *keyBegin : '\0';
+                if (key == 'n' && reader.peek() == '"') {
+                    const char* nameBegin = nullptr;
+                    const char* nameEnd = nullptr;
+                    if (reader.readRawString(&nameBegin, &nameEnd)) {
+                        req->functionName = FunctionName(nameBegin, static_cast<int>(nameEnd - nameBegin));
+                    }
+                } else if (key == 's' && (reader.peek() == '-' || (reader.peek() >= '0' && reader.peek() <= '9'))) {
+                    qint64 sequence = 0;
+                    reader.readInteger(&sequence);
+                    req->sequence = static_cast<int>(sequence);
+                } else if (key == 'p') {
+                    reader.peek();
+                    const char* begin = reader.position();
+                    reader.skipValue();
+                    req->payload = Payload::fromJsonSpan(message, static_cast<int>(begin - message.constData()),
+                                                         static_cast<int>(reader.position() - begin));
+                } else {
+                    reader.skipValue();
+                }
+            } while (reader.consume(','));
+            
+            reader.expect('}');
+        }
+        
+        if (reader.hasError()) {
+            *errorReason = reader.errorString();
+            return false;
+        }
+        return true;
+    }
+    
+    // 直接读取 CBOR 字节：与 JSON 相同，只解码 n 和 s，p 保留为原始字节范围
+    static bool fromCborBytes(const QByteArray& message, Request* out, QString* errorReason) {
+        QCborStreamReader reader(message);
+        Request req;
+        if (!readCborObject(reader, message, &req, errorReason)) {
+            return false;
+        }
+        
+        if (reader.currentOffset() != message.size()) {
+            *errorReason = "CBOR map 之后存在多余数据";
+            return false;
+        }
+        
+        *out = req;
+        return true;
+    }
+    
+    // 批量请求帧：CBOR 数组，每一项与单个请求的格式相同
+    static bool fromCborBatchBytes(const QByteArray& message, std::vector<Request>* out, QString* errorReason) {
+        QCborStreamReader reader(message);
+        if (!reader.isArray() || !reader.enterContainer()) {
+            *errorReason = "消息不是 CBOR 数组";
+            return false;
+        }
+        
+        std::vector<Request> requests;
+        while (reader.hasNext()) {
+            if (static_cast<int>(requests.size()) >= MaxBatchSize) {
+                *errorReason = QString("批量请求超过 %1 项").arg(MaxBatchSize);
+                return false;
+            }
+            Request req;
+            if (!readCborObject(reader, message, &req, errorReason)) {
+                return false;
+            }
+            requests.push_back(std::move(req));
+        }
+        
+        if (!reader.leaveContainer()) {
+            *errorReason = reader.lastError().toString();
+            return false;
+        }
+        if (reader.currentOffset() != message.size()) {
+            *errorReason = "CBOR 数组之后存在多余数据";
+            return false;
+        }
+        
+        *out = std::move(requests);
+        return true;
+    }
+    
+    // 读取一个请求 map，reader 停在 map 之后
+    static bool readCborObject(QCborStreamReader& reader, const QByteArray& message, Request* req, QString* errorReason) {
+        req->format = WireFormat::Cbor;
+        
+        if (!reader.isMap() || !reader.enterContainer()) {
+            *errorReason = "消息不是 CBOR map";
+            return false;
+        }
+        
+        QByteArray storage;
+        while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+            const char* key = nullptr;
+            int keySize = 0;
+            if (!readCborText(reader, message, &storage, &key, &keySize)) {
+                // 非文本键，连同值一起跳过
+                reader.next();
+                reader.next();
+                continue;
+            }
+            
+            char name = keySize == 1 ? *key : '\0';
+            if (name == 'n' && reader.isString()) {
+                const char* begin = nullptr;
+                int size = 0;
+                if (readCborText(reader, message, &storage, &begin, &size)) {
+                    req->functionName = FunctionName(begin, size);
+                }
+            } else if (name == 's') {
+                qint64 sequence = 0;
+                readCborInteger(reader, &sequence);
+                req->sequence = static_cast<int>(sequence);
+            } else if (name == 'p') {
+                qint64 begin = reader.currentOffset();
+                reader.next();
+                req->payload = Payload::fromCborSpan(message, static_cast<int>(begin),
+                                                     static_cast<int>(reader.currentOffset() - begin));
+            } else {
+                reader.next();
+            }
+        }
+        
+        if (reader.lastError() != QCborError::NoError || !reader.leaveContainer()) {
+            *errorReason = reader.lastError().toString();
+            return false;
+        }
+        return true;
+    }
+    
+private:
+    // 读取文本串：定长的直接引用 message 中的 UTF-8 字节，分段的拼接到 storage 中
+    static bool readCborText(QCborStreamReader& reader, const QByteArray& message, QByteArray* storage,
+                             const char** data, int* size) {
+        if (!reader.isString()) {
+            return false;
+        }
+        if (reader.isLengthKnown()) {
+            qint64 length = static_cast<qint64>(reader.length());
+            if (!reader.next()) {
+                return false;
+            }
+            // 文本紧挨在下一个元素之前，不依赖长度前缀的编码方式
+            qint64 end = reader.currentOffset();
+            *data = message.constData() + end - length;
+            *size = static_cast<int>(length);
+            return true;
+        }
+        QString text;
+        if (!readCborString(reader, &text)) {
+            return false;
+        }
+        *storage = text.toUtf8();
+        *data = storage->constData();
+        *size = storage->size();
+        return true;
+    }
+};
+
+template<typename Derived>
+class ResponseBase;
+
+// 按 QJsonValue 的结构写出 CBOR，不先转换为 QCborValue
+inline void writeCborJsonValue(QCborStreamWriter& writer, const QJsonValue& value) {
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        writer.append(value.toBool());
+        break;
+    case QJsonValue::Double: {
+        // 与 QCborValue::fromJsonValue 相同：整数值按 CBOR 整数编码
+        double number = value.toDouble();
+        if (std::floor(number) == number && std::fabs(number) <= 9007199254740992.0) {
+            writer.append(static_cast<qint64>(number));
+        } else {
+            writer.append(number);
+        }
+        break;
+    }
+    case QJsonValue::String:
+        writer.append(value.toString());
+        break;
+    case QJsonValue::Array: {
+        const QJsonArray array = value.toArray();
+        writer.startArray(static_cast<quint64>(array.size()));
+        for (const QJsonValue& element : array) {
+            writeCborJsonValue(writer, element);
+        }
+        writer.endArray();
+        break;
+    }
+    case QJsonValue::Object: {
+        const QJsonObject object = value.toObject();
+        writer.startMap(static_cast<quint64>(object.size()));
+        for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+            writer.append(it.key());
+            writeCborJsonValue(writer, it.value());
+        }
+        writer.endMap();
+        break;
+    }
+    case QJsonValue::Undefined:
+        writer.append(QCborSimpleType::Undefined);
+        break;
+    default:
+        writer.appendNull();
+        break;
+    }
+}
+
+// 把已序列化的 JSON 字节（如缓存的 r）顺序转写为 CBOR，不构建 DOM。
+// 键按原始字节写出，只用于本程序 TJsonWriter 的输出，其键名不含转义
+inline bool transcodeJsonToCbor(TJsonReader& reader, QCborStreamWriter& writer) {
+    switch (reader.peek()) {
+    case '{':
+        reader.consume('{');
+        writer.startMap();
+        if (!reader.consume('}')) {
+            do {
+                const char* keyBegin = nullptr;
+                const char* keyEnd = nullptr;
+                if (!reader.readKey(&keyBegin, &keyEnd)) {
+                    return false;
+                }
+                writer.appendTextString(keyBegin, keyEnd - keyBegin);
+                if (!transcodeJsonToCbor(reader, writer)) {
+                    return false;
+                }
+            } while (reader.consume(','));
+            if (!reader.expect('}')) {
+                return false;
+            }
+        }
+        writer.endMap();
+        return true;
+    case '[':
+        reader.consume('[');
+        writer.startArray();
+        if (!reader.consume(']')) {
+            do {
+                if (!transcodeJsonToCbor(reader, writer)) {
+                    return false;
+                }
+            } while (reader.consume(','));
+            if (!reader.expect(']')) {
+                return false;
+            }
+        }
+        writer.endArray();
+        return true;
+    case '"': {
+        QString text;
+        if (!reader.readString(&text)) {
+            return false;
+        }
+        writer.append(text);
+        return true;
+    }
+    case 't':
+    case 'f': {
+        bool flag = false;
+        if (!reader.readBool(&flag)) {
+            return false;
+        }
+        writer.append(flag);
+        return true;
+    }
+    case 'n':
+        if (!reader.readNull()) {
+            return false;
+        }
+        writer.appendNull();
+        return true;
+    default: {
+        double number = 0;
+        if (!reader.readDouble(&number)) {
+            return false;
+        }
+        writeCborJsonValue(writer, QJsonValue(number));
+        return true;
+    }
+    }
+}
+
+// 类型擦除的结果模型：编码格式在发送时才确定，按字段表直接写出 JSON 或 CBOR
+class ResultModel {
+public:
+    virtual ~ResultModel() = default;
+    virtual void writeJson(TJsonWriter& writer) const = 0;
+    virtual void writeCbor(QCborStreamWriter& writer) const = 0;
+};
+
+template<typename T>
+class ResultModelOf : public ResultModel {
+public:
+    explicit ResultModelOf(const T& model) : m_model(model) {}
+    void writeJson(TJsonWriter& writer) const override { writeFields(writer, m_model); }
+    void writeCbor(QCborStreamWriter& writer) const override { writeCborFields(writer, m_model); }
+    
+private:
+    T m_model;
 };
 
 // 通用响应结构
@@ -33,20 +548,177 @@ struct Response {
     QJsonValue result;          // r
     int sequence = 0;           // s
     
+    // 预先序列化好的 r（JSON 字节，如缓存命中），非空时优先于 resultModel 和 result
+    QByteArray rawResult;
+    
+    // setResult 保存的结果模型，发送时按会话的编码格式直接写出
+    std::shared_ptr<const ResultModel> resultModel;
+    
+    // 流式响应体：非空时先以数据块帧发送内容，再发送完成响应（r 中附带流信息）
+    std::shared_ptr<TStreamBody> stream;
+    
+    // 保存模型副本，发送时按字段表直接序列化为 JSON 或 CBOR，不经过 QJsonObject
+    template<typename T>
+    void setResult(const ResponseBase<T>& model) {
+        resultModel = std::make_shared<ResultModelOf<T>>(static_cast<const T&>(model));
+        rawResult.clear();
+        result = QJsonValue();
+    }
+    
+    // r 的 JSON 字节（供缓存和 HTTP 主体使用）
+    QByteArray resultJsonBytes() const {
+        if (!rawResult.isEmpty()) {
+            return rawResult;
+        }
+        QByteArray out;
+        TJsonWriter writer(&out);
+        if (resultModel) {
+            resultModel->writeJson(writer);
+        } else {
+            writer.value(result);
+        }
+        return out;
+    }
+    
+    // r 的 QJsonValue 形式（rawResult 或 resultModel 非空时需要解析）
+    QJsonValue resultValue() const {
+        if (rawResult.isEmpty() && !resultModel) {
+            return result;
+        }
+        QJsonDocument doc = QJsonDocument::fromJson(resultJsonBytes());
+        return doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+    }
+    
     QJsonObject toJson() const {
         QJsonObject json;
         json["c"] = statusCode;
         json["e"] = error.isEmpty() ? QJsonValue() : QJsonValue(error);
         json["er"] = errorReason.isEmpty() ? QJsonValue() : QJsonValue(errorReason);
-        json["r"] = result;
+        json["r"] = resultValue();
         json["s"] = sequence;
         return json;
     }
+    
+    // 直接写出 JSON 字节，rawResult 原样嵌入
+    QByteArray toJsonBytes() const {
+        QByteArray out;
+        out.reserve(rawResult.size() + 64);
+        TJsonWriter writer(&out);
+        writer.beginObject();
+        writer.key("c");
+        writer.value(statusCode);
+        writer.key("e");
+        if (error.isEmpty()) {
+            writer.null();
+        } else {
+            writer.value(error);
+        }
+        writer.key("er");
+        if (errorReason.isEmpty()) {
+            writer.null();
+        } else {
+            writer.value(errorReason);
+        }
+        writer.key("r");
+        if (!rawResult.isEmpty()) {
+            writer.raw(rawResult);
+        } else if (resultModel) {
+            resultModel->writeJson(writer);
+        } else {
+            writer.value(result);
+        }
+        writer.key("s");
+        writer.value(sequence);
+        writer.endObject();
+        return out;
+    }
+    
+    // 直接写出 CBOR 字节：结果模型按字段表编码，缓存的 JSON 结果顺序转写，都不经过 DOM
+    QByteArray toCborBytes() const {
+        QByteArray out;
+        out.reserve(rawResult.size() + 64);
+        QCborStreamWriter writer(&out);
+        writer.startMap(5);
+        writer.append(QLatin1String("c"));
+        writer.append(static_cast<qint64>(statusCode));
+        writer.append(QLatin1String("e"));
+        if (error.isEmpty()) {
+            writer.appendNull();
+        } else {
+            writer.append(error);
+        }
+        writer.append(QLatin1String("er"));
+        if (errorReason.isEmpty()) {
+            writer.appendNull();
+        } else {
+            writer.append(errorReason);
+        }
+        writer.append(QLatin1String("r"));
+        if (!rawResult.isEmpty()) {
+            TJsonReader reader(rawResult);
+            transcodeJsonToCbor(reader, writer);
+        } else if (resultModel) {
+            resultModel->writeCbor(writer);
+        } else {
+            writeCborJsonValue(writer, result);
+        }
+        writer.append(QLatin1String("s"));
+        writer.append(static_cast<qint64>(sequence));
+        writer.endMap();
+        return out;
+    }
 };
 
+// =================== 二进制数据块帧 ===================
+
+// 流式响应的数据块帧，通过首字节与 CBOR 消息（总是以 map 或数组开头）区分
+// 布局（大端）: [type:u8][channel:u8][reserved:u16][sequence:i32][offset:i64][data...]
+namespace Frame {
+
+constexpr quint8 Chunk = 0x01;
+constexpr int HeaderSize = 16;
+
+// 对端发来的上传数据块帧（"wf" 分块上传），布局与 Chunk 相同，channel 字节为标志，offset 为文件内偏移
+constexpr quint8 Upload = 0x02;
+constexpr quint8 UploadFinal = 0x01;    // 最后一个数据块（未声明总大小时以它结束上传）
+
+inline QByteArray chunkHeader(int sequence, qint64 offset, quint8 channel = 0) {
+    QByteArray header(HeaderSize, '\0');
+    uchar* data = reinterpret_cast<uchar*>(header.data());
+    data[0] = Chunk;
+    data[1] = channel;
+    qToBigEndian<qint32>(sequence, data + 4);
+    qToBigEndian<qint64>(offset, data + 8);
+    return header;
+}
+
+// 批量响应帧：CBOR 数组头（定长），后面直接拼接各个已编码的响应
+inline QByteArray cborArrayHeader(int count) {
+    QByteArray header;
+    if (count < 24) {
+        header.append(static_cast<char>(0x80 | count));
+    } else if (count < 0x100) {
+        header.append(static_cast<char>(0x98));
+        header.append(static_cast<char>(count));
+    } else if (count < 0x10000) {
+        header.resize(3);
+        header[0] = static_cast<char>(0x99);
+        qToBigEndian<quint16>(static_cast<quint16>(count), reinterpret_cast<uchar*>(header.data()) + 1);
+    } else {
+        header.resize(5);
+        header[0] = static_cast<char>(0x9a);
+        qToBigEndian<quint32>(static_cast<quint32>(count), reinterpret_cast<uchar*>(header.data()) + 1);
+    }
+    return header;
+}
+
+} // namespace Frame
+
 // =================== 基础模板类 ===================
 
 // 请求基类模板
+// Derived 通过 fields() 声明字段，即可获得字节级解析和 QJsonValue 解析；
+// 也可以自行提供 parseFromPayload 覆盖
 template<typename Derived, const char* FuncName>
 class RequestBase {
 public:
@@ -55,6 +727,41 @@ public:
     static Derived fromPayload(const QJsonValue& payload) {
         return Derived::parseFromPayload(payload);
     }
+    
+    // 延迟解析的负载在这里才真正解码；有字段表时直接读取原始 JSON 或 CBOR 字节
+    static Derived fromPayload(const Payload& payload) {
+        if constexpr (HasFields<Derived>::value) {
+            if (payload.hasRawJson()) {
+                Derived req;
+                TJsonReader reader(payload.rawBegin(), payload.rawEnd());
+                if (!readPayload(reader, &req)) {
+                    throw std::invalid_argument(reader.errorString().toStdString());
+                }
+                return req;
+            }
+            if (payload.hasRawCbor()) {
+                Derived req;
+                QCborStreamReader reader(payload.rawBegin(), payload.rawSize());
+                if (!readCborPayload(reader, &req)) {
+                    throw std::invalid_argument(reader.lastError().toString().toStdString());
+                }
+                return req;
+            }
+        }
+        
+        bool ok = false;
+        QJsonValue value = payload.toJsonValue(&ok);
+        if (!ok) {
+            throw std::invalid_argument("Malformed payload JSON");
+        }
+        return Derived::parseFromPayload(value);
+    }
+    
+    static Derived parseFromPayload(const QJsonValue& payload) {
+        Derived req;
+        fromJsonPayload(payload, &req);
+        return req;
+    }
 };
 
 // 响应基类模板
@@ -62,7 +769,26 @@ template<typename Derived>
 class ResponseBase {
 public:
     QJsonValue toJsonValue() const {
-        return static_cast<const Derived*>(this)->serialize();
+        return derived().serialize();
+    }
+    
+    // 按字段表直接写出 JSON 字节
+    QByteArray toJsonBytes() const {
+        QByteArray out;
+        TJsonWriter writer(&out);
+        writeFields(writer, derived());
+        return out;
+    }
+    
+    QJsonValue serialize() const {
+        QJsonObject obj;
+        toJsonObject(derived(), &obj);
+        return obj;
+    }
+    
+private:
+    const Derived& derived() const {
+        return *static_cast<const Derived*>(this);
     }
 };
 
@@ -74,106 +800,130 @@ constexpr const char write_file[] = "wf";
 constexpr const char list_directory[] = "ld";
 constexpr const char execute_command[] = "ec";
 constexpr const char get_system_info[] = "gsi";
+constexpr const char get_metrics[] = "metrics";
+constexpr const char subscribe_changes[] = "sub";
+constexpr const char unsubscribe_changes[] = "unsub";
+constexpr const char read_files[] = "rfs";
 
 // 1. 读取文件
 class ReadFileRequest : public RequestBase<ReadFileRequest, READ_file>
 {
 public:
-    QString filePath;
+    QString filePath;       // 负载为字符串时即为路径
+    bool stream = false;    // 以数据块帧流式返回
+    qint64 offset = 0;      // 字节范围起点（仅流式）
+    qint64 length = -1;     // 字节范围长度，-1 表示到文件末尾（仅流式）
+    int chunkSize = 0;      // 块大小，0 使用会话默认值，其余限制在 4 KiB - 4 MiB
     
-    static ReadFileRequest parseFromPayload(const QJsonValue& payload) {
-        ReadFileRequest req;
-        req.filePath = payload.toString();
-        return req;
+    static constexpr auto fields() {
+        return std::make_tuple(field("path", &ReadFileRequest::filePath),
+                               field("stream", &ReadFileRequest::stream),
+                               field("offset", &ReadFileRequest::offset),
+                               field("length", &ReadFileRequest::length),
+                               field("chunkSize", &ReadFileRequest::chunkSize));
     }
 };
 
 class ReadFileResponse : public ResponseBase<ReadFileResponse> {
 public:
     QString content;
+    QString readPath = "text";  // 读取路径："text"，大文件走 "mmap"/"stream" 时由完成响应报告
     
-    QJsonValue serialize() const {
-        QJsonObject obj;
-        obj["content"] = content;
-        return obj;
+    static constexpr auto fields() {
+        return std::make_tuple(field("content", &ReadFileResponse::content),
+                               field("readPath", &ReadFileResponse::readPath));
     }
 };
 
 // 2. 写入文件
+// chunked 时忽略 content，文件内容随后以上传数据块帧（Frame::Upload，sequence 与本请求相同）发来，
+// 直接写入文件的对应偏移；全部写入并按 durability 落盘后以完成响应结束
 class WriteFileRequest : public RequestBase<WriteFileRequest, write_file> {
 public:
     QString filePath;
     QString content;
     bool append = false;
+    bool chunked = false;
+    qint64 size = -1;       // 分块上传的总字节数（数据块不得重叠），-1 表示以带 UploadFinal 标志的数据块结束
+    bool atomic = false;    // 写入同目录的临时文件，完成后 rename 替换，读者看不到写了一半的文件；不能与 append 同用
+    QString durability;     // "none"（默认，只写入页缓存）、"fdatasync"（完成前落盘）、
+                            // "group"（与并发的写入合并落盘，吞吐更高）
     
-    static WriteFileRequest parseFromPayload(const QJsonValue& payload) {
-        WriteFileRequest req;
-        QJsonObject obj = payload.toObject();
-        req.filePath = obj["path"].toString();
-        req.content = obj["content"].toString();
-        req.append = obj["append"].toBool(false);
-        return req;
+    static constexpr auto fields() {
+        return std::make_tuple(field("path", &WriteFileRequest::filePath),
+                               field("content", &WriteFileRequest::content),
+                               field("append", &WriteFileRequest::append),
+                               field("chunked", &WriteFileRequest::chunked),
+                               field("size", &WriteFileRequest::size),
+                               field("atomic", &WriteFileRequest::atomic),
+                               field("durability", &WriteFileRequest::durability));
     }
 };
 
 class WriteFileResponse : public ResponseBase<WriteFileResponse> {
 public:
     QString message;
-    int bytesWritten = 0;
+    qint64 bytesWritten = 0;
+    std::optional<qint64> chunks;   // 分块上传收到的数据块数
     
-    QJsonValue serialize() const {
-        QJsonObject obj;
-        obj["message"] = message;
-        obj["bytesWritten"] = bytesWritten;
-        return obj;
+    static constexpr auto fields() {
+        return std::make_tuple(field("message", &WriteFileResponse::message),
+                               field("bytesWritten", &WriteFileResponse::bytesWritten),
+                               field("chunks", &WriteFileResponse::chunks));
     }
 };
 
 // 3. 列出目录
 class ListDirectoryRequest : public RequestBase<ListDirectoryRequest, list_directory> {
 public:
-    QString directoryPath;
+    QString directoryPath;  // 负载为字符串时即为路径
     bool includeHidden = false;
+    int depth = 0;          // 递归深度：0 只列出该目录，-1 不限
+    QStringList patterns;   // 通配符（如 "*.log"），匹配条目名称；为空时不过滤，不影响递归
+    QStringList requestedFields;  // 需要的字段："type"、"size"、"lastModified"；为空表示全部，未请求的字段不做 stat
+    int pageSize = 0;       // 每页条目数，0 不分页；流式返回时为每个数据块中的条目数
+    QString cursor;         // 上一页响应中的 nextCursor
+    bool stream = false;    // 以数据块帧流式返回，每页一行 JSON 数组
     
-    static ListDirectoryRequest parseFromPayload(const QJsonValue& payload) {
-        ListDirectoryRequest req;
-        if (payload.isString()) {
-            req.directoryPath = payload.toString();
-        } else {
-            QJsonObject obj = payload.toObject();
-            req.directoryPath = obj["path"].toString();
-            req.includeHidden = obj["includeHidden"].toBool(false);
-        }
-        return req;
+    static constexpr auto fields() {
+        return std::make_tuple(field("path", &ListDirectoryRequest::directoryPath),
+                               field("includeHidden", &ListDirectoryRequest::includeHidden),
+                               field("depth", &ListDirectoryRequest::depth),
+                               field("patterns", &ListDirectoryRequest::patterns),
+                               field("fields", &ListDirectoryRequest::requestedFields),
+                               field("pageSize", &ListDirectoryRequest::pageSize),
+                               field("cursor", &ListDirectoryRequest::cursor),
+                               field("stream", &ListDirectoryRequest::stream));
+    }
+    
+    bool wants(const char* name) const {
+        return requestedFields.isEmpty() || requestedFields.contains(QLatin1String(name));
     }
 };
 
 class ListDirectoryResponse : public ResponseBase<ListDirectoryResponse> {
 public:
+    // 未请求的字段为空并省略
     struct FileInfo {
-        QString name;
-        QString type;  // "file" or "directory"
-        qint64 size;
-        QString lastModified;
+        QString name;                       // 相对所列目录的路径，'/' 分隔
+        std::optional<QString> type;        // "file" or "directory"
+        std::optional<qint64> size;
+        std::optional<QString> lastModified;
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("name", &FileInfo::name),
+                                   field("type", &FileInfo::type),
+                                   field("size", &FileInfo::size),
+                                   field("lastModified", &FileInfo::lastModified));
+        }
     };
     
     QList<FileInfo> files;
+    std::optional<QString> nextCursor;      // 还有后续条目时，作为下一页请求的 cursor
     
-    QJsonValue serialize() const {
-        QJsonObject obj;
-        QJsonArray filesArray;
-        
-        for (const auto& file : files) {
-            QJsonObject fileObj;
-            fileObj["name"] = file.name;
-            fileObj["type"] = file.type;
-            fileObj["size"] = file.size;
-            fileObj["lastModified"] = file.lastModified;
-            filesArray.append(fileObj);
-        }
-        
-        obj["files"] = filesArray;
-        return obj;
+    static constexpr auto fields() {
+        return std::make_tuple(field("files", &ListDirectoryResponse::files),
+                               field("nextCursor", &ListDirectoryResponse::nextCursor));
     }
 };
 
@@ -183,94 +933,333 @@ public:
     QString command;
     QStringList arguments;
     QString workingDirectory;
+    int timeoutMs = 0;  // <= 0 使用执行器的默认超时
     
-    static ExecuteCommandRequest parseFromPayload(const QJsonValue& payload) {
-        ExecuteCommandRequest req;
-        QJsonObject obj = payload.toObject();
-        req.command = obj["command"].toString();
-        req.workingDirectory = obj["workingDirectory"].toString();
-        
-        QJsonArray argsArray = obj["arguments"].toArray();
-        for (const auto& arg : argsArray) {
-            req.arguments.append(arg.toString());
-        }
-        
-        return req;
+    static constexpr auto fields() {
+        return std::make_tuple(field("command", &ExecuteCommandRequest::command),
+                               field("arguments", &ExecuteCommandRequest::arguments),
+                               field("workingDirectory", &ExecuteCommandRequest::workingDirectory),
+                               field("timeoutMs", &ExecuteCommandRequest::timeoutMs));
     }
 };
 
-// class ExecuteCommandResponse : public ResponseBase<ExecuteCommandResponse> {
-// public:
-//     QString stdout;
-//     QString stderr;
-//     int exitCode = 0;
-
-//     QJsonValue serialize() const {
-//         QJsonObject obj;
-//         obj["stdout"] = stdout;
-//         obj["stderr"] = stderr;
-//         obj["exitCode"] = exitCode;
-//         return obj;
-//     }
-// };
+// 输出以数据块帧流式发送（通道 0 为 stdout，通道 1 为 stderr），完成响应只携带退出信息
+class ExecuteCommandResponse : public ResponseBase<ExecuteCommandResponse> {
+public:
+    int exitCode = -1;
+    QString exitStatus;
+    bool timedOut = false;
+    qint64 stdoutBytes = 0;
+    qint64 stderrBytes = 0;
+    QString error;
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("exitCode", &ExecuteCommandResponse::exitCode),
+                               field("exitStatus", &ExecuteCommandResponse::exitStatus),
+                               field("timedOut", &ExecuteCommandResponse::timedOut),
+                               field("stdoutBytes", &ExecuteCommandResponse::stdoutBytes),
+                               field("stderrBytes", &ExecuteCommandResponse::stderrBytes),
+                               field("error", &ExecuteCommandResponse::error));
+    }
+};
 
 // 5. 获取系统信息
 class GetSystemInfoRequest : public RequestBase<GetSystemInfoRequest, get_system_info> {
 public:
-    QStringList requestedInfo; // 可以指定需要哪些信息，如 ["os", "cpu", "memory"]
-    
-    static GetSystemInfoRequest parseFromPayload(const QJsonValue& payload) {
-        GetSystemInfoRequest req;
-        if (payload.isArray()) {
-            QJsonArray array = payload.toArray();
-            for (const auto& item : array) {
-                req.requestedInfo.append(item.toString());
-            }
-        } else if (payload.isNull()) {
-            // 如果 payload 为 null，返回所有信息
-            req.requestedInfo = {"os", "cpu", "memory", "disk"};
-        }
-        return req;
+    // 可以指定需要哪些信息："os"、"cpu"、"memory"、"disk"、"load"；为空（或负载为 null）表示全部
+    QStringList requestedInfo;
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("info", &GetSystemInfoRequest::requestedInfo));
+    }
+    
+    bool wants(const char* section) const {
+        return requestedInfo.isEmpty() || requestedInfo.contains(QLatin1String(section));
     }
 };
 
 class GetSystemInfoResponse : public ResponseBase<GetSystemInfoResponse> {
 public:
+    struct DiskInfo {
+        QString mount;
+        qint64 total = 0;
+        qint64 available = 0;
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("mount", &DiskInfo::mount),
+                                   field("total", &DiskInfo::total),
+                                   field("available", &DiskInfo::available));
+        }
+    };
+    
+    // 只输出请求的部分，未请求的字段为空并从 r 中省略
     struct SystemInfo {
-        QString osName;
-        QString osVersion;
-        QString cpuInfo;
-        qint64 totalMemory;
-        qint64 availableMemory;
-        qint64 totalDisk;
-        qint64 availableDisk;
+        std::optional<QString> osName;            // os
+        std::optional<QString> osVersion;         // os
+        std::optional<QString> cpuInfo;           // cpu：架构
+        std::optional<int> cpuCount;              // cpu
+        std::optional<double> cpuUsage;           // cpu：最近一个采样周期的利用率，0~1
+        std::optional<qint64> totalMemory;        // memory
+        std::optional<qint64> availableMemory;    // memory
+        std::optional<qint64> totalDisk;          // disk：各挂载点之和
+        std::optional<qint64> availableDisk;      // disk
+        std::optional<QList<DiskInfo>> disks;     // disk
+        std::optional<QList<double>> loadAverage; // load：1、5、15 分钟
+        std::optional<qint64> sampledAt;          // 采样时间（毫秒时间戳）
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("osName", &SystemInfo::osName),
+                                   field("osVersion", &SystemInfo::osVersion),
+                                   field("cpuInfo", &SystemInfo::cpuInfo),
+                                   field("cpuCount", &SystemInfo::cpuCount),
+                                   field("cpuUsage", &SystemInfo::cpuUsage),
+                                   field("totalMemory", &SystemInfo::totalMemory),
+                                   field("availableMemory", &SystemInfo::availableMemory),
+                                   field("totalDisk", &SystemInfo::totalDisk),
+                                   field("availableDisk", &SystemInfo::availableDisk),
+                                   field("disks", &SystemInfo::disks),
+                                   field("loadAverage", &SystemInfo::loadAverage),
+                                   field("sampledAt", &SystemInfo::sampledAt));
+        }
     } systemInfo;
     
-    QJsonValue serialize() const {
-        QJsonObject obj;
-        obj["osName"] = systemInfo.osName;
-        obj["osVersion"] = systemInfo.osVersion;
-        obj["cpuInfo"] = systemInfo.cpuInfo;
-        obj["totalMemory"] = systemInfo.totalMemory;
-        obj["availableMemory"] = systemInfo.availableMemory;
-        obj["totalDisk"] = systemInfo.totalDisk;
-        obj["availableDisk"] = systemInfo.availableDisk;
-        return obj;
+    // systemInfo 的字段直接展开在 r 中
+    static constexpr auto fields() {
+        return std::make_tuple(inlineField(&GetSystemInfoResponse::systemInfo));
+    }
+};
+
+// 6. 运行指标
+class MetricsRequest : public RequestBase<MetricsRequest, get_metrics> {
+public:
+    QStringList functions;  // 只返回这些函数的指标，为空（或负载为 null）表示全部
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("functions", &MetricsRequest::functions));
+    }
+};
+
+class MetricsResponse : public ResponseBase<MetricsResponse> {
+public:
+    // 延迟分布，单位为微秒
+    struct LatencySummary {
+        qint64 count = 0;
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double p999 = 0.0;
+        double max = 0.0;
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("count", &LatencySummary::count),
+                                   field("mean", &LatencySummary::mean),
+                                   field("p50", &LatencySummary::p50),
+                                   field("p90", &LatencySummary::p90),
+                                   field("p99", &LatencySummary::p99),
+                                   field("p999", &LatencySummary::p999),
+                                   field("max", &LatencySummary::max));
+        }
+    };
+    
+    struct FunctionMetrics {
+        QString name;
+        qint64 requests = 0;
+        qint64 errors = 0;          // 状态码 >= 400 的响应
+        qint64 inFlight = 0;        // 已收到但尚未发送响应的请求
+        qint64 bytesIn = 0;         // 请求消息字节数
+        qint64 bytesOut = 0;        // 响应消息字节数（不含流式数据块）
+        LatencySummary queueWait;   // 收到请求到回调开始执行
+        LatencySummary handler;     // 回调执行
+        LatencySummary send;        // 序列化并写入 socket
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("name", &FunctionMetrics::name),
+                                   field("requests", &FunctionMetrics::requests),
+                                   field("errors", &FunctionMetrics::errors),
+                                   field("inFlight", &FunctionMetrics::inFlight),
+                                   field("bytesIn", &FunctionMetrics::bytesIn),
+                                   field("bytesOut", &FunctionMetrics::bytesOut),
+                                   field("queueWait", &FunctionMetrics::queueWait),
+                                   field("handler", &FunctionMetrics::handler),
+                                   field("send", &FunctionMetrics::send));
+        }
+    };
+    
+    // "ld"/"rf" 结果缓存（TPathCache）
+    struct CacheStats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 invalidations = 0;   // 因文件系统变化移除的条目
+        qint64 evictions = 0;       // 因超出内存预算移除的条目
+        qint64 entries = 0;
+        qint64 bytes = 0;
+        qint64 watches = 0;         // inotify 目录监视数
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("hits", &CacheStats::hits),
+                                   field("misses", &CacheStats::misses),
+                                   field("invalidations", &CacheStats::invalidations),
+                                   field("evictions", &CacheStats::evictions),
+                                   field("entries", &CacheStats::entries),
+                                   field("bytes", &CacheStats::bytes),
+                                   field("watches", &CacheStats::watches));
+        }
+    };
+    
+    QList<FunctionMetrics> functions;
+    qint64 notFound = 0;  // 请求了未注册函数的次数
+    std::optional<CacheStats> cache;  // 未启用缓存时省略
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("functions", &MetricsResponse::functions),
+                               field("notFound", &MetricsResponse::notFound),
+                               field("cache", &MetricsResponse::cache));
+    }
+};
+
+// 7. 订阅文件变化
+class SubscribeRequest : public RequestBase<SubscribeRequest, subscribe_changes> {
+public:
+    QString id;                 // 订阅标识，"unsub" 凭它取消；为空时使用请求的 sequence，只在本会话内有效
+                                // 显式标识在整个服务进程内唯一（不分会话），已被占用时返回 409，多个会话应使用各自的前缀
+    QStringList paths;          // 监视的文件或目录（文件可以尚不存在，只要所在目录存在）
+    bool recursive = false;     // 目录包括所有子目录，之后新建的子目录也会加入监视
+    int debounceMs = 100;       // 事件停止 debounceMs 后发出一批，最长等待 4 倍
+    int maxBatch = 256;         // 一批累计到该事件数时立即发出
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("id", &SubscribeRequest::id),
+                               field("paths", &SubscribeRequest::paths),
+                               field("recursive", &SubscribeRequest::recursive),
+                               field("debounceMs", &SubscribeRequest::debounceMs),
+                               field("maxBatch", &SubscribeRequest::maxBatch));
+    }
+};
+
+// 事件以数据块帧推送，每批是一行 JSON 数组（以 '\n' 结尾），同一路径在一批中合并为一个事件；
+// 订阅取消、被监视的路径全部删除或连接断开时结束，完成响应只携带统计信息
+class SubscribeResponse : public ResponseBase<SubscribeResponse> {
+public:
+    struct Event {
+        QString path;
+        QString type;           // "created"（含 rename 覆盖已有文件）、"deleted"、"modified"、"attrib"，
+                                // "overflow" 表示有事件丢失，path 下的内容需要重新读取
+        bool isDirectory = false;
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("path", &Event::path),
+                                   field("type", &Event::type),
+                                   field("isDirectory", &Event::isDirectory));
+        }
+    };
+    
+    QString id;
+    qint64 events = 0;
+    qint64 batches = 0;
+    qint64 watches = 0;         // 结束时的 inotify 监视数
+    QString reason;             // "unsubscribed" 或 "deleted"
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("id", &SubscribeResponse::id),
+                               field("events", &SubscribeResponse::events),
+                               field("batches", &SubscribeResponse::batches),
+                               field("watches", &SubscribeResponse::watches),
+                               field("reason", &SubscribeResponse::reason));
+    }
+};
+
+// 8. 取消订阅
+class UnsubscribeRequest : public RequestBase<UnsubscribeRequest, unsubscribe_changes> {
+public:
+    QString id;
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("id", &UnsubscribeRequest::id));
+    }
+};
+
+class UnsubscribeResponse : public ResponseBase<UnsubscribeResponse> {
+public:
+    QString id;
+    QString message;
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("id", &UnsubscribeResponse::id),
+                               field("message", &UnsubscribeResponse::message));
+    }
+};
+
+// 9. 批量读取文件
+// 一次请求读取或 stat 多个小文件，各文件的结果（含错误）按请求顺序放在同一个响应中；
+// 大文件仍应使用 "rf"（内存映射或流式返回）。只读取普通文件的内容：FIFO、套接字和设备文件
+// 报告 "Not a regular file" 错误（只 stat 时照常返回），以免一个没有写端的 FIFO 阻塞整个批次
+class ReadFilesRequest : public RequestBase<ReadFilesRequest, read_files> {
+public:
+    struct File {
+        QString path;           // 数组元素为字符串时即为路径
+        qint64 offset = 0;      // 字节范围起点
+        qint64 length = -1;     // 字节范围长度，-1 表示到文件末尾
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("path", &File::path),
+                                   field("offset", &File::offset),
+                                   field("length", &File::length));
+        }
+    };
+    
+    QList<File> files;          // 负载为数组时即为文件列表，最多 1024 个
+    bool content = true;        // false 时只返回大小和修改时间，不打开文件
+    int queueDepth = 32;        // 同时在途的文件数（1 - 128）
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("files", &ReadFilesRequest::files),
+                               field("content", &ReadFilesRequest::content),
+                               field("queueDepth", &ReadFilesRequest::queueDepth));
+    }
+};
+
+class ReadFilesResponse : public ResponseBase<ReadFilesResponse> {
+public:
+    struct File {
+        QString path;
+        int status = 200;                       // 404 不存在，400 是目录，413 超出批量读取的上限，500 其它错误
+        std::optional<QString> error;
+        std::optional<QString> content;         // 按 UTF-8 解码的字节范围
+        std::optional<qint64> size;             // 文件大小
+        std::optional<QString> lastModified;
+        
+        static constexpr auto fields() {
+            return std::make_tuple(field("path", &File::path),
+                                   field("status", &File::status),
+                                   field("error", &File::error),
+                                   field("content", &File::content),
+                                   field("size", &File::size),
+                                   field("lastModified", &File::lastModified));
+        }
+    };
+    
+    QList<File> files;
+    QString engine;             // "io_uring" 或 "threads"（内核不支持或禁用了 io_uring）
+    qint64 submissions = 0;     // io_uring_enter 调用次数
+    
+    static constexpr auto fields() {
+        return std::make_tuple(field("files", &ReadFilesResponse::files),
+                               field("engine", &ReadFilesResponse::engine),
+                               field("submissions", &ReadFilesResponse::submissions));
     }
 };
 
 // =================== 辅助宏（可选使用）===================
 
-// 简化请求类定义的宏
-#define DEFINE_SIMPLE_REQUEST(ClassName, FuncName, PayloadType) \
+// 简化请求类定义的宏：单个字段 data，负载直接绑定到该字段
+#define DEFINE_SIMPLE_REQUEST(ClassName, FuncName, FieldType) \
     constexpr const char ClassName##_func[] = FuncName; \
     class ClassName : public RequestBase<ClassName, ClassName##_func> { \
     public: \
-        PayloadType data; \
-        static ClassName parseFromPayload(const QJsonValue& payload) { \
-            ClassName req; \
-            req.data = payload.to##PayloadType(); \
-            return req; \
+        FieldType data; \
+        static constexpr auto fields() { \
+            return std::make_tuple(field("data", &ClassName::data)); \
         } \
     };
 
@@ -279,10 +1268,8 @@ public:
     class ClassName : public ResponseBase<ClassName> { \
     public: \
         FieldType FieldName; \
-        QJsonValue serialize() const { \
-            QJsonObject obj; \
-            obj[#FieldName] = FieldName; \
-            return obj; \
+        static constexpr auto fields() { \
+            return std::make_tuple(field(#FieldName, &ClassName::FieldName)); \
         } \
     };
 
@@ -0,0 +1,650 @@
+#include "TBatchReader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "TLog.h"
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// 需要 5.6 起的内核头文件（OPENAT/STATX/READ/CLOSE 操作与操作探测）和 glibc 的 struct statx，
+// 不依赖 liburing；运行时仍按探测结果决定是否使用
+#if defined(IO_URING_OP_SUPPORTED) && defined(__NR_io_uring_setup) && defined(STATX_BASIC_STATS)
+#define TBATCH_HAVE_IO_URING 1
+#endif
+
+namespace {
+
+constexpr int MaxQueueDepth = 128;
+
+// 大小为 0 的文件可能是 /proc、/sys 下的伪文件，按该长度读取一次，未用完的部分退回总量
+constexpr qint64 PseudoFileBytes = 64 * 1024;
+
+std::atomic<bool> ioUringEnabled{true};
+
+QString errnoString(int error)
+{
+    return QString::fromLocal8Bit(std::strerror(error));
+}
+
+// 所有条目共用的字节总量，超出单个文件或总量上限的条目不读取
+class Budget
+{
+public:
+    explicit Budget(const TBatchReader::Options& options)
+        : m_maxFile(options.maxFileBytes)
+        , m_maxTotal(options.maxTotalBytes)
+    {
+    }
+
+    bool reserve(qint64 bytes) {
+        if (bytes > m_maxFile) {
+            return false;
+        }
+        if (m_used.fetch_add(bytes) + bytes > m_maxTotal) {
+            m_used.fetch_sub(bytes);
+            return false;
+        }
+        return true;
+    }
+
+    void release(qint64 bytes) { m_used.fetch_sub(bytes); }
+
+private:
+    qint64 m_maxFile;
+    qint64 m_maxTotal;
+    std::atomic<qint64> m_used{0};
+};
+
+// 字节范围在文件中的长度
+qint64 rangeLength(const TBatchReader::Item& item, qint64 size, const TBatchReader::Options& options)
+{
+    if (size == 0) {
+        return item.length >= 0 ? item.length : qMin(PseudoFileBytes, options.maxFileBytes);
+    }
+    qint64 available = qMax<qint64>(0, size - item.offset);
+    return item.length >= 0 ? qMin(item.length, available) : available;
+}
+
+void setErrno(TBatchReader::Item& item, int error)
+{
+    item.error = QString("Cannot read file: %1: %2").arg(item.path, errnoString(error));
+    item.notFound = error == ENOENT || error == ENOTDIR;
+}
+
+void setDirectory(TBatchReader::Item& item)
+{
+    item.isDirectory = true;
+    item.error = QString("Is a directory: %1").arg(item.path);
+}
+
+// FIFO、套接字和设备文件不读取内容：读取可能一直阻塞，拖住整个批次；只 stat 时照常返回
+void setNotRegular(TBatchReader::Item& item)
+{
+    item.error = QString("Not a regular file: %1").arg(item.path);
+}
+
+void setTooLarge(TBatchReader::Item& item, qint64 bytes)
+{
+    item.tooLarge = true;
+    item.error = QString("Reading %1 bytes of %2 exceeds the batch read limit, use rf").arg(bytes).arg(item.path);
+}
+
+// 读取结果比预留的少时退回多余的字节，伪文件的缓冲区按实际长度重新分配
+void finishRead(TBatchReader::Item& item, Budget& budget, qint64 reserved, qint64 bytes)
+{
+    item.data.resize(static_cast<int>(bytes));
+    if (bytes < reserved) {
+        budget.release(reserved - bytes);
+        item.data.squeeze();
+    }
+}
+
+// ---------- 线程池 ----------
+
+// 回退路径共用的线程池：任务阻塞在打开和读取上，线程数多于核心数
+QThreadPool& readPool()
+{
+    static QThreadPool* pool = []() {
+        QThreadPool* p = new QThreadPool();
+        p->setMaxThreadCount(qMax(4, 2 * QThread::idealThreadCount()));
+        return p;
+    }();
+    return *pool;
+}
+
+void readOne(TBatchReader::Item& item, const TBatchReader::Options& options, Budget& budget)
+{
+#ifdef Q_OS_UNIX
+    const QByteArray path = QFile::encodeName(item.path);
+    struct stat info;
+    int fd = -1;
+    if (options.readContent) {
+        // O_NONBLOCK：打开没有写端的 FIFO 时不等待
+        fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd < 0 || ::fstat(fd, &info) != 0) {
+            setErrno(item, errno);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return;
+        }
+    } else if (::stat(path.constData(), &info) != 0) {
+        setErrno(item, errno);
+        return;
+    }
+
+    item.size = info.st_size;
+    item.lastModified = static_cast<qint64>(info.st_mtim.tv_sec) * 1000 + info.st_mtim.tv_nsec / 1000000;
+    if (S_ISDIR(info.st_mode)) {
+        setDirectory(item);
+    } else if (fd >= 0 && !S_ISREG(info.st_mode)) {
+        setNotRegular(item);
+    } else if (fd >= 0) {
+        qint64 want = rangeLength(item, item.size, options);
+        if (!budget.reserve(want)) {
+            setTooLarge(item, want);
+        } else {
+            item.data = QByteArray(static_cast<int>(want), Qt::Uninitialized);
+            qint64 done = 0;
+            while (done < want) {
+                ssize_t n = ::pread(fd, item.data.data() + done, static_cast<size_t>(want - done),
+                                    static_cast<off_t>(item.offset + done));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    setErrno(item, errno);
+                    break;
+                }
+                if (n == 0) {
+                    break;
+                }
+                done += n;
+            }
+            finishRead(item, budget, want, item.error.isEmpty() ? done : 0);
+        }
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#else
+    QFileInfo info(item.path);
+    if (!info.exists()) {
+        item.notFound = true;
+        item.error = QString("Cannot read file: %1").arg(item.path);
+        return;
+    }
+    item.size = info.size();
+    item.lastModified = info.lastModified().toMSecsSinceEpoch();
+    if (info.isDir()) {
+        setDirectory(item);
+        return;
+    }
+    if (!options.readContent) {
+        return;
+    }
+    if (!info.isFile()) {
+        setNotRegular(item);
+        return;
+    }
+    qint64 want = rangeLength(item, item.size, options);
+    if (!budget.reserve(want)) {
+        setTooLarge(item, want);
+        return;
+    }
+    QFile file(item.path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(item.offset)) {
+        item.error = QString("Cannot read file: %1").arg(item.path);
+        budget.release(want);
+        return;
+    }
+    item.data = file.read(want);
+    finishRead(item, budget, want, item.data.size());
+#endif
+}
+
+// 调用线程也参与读取；只借用线程池中空闲的线程，不排队等待，避免被其它批量读取拖住
+void runThreads(std::vector<TBatchReader::Item>& items, const TBatchReader::Options& options, Budget& budget)
+{
+    struct Shared {
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        int running = 0;
+    };
+    Shared shared;
+
+    auto work = [&items, &options, &budget, &shared]() {
+        for (size_t i = shared.next++; i < items.size(); i = shared.next++) {
+            readOne(items[i], options, budget);
+        }
+    };
+
+    int helpers = static_cast<int>(qMin<size_t>(options.queueDepth, items.size())) - 1;
+    for (int i = 0; i < helpers; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            ++shared.running;
+        }
+        bool started = readPool().tryStart([&work, &shared]() {
+            work();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (--shared.running == 0) {
+                shared.done.notify_all();
+            }
+        });
+        if (!started) {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            --shared.running;
+            break;
+        }
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(shared.mutex);
+    shared.done.wait(lock, [&shared]() { return shared.running == 0; });
+}
+
+// ---------- io_uring ----------
+
+#ifdef TBATCH_HAVE_IO_URING
+
+// 一个 io_uring 实例：SQ/CQ 环与 SQE 数组映射到用户空间，直接经系统调用使用
+class Ring
+{
+public:
+    ~Ring() {
+        if (m_sqes != MAP_FAILED) {
+            ::munmap(m_sqes, m_sqesSize);
+        }
+        if (m_cq != MAP_FAILED && m_cq != m_sq) {
+            ::munmap(m_cq, m_cqSize);
+        }
+        if (m_sq != MAP_FAILED) {
+            ::munmap(m_sq, m_sqSize);
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    // 失败时返回 errno；内核缺少需要的操作时返回 EOPNOTSUPP
+    int setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0) {
+            return errno;
+        }
+
+        m_sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            m_sqSize = m_cqSize = qMax(m_sqSize, m_cqSize);
+        }
+        m_sq = ::mmap(nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sq == MAP_FAILED) {
+            return errno;
+        }
+        m_cq = single ? m_sq
+                      : ::mmap(nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cq == MAP_FAILED) {
+            return errno;
+        }
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (m_sqes == MAP_FAILED) {
+            return errno;
+        }
+
+        char* sq = static_cast<char*>(m_sq);
+        m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        m_localTail = *m_sqTail;
+        char* cq = static_cast<char*>(m_cq);
+        m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        m_capacity = params.sq_entries;
+
+        // 探测需要的操作（5.6 起），探测本身不可用说明内核更旧
+        std::vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            return EOPNOTSUPP;
+        }
+        for (int op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return EOPNOTSUPP;
+            }
+        }
+        return 0;
+    }
+
+    // 同时在途的操作数上限，不超过它时完成队列（容量为它的两倍）不会溢出
+    unsigned capacity() const { return m_capacity; }
+
+    // 取一个清零的 SQE，随下一次 submitAndWait 提交
+    io_uring_sqe* nextSqe() {
+        unsigned index = m_localTail & m_sqMask;
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        ++m_localTail;
+        ++m_toSubmit;
+        return sqe;
+    }
+
+    // 提交已准备的 SQE 并等待至少一个完成，失败时返回 -1 并设置 errno
+    int submitAndWait() {
+        __atomic_store_n(m_sqTail, m_localTail, __ATOMIC_RELEASE);
+        int ret = static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, m_toSubmit, 1, IORING_ENTER_GETEVENTS,
+                                             nullptr, 0));
+        if (ret > 0) {
+            m_toSubmit -= static_cast<unsigned>(ret);
+        }
+        return ret;
+    }
+
+    // 取出所有已完成的 CQE
+    template<typename Handler>
+    void reap(Handler handler) {
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+            handler(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int m_fd = -1;
+    void* m_sq = MAP_FAILED;
+    void* m_cq = MAP_FAILED;
+    void* m_sqes = MAP_FAILED;
+    size_t m_sqSize = 0;
+    size_t m_cqSize = 0;
+    size_t m_sqesSize = 0;
+    unsigned* m_sqTail = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_localTail = 0;
+    unsigned m_toSubmit = 0;
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+    unsigned m_capacity = 0;
+};
+
+// 内核不支持或禁用了 io_uring 时记住结果，之后直接走线程池
+std::atomic<bool> ioUringUnsupported{false};
+
+// 每个线程一个环，创建后复用（"rfs" 可能在会话线程或线程池线程中执行）
+thread_local std::unique_ptr<Ring> threadRing;
+
+Ring* ring()
+{
+    if (threadRing || ioUringUnsupported.load()) {
+        return threadRing.get();
+    }
+    std::unique_ptr<Ring> created(new Ring());
+    int error = created->setup(2 * MaxQueueDepth);
+    if (error == 0) {
+        threadRing = std::move(created);
+    } else if (error == ENOSYS || error == EPERM || error == EACCES || error == EOPNOTSUPP) {
+        if (!ioUringUnsupported.exchange(true)) {
+            TLOG_INFO("io_uring_unavailable").field("reason", errnoString(error));
+        }
+    } else {
+        // 如 5.12 之前的内核受 RLIMIT_MEMLOCK 限制：本次改用线程池，之后再尝试创建
+        static std::atomic<bool> warned{false};
+        if (!warned.exchange(true)) {
+            TLOG_WARN("io_uring_setup_failed").field("reason", errnoString(error));
+        }
+    }
+    return threadRing.get();
+}
+
+// 一次批量读取的状态。放弃时内核可能仍在写入其中的缓冲区，因此不释放
+struct RingBatch {
+    enum Op : quint64 {
+        Open,
+        Stat,
+        Read,
+        Close
+    };
+
+    struct Slot {
+        QByteArray path;
+        int fd = -1;
+        int pending = 0;            // 打开和 statx 中尚未完成的个数
+        int openResult = 0;
+        int statResult = 0;
+        qint64 reserved = 0;        // 读取预留的字节数
+        QByteArray buffer;          // 读取完成后移交给条目
+        bool done = false;
+        struct statx info;
+    };
+
+    std::vector<Slot> files;
+    std::deque<size_t> ready;       // 打开和 statx 都已完成、等待提交后续操作的条目
+};
+
+quint64 userData(size_t index, RingBatch::Op op)
+{
+    return (static_cast<quint64>(index) << 2) | op;
+}
+
+bool runRing(Ring& ring, std::vector<TBatchReader::Item>& items, const TBatchReader::Options& options,
+             Budget& budget, qint64* submissions)
+{
+    std::unique_ptr<RingBatch> batch(new RingBatch());
+    batch->files.resize(items.size());
+
+    const unsigned capacity = qMin(ring.capacity(), 2u * static_cast<unsigned>(options.queueDepth));
+    size_t next = 0;
+    size_t finished = 0;
+    unsigned inFlight = 0;
+    int active = 0;
+
+    // 打开和 statx 同时提交，只 stat 时不打开
+    auto start = [&](size_t index) {
+        RingBatch::Slot& slot = batch->files[index];
+        slot.path = QFile::encodeName(items[index].path);
+
+        io_uring_sqe* stat = ring.nextSqe();
+        stat->opcode = IORING_OP_STATX;
+        stat->fd = AT_FDCWD;
+        stat->addr = reinterpret_cast<quint64>(slot.path.constData());
+        stat->len = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+        stat->off = reinterpret_cast<quint64>(&slot.info);
+        stat->user_data = userData(index, RingBatch::Stat);
+        slot.pending = 1;
+
+        if (options.readContent) {
+            io_uring_sqe* open = ring.nextSqe();
+            open->opcode = IORING_OP_OPENAT;
+            open->fd = AT_FDCWD;
+            open->addr = reinterpret_cast<quint64>(slot.path.constData());
+            open->open_flags = O_RDONLY | O_CLOEXEC | O_NONBLOCK;
+            open->user_data = userData(index, RingBatch::Open);
+            slot.pending = 2;
+        }
+        inFlight += slot.pending;
+    };
+
+    auto finish = [&](size_t index) {
+        batch->files[index].done = true;
+        ++finished;
+        --active;
+    };
+
+    // 打开的错误优先：statx 成功而打开失败通常是没有读权限
+    auto proceed = [&](size_t index) {
+        RingBatch::Slot& slot = batch->files[index];
+        TBatchReader::Item& item = items[index];
+        int error = slot.openResult < 0 ? -slot.openResult : (slot.statResult < 0 ? -slot.statResult : 0);
+        if (error != 0) {
+            setErrno(item, error);
+        } else {
+            item.size = static_cast<qint64>(slot.info.stx_size);
+            item.lastModified = static_cast<qint64>(slot.info.stx_mtime.tv_sec) * 1000
+                                + slot.info.stx_mtime.tv_nsec / 1000000;
+            if (S_ISDIR(slot.info.stx_mode)) {
+                setDirectory(item);
+            } else if (slot.fd >= 0 && !S_ISREG(slot.info.stx_mode)) {
+                setNotRegular(item);
+            } else if (slot.fd >= 0) {
+                qint64 want = rangeLength(item, item.size, options);
+                if (!budget.reserve(want)) {
+                    setTooLarge(item, want);
+                } else if (want > 0) {
+                    // 读取与关闭硬链接：读取失败时关闭照常执行
+                    slot.reserved = want;
+                    slot.buffer = QByteArray(static_cast<int>(want), Qt::Uninitialized);
+                    io_uring_sqe* read = ring.nextSqe();
+                    read->opcode = IORING_OP_READ;
+                    read->fd = slot.fd;
+                    read->addr = reinterpret_cast<quint64>(slot.buffer.data());
+                    read->len = static_cast<unsigned>(want);
+                    read->off = static_cast<quint64>(item.offset);
+                    read->flags = IOSQE_IO_HARDLINK;
+                    read->user_data = userData(index, RingBatch::Read);
+                    ++inFlight;
+                }
+            }
+        }
+        if (slot.fd >= 0) {
+            io_uring_sqe* close = ring.nextSqe();
+            close->opcode = IORING_OP_CLOSE;
+            close->fd = slot.fd;
+            close->user_data = userData(index, RingBatch::Close);
+            ++inFlight;
+        } else {
+            finish(index);
+        }
+    };
+
+    auto complete = [&](quint64 data, int result) {
+        --inFlight;
+        size_t index = static_cast<size_t>(data >> 2);
+        RingBatch::Slot& slot = batch->files[index];
+        switch (static_cast<RingBatch::Op>(data & 3)) {
+        case RingBatch::Open:
+            slot.openResult = result;
+            slot.fd = result;
+            if (--slot.pending == 0) {
+                batch->ready.push_back(index);
+            }
+            break;
+        case RingBatch::Stat:
+            slot.statResult = result;
+            if (--slot.pending == 0) {
+                batch->ready.push_back(index);
+            }
+            break;
+        case RingBatch::Read:
+            if (result < 0) {
+                setErrno(items[index], -result);
+            }
+            items[index].data = std::move(slot.buffer);
+            finishRead(items[index], budget, slot.reserved, qMax(0, result));
+            break;
+        case RingBatch::Close:
+            finish(index);
+            break;
+        }
+    };
+
+    while (finished < items.size()) {
+        // 先为已打开的文件提交读取和关闭，尽早释放描述符；每个条目最多同时有两个操作在途
+        while (!batch->ready.empty() && inFlight + 2 <= capacity) {
+            size_t index = batch->ready.front();
+            batch->ready.pop_front();
+            proceed(index);
+        }
+        while (next < items.size() && active < options.queueDepth && inFlight + 2 <= capacity) {
+            ++active;
+            start(next++);
+        }
+        if (inFlight == 0) {
+            continue;
+        }
+
+        int ret = ring.submitAndWait();
+        ++*submissions;
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            int error = errno;
+            TLOG_ERROR("io_uring_enter_failed").field("reason", errnoString(error));
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (!batch->files[i].done) {
+                    items[i].data.clear();
+                    setErrno(items[i], error);
+                }
+            }
+            batch.release();
+            return false;
+        }
+        ring.reap(complete);
+    }
+    return true;
+}
+
+#endif // TBATCH_HAVE_IO_URING
+
+} // namespace
+
+void TBatchReader::setIoUringEnabled(bool enabled)
+{
+    ioUringEnabled = enabled;
+}
+
+TBatchReader::Engine TBatchReader::run(std::vector<Item>& items, const Options& options, qint64* submissions)
+{
+    Options effective = options;
+    effective.queueDepth = qBound(1, options.queueDepth, MaxQueueDepth);
+    Budget budget(effective);
+    *submissions = 0;
+
+#ifdef TBATCH_HAVE_IO_URING
+    if (ioUringEnabled.load()) {
+        if (Ring* uring = ring()) {
+            if (!runRing(*uring, items, effective, budget, submissions)) {
+                threadRing.reset();
+            }
+            return Engine::IoUring;
+        }
+    }
+#endif
+
+    runThreads(items, effective, budget);
+    return Engine::Threads;
+}
@@ -0,0 +1,53 @@
+#ifndef TBATCHREADER_H
+#define TBATCHREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+// 批量读取："rfs" 的实现
+//
+// Linux 上经 io_uring 提交 openat/statx/read/close：每个文件先同时提交打开和 statx，
+// 两者完成后再提交读取并硬链接关闭，同时在途的文件数不超过 queueDepth；
+// 一次 io_uring_enter 既提交新操作也等待完成，几百个文件只需要少量系统调用。
+// 内核不支持、被 kernel.io_uring_disabled 禁用或其它平台上，改为线程池中逐个文件同步读取
+//
+// 文件以 O_NONBLOCK 打开，FIFO、套接字和设备文件不读取内容而是报告错误，不会阻塞整个批次
+class TBatchReader
+{
+public:
+    struct Item {
+        QString path;
+        qint64 offset = 0;
+        qint64 length = -1;         // -1 表示到文件末尾
+
+        // 结果
+        QString error;              // 为空表示成功
+        bool notFound = false;
+        bool isDirectory = false;   // 目录不读取内容，报告为错误
+        bool tooLarge = false;      // 字节范围超出 maxFileBytes，或累计超出 maxTotalBytes
+        qint64 size = 0;
+        qint64 lastModified = 0;    // 毫秒时间戳
+        QByteArray data;
+    };
+
+    struct Options {
+        bool readContent = true;    // false 时只 stat，不打开文件
+        int queueDepth = 32;        // 同时在途的文件数，限制在 1 - 128
+        qint64 maxFileBytes = 16 * 1024 * 1024;
+        qint64 maxTotalBytes = 64 * 1024 * 1024;
+    };
+
+    enum class Engine {
+        IoUring,
+        Threads
+    };
+
+    // 处理全部条目，阻塞直到完成；submissions 为 io_uring_enter 的调用次数
+    static Engine run(std::vector<Item>& items, const Options& options, qint64* submissions);
+
+    // 关闭后总是使用线程池（用于对比或规避内核问题），默认开启
+    static void setIoUringEnabled(bool enabled);
+};
+
+#endif // TBATCHREADER_H
@@ -0,0 +1,131 @@
+#ifndef TCALLBACKREGISTRY_H
+#define TCALLBACKREGISTRY_H
+
+#include <QString>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include "Models.h"
+#include "TDispatchTable.h"
+#include "TMetrics.h"
+
+// 回调注册表：函数名到回调的映射，可由多个会话共享
+// 注册和设置并发限制须在会话开始处理请求之前完成，之后只读，可被多个线程同时查找
+class TCallbackRegistry
+{
+public:
+    // 内部调用入口：按 PayloadType 和回调类型实例化的普通函数指针
+    using Invoker = Models::Response (*)(void* target, int sequence, const Models::Payload& payload);
+
+    // HTTP 查询参数按 PayloadType 的字段类型转换（见 Models::coerceQueryFields）
+    using QueryCoercer = void (*)(QJsonObject* query);
+
+    // 模板回调函数类型定义
+    template<typename PayloadType>
+    using CallbackFunction = std::function<Models::Response(int sequence, const PayloadType& payload)>;
+
+    // 回调注册项
+    struct Entry {
+        Invoker invoke = nullptr;
+        QueryCoercer coerceQuery = nullptr;  // PayloadType 没有字段表时为空，查询参数保持字符串
+        std::shared_ptr<void> target;   // 用户回调对象
+        int maxConcurrency = 0;         // 每个会话中的最大并发数，0 表示不限制
+        int metricsId = -1;             // TMetrics 中的函数编号
+        int index = -1;                 // 注册顺序编号，会话按此编号保存各函数的运行状态
+    };
+
+    // 注册回调函数 - 自动从 PayloadType 获取 functionName
+    // Callback 可以是 lambda 或 CallbackFunction<PayloadType>，按原类型保存并直接调用
+    template<typename PayloadType, typename Callback>
+    void registerCallback(Callback callback);
+
+    // 设置单个函数在每个会话中的最大并发数（<= 0 表示不限制），仅在 ThreadPool 模式下生效
+    void setConcurrencyLimit(const QString& functionName, int limit) {
+        QByteArray name = functionName.toUtf8();
+        entry(name.constData(), name.size()).maxConcurrency = qMax(0, limit);
+    }
+
+    // 直接用 UTF-8 字节查找，未注册时返回 nullptr
+    const Entry* find(const char* name, int size) const {
+        return m_entries.find(name, static_cast<std::size_t>(size));
+    }
+
+    // 已有的条目数（含只设置了并发限制的条目），即 index 的上界
+    int size() const { return static_cast<int>(m_entries.size()); }
+
+    // 当前线程中正在执行的回调所属的会话编号（从 1 开始），不经会话调用（如 HTTP 网关）时为 0
+    // 注册表由多个会话共享，回调需要区分会话时（如订阅的默认标识）使用
+    static quint64 currentSession() { return s_currentSession; }
+
+    // 由会话在调用回调期间设置当前会话编号，离开作用域时恢复
+    class SessionScope {
+    public:
+        explicit SessionScope(quint64 session) : m_previous(s_currentSession) { s_currentSession = session; }
+        ~SessionScope() { s_currentSession = m_previous; }
+        SessionScope(const SessionScope&) = delete;
+        SessionScope& operator=(const SessionScope&) = delete;
+
+    private:
+        quint64 m_previous;
+    };
+
+private:
+    template<typename PayloadType, typename Target>
+    static Models::Response invokeCallback(void* target, int sequence, const Models::Payload& payload);
+
+    // 查找条目，不存在时插入并分配编号
+    Entry& entry(const char* name, std::size_t size) {
+        Entry& result = m_entries.findOrInsert(name, size);
+        if (result.index < 0) {
+            result.index = static_cast<int>(m_entries.size()) - 1;
+        }
+        return result;
+    }
+
+    TDispatchTable<Entry> m_entries;  // 按函数名 UTF-8 字节查找，条目地址稳定
+
+    static inline thread_local quint64 s_currentSession = 0;
+};
+
+// 模板函数实现
+template<typename PayloadType, typename Target>
+Models::Response TCallbackRegistry::invokeCallback(void* target, int sequence, const Models::Payload& payload)
+{
+    try {
+        // 将 JSON payload 转换为具体类型
+        PayloadType typedPayload = PayloadType::fromPayload(payload);
+
+        // 调用用户回调函数
+        return (*static_cast<Target*>(target))(sequence, typedPayload);
+    } catch (const std::exception& e) {
+        // 转换失败，返回错误响应
+        Models::Response errorResponse;
+        errorResponse.statusCode = 400;
+        errorResponse.error = "Payload conversion failed";
+        errorResponse.errorReason = QString::fromStdString(e.what());
+        errorResponse.sequence = sequence;
+        return errorResponse;
+    }
+}
+
+template<typename PayloadType, typename Callback>
+void TCallbackRegistry::registerCallback(Callback callback)
+{
+    using Target = std::decay_t<Callback>;
+
+    // 从 PayloadType 获取 functionName
+    const char* functionName = PayloadType::functionName;
+
+    // 保留之前通过 setConcurrencyLimit 设置的并发限制
+    Entry& registered = entry(functionName, std::strlen(functionName));
+    registered.metricsId = TMetrics::instance().registerFunction(functionName, std::strlen(functionName));
+    registered.target = std::make_shared<Target>(std::move(callback));
+    registered.invoke = &invokeCallback<PayloadType, Target>;
+    if constexpr (Models::HasFields<PayloadType>::value) {
+        registered.coerceQuery = &Models::coerceQueryFields<PayloadType>;
+    }
+}
+
+#endif // TCALLBACKREGISTRY_H
@@ -0,0 +1,245 @@
+#include "TCommandRunner.h"
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include "Models.h"
+
+TCommandRunner& TCommandRunner::instance()
+{
+    static TCommandRunner runner;
+    return runner;
+}
+
+TCommandRunner::TCommandRunner()
+    : m_maxConcurrent(qMax(1, QThread::idealThreadCount()))
+{
+}
+
+void TCommandRunner::setMaxConcurrent(int count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxConcurrent = qMax(1, count);
+    scheduleLocked();
+}
+
+void TCommandRunner::setMaxQueued(int count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxQueued = qMax(0, count);
+}
+
+void TCommandRunner::setDefaultTimeout(int msecs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_defaultTimeout = msecs;
+}
+
+int TCommandRunner::defaultTimeout() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_defaultTimeout;
+}
+
+bool TCommandRunner::enqueue(TProcessStreamBody* body)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (static_cast<int>(m_queue.size()) >= m_maxQueued) {
+        return false;
+    }
+    m_queue.push_back(body);
+    scheduleLocked();
+    return true;
+}
+
+void TCommandRunner::detach(TProcessStreamBody* body)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (body->m_holdsSlot) {
+        body->m_holdsSlot = false;
+        --m_running;
+    } else {
+        auto it = std::find(m_queue.begin(), m_queue.end(), body);
+        if (it != m_queue.end()) {
+            m_queue.erase(it);
+        }
+    }
+    scheduleLocked();
+}
+
+void TCommandRunner::scheduleLocked()
+{
+    while (m_running < m_maxConcurrent && !m_queue.empty()) {
+        TProcessStreamBody* body = m_queue.front();
+        m_queue.pop_front();
+        body->m_holdsSlot = true;
+        ++m_running;
+
+        // 以 QProcess 为上下文投递：流对象先于启动被销毁时，该调用随 QProcess 一起取消
+        QMetaObject::invokeMethod(body->m_process, [body]() {
+            body->start();
+        }, Qt::QueuedConnection);
+    }
+}
+
+TProcessStreamBody::TProcessStreamBody(const QString& command, const QStringList& arguments,
+                                       const QString& workingDirectory, int timeoutMsecs)
+    : m_command(command)
+    , m_arguments(arguments)
+    , m_workingDirectory(workingDirectory)
+    , m_timeout(timeoutMsecs > 0 ? timeoutMsecs : TCommandRunner::instance().defaultTimeout())
+{
+}
+
+TProcessStreamBody::~TProcessStreamBody()
+{
+    if (!m_process) {
+        return;
+    }
+
+    TCommandRunner::instance().detach(this);
+
+    // 断开信号并停止超时定时器，避免在销毁过程中或之后回调本对象
+    QObject::disconnect(m_process, nullptr, nullptr, nullptr);
+    delete m_timeoutTimer;
+    if (m_process->state() == QProcess::NotRunning) {
+        // 尚未启动时一并取消排队中的 start() 调用
+        delete m_process;
+        return;
+    }
+
+    // 不在会话线程上等待子进程退出：强制结束后由 finished 信号异步回收
+    QProcess* process = m_process;
+    QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                     process, &QObject::deleteLater);
+    QObject::connect(process, &QProcess::errorOccurred, process, [process](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            process->deleteLater();
+        }
+    });
+    process->kill();
+}
+
+bool TProcessStreamBody::open(QString* errorReason)
+{
+    // 在 socket 所在线程创建，信号在该线程的事件循环中处理，不阻塞会话
+    m_process = new QProcess();
+    if (!m_workingDirectory.isEmpty()) {
+        m_process->setWorkingDirectory(m_workingDirectory);
+    }
+
+    QObject::connect(m_process, &QProcess::readyReadStandardOutput, m_process, [this]() {
+        notifyReadyRead();
+    });
+    QObject::connect(m_process, &QProcess::readyReadStandardError, m_process, [this]() {
+        notifyReadyRead();
+    });
+    QObject::connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), m_process,
+                     [this](int exitCode, QProcess::ExitStatus exitStatus) {
+                         onFinished(exitCode, exitStatus);
+                     });
+    QObject::connect(m_process, &QProcess::errorOccurred, m_process, [this](QProcess::ProcessError error) {
+        onErrorOccurred(error);
+    });
+
+    if (!TCommandRunner::instance().enqueue(this)) {
+        *errorReason = QString("Command queue is full: %1").arg(m_command);
+        return false;
+    }
+    return true;
+}
+
+void TProcessStreamBody::start()
+{
+    m_process->start(m_command, m_arguments);
+    // 不向子进程提供输入，关闭 stdin 以免读取 stdin 的命令一直阻塞到超时
+    m_process->closeWriteChannel();
+
+    // 超时后强制结束，随后由 finished 信号完成收尾
+    m_timeoutTimer = new QTimer(m_process);
+    m_timeoutTimer->setSingleShot(true);
+    QObject::connect(m_timeoutTimer, &QTimer::timeout, m_process, [this]() {
+        if (m_process->state() != QProcess::NotRunning) {
+            m_timedOut = true;
+            m_process->kill();
+        }
+    });
+    m_timeoutTimer->start(m_timeout);
+}
+
+void TProcessStreamBody::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    m_exitCode = exitCode;
+    m_exitStatus = exitStatus;
+    m_finished = true;
+    TCommandRunner::instance().detach(this);
+    notifyReadyRead();
+}
+
+void TProcessStreamBody::onErrorOccurred(QProcess::ProcessError error)
+{
+    // 其它错误（如崩溃）之后仍会收到 finished 信号
+    if (error != QProcess::FailedToStart) {
+        return;
+    }
+    m_error = m_process->errorString();
+    m_finished = true;
+    TCommandRunner::instance().detach(this);
+    notifyReadyRead();
+}
+
+QByteArray TProcessStreamBody::read(qint64 maxSize)
+{
+    // stdout 与 stderr 轮流读取，避免一方持续输出时另一方饿死
+    for (int i = 1; i <= 2; ++i) {
+        quint8 channel = (m_channel + i) % 2;
+        m_process->setReadChannel(channel == 0 ? QProcess::StandardOutput : QProcess::StandardError);
+        if (m_process->bytesAvailable() <= 0) {
+            continue;
+        }
+
+        QByteArray data = m_process->read(maxSize);
+        m_channel = channel;
+        if (channel == 0) {
+            m_stdoutBytes += data.size();
+        } else {
+            m_stderrBytes += data.size();
+        }
+        return data;
+    }
+    return QByteArray();
+}
+
+bool TProcessStreamBody::atEnd() const
+{
+    if (!m_finished) {
+        return false;
+    }
+    m_process->setReadChannel(QProcess::StandardOutput);
+    if (m_process->bytesAvailable() > 0) {
+        return false;
+    }
+    m_process->setReadChannel(QProcess::StandardError);
+    return m_process->bytesAvailable() <= 0;
+}
+
+QJsonObject TProcessStreamBody::completion() const
+{
+    Models::ExecuteCommandResponse result;
+    result.exitCode = m_exitCode;
+    result.exitStatus = m_exitStatus == QProcess::NormalExit ? "normal" : "crash";
+    result.timedOut = m_timedOut;
+    result.stdoutBytes = m_stdoutBytes;
+    result.stderrBytes = m_stderrBytes;
+    result.error = m_error;
+    return result.toJsonValue().toObject();
+}
+
+quint8 TProcessStreamBody::channel() const
+{
+    return m_channel;
+}
+
+bool TProcessStreamBody::waitingForData() const
+{
+    return !atEnd();
+}
@@ -0,0 +1,94 @@
+#ifndef TCOMMANDRUNNER_H
+#define TCOMMANDRUNNER_H
+
+#include <QProcess>
+#include <QStringList>
+#include <deque>
+#include <mutex>
+#include "TStreamBody.h"
+
+class QTimer;
+
+class TProcessStreamBody;
+
+// 全局命令执行器：限制同时运行的子进程数量，超出的命令排队
+// 可被多个会话线程共享，进程总是在发起请求的会话线程中启动
+class TCommandRunner
+{
+public:
+    static TCommandRunner& instance();
+
+    // 同时运行的最大进程数（默认为 CPU 核心数）
+    void setMaxConcurrent(int count);
+
+    // 最大排队数，超出时拒绝新命令
+    void setMaxQueued(int count);
+
+    // 未指定超时的命令使用的默认超时（毫秒）
+    void setDefaultTimeout(int msecs);
+    int defaultTimeout() const;
+
+    // 申请执行名额，队列已满时返回 false
+    bool enqueue(TProcessStreamBody* body);
+
+    // 从队列中移除，或在进程结束后释放名额
+    void detach(TProcessStreamBody* body);
+
+private:
+    TCommandRunner();
+
+    // 在持有锁时调用：为排队的命令分配空闲名额
+    void scheduleLocked();
+
+    mutable std::mutex m_mutex;
+    std::deque<TProcessStreamBody*> m_queue;
+    int m_running = 0;
+    int m_maxConcurrent;
+    int m_maxQueued = 1024;
+    int m_defaultTimeout = 60000;
+};
+
+// 子进程流：stdout 走通道 0，stderr 走通道 1，输出产生后立即以数据块帧发送
+class TProcessStreamBody : public TStreamBody
+{
+public:
+    // timeoutMsecs <= 0 使用 TCommandRunner 的默认超时
+    TProcessStreamBody(const QString& command, const QStringList& arguments,
+                       const QString& workingDirectory, int timeoutMsecs = 0);
+    ~TProcessStreamBody() override;
+
+    bool open(QString* errorReason) override;
+    QByteArray read(qint64 maxSize) override;
+    bool atEnd() const override;
+    QJsonObject completion() const override;
+    quint8 channel() const override;
+    bool waitingForData() const override;
+    bool needsEventLoop() const override { return true; }
+
+private:
+    friend class TCommandRunner;
+
+    // 由 TCommandRunner 在获得名额后投递到会话线程执行
+    void start();
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onErrorOccurred(QProcess::ProcessError error);
+
+    QString m_command;
+    QStringList m_arguments;
+    QString m_workingDirectory;
+    int m_timeout;
+
+    QProcess* m_process = nullptr;  // 在 open() 中创建，归属会话线程
+    QTimer* m_timeoutTimer = nullptr;  // m_process 的子对象，在 start() 中创建
+    bool m_holdsSlot = false;       // 由 TCommandRunner 在锁内维护
+    bool m_finished = false;
+    bool m_timedOut = false;
+    int m_exitCode = -1;
+    QProcess::ExitStatus m_exitStatus = QProcess::NormalExit;
+    QString m_error;
+    quint8 m_channel = 0;
+    qint64 m_stdoutBytes = 0;
+    qint64 m_stderrBytes = 0;
+};
+
+#endif // TCOMMANDRUNNER_H
@@ -1,106 +1,1013 @@
 #include "TCoreSession.h"
-#include <QDebug>
-#include <QJsonParseError>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include "TJsonReader.h"
+#include "TLog.h"
+
+namespace {
+
+quint64 nextSessionId()
+{
+    static std::atomic<quint64> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
 
 TCoreSession::TCoreSession(QObject *parent)
+    : TCoreSession(std::make_shared<TCallbackRegistry>(), parent)
+{
+}
+
+TCoreSession::TCoreSession(std::shared_ptr<TCallbackRegistry> registry, QObject *parent)
     : QObject(parent)
-    , m_webSocket(new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this))
+    , m_threadPool(new QThreadPool(this))
+    , m_registry(std::move(registry))
+    , m_sessionId(nextSessionId())
+    , m_batchTimer(new QTimer(this))
+    , m_reconnectTimer(new QTimer(this))
 {
-    connect(m_webSocket, &QWebSocket::connected, this, &TCoreSession::onConnected);
-    connect(m_webSocket, &QWebSocket::disconnected, this, &TCoreSession::onDisconnected);
-    connect(m_webSocket, &QWebSocket::textMessageReceived, this, &TCoreSession::onTextMessageReceived);
-    connect(m_webSocket, QOverload<QAbstractSocket::SocketError>::of(&QWebSocket::error),
-            this, &TCoreSession::onError);
+    m_batchTimer->setSingleShot(true);
+    connect(m_batchTimer, &QTimer::timeout, this, [this]() {
+        flushBatch();
+        flushOutbound();
+        updateIntake();
+    });
+    
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, [this]() {
+        TLOG_INFO("reconnecting").field("url", m_url).field("attempt", m_reconnectAttempt);
+        m_transport->open(m_url);
+    });
 }
 
 TCoreSession::~TCoreSession()
 {
-    if (m_webSocket->state() == QAbstractSocket::ConnectedState) {
-        m_webSocket->close();
+    m_closing = true;
+    
+    // 等待线程池中的回调全部结束，避免其访问已析构的会话
+    m_threadPool->waitForDone();
+    
+    if (m_transport) {
+        m_transport->close();
     }
 }
 
+TCallbackRegistry& TCoreSession::registry()
+{
+    return *m_registry;
+}
+
 void TCoreSession::connectToServer(const QString& url)
 {
-    qDebug() << "正在连接到服务器:" << url;
-    m_webSocket->open(QUrl(url));
+    TLOG_INFO("connecting").field("url", url);
+    m_url = url;
+    m_closing = false;
+    m_reconnectAttempt = 0;
+    m_reconnectTimer->stop();
+    prepareTransport(url);
+    m_transport->open(url);
+}
+
+void TCoreSession::prepareTransport(const QString& url)
+{
+    if (m_transport && m_transport->supports(url)) {
+        return;
+    }
+    if (m_transport) {
+        m_transport->disconnect(this);
+        m_transport->close();
+        m_transport->deleteLater();
+    }
+    
+    m_transport = TTransport::create(url, this);
+    connect(m_transport, &TTransport::connected, this, &TCoreSession::onConnected);
+    connect(m_transport, &TTransport::disconnected, this, &TCoreSession::onDisconnected);
+    connect(m_transport, &TTransport::messageReceived, this, &TCoreSession::onMessageReceived);
+    connect(m_transport, &TTransport::bytesWritten, this, &TCoreSession::onBytesWritten);
+    connect(m_transport, &TTransport::errorOccurred, this, &TCoreSession::onError);
 }
 
 void TCoreSession::disconnect()
 {
-    if (m_webSocket->state() == QAbstractSocket::ConnectedState) {
-        m_webSocket->close();
+    m_closing = true;
+    m_reconnectTimer->stop();
+    
+    if (m_transport) {
+        m_transport->close();
+    }
+}
+
+void TCoreSession::setExecutionMode(ExecutionMode mode)
+{
+    m_executionMode = mode;
+}
+
+TCoreSession::ExecutionMode TCoreSession::executionMode() const
+{
+    return m_executionMode;
+}
+
+void TCoreSession::setMaxThreadCount(int count)
+{
+    m_threadPool->setMaxThreadCount(count);
+}
+
+void TCoreSession::setConcurrencyLimit(const QString& functionName, int limit)
+{
+    m_registry->setConcurrencyLimit(functionName, limit);
+}
+
+void TCoreSession::setStreamChunkSize(int size)
+{
+    m_streamChunkSize = qMax(1, size);
+}
+
+void TCoreSession::setStreamHighWatermark(qint64 bytes)
+{
+    m_streamHighWatermark = qMax<qint64>(1, bytes);
+}
+
+void TCoreSession::setSendWatermarks(qint64 high, qint64 low)
+{
+    m_sendHighWatermark = qMax<qint64>(1, high);
+    m_sendLowWatermark = qBound<qint64>(0, low, m_sendHighWatermark);
+}
+
+void TCoreSession::setMaxDeferredRequests(int count)
+{
+    m_maxDeferredRequests = qMax(0, count);
+}
+
+void TCoreSession::setResponseBatching(int maxBytes, int maxDelayMs)
+{
+    flushBatch();
+    flushOutbound();
+    m_batchMaxBytes = qMax(0, maxBytes);
+    m_batchMaxDelay = qMax(0, maxDelayMs);
+}
+
+void TCoreSession::setReconnectPolicy(bool enabled, int initialDelayMs, int maxDelayMs)
+{
+    m_reconnectEnabled = enabled;
+    m_reconnectInitialDelay = qMax(1, initialDelayMs);
+    m_reconnectMaxDelay = qMax(m_reconnectInitialDelay, maxDelayMs);
+    if (!enabled) {
+        m_reconnectTimer->stop();
     }
 }
 
+void TCoreSession::setReplayLimits(qint64 maxBytes, int maxFrames)
+{
+    m_replayMaxBytes = qMax<qint64>(0, maxBytes);
+    m_replayMaxFrames = qMax(0, maxFrames);
+}
+
+Models::WireFormat TCoreSession::peerWireFormat() const
+{
+    return m_peerFormat;
+}
+
 void TCoreSession::onConnected()
 {
-    qDebug() << "已连接到 PaaSServer";
+    // 新连接默认按旧协议（JSON）处理，直到对端发来 CBOR
+    m_peerFormat = Models::WireFormat::Json;
+    m_reconnectAttempt = 0;
+    TLOG_INFO("connected").field("replay", m_replay.size()).field("replay_bytes", m_replayBytes);
+    
+    // 先发送断线期间保存的响应，再恢复处理暂存的请求
+    while (!m_replay.empty()) {
+        pushOutbound(m_replay.front());
+        m_replay.pop_front();
+    }
+    m_replayBytes = 0;
+    flushOutbound();
+    updateIntake();
 }
 
 void TCoreSession::onDisconnected()
 {
-    qDebug() << "已断开与 PaaSServer 的连接";
+    TLOG_INFO("disconnected").field("queued", m_outbound.size()).field("streams", m_streams.size() + m_waitingStreams.size());
+    
+    bool reconnect = m_reconnectEnabled && !m_closing;
+    
+    // 未写出的响应转入重放缓冲区（pushOutbound 在断线状态下会这样处理）
+    flushBatch();
+    std::deque<OutboundFrame> outbound;
+    outbound.swap(m_outbound);
+    m_outboundBytes = 0;
+    for (const OutboundFrame& frame : outbound) {
+        pushOutbound(frame);
+    }
+    
+    // 流式响应无法续传，告知对端从已收到的偏移处重新请求
+    std::vector<ActiveStream> streams(m_streams.begin(), m_streams.end());
+    streams.insert(streams.end(), m_waitingStreams.begin(), m_waitingStreams.end());
+    m_streams.clear();
+    m_waitingStreams.clear();
+    m_earlyUploads.clear();
+    m_earlyUploadBytes = 0;
+    for (const ActiveStream& stream : streams) {
+        Models::Response response;
+        response.statusCode = 503;
+        response.error = "Stream interrupted";
+        response.errorReason = QString("Connection lost after %1 bytes").arg(stream.bytesSent);
+        response.sequence = stream.sequence;
+        sendResponse(response, stream.format);
+    }
+    
+    if (!reconnect) {
+        // 不再重连：丢弃所有待发送内容和暂存的请求
+        m_replay.clear();
+        m_replayBytes = 0;
+        m_deferredRequests.clear();
+        m_intakePaused = false;
+        return;
+    }
+    
+    scheduleReconnect();
 }
 
-void TCoreSession::onTextMessageReceived(const QString& message)
+void TCoreSession::scheduleReconnect()
 {
-    qDebug() << "收到消息:" << message;
+    if (!m_reconnectEnabled || m_closing || m_url.isEmpty() || m_reconnectTimer->isActive()) {
+        return;
+    }
     
-    // 解析 JSON 消息
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8(), &parseError);
+    // 指数退避，随机抖动避免大量会话同时重连
+    qint64 delay = qMin<qint64>(static_cast<qint64>(m_reconnectInitialDelay) << qMin(m_reconnectAttempt, 20),
+                                m_reconnectMaxDelay);
+    int wait = static_cast<int>(delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1));
+    ++m_reconnectAttempt;
     
-    if (parseError.error != QJsonParseError::NoError) {
-        qWarning() << "JSON 解析错误:" << parseError.errorString();
-        return;
+    TLOG_INFO("reconnect_scheduled").field("attempt", m_reconnectAttempt).field("delay_ms", wait);
+    m_reconnectTimer->start(wait);
+}
+
+void TCoreSession::onMessageReceived(const QByteArray& message, bool binary)
+{
+    if (binary) {
+        onBinaryMessageReceived(message);
+    } else {
+        onTextMessageReceived(message);
     }
+}
+
+void TCoreSession::onTextMessageReceived(const QByteArray& utf8)
+{
+    qint64 receivedAt = TMetrics::now();
     
-    if (!doc.isObject()) {
-        qWarning() << "消息不是 JSON 对象";
+    // 只扫描信封中的 n 和 s，p 在回调转换负载时才解析
+    TLOG_DEBUG("recv").payload(utf8);
+    
+    // 数组为批量请求帧
+    if (TJsonReader(utf8).peek() == '[') {
+        std::vector<Models::Request> requests;
+        QString errorReason;
+        if (!Models::Request::fromJsonBatchBytes(utf8, &requests, &errorReason)) {
+            TLOG_WARN("json_parse_error").field("reason", errorReason).payload(utf8);
+            return;
+        }
+        for (Models::Request& request : requests) {
+            request.receivedAt = receivedAt;
+            request.wireSize = utf8.size() / static_cast<int>(requests.size());
+        }
+        acceptBatch(requests, Models::WireFormat::Json);
         return;
     }
     
-    // 转换为请求模型
-    Models::Request request = Models::Request::fromJson(doc.object());
+    Models::Request request;
+    QString errorReason;
+    if (!Models::Request::fromJsonBytes(utf8, &request, &errorReason)) {
+        TLOG_WARN("json_parse_error").field("reason", errorReason).payload(utf8);
+        return;
+    }
+    request.receivedAt = receivedAt;
+    request.wireSize = utf8.size();
     
     // 处理请求
-    handleRequest(request);
+    acceptRequest(request);
+}
+
+void TCoreSession::onBinaryMessageReceived(const QByteArray& message)
+{
+    // 上传数据块帧以类型字节开头，CBOR 消息总是以 map 或数组开头，不会混淆
+    if (!message.isEmpty() && static_cast<quint8>(message.at(0)) == Models::Frame::Upload) {
+        onUploadChunk(message);
+        return;
+    }
+    
+    qint64 receivedAt = TMetrics::now();
+    TLOG_DEBUG("recv_cbor").field("bytes", message.size());
+    
+    if (message.isEmpty()) {
+        TLOG_WARN("cbor_parse_error").field("reason", "empty message");
+        return;
+    }
+    
+    // 与 JSON 相同只扫描信封中的 n 和 s，p 在回调转换负载时才按字段表读取。
+    // 首字节的主类型 4 为数组，即批量请求帧，每一项都必须是 map
+    if ((static_cast<quint8>(message.at(0)) >> 5) == 4) {
+        std::vector<Models::Request> requests;
+        QString errorReason;
+        if (!Models::Request::fromCborBatchBytes(message, &requests, &errorReason)) {
+            TLOG_WARN("cbor_parse_error").field("reason", errorReason).field("bytes", message.size());
+            return;
+        }
+        for (Models::Request& request : requests) {
+            request.receivedAt = receivedAt;
+            request.wireSize = message.size() / static_cast<int>(requests.size());
+        }
+        
+        m_peerFormat = Models::WireFormat::Cbor;
+        acceptBatch(requests, Models::WireFormat::Cbor);
+        return;
+    }
+    
+    Models::Request request;
+    QString errorReason;
+    if (!Models::Request::fromCborBytes(message, &request, &errorReason)) {
+        TLOG_WARN("cbor_parse_error").field("reason", errorReason).field("bytes", message.size());
+        return;
+    }
+    
+    // 对端发送了 CBOR，说明其支持二进制协议
+    m_peerFormat = Models::WireFormat::Cbor;
+    
+    request.receivedAt = receivedAt;
+    request.wireSize = message.size();
+    
+    acceptRequest(request);
 }
 
-void TCoreSession::onError(QAbstractSocket::SocketError error)
+void TCoreSession::onError()
 {
-    qWarning() << "WebSocket 错误:" << m_webSocket->errorString();
+    TLOG_ERROR("socket_error").field("reason", m_transport->errorString());
+    
+    // 连接失败时可能不会触发 disconnected
+    if (m_transport->state() == TTransport::State::Unconnected) {
+        scheduleReconnect();
+    }
 }
 
-void TCoreSession::sendResponse(const Models::Response& response)
+void TCoreSession::onBytesWritten(qint64 bytes)
 {
-    QJsonDocument doc(response.toJson());
-    QString jsonString = doc.toJson(QJsonDocument::Compact);
+    Q_UNUSED(bytes);
     
-    qDebug() << "发送响应:" << jsonString;
-    m_webSocket->sendTextMessage(jsonString);
+    // 写缓冲区有空间了，先发出排队的消息，再继续发送流数据
+    flushOutbound();
+    updateIntake();
+    
+    if (!m_streams.empty()) {
+        pumpStreams();
+    }
 }
 
-void TCoreSession::handleRequest(const Models::Request& request)
+void TCoreSession::acceptRequest(const Models::Request& request, const BatchSlot& slot)
 {
-    auto it = m_callbacks.find(request.functionName);
+    // 对端跟不上时不再执行回调，避免继续产生待发送的响应
+    if (m_intakePaused) {
+        if (static_cast<int>(m_deferredRequests.size()) >= m_maxDeferredRequests) {
+            // 暂存的请求已达上限，直接拒绝，对端稍后重试
+            Models::Response response;
+            response.statusCode = 503;
+            response.error = "Session overloaded";
+            response.errorReason = QString("%1 requests are already waiting for the peer to read responses").arg(static_cast<qint64>(m_deferredRequests.size()));
+            response.sequence = request.sequence;
+            sendResponse(response, request.format, slot);
+            return;
+        }
+        m_deferredRequests.push_back(QueuedRequest{request, slot});
+        return;
+    }
+    
+    handleRequest(request, slot);
+}
+
+void TCoreSession::acceptBatch(std::vector<Models::Request>& requests, Models::WireFormat format)
+{
+    if (requests.empty()) {
+        TLOG_DEBUG("recv_empty_batch");
+        return;
+    }
+    
+    auto batch = std::make_shared<ResponseBatch>();
+    batch->format = format;
+    batch->items.resize(requests.size());
+    batch->remaining = static_cast<int>(requests.size());
     
-    if (it == m_callbacks.end()) {
+    // Inline 模式下逐项执行，ThreadPool 模式下各项并行执行
+    for (int i = 0; i < static_cast<int>(requests.size()); ++i) {
+        acceptRequest(requests[i], BatchSlot{batch, i});
+    }
+}
+
+void TCoreSession::completeBatchItem(const BatchSlot& slot, const QByteArray& encoded)
+{
+    ResponseBatch& batch = *slot.batch;
+    batch.items[slot.index] = encoded;
+    if (--batch.remaining > 0) {
+        return;
+    }
+    
+    bool binary = batch.format == Models::WireFormat::Cbor;
+    int count = 0;
+    int size = 2;
+    for (const QByteArray& item : batch.items) {
+        if (!item.isEmpty()) {
+            ++count;
+            size += item.size() + 1;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+    
+    QByteArray frame;
+    frame.reserve(size + 8);
+    frame.append(binary ? Models::Frame::cborArrayHeader(count) : QByteArray("["));
+    bool first = true;
+    for (const QByteArray& item : batch.items) {
+        if (item.isEmpty()) {
+            continue;
+        }
+        if (!binary && !first) {
+            frame.append(',');
+        }
+        frame.append(item);
+        first = false;
+    }
+    if (!binary) {
+        frame.append(']');
+    }
+    
+    // 每一项都在上限以内（见 encodeResponse），合起来超出时逐个发送，各响应自带序号
+    if (frame.size() > m_transport->maxMessageSize()) {
+        TLOG_DEBUG("send_batch_response_split").field("count", count).field("bytes", frame.size());
+        for (const QByteArray& item : batch.items) {
+            if (!item.isEmpty()) {
+                enqueueFrame(OutboundFrame{item, binary, true});
+            }
+        }
+        batch.items.clear();
+        return;
+    }
+    
+    TLOG_DEBUG("send_batch_response").field("count", count).field("bytes", frame.size());
+    batch.items.clear();
+    enqueueFrame(OutboundFrame{frame, binary, true});
+}
+
+void TCoreSession::updateIntake()
+{
+    // 断线期间保持暂停，重连后再处理暂存的请求
+    if (!isConnected()) {
+        return;
+    }
+    
+    qint64 pending = pendingOutboundBytes();
+    
+    if (!m_intakePaused) {
+        if (pending > m_sendHighWatermark) {
+            m_intakePaused = true;
+            TLOG_WARN("intake_paused").field("pending", pending);
+        }
+        return;
+    }
+    
+    if (pending > m_sendLowWatermark) {
+        return;
+    }
+    
+    m_intakePaused = false;
+    TLOG_INFO("intake_resumed").field("pending", pending).field("deferred", m_deferredRequests.size());
+    
+    // 处理暂存的请求，期间可能再次越过高水位
+    while (!m_intakePaused && !m_deferredRequests.empty()) {
+        QueuedRequest next = m_deferredRequests.front();
+        m_deferredRequests.pop_front();
+        handleRequest(next.request, next.slot);
+    }
+}
+
+qint64 TCoreSession::pendingOutboundBytes() const
+{
+    if (!m_transport) {
+        return m_outboundBytes + m_batch.size();
+    }
+    return m_outboundBytes + m_batch.size() + m_transport->bytesToWrite() + m_transport->sharedBytesInFlight();
+}
+
+void TCoreSession::enqueueFrame(const OutboundFrame& frame)
+{
+    flushBatch();
+    pushOutbound(frame);
+    
+    flushOutbound();
+    updateIntake();
+}
+
+void TCoreSession::pushOutbound(const OutboundFrame& frame)
+{
+    if (isConnected()) {
+        m_outbound.push_back(frame);
+        m_outboundBytes += frame.data.size();
+        return;
+    }
+    
+    // 断线期间：等待重连时保留响应，数据块帧和主动断开后的响应丢弃
+    if (frame.replayable && m_reconnectEnabled && !m_closing) {
+        appendReplay(frame);
+    }
+}
+
+void TCoreSession::appendReplay(const OutboundFrame& frame)
+{
+    if (frame.hasSequence) {
+        auto it = std::find_if(m_replay.begin(), m_replay.end(), [&frame](const OutboundFrame& other) {
+            return other.hasSequence && other.sequence == frame.sequence;
+        });
+        if (it != m_replay.end()) {
+            m_replayBytes -= it->data.size();
+            m_replay.erase(it);
+        }
+    }
+    
+    m_replay.push_back(frame);
+    m_replayBytes += frame.data.size();
+    
+    while (!m_replay.empty()
+           && (m_replayBytes > m_replayMaxBytes || static_cast<int>(m_replay.size()) > m_replayMaxFrames)) {
+        const OutboundFrame& oldest = m_replay.front();
+        TLOG_WARN("replay_evicted").field("seq", oldest.sequence).field("array", !oldest.hasSequence)
+            .field("bytes", oldest.data.size());
+        m_replayBytes -= oldest.data.size();
+        m_replay.pop_front();
+    }
+}
+
+void TCoreSession::appendToBatch(const QByteArray& data, Models::WireFormat format)
+{
+    if (m_batchCount > 0 && m_batchFormat != format) {
+        flushBatch();
+    }
+    
+    if (m_batchCount > 0 && format == Models::WireFormat::Json) {
+        m_batch.append(',');
+    }
+    m_batch.append(data);
+    m_batchFormat = format;
+    ++m_batchCount;
+    
+    if (m_batch.size() >= m_batchMaxBytes) {
+        flushBatch();
+        flushOutbound();
+    } else if (!m_batchTimer->isActive()) {
+        m_batchTimer->start(m_batchMaxDelay);
+    }
+    updateIntake();
+}
+
+void TCoreSession::flushBatch()
+{
+    if (m_batchCount == 0) {
+        return;
+    }
+    m_batchTimer->stop();
+    
+    OutboundFrame frame;
+    frame.binary = m_batchFormat == Models::WireFormat::Cbor;
+    frame.replayable = true;
+    if (m_batchCount == 1) {
+        frame.data = m_batch;
+    } else if (frame.binary) {
+        frame.data = Models::Frame::cborArrayHeader(m_batchCount);
+        frame.data.append(m_batch);
+    } else {
+        frame.data.reserve(m_batch.size() + 2);
+        frame.data.append('[');
+        frame.data.append(m_batch);
+        frame.data.append(']');
+    }
+    
+    TLOG_DEBUG("send_batch").field("count", m_batchCount).field("bytes", frame.data.size());
+    
+    pushOutbound(frame);
+    m_batch.clear();
+    m_batchCount = 0;
+}
+
+void TCoreSession::flushOutbound()
+{
+    // 队列中的消息只在 socket 写缓冲区较空时写入，其余留在队列中统计和限流
+    while (!m_outbound.empty()
+           && isConnected()
+           && m_transport->bytesToWrite() < m_socketBufferLimit) {
+        OutboundFrame frame = std::move(m_outbound.front());
+        m_outbound.pop_front();
+        m_outboundBytes -= frame.data.size();
+        
+        m_transport->sendMessage(frame.data, frame.binary);
+    }
+}
+
+qint64 TCoreSession::sendResponse(const Models::Response& response, Models::WireFormat format,
+                                  const BatchSlot& slot)
+{
+    if (response.stream) {
+        // 流式响应不放进数组帧，数据块和完成响应照常单独发送
+        startStream(response, format);
+        if (slot.batch) {
+            completeBatchItem(slot, QByteArray());
+        }
+        return 0;
+    }
+    
+    // 请求已有最终响应（如 "wf" 分块上传被拒绝），之后不会再有流接收它的数据块
+    if (!m_earlyUploads.isEmpty()) {
+        discardEarlyUpload(response.sequence);
+    }
+    
+    if (format == Models::WireFormat::Cbor) {
+        QByteArray frame = encodeResponse(response, format);
+        
+        TLOG_DEBUG("send_cbor").field("seq", response.sequence).field("status", response.statusCode)
+            .field("bytes", frame.size());
+        if (slot.batch) {
+            completeBatchItem(slot, frame);
+        } else if (frame.size() < m_batchMaxBytes) {
+            appendToBatch(frame, format);
+        } else {
+            enqueueFrame(OutboundFrame{frame, true, true, true, response.sequence});
+        }
+        return frame.size();
+    }
+    
+    QByteArray json = encodeResponse(response, format);
+    
+    TLOG_DEBUG("send").field("seq", response.sequence).field("status", response.statusCode).payload(json);
+    if (slot.batch) {
+        completeBatchItem(slot, json);
+    } else if (json.size() < m_batchMaxBytes) {
+        appendToBatch(json, format);
+    } else {
+        enqueueFrame(OutboundFrame{json, false, true, true, response.sequence});
+    }
+    return json.size();
+}
+
+QByteArray TCoreSession::encodeResponse(const Models::Response& response, Models::WireFormat format) const
+{
+    bool binary = format == Models::WireFormat::Cbor;
+    QByteArray frame = binary ? response.toCborBytes() : response.toJsonBytes();
+    qint64 limit = m_transport->maxMessageSize();
+    if (frame.size() <= limit) {
+        return frame;
+    }
+    
+    TLOG_WARN("response_too_large").field("seq", response.sequence).field("bytes", frame.size())
+        .field("limit", limit);
+    Models::Response tooLarge;
+    tooLarge.statusCode = 413;
+    tooLarge.error = "Response too large";
+    tooLarge.errorReason = QString("Encoded response is %1 bytes, the transport accepts at most %2; "
+                                   "request a stream or a smaller range").arg(frame.size()).arg(limit);
+    tooLarge.sequence = response.sequence;
+    return binary ? tooLarge.toCborBytes() : tooLarge.toJsonBytes();
+}
+
+void TCoreSession::sendCallbackResponse(const CallbackEntry& entry, const Models::Response& response,
+                                        Models::WireFormat format, const BatchSlot& slot)
+{
+    qint64 start = TMetrics::now();
+    qint64 bytes = sendResponse(response, format, slot);
+    
+    TMetrics& metrics = TMetrics::instance();
+    metrics.recordLatency(entry.metricsId, TMetrics::Stage::Send, TMetrics::now() - start);
+    metrics.recordResponse(entry.metricsId, response.statusCode, bytes);
+}
+
+void TCoreSession::startStream(const Models::Response& response, Models::WireFormat format)
+{
+    QString errorReason;
+    if (!response.stream->open(&errorReason)) {
+        Models::Response errorResponse;
+        errorResponse.statusCode = 500;
+        errorResponse.error = "Stream open failed";
+        errorResponse.errorReason = errorReason;
+        errorResponse.sequence = response.sequence;
+        
+        sendResponse(errorResponse, format);
+        return;
+    }
+    
+    ActiveStream stream;
+    stream.sequence = response.sequence;
+    stream.format = format;
+    stream.body = response.stream;
+    stream.offset[0] = response.stream->startOffset();
+    
+    TStreamBody* body = response.stream.get();
+    body->setReadyReadHandler([this, body]() {
+        resumeStream(body);
+    });
+    
+    // 回调执行期间到达的上传数据块按顺序补交
+    auto early = m_earlyUploads.find(response.sequence);
+    if (early != m_earlyUploads.end()) {
+        EarlyUpload upload = early.value();
+        m_earlyUploads.erase(early);
+        m_earlyUploadBytes -= upload.bytes;
+        if (upload.overflowed) {
+            finishStream(stream, QString("Upload chunks sent before the request was accepted exceeded %1 bytes")
+                                     .arg(m_earlyUploadLimit));
+            return;
+        }
+        m_streams.push_back(stream);
+        for (const QByteArray& frame : upload.frames) {
+            deliverUploadChunk(body, frame);
+        }
+    } else {
+        m_streams.push_back(stream);
+    }
+    
+    pumpStreams();
+}
+
+void TCoreSession::resumeStream(TStreamBody* body)
+{
+    auto it = std::find_if(m_waitingStreams.begin(), m_waitingStreams.end(),
+                           [body](const ActiveStream& stream) { return stream.body.get() == body; });
+    if (it != m_waitingStreams.end()) {
+        m_streams.push_back(*it);
+        m_waitingStreams.erase(it);
+    }
+    
+    pumpStreams();
+}
+
+void TCoreSession::pumpStreams()
+{
+    // sendBinaryMessage 可能同步触发 bytesWritten，避免重入
+    if (m_pumping) {
+        return;
+    }
+    m_pumping = true;
+    
+    while (!m_streams.empty()
+           && isConnected()
+           && pendingOutboundBytes() < m_streamHighWatermark) {
+        ActiveStream stream = m_streams.front();
+        m_streams.pop_front();
+        
+        if (stream.body->atEnd()) {
+            finishStream(stream);
+            continue;
+        }
+        
+        int chunkSize = stream.body->preferredChunkSize() > 0 ? stream.body->preferredChunkSize()
+                                                               : m_streamChunkSize;
+        // 一个数据块不超过背压阈值，也不超过传输的帧长度
+        chunkSize = static_cast<int>(qBound<qint64>(TStreamBody::MinChunkSize,
+                                                    qMin<qint64>(chunkSize, m_streamHighWatermark),
+                                                    TStreamBody::MaxChunkSize));
+        
+        // 传输提供共享内存时数据块直接读入其中；批量帧或队列中还有待发的响应时不走捷径，保持发送顺序
+        char* shared = m_outbound.empty() && m_batchCount == 0
+                ? m_transport->reserveMessage(Models::Frame::HeaderSize + chunkSize) : nullptr;
+        QByteArray data;
+        qint64 size = 0;
+        if (shared) {
+            size = stream.body->readInto(shared + Models::Frame::HeaderSize, chunkSize);
+        } else {
+            data = stream.body->read(chunkSize);
+            size = data.size();
+        }
+        if (size == 0) {
+            if (shared) {
+                m_transport->commitMessage(0, true);
+            }
+            if (stream.body->atEnd()) {
+                finishStream(stream);
+            } else if (stream.body->waitingForData()) {
+                // 挂起，等数据源通知后再恢复
+                m_waitingStreams.push_back(stream);
+            } else {
+                QString errorReason = stream.body->errorString();
+                finishStream(stream, errorReason.isEmpty() ? QString("Unexpected end of stream") : errorReason);
+            }
+            continue;
+        }
+        
+        quint8 channel = stream.body->channel() & 3;
+        QByteArray frame = Models::Frame::chunkHeader(stream.sequence, stream.offset[channel], channel);
+        if (shared) {
+            std::memcpy(shared, frame.constData(), Models::Frame::HeaderSize);
+            m_transport->commitMessage(Models::Frame::HeaderSize + size, true);
+        } else {
+            frame.append(data);
+            enqueueFrame(OutboundFrame{frame, true});
+        }
+        
+        stream.offset[channel] += size;
+        stream.bytesSent += size;
+        
+        if (stream.body->atEnd()) {
+            finishStream(stream);
+        } else {
+            // 放到队尾，多个流轮流发送
+            m_streams.push_back(stream);
+        }
+    }
+    
+    m_pumping = false;
+}
+
+void TCoreSession::finishStream(const ActiveStream& stream, const QString& errorReason)
+{
+    Models::Response response;
+    response.sequence = stream.sequence;
+    
+    if (!errorReason.isEmpty()) {
+        response.statusCode = 500;
+        response.error = "Stream read error";
+        response.errorReason = errorReason;
+    } else {
+        QJsonObject result = stream.body->completion();
+        result["streamed"] = true;
+        result["offset"] = stream.body->startOffset();
+        result["bytes"] = stream.bytesSent;
+        
+        response.statusCode = 200;
+        response.result = result;
+    }
+    
+    sendResponse(response, stream.format);
+}
+
+void TCoreSession::onUploadChunk(const QByteArray& message)
+{
+    if (message.size() < Models::Frame::HeaderSize) {
+        TLOG_WARN("upload_chunk_malformed").field("bytes", message.size());
+        return;
+    }
+    int sequence = qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(message.constData()) + 4);
+    
+    auto matches = [sequence](const ActiveStream& stream) { return stream.sequence == sequence; };
+    auto active = std::find_if(m_streams.begin(), m_streams.end(), matches);
+    if (active != m_streams.end()) {
+        deliverUploadChunk(active->body.get(), message);
+        return;
+    }
+    auto waiting = std::find_if(m_waitingStreams.begin(), m_waitingStreams.end(), matches);
+    if (waiting != m_waitingStreams.end()) {
+        deliverUploadChunk(waiting->body.get(), message);
+        return;
+    }
+    
+    // 对端没有等待 "wf" 的确认就开始发送数据块，流开始前暂存，总量受限
+    EarlyUpload& upload = m_earlyUploads[sequence];
+    if (upload.overflowed) {
+        return;
+    }
+    if (m_earlyUploadBytes + message.size() > m_earlyUploadLimit) {
+        TLOG_WARN("upload_buffer_overflow").field("seq", sequence).field("bytes", m_earlyUploadBytes);
+        m_earlyUploadBytes -= upload.bytes;
+        upload.frames.clear();
+        upload.bytes = 0;
+        upload.overflowed = true;
+        return;
+    }
+    upload.frames.push_back(message);
+    upload.bytes += message.size();
+    m_earlyUploadBytes += message.size();
+}
+
+void TCoreSession::deliverUploadChunk(TStreamBody* body, const QByteArray& message)
+{
+    const uchar* header = reinterpret_cast<const uchar*>(message.constData());
+    bool final = header[1] & Models::Frame::UploadFinal;
+    qint64 offset = qFromBigEndian<qint64>(header + 8);
+    QByteArray data = QByteArray::fromRawData(message.constData() + Models::Frame::HeaderSize,
+                                              message.size() - Models::Frame::HeaderSize);
+    
+    if (!body->receiveChunk(offset, data, final)) {
+        TLOG_WARN("upload_chunk_rejected").field("seq", qFromBigEndian<qint32>(header + 4)).field("offset", offset);
+    }
+}
+
+void TCoreSession::discardEarlyUpload(int sequence)
+{
+    auto it = m_earlyUploads.find(sequence);
+    if (it != m_earlyUploads.end()) {
+        m_earlyUploadBytes -= it->bytes;
+        m_earlyUploads.erase(it);
+    }
+}
+
+void TCoreSession::handleRequest(const Models::Request& request, const BatchSlot& slot)
+{
+    // 直接用 UTF-8 字节查表，不构造 QString
+    const CallbackEntry* entry = m_registry->find(request.functionName.data(), request.functionName.size());
+    
+    if (!entry || !entry->invoke) {
         // 未找到对应的回调函数
+        TMetrics::instance().recordNotFound();
+        
         Models::Response errorResponse;
         errorResponse.statusCode = 404;
         errorResponse.error = "Function not found";
-        errorResponse.errorReason = QString("No callback registered for function: %1").arg(request.functionName);
+        errorResponse.errorReason = QString("No callback registered for function: %1").arg(request.functionName.toString());
         errorResponse.sequence = request.sequence;
         
-        sendResponse(errorResponse);
+        sendResponse(errorResponse, request.format, slot);
         return;
     }
     
-    // 调用回调函数
-    Models::Response response = it->second(request.sequence, request.payload);
+    TMetrics& metrics = TMetrics::instance();
+    metrics.recordRequest(entry->metricsId, request.wireSize);
     
-    // 发送响应
-    sendResponse(response);
+    if (m_executionMode == ExecutionMode::Inline) {
+        // 调用回调函数
+        qint64 start = TMetrics::now();
+        metrics.recordLatency(entry->metricsId, TMetrics::Stage::QueueWait, start - request.receivedAt);
+        TCallbackRegistry::SessionScope scope(m_sessionId);
+        Models::Response response = entry->invoke(entry->target.get(), request.sequence, request.payload);
+        metrics.recordLatency(entry->metricsId, TMetrics::Stage::Handler, TMetrics::now() - start);
+        
+        // 发送响应
+        sendCallbackResponse(*entry, response, request.format, slot);
+        return;
+    }
+    
+    // 超出该函数的并发限制，排队等待
+    CallbackState& state = callbackState(*entry);
+    if (entry->maxConcurrency > 0 && state.inFlight >= entry->maxConcurrency) {
+        state.pending.push_back(QueuedRequest{request, slot});
+        return;
+    }
+    
+    dispatchToPool(*entry, state, request, slot);
+}
+
+TCoreSession::CallbackState& TCoreSession::callbackState(const CallbackEntry& entry)
+{
+    if (entry.index >= static_cast<int>(m_callbackStates.size())) {
+        m_callbackStates.resize(m_registry->size());
+    }
+    return m_callbackStates[entry.index];
+}
+
+void TCoreSession::dispatchToPool(const CallbackEntry& entry, CallbackState& state,
+                                  const Models::Request& request, const BatchSlot& slot)
+{
+    ++state.inFlight;
+    
+    // 按值捕获调用入口，工作线程不访问注册表和会话状态
+    const CallbackEntry* entryPtr = &entry;
+    CallbackState* statePtr = &state;
+    TCallbackRegistry::Invoker invoke = entry.invoke;
+    std::shared_ptr<void> target = entry.target;
+    Models::Payload payload = request.payload;
+    int sequence = request.sequence;
+    Models::WireFormat format = request.format;
+    int metricsId = entry.metricsId;
+    qint64 receivedAt = request.receivedAt;
+    quint64 session = m_sessionId;
+    
+    m_threadPool->start([this, entryPtr, statePtr, invoke, target, payload, sequence, format, metricsId, receivedAt,
+                         slot, session]() {
+        // 在工作线程的指标分片中记录，不与 socket 线程争用
+        TMetrics& metrics = TMetrics::instance();
+        qint64 start = TMetrics::now();
+        metrics.recordLatency(metricsId, TMetrics::Stage::QueueWait, start - receivedAt);
+        TCallbackRegistry::SessionScope scope(session);
+        Models::Response response = invoke(target.get(), sequence, payload);
+        metrics.recordLatency(metricsId, TMetrics::Stage::Handler, TMetrics::now() - start);
+        
+        // 回到 socket 所在线程发送响应
+        QMetaObject::invokeMethod(this, [this, entryPtr, statePtr, response, format, slot]() {
+            onPoolTaskFinished(entryPtr, statePtr, response, format, slot);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TCoreSession::onPoolTaskFinished(const CallbackEntry* entry, CallbackState* state,
+                                      const Models::Response& response, Models::WireFormat format,
+                                      const BatchSlot& slot)
+{
+    // 按完成顺序发送，由 sequence 与请求对应
+    sendCallbackResponse(*entry, response, format, slot);
+    
+    --state->inFlight;
+    
+    // 释放出的并发名额交给排队的请求
+    while (!state->pending.empty()
+           && (entry->maxConcurrency <= 0 || state->inFlight < entry->maxConcurrency)) {
+        QueuedRequest next = state->pending.front();
+        state->pending.pop_front();
+        dispatchToPool(*entry, *state, next.request, next.slot);
+    }
 }
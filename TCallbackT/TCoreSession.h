@@ -2,12 +2,19 @@
 #define TCORESESSION_H
 
 #include <QObject>
-#include <QWebSocket>
 #include <QJsonObject>
 #include <QJsonDocument>
-#include <functional>
-#include <unordered_map>
+#include <QHash>
+#include <QThreadPool>
+#include <QTimer>
+#include <deque>
+#include <memory>
+#include <vector>
 #include "Models.h"
+#include "TCallbackRegistry.h"
+#include "TMetrics.h"
+#include "TStreamBody.h"
+#include "TTransport.h"
 
 class TCoreSession : public QObject
 {
@@ -15,70 +22,278 @@ class TCoreSession : public QObject
 
 public:
     explicit TCoreSession(QObject *parent = nullptr);
+    
+    // 使用共享的回调注册表（多个会话共用同一组回调）
+    explicit TCoreSession(std::shared_ptr<TCallbackRegistry> registry, QObject *parent = nullptr);
     ~TCoreSession();
     
-    // 连接到服务器
+    // 回调注册表，registerCallback 和 setConcurrencyLimit 都作用于它
+    TCallbackRegistry& registry();
+    
+    // 连接到服务器：ws:// 或 wss:// 使用 WebSocket，local:<名称> 使用本机套接字，
+    // local:<名称>?shm=<MiB> 时大消息和数据块经共享内存环传递（见 TTransport）
     void connectToServer(const QString& url);
     
-    // 断开连接
+    // 断开连接（主动断开后不再自动重连）
     void disconnect();
     
+    // 自动重连：连接断开或连接失败后按指数退避重试，实际等待时间在 [delay/2, delay] 内随机取值
+    void setReconnectPolicy(bool enabled, int initialDelayMs = 500, int maxDelayMs = 30000);
+    
+    // 重放缓冲区上限：断线期间完成的响应和尚未写出的响应按 sequence 保存，重连后依次发送
+    // 超出上限时丢弃最早的响应
+    void setReplayLimits(qint64 maxBytes, int maxFrames);
+    
+    // 回调执行模式
+    enum class ExecutionMode {
+        Inline,     // 在 socket 所在线程同步执行（默认）
+        ThreadPool  // 在线程池中执行，响应按完成顺序发回
+    };
+    
+    // 设置回调执行模式
+    void setExecutionMode(ExecutionMode mode);
+    ExecutionMode executionMode() const;
+    
+    // 设置线程池最大线程数（默认为 CPU 核心数）
+    void setMaxThreadCount(int count);
+    
+    // 设置单个函数的最大并发数（<= 0 表示不限制），仅在 ThreadPool 模式下生效
+    // 注册表共享时，限制对每个会话分别生效
+    void setConcurrencyLimit(const QString& functionName, int limit);
+    
+    // 流式响应的默认块大小（字节）
+    void setStreamChunkSize(int size);
+    
+    // 流式发送的背压阈值：socket 待写字节数超过该值时暂停发送数据块
+    void setStreamHighWatermark(qint64 bytes);
+    
+    // 发送队列的高低水位（字节，含 socket 写缓冲区中的数据）
+    // 待发送数据超过高水位时暂停处理新请求，回落到低水位以下后恢复
+    void setSendWatermarks(qint64 high, qint64 low);
+    
+    // 暂停期间最多暂存的请求数，超出的请求直接以 503 拒绝
+    void setMaxDeferredRequests(int count);
+    
+    // 合并小响应：编码后小于 maxBytes 的响应先放入批量帧（JSON 数组或 CBOR 数组），
+    // 累计达到 maxBytes 或等待 maxDelayMs 毫秒后发出；maxBytes <= 0 表示关闭（默认）
+    void setResponseBatching(int maxBytes, int maxDelayMs);
+    
+    // 对端最近一次请求使用的编码格式
+    Models::WireFormat peerWireFormat() const;
+    
     // 模板回调函数类型定义
     template<typename PayloadType>
-    using CallbackFunction = std::function<Models::Response(int sequence, const PayloadType& payload)>;
+    using CallbackFunction = TCallbackRegistry::CallbackFunction<PayloadType>;
     
     // 注册回调函数 - 自动从 PayloadType 获取 functionName
-    template<typename PayloadType>
-    void registerCallback(CallbackFunction<PayloadType> callback);
+    // Callback 可以是 lambda 或 CallbackFunction<PayloadType>，按原类型保存并直接调用
+    template<typename PayloadType, typename Callback>
+    void registerCallback(Callback callback) {
+        m_registry->registerCallback<PayloadType>(std::move(callback));
+    }
 
 private slots:
     void onConnected();
     void onDisconnected();
-    void onTextMessageReceived(const QString& message);
-    void onError(QAbstractSocket::SocketError error);
+    void onMessageReceived(const QByteArray& message, bool binary);
+    void onError();
+    void onBytesWritten(qint64 bytes);
 
 private:
-    // 内部回调函数类型
-    using InternalCallback = std::function<Models::Response(int sequence, const QJsonValue& payload)>;
+    using CallbackEntry = TCallbackRegistry::Entry;
+    
+    // JSON 文本消息（UTF-8）与 CBOR 二进制消息
+    void onTextMessageReceived(const QByteArray& utf8);
+    void onBinaryMessageReceived(const QByteArray& message);
+    
+    // 按 URL 的协议准备传输，协议与当前传输不同时重新创建
+    void prepareTransport(const QString& url);
+    
+    bool isConnected() const { return m_transport && m_transport->isConnected(); }
+    
+    // 一个批量请求帧：各项的响应全部就绪后合并为一个数组帧发回
+    struct ResponseBatch {
+        Models::WireFormat format = Models::WireFormat::Json;
+        std::vector<QByteArray> items;  // 按请求顺序保存已编码的响应；流式响应单独发送，对应项为空
+        int remaining = 0;              // 尚未完成的项数
+    };
+    
+    // 请求在批量帧中的位置，batch 为空表示单独的请求
+    struct BatchSlot {
+        // 显式构造函数：类定义内的默认参数 BatchSlot() 需要在外层类完成前可用
+        BatchSlot(std::shared_ptr<ResponseBatch> b = nullptr, int i = -1) : batch(std::move(b)), index(i) {}
+        
+        std::shared_ptr<ResponseBatch> batch;
+        int index;
+    };
+    
+    // 排队等待处理的请求
+    struct QueuedRequest {
+        Models::Request request;
+        BatchSlot slot;
+    };
+    
+    // 发送响应，按 format 选择 JSON 文本帧或 CBOR 二进制帧，返回消息字节数（流式响应返回 0）
+    // 属于批量帧的响应先保存，整批完成后一起发送
+    qint64 sendResponse(const Models::Response& response, Models::WireFormat format,
+                        const BatchSlot& slot = BatchSlot());
+    
+    // 编码响应；超出传输的单条消息上限时改为同一序号的 413 响应，避免对端一直等待
+    QByteArray encodeResponse(const Models::Response& response, Models::WireFormat format) const;
+    
+    // 发送回调的响应并记录发送耗时和响应指标
+    void sendCallbackResponse(const CallbackEntry& entry, const Models::Response& response,
+                              Models::WireFormat format, const BatchSlot& slot);
+    
+    // 保存批量帧中一项的响应（encoded 为空表示该项不出现在数组中），最后一项完成时发送数组帧
+    void completeBatchItem(const BatchSlot& slot, const QByteArray& encoded);
+    
+    // 待写入 socket 的消息
+    struct OutboundFrame {
+        QByteArray data;
+        bool binary = false;
+        bool replayable = false;    // 响应帧断线后保留重发，数据块帧直接丢弃
+        bool hasSequence = false;   // 单个响应帧，sequence 有效；数组帧没有单一的 sequence
+        int sequence = 0;
+    };
+    
+    // 消息放入发送队列（会先发出未完成的批量帧，保证顺序）
+    void enqueueFrame(const OutboundFrame& frame);
+    
+    // 已连接时放入发送队列，否则可重发的帧进入重放缓冲区
+    void pushOutbound(const OutboundFrame& frame);
     
-    // 发送响应
-    void sendResponse(const Models::Response& response);
+    // 放入重放缓冲区，同一 sequence 只保留最新的一个，超出上限时丢弃最早的
+    void appendReplay(const OutboundFrame& frame);
+    
+    // 安排下一次重连
+    void scheduleReconnect();
+    
+    // 响应放入批量帧
+    void appendToBatch(const QByteArray& data, Models::WireFormat format);
+    
+    // 发出批量帧，只有一个响应时按普通消息发送
+    void flushBatch();
+    
+    // 在 socket 写缓冲区允许的范围内把队列中的消息写入 socket
+    void flushOutbound();
+    
+    // 队列、socket 写缓冲区和共享内存环中尚未发出或尚未被对端处理的字节数
+    qint64 pendingOutboundBytes() const;
+    
+    // 根据待发送字节数暂停或恢复处理请求
+    void updateIntake();
+    
+    // 收到请求：暂停期间先暂存，否则直接处理
+    void acceptRequest(const Models::Request& request, const BatchSlot& slot = BatchSlot());
+    
+    // 收到批量请求帧，各项按顺序交给 acceptRequest
+    void acceptBatch(std::vector<Models::Request>& requests, Models::WireFormat format);
+    
+    // 正在发送的流式响应
+    struct ActiveStream {
+        int sequence = 0;
+        Models::WireFormat format = Models::WireFormat::Json;
+        std::shared_ptr<TStreamBody> body;
+        qint64 offset[4] = {};  // 各通道下一个数据块的偏移
+        qint64 bytesSent = 0;
+    };
+    
+    // 单个函数在本会话中的运行状态，按注册表中的 index 保存
+    struct CallbackState {
+        int inFlight = 0;                      // 正在线程池中执行的数量
+        std::deque<QueuedRequest> pending;     // 超出并发限制而排队的请求
+    };
+    
+    // 取函数的运行状态，注册表在会话创建后新增条目时按需扩充
+    CallbackState& callbackState(const CallbackEntry& entry);
+    
+    // 开始发送流式响应
+    void startStream(const Models::Response& response, Models::WireFormat format);
+    
+    // 在背压阈值内轮流发送各个流的数据块
+    void pumpStreams();
+    
+    // 推送型数据源有新数据，恢复被挂起的流
+    void resumeStream(TStreamBody* body);
+    
+    // 流发送结束，发送完成响应或错误响应
+    void finishStream(const ActiveStream& stream, const QString& errorReason = QString());
+    
+    // 收到上传数据块帧：交给对应的上传流，流尚未开始（回调仍在执行）时先暂存
+    void onUploadChunk(const QByteArray& message);
+    
+    // 把一个上传数据块帧交给流对象，数据引用帧的内存，不复制
+    void deliverUploadChunk(TStreamBody* body, const QByteArray& message);
+    
+    // 丢弃某个 sequence 暂存的上传数据块
+    void discardEarlyUpload(int sequence);
     
     // 处理收到的请求
-    void handleRequest(const Models::Request& request);
+    void handleRequest(const Models::Request& request, const BatchSlot& slot);
+    
+    // 将请求投递到线程池执行
+    void dispatchToPool(const CallbackEntry& entry, CallbackState& state,
+                        const Models::Request& request, const BatchSlot& slot);
+    
+    // 线程池任务完成（在 socket 所在线程调用）
+    void onPoolTaskFinished(const CallbackEntry* entry, CallbackState* state, const Models::Response& response,
+                            Models::WireFormat format, const BatchSlot& slot);
     
 private:
-    QWebSocket* m_webSocket;
-    std::unordered_map<QString, InternalCallback> m_callbacks;
-};
-
-// 模板函数实现
-template<typename PayloadType>
-void TCoreSession::registerCallback(CallbackFunction<PayloadType> callback)
-{
-    // 从 PayloadType 获取 functionName
-    QString functionName = PayloadType::functionName;
-    
-    // 包装用户回调函数，处理 JSON 到具体类型的转换
-    InternalCallback internalCallback = [callback](int sequence, const QJsonValue& payload) -> Models::Response {
-        try {
-            // 将 JSON payload 转换为具体类型
-            PayloadType typedPayload = PayloadType::fromPayload(payload);
-            
-            // 调用用户回调函数
-            return callback(sequence, typedPayload);
-        } catch (const std::exception& e) {
-            // 转换失败，返回错误响应
-            Models::Response errorResponse;
-            errorResponse.statusCode = 400;
-            errorResponse.error = "Payload conversion failed";
-            errorResponse.errorReason = QString::fromStdString(e.what());
-            errorResponse.sequence = sequence;
-            return errorResponse;
-        }
+    TTransport* m_transport = nullptr;
+    QThreadPool* m_threadPool;
+    ExecutionMode m_executionMode = ExecutionMode::Inline;
+    Models::WireFormat m_peerFormat = Models::WireFormat::Json;  // 对端最近一次使用的编码
+    std::shared_ptr<TCallbackRegistry> m_registry;
+    const quint64 m_sessionId;          // 进程内唯一，回调经 TCallbackRegistry::currentSession() 读取
+    std::deque<CallbackState> m_callbackStates;  // 扩充时已有元素的地址不变
+    
+    std::deque<ActiveStream> m_streams;
+    std::vector<ActiveStream> m_waitingStreams;  // 等待推送型数据源产生数据的流
+    
+    // 先于上传流到达的数据块帧，超出总量上限的上传在流开始时以错误结束
+    struct EarlyUpload {
+        std::vector<QByteArray> frames;
+        qint64 bytes = 0;
+        bool overflowed = false;
     };
+    QHash<int, EarlyUpload> m_earlyUploads;
+    qint64 m_earlyUploadBytes = 0;
+    qint64 m_earlyUploadLimit = 16 * 1024 * 1024;
+    
+    int m_streamChunkSize = 256 * 1024;
+    qint64 m_streamHighWatermark = 4 * 1024 * 1024;
+    bool m_pumping = false;
     
-    m_callbacks[functionName] = internalCallback;
-}
+    std::deque<OutboundFrame> m_outbound;
+    qint64 m_outboundBytes = 0;                     // m_outbound 中的字节数
+    qint64 m_socketBufferLimit = 1024 * 1024;       // socket 写缓冲区中最多保留的字节数
+    qint64 m_sendHighWatermark = 16 * 1024 * 1024;
+    qint64 m_sendLowWatermark = 4 * 1024 * 1024;
+    bool m_intakePaused = false;
+    std::deque<QueuedRequest> m_deferredRequests;   // 暂停期间收到的请求
+    int m_maxDeferredRequests = 10000;
+    
+    int m_batchMaxBytes = 0;
+    int m_batchMaxDelay = 2;
+    QByteArray m_batch;                             // 已编码的响应，JSON 之间以逗号分隔
+    int m_batchCount = 0;
+    Models::WireFormat m_batchFormat = Models::WireFormat::Json;
+    QTimer* m_batchTimer;
+    
+    QString m_url;
+    bool m_closing = false;                         // 主动断开，不再重连
+    bool m_reconnectEnabled = true;
+    int m_reconnectInitialDelay = 500;
+    int m_reconnectMaxDelay = 30000;
+    int m_reconnectAttempt = 0;
+    QTimer* m_reconnectTimer;
+    
+    std::deque<OutboundFrame> m_replay;             // 断线期间保存的响应，重连后按顺序发送
+    qint64 m_replayBytes = 0;
+    qint64 m_replayMaxBytes = 8 * 1024 * 1024;
+    int m_replayMaxFrames = 1024;
+};
 
 #endif // TCORESESSION_H
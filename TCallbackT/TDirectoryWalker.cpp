@@ -0,0 +1,674 @@
+#include "TDirectoryWalker.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_UNIX
+#include <fnmatch.h>
+#else
+#include <QRegularExpression>
+#endif
+
+namespace {
+
+// 一个目录中的条目，读取时按请求的字段决定是否 stat
+struct RawEntry {
+    QByteArray name;
+    bool isDirectory = false;       // 目录或指向目录的符号链接（对外报告的类型）
+    bool traversable = false;       // 真实目录，可以递归进入（不跟随符号链接，避免环）
+    qint64 size = 0;
+    qint64 lastModified = 0;
+    std::shared_ptr<TDirectoryWalker::Listing> child;  // 预取的子目录内容
+};
+
+struct ReadOptions {
+    bool includeHidden = false;
+    bool wantType = true;
+    bool wantStat = true;           // 需要大小或修改时间
+    QByteArray from;                // 非空时只保留名称不小于它的条目（续传游标所在的目录）
+};
+
+// 目录读取共用的线程池：任务只读取一个目录，从不等待其它任务
+QThreadPool& listingPool()
+{
+    static QThreadPool* pool = []() {
+        QThreadPool* p = new QThreadPool();
+        p->setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+        return p;
+    }();
+    return *pool;
+}
+
+} // namespace
+
+struct TDirectoryWalker::Listing {
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool done = false;
+    bool notFound = false;
+    QString error;
+    std::vector<RawEntry> entries;
+    std::function<void()> wake;     // 读取完成后在线程池中调用一次
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return done; });
+    }
+
+    // 已读取完成时返回 true，否则登记 wake（为空时不登记）
+    bool whenDone(const std::function<void()>& callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!done && callback) {
+            wake = callback;
+        }
+        return done;
+    }
+};
+
+struct TDirectoryWalker::Frame {
+    QByteArray prefix;              // 该目录相对 root 的路径，非空时以 '/' 结尾
+    int level = 0;                  // root 下的条目为 0
+    std::shared_ptr<Listing> listing;
+    bool entered = false;
+    size_t index = 0;
+    size_t prefetched = 0;          // 已检查过是否需要预取的条目数
+    QList<QByteArray> cursor;       // 续传游标在该目录及以下的剩余部分
+};
+
+namespace {
+
+void readDirectory(const QByteArray& path, const ReadOptions& options, TDirectoryWalker::Listing* listing)
+{
+#ifdef Q_OS_LINUX
+    int fd = ::open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        listing->notFound = errno == ENOENT || errno == ENOTDIR;
+        listing->error = QString::fromLocal8Bit(std::strerror(errno));
+        return;
+    }
+
+    // linux_dirent64 没有公开的声明，按内核 ABI 解析
+    constexpr size_t BufferSize = 64 * 1024;
+    std::unique_ptr<char[]> buffer(new char[BufferSize]);
+    for (;;) {
+        long count = ::syscall(SYS_getdents64, fd, buffer.get(), BufferSize);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            listing->error = QString::fromLocal8Bit(std::strerror(errno));
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < count;) {
+            const char* record = buffer.get() + offset;
+            unsigned short length = 0;
+            std::memcpy(&length, record + 16, sizeof(length));
+            unsigned char type = static_cast<unsigned char>(record[18]);
+            const char* name = record + 19;
+            offset += length;
+
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (name[0] == '.' && !options.includeHidden) {
+                continue;
+            }
+            // 游标之前的条目已在前几页输出，既不 stat 也不参与排序
+            if (!options.from.isEmpty() && std::strcmp(name, options.from.constData()) < 0) {
+                continue;
+            }
+
+            RawEntry entry;
+            entry.name = QByteArray(name);
+            entry.traversable = type == DT_DIR;
+            entry.isDirectory = type == DT_DIR;
+
+            struct stat info;
+            bool isLink = type == DT_LNK;
+            if (options.wantStat || (isLink && options.wantType)) {
+                // 与 QFileInfo 一致，大小和时间取符号链接指向的文件
+                if (::fstatat(fd, name, &info, 0) == 0) {
+                    entry.isDirectory = S_ISDIR(info.st_mode);
+                    entry.size = entry.isDirectory ? 0 : static_cast<qint64>(info.st_size);
+                    entry.lastModified = static_cast<qint64>(info.st_mtim.tv_sec) * 1000
+                                         + info.st_mtim.tv_nsec / 1000000;
+                    if (type == DT_UNKNOWN) {
+                        // 文件系统不提供类型时再确认一次本身是否为符号链接
+                        struct stat self;
+                        entry.traversable = entry.isDirectory
+                                            && ::fstatat(fd, name, &self, AT_SYMLINK_NOFOLLOW) == 0
+                                            && S_ISDIR(self.st_mode);
+                    }
+                }
+            } else if (type == DT_UNKNOWN && ::fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) == 0) {
+                entry.isDirectory = S_ISDIR(info.st_mode);
+                entry.traversable = entry.isDirectory;
+            }
+            listing->entries.push_back(std::move(entry));
+        }
+    }
+    ::close(fd);
+#else
+    QFileInfo root(QString::fromUtf8(path));
+    if (!root.isDir()) {
+        listing->notFound = true;
+        listing->error = "Not a directory";
+        return;
+    }
+    QDir::Filters filters = QDir::Files | QDir::Dirs | QDir::System | QDir::NoDotAndDotDot;
+    if (options.includeHidden) {
+        filters |= QDir::Hidden;
+    }
+    const QFileInfoList infos = QDir(root.filePath()).entryInfoList(filters, QDir::NoSort);
+    for (const QFileInfo& info : infos) {
+        RawEntry entry;
+        entry.name = info.fileName().toUtf8();
+        if (!options.from.isEmpty() && entry.name < options.from) {
+            continue;
+        }
+        entry.isDirectory = info.isDir();
+        entry.traversable = info.isDir() && !info.isSymLink();
+        entry.size = info.isDir() ? 0 : info.size();
+        entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+        listing->entries.push_back(std::move(entry));
+    }
+#endif
+
+    std::sort(listing->entries.begin(), listing->entries.end(),
+              [](const RawEntry& a, const RawEntry& b) { return a.name < b.name; });
+}
+
+// 暂存的遍历器：数量有限，超时后丢弃
+constexpr size_t MaxSuspended = 32;
+constexpr std::chrono::seconds SuspendedLifetime(60);
+
+struct Suspended {
+    QByteArray key;
+    std::unique_ptr<TDirectoryWalker> walker;
+    std::chrono::steady_clock::time_point since;
+};
+
+std::mutex g_suspendedMutex;
+std::deque<Suspended> g_suspended;
+
+void dropExpired(std::chrono::steady_clock::time_point now)
+{
+    while (!g_suspended.empty()
+           && (g_suspended.size() > MaxSuspended || now - g_suspended.front().since > SuspendedLifetime)) {
+        g_suspended.pop_front();
+    }
+}
+
+} // namespace
+
+TDirectoryWalker::TDirectoryWalker(const Options& options)
+    : m_options(options)
+    , m_root(QDir::cleanPath(options.root).toUtf8())
+{
+    for (const QString& pattern : options.patterns) {
+        m_patterns.push_back(pattern.toUtf8());
+    }
+}
+
+TDirectoryWalker::~TDirectoryWalker() = default;
+
+std::shared_ptr<TDirectoryWalker::Listing> TDirectoryWalker::submit(const QByteArray& path, const QByteArray& from)
+{
+    std::shared_ptr<Listing> listing = std::make_shared<Listing>();
+    ReadOptions options;
+    options.includeHidden = m_options.includeHidden;
+    options.wantType = m_options.wantType;
+    options.wantStat = m_options.wantSize || m_options.wantModified;
+    options.from = from;
+
+    // 任务只持有 listing 的共享所有权，遍历器提前析构时任务照常结束
+    ++m_outstanding;
+    listingPool().start([listing, path, options]() {
+        readDirectory(path, options, listing.get());
+        std::function<void()> wake;
+        {
+            std::lock_guard<std::mutex> lock(listing->mutex);
+            listing->done = true;
+            wake.swap(listing->wake);
+        }
+        listing->ready.notify_all();
+        if (wake) {
+            wake();
+        }
+    });
+    return listing;
+}
+
+bool TDirectoryWalker::start(QString* errorReason, bool* notFound)
+{
+    m_stack.clear();
+    m_skipped = 0;
+
+    Frame root;
+    if (!m_options.cursor.isEmpty()) {
+        const QList<QByteArray> parts = m_options.cursor.toUtf8().split('/');
+        for (const QByteArray& part : parts) {
+            if (!part.isEmpty()) {
+                root.cursor.append(part);
+            }
+        }
+    }
+    root.listing = submit(m_root, root.cursor.value(0));
+    m_stack.push_back(std::move(root));
+
+    m_stack.back().listing->wait();
+    if (!enterFrame(m_stack.back())) {
+        const Listing& listing = *m_stack.back().listing;
+        *errorReason = QString("Cannot list directory %1: %2").arg(m_options.root, listing.error);
+        *notFound = listing.notFound;
+        m_stack.clear();
+        return false;
+    }
+    return true;
+}
+
+bool TDirectoryWalker::enterFrame(Frame& frame)
+{
+    frame.entered = true;
+    --m_outstanding;
+    if (!frame.listing->error.isEmpty() && frame.listing->entries.empty()) {
+        return false;
+    }
+
+    // 跳过游标之前已输出的条目；游标所在的条目本身已输出，但还要进入它继续
+    std::vector<RawEntry>& entries = frame.listing->entries;
+    if (!frame.cursor.isEmpty()) {
+        const QByteArray& name = frame.cursor.first();
+        auto it = std::lower_bound(entries.begin(), entries.end(), name,
+                                   [](const RawEntry& entry, const QByteArray& key) { return entry.name < key; });
+        frame.index = static_cast<size_t>(it - entries.begin());
+    }
+    frame.prefetched = frame.index;
+    prefetch(frame);
+    return true;
+}
+
+void TDirectoryWalker::prefetch(Frame& frame)
+{
+    // 全局窗口限制预取量，超出的子目录在轮到时再读取
+    const int window = 4 * listingPool().maxThreadCount();
+    if (m_options.depth >= 0 && frame.level >= m_options.depth) {
+        return;
+    }
+    std::vector<RawEntry>& entries = frame.listing->entries;
+    while (frame.prefetched < entries.size() && m_outstanding < window) {
+        RawEntry& entry = entries[frame.prefetched++];
+        if (entry.traversable && !entry.child) {
+            // 续传游标经过的子目录只需要读取游标之后的部分
+            bool onCursor = frame.cursor.size() > 1 && entry.name == frame.cursor.first();
+            entry.child = submit(m_root + '/' + frame.prefix + entry.name,
+                                 onCursor ? frame.cursor.at(1) : QByteArray());
+        }
+    }
+}
+
+bool TDirectoryWalker::matches(const QByteArray& name) const
+{
+    if (m_patterns.empty()) {
+        return true;
+    }
+    for (const QByteArray& pattern : m_patterns) {
+#ifdef Q_OS_UNIX
+        if (::fnmatch(pattern.constData(), name.constData(), 0) == 0) {
+            return true;
+        }
+#else
+        QRegularExpression expression(QRegularExpression::wildcardToRegularExpression(QString::fromUtf8(pattern)));
+        if (expression.match(QString::fromUtf8(name)).hasMatch()) {
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+TDirectoryWalker::Step TDirectoryWalker::step(Entry* entry, const std::function<void()>& wake)
+{
+    if (m_hasLookahead) {
+        *entry = std::move(m_lookahead);
+        m_hasLookahead = false;
+        return Step::Entry;
+    }
+
+    while (!m_stack.empty()) {
+        Frame& frame = m_stack.back();
+        if (!frame.entered) {
+            if (!frame.listing->whenDone(wake)) {
+                return Step::Pending;
+            }
+            if (!enterFrame(frame)) {
+                ++m_skipped;
+                m_stack.pop_back();
+                continue;
+            }
+        }
+
+        std::vector<RawEntry>& entries = frame.listing->entries;
+        if (frame.index >= entries.size()) {
+            m_stack.pop_back();
+            continue;
+        }
+
+        size_t index = frame.index++;
+        RawEntry& raw = entries[index];
+        bool resumed = !frame.cursor.isEmpty() && raw.name == frame.cursor.first();
+        bool descend = raw.traversable && (m_options.depth < 0 || frame.level < m_options.depth);
+
+        Entry result;
+        bool report = !resumed && matches(raw.name);
+        if (report) {
+            result.path = frame.prefix + raw.name;
+            result.isDirectory = raw.isDirectory;
+            result.size = raw.size;
+            result.lastModified = raw.lastModified;
+        }
+
+        if (descend) {
+            Frame child;
+            child.prefix = frame.prefix + raw.name + '/';
+            child.level = frame.level + 1;
+            if (resumed) {
+                child.cursor = frame.cursor.mid(1);
+            }
+            child.listing = raw.child ? std::move(raw.child) : submit(m_root + '/' + child.prefix, child.cursor.value(0));
+            frame.cursor.clear();
+            prefetch(frame);
+            // push_back 之后 frame 引用失效
+            m_stack.push_back(std::move(child));
+        } else {
+            frame.cursor.clear();
+            prefetch(frame);
+        }
+
+        if (report) {
+            *entry = std::move(result);
+            return Step::Entry;
+        }
+    }
+    return Step::End;
+}
+
+bool TDirectoryWalker::next(Entry* entry)
+{
+    for (;;) {
+        Step result = step(entry, std::function<void()>());
+        if (result != Step::Pending) {
+            return result == Step::Entry;
+        }
+        m_stack.back().listing->wait();
+    }
+}
+
+bool TDirectoryWalker::hasMore()
+{
+    if (!m_hasLookahead) {
+        m_hasLookahead = next(&m_lookahead);
+    }
+    return m_hasLookahead;
+}
+
+QByteArray TDirectoryWalker::suspensionKey(const Options& options, const QString& cursor)
+{
+    QByteArray key = QDir::cleanPath(options.root).toUtf8();
+    key += '\n' + QByteArray::number(options.depth) + '\n' + options.patterns.join(QLatin1Char('/')).toUtf8();
+    key += '\n';
+    key += options.includeHidden ? 'h' : '-';
+    key += options.wantType ? 't' : '-';
+    key += options.wantSize ? 's' : '-';
+    key += options.wantModified ? 'm' : '-';
+    key += '\n' + cursor.toUtf8();
+    return key;
+}
+
+void TDirectoryWalker::suspend(std::unique_ptr<TDirectoryWalker> walker, const QString& cursor)
+{
+    QByteArray key = suspensionKey(walker->m_options, cursor);
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(g_suspendedMutex);
+    g_suspended.push_back(Suspended{key, std::move(walker), now});
+    dropExpired(now);
+}
+
+std::unique_ptr<TDirectoryWalker> TDirectoryWalker::resume(const Options& options)
+{
+    if (options.cursor.isEmpty()) {
+        return nullptr;
+    }
+    QByteArray key = suspensionKey(options, options.cursor);
+
+    std::lock_guard<std::mutex> lock(g_suspendedMutex);
+    dropExpired(std::chrono::steady_clock::now());
+    for (auto it = g_suspended.begin(); it != g_suspended.end(); ++it) {
+        if (it->key == key) {
+            std::unique_ptr<TDirectoryWalker> walker = std::move(it->walker);
+            g_suspended.erase(it);
+            return walker;
+        }
+    }
+    return nullptr;
+}
+
+Models::ListDirectoryResponse::FileInfo TDirectoryWalker::fileInfo(const Entry& entry) const
+{
+    Models::ListDirectoryResponse::FileInfo info;
+    info.name = QString::fromUtf8(entry.path);
+    if (m_options.wantType) {
+        info.type = entry.isDirectory ? QString("directory") : QString("file");
+    }
+    if (m_options.wantSize) {
+        info.size = entry.size;
+    }
+    if (m_options.wantModified) {
+        info.lastModified = QDateTime::fromMSecsSinceEpoch(entry.lastModified).toString(Qt::ISODate);
+    }
+    return info;
+}
+
+// =================== TDirectoryStreamBody ===================
+
+namespace {
+
+// 生成任务领先发送的字节数上限，达到后等会话线程取走数据再继续
+constexpr int BufferedPageBytes = 1024 * 1024;
+
+} // namespace
+
+// 与生成任务共享：walker 和 page 只由正在运行的任务使用，其余字段在锁内访问；
+// context 在会话线程创建和销毁，任务在锁内检查后才向它投递通知；
+// 设置了线程安全的通知函数时（HTTP 反应器）不创建 context，任务在锁内直接通知
+struct TDirectoryStreamBody::Producer {
+    std::unique_ptr<TDirectoryWalker> walker;
+    int pageSize = 1;
+    std::vector<TDirectoryWalker::Entry> page;
+
+    std::mutex mutex;
+    TDirectoryStreamBody* body = nullptr;
+    QObject* context = nullptr;
+    bool notifyDirectly = false;
+    QByteArray pending;             // 已序列化、尚未发送的页
+    bool running = false;           // 生成任务正在运行或在等待目录读取
+    bool finished = false;          // 遍历结束
+    bool cancelled = false;         // 流对象已析构
+    qint64 entries = 0;
+    int pages = 0;
+    int skipped = 0;
+};
+
+TDirectoryStreamBody::TDirectoryStreamBody(std::unique_ptr<TDirectoryWalker> walker, int pageSize)
+    : m_producer(std::make_shared<Producer>())
+{
+    m_producer->walker = std::move(walker);
+    m_producer->pageSize = qMax(1, pageSize);
+}
+
+TDirectoryStreamBody::~TDirectoryStreamBody()
+{
+    std::lock_guard<std::mutex> lock(m_producer->mutex);
+    delete m_producer->context;
+    m_producer->context = nullptr;
+    m_producer->cancelled = true;
+    m_producer->notifyDirectly = false;
+}
+
+bool TDirectoryStreamBody::open(QString* errorReason)
+{
+    Q_UNUSED(errorReason);
+    std::lock_guard<std::mutex> lock(m_producer->mutex);
+    m_producer->body = this;
+    if (hasThreadSafeReadyReadHandler()) {
+        m_producer->notifyDirectly = true;
+    } else {
+        m_producer->context = new QObject();
+    }
+    schedule(m_producer);
+    return true;
+}
+
+void TDirectoryStreamBody::schedule(const std::shared_ptr<Producer>& producer)
+{
+    if (producer->running || producer->finished || producer->cancelled
+        || producer->pending.size() >= BufferedPageBytes) {
+        return;
+    }
+    producer->running = true;
+    listingPool().start([producer]() {
+        produce(producer);
+    });
+}
+
+void TDirectoryStreamBody::produce(const std::shared_ptr<Producer>& producer)
+{
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(producer->mutex);
+            if (producer->cancelled || producer->pending.size() >= BufferedPageBytes) {
+                producer->running = false;
+                return;
+            }
+        }
+
+        // 目录尚未读完时不等待：读取任务完成后重新提交生成任务，running 保持为 true
+        TDirectoryWalker::Entry entry;
+        TDirectoryWalker::Step step = producer->walker->step(&entry, [producer]() {
+            listingPool().start([producer]() {
+                produce(producer);
+            });
+        });
+        if (step == TDirectoryWalker::Step::Pending) {
+            return;
+        }
+        bool last = step == TDirectoryWalker::Step::End;
+        if (!last) {
+            producer->page.push_back(std::move(entry));
+            if (static_cast<int>(producer->page.size()) < producer->pageSize) {
+                continue;
+            }
+        }
+        appendPage(producer, last);
+        if (last) {
+            return;
+        }
+    }
+}
+
+void TDirectoryStreamBody::appendPage(const std::shared_ptr<Producer>& producer, bool last)
+{
+    QByteArray page;
+    TJsonWriter writer(&page);
+    writer.beginArray();
+    for (const TDirectoryWalker::Entry& entry : producer->page) {
+        Models::FieldCodec<Models::ListDirectoryResponse::FileInfo>::write(writer, producer->walker->fileInfo(entry));
+    }
+    writer.endArray();
+    page.append('\n');
+    int count = static_cast<int>(producer->page.size());
+    producer->page.clear();
+
+    std::lock_guard<std::mutex> lock(producer->mutex);
+    bool wasEmpty = producer->pending.isEmpty();
+    // 上一页恰好取完时不再发送空页；目录为空时仍发送一个空页
+    if (count > 0 || producer->pages == 0) {
+        producer->pending.append(page);
+        producer->entries += count;
+        ++producer->pages;
+    }
+    if (last) {
+        producer->finished = true;
+        producer->running = false;
+        producer->skipped = producer->walker->skippedDirectories();
+    }
+    // 会话线程只在取空数据后挂起，此时才需要通知
+    if ((wasEmpty || last) && producer->context) {
+        TDirectoryStreamBody* body = producer->body;
+        QMetaObject::invokeMethod(producer->context, [body]() {
+            body->notifyReadyRead();
+        }, Qt::QueuedConnection);
+    } else if ((wasEmpty || last) && producer->notifyDirectly) {
+        // 持有锁调用：流对象析构时先在锁内清除 notifyDirectly，之后不会再被调用
+        producer->body->notifyReadyRead();
+    }
+}
+
+QByteArray TDirectoryStreamBody::read(qint64 maxSize)
+{
+    std::lock_guard<std::mutex> lock(m_producer->mutex);
+    QByteArray data;
+    if (m_producer->pending.size() <= maxSize) {
+        data.swap(m_producer->pending);
+    } else {
+        data = m_producer->pending.left(static_cast<int>(maxSize));
+        m_producer->pending.remove(0, static_cast<int>(maxSize));
+    }
+    schedule(m_producer);
+    return data;
+}
+
+bool TDirectoryStreamBody::atEnd() const
+{
+    std::lock_guard<std::mutex> lock(m_producer->mutex);
+    return m_producer->finished && m_producer->pending.isEmpty();
+}
+
+// 只在 read() 取空之后调用：此后新生成的页必然会通知，未结束就可以挂起；
+// 不能只看 pending 是否为空，否则取空与检查之间生成的页会被当成流意外结束
+bool TDirectoryStreamBody::waitingForData() const
+{
+    return !atEnd();
+}
+
+QJsonObject TDirectoryStreamBody::completion() const
+{
+    std::lock_guard<std::mutex> lock(m_producer->mutex);
+    QJsonObject obj;
+    obj["entries"] = m_producer->entries;
+    obj["pages"] = m_producer->pages;
+    obj["skippedDirectories"] = m_producer->skipped;
+    return obj;
+}
@@ -0,0 +1,130 @@
+#ifndef TDIRECTORYWALKER_H
+#define TDIRECTORYWALKER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Models.h"
+#include "TStreamBody.h"
+
+// 目录遍历器："ld" 的实现
+//
+// 条目按先序输出：同一目录内按名称字节序排序，子目录的内容紧跟在该子目录之后，
+// 因此任意条目的相对路径都可以作为续传游标，下一页从它之后继续，已输出的子树被整体跳过。
+// 目录内容在线程池中读取（Linux 上直接用 getdents64/fstatat），进入当前目录时
+// 预先提交其子目录的读取，输出顺序仍由调用线程决定；只在需要大小或修改时间时才 stat。
+// 从游标续传时，游标路径上的目录只保留游标之后的条目；非流式分页还会暂存遍历器，
+// 下一页直接续用，不再重新读取这些目录
+class TDirectoryWalker
+{
+public:
+    struct Options {
+        QString root;
+        int depth = 0;              // 递归深度：0 只列出 root 下的条目，-1 不限
+        QStringList patterns;       // 通配符，匹配条目名称；为空时不过滤，不影响遍历
+        bool includeHidden = false;
+        bool wantType = true;
+        bool wantSize = true;
+        bool wantModified = true;
+        QString cursor;             // 上一页最后一个条目的相对路径
+    };
+
+    struct Entry {
+        QByteArray path;            // 相对 root 的路径，'/' 分隔
+        bool isDirectory = false;
+        qint64 size = 0;
+        qint64 lastModified = 0;    // 毫秒时间戳
+    };
+
+    struct Listing;
+
+    enum class Step {
+        Entry,
+        Pending,                    // 当前目录尚未读完
+        End
+    };
+
+    explicit TDirectoryWalker(const Options& options);
+    ~TDirectoryWalker();
+
+    TDirectoryWalker(const TDirectoryWalker&) = delete;
+    TDirectoryWalker& operator=(const TDirectoryWalker&) = delete;
+
+    // 同步读取 root，失败时填写原因；notFound 表示 root 不存在或不是目录
+    bool start(QString* errorReason, bool* notFound);
+
+    // 取下一个条目，遍历结束时返回 false；需要时等待目录读取完成
+    bool next(Entry* entry);
+
+    // 不等待的 next()：当前目录尚未读完时登记 wake（读完后在线程池中调用一次）并返回 Pending
+    Step step(Entry* entry, const std::function<void()>& wake);
+
+    // 是否还有条目；预读的条目由下一次 next() 返回
+    bool hasMore();
+
+    // 暂存本页之后还有条目的遍历器，cursor 为本页最后一个条目；最多暂存 32 个，60 秒后丢弃
+    static void suspend(std::unique_ptr<TDirectoryWalker> walker, const QString& cursor);
+
+    // 取出参数和游标都与 options 相同的暂存遍历器，没有时返回空
+    static std::unique_ptr<TDirectoryWalker> resume(const Options& options);
+
+    // 无法读取而被跳过的子目录数
+    int skippedDirectories() const { return m_skipped; }
+
+    // 按请求的字段转换为响应条目，lastModified 只在需要时格式化
+    Models::ListDirectoryResponse::FileInfo fileInfo(const Entry& entry) const;
+
+private:
+    struct Frame;
+
+    static QByteArray suspensionKey(const Options& options, const QString& cursor);
+
+    // from 非空时只读取名称不小于它的条目
+    std::shared_ptr<Listing> submit(const QByteArray& path, const QByteArray& from = QByteArray());
+    bool enterFrame(Frame& frame);
+    void prefetch(Frame& frame);
+    bool matches(const QByteArray& name) const;
+
+    Options m_options;
+    QByteArray m_root;
+    std::vector<QByteArray> m_patterns;
+    std::vector<Frame> m_stack;
+    int m_outstanding = 0;          // 已提交但尚未进入的目录读取
+    int m_skipped = 0;
+    Entry m_lookahead;              // hasMore() 预读的条目
+    bool m_hasLookahead = false;
+};
+
+// 流式目录列表：每个数据块由若干页组成，每页是一行 JSON 数组（以 '\n' 结尾），
+// 数据块边界不一定与页对齐，客户端按数据块偏移拼接后逐行解析
+// 推送型数据源：页面由生成任务在目录读取的线程池中组装，遇到尚未读完的目录时不等待，
+// 读完后再继续；read() 只取走已生成的数据，没有时会话挂起该流直到新页生成
+class TDirectoryStreamBody : public TStreamBody
+{
+public:
+    // walker 须已 start() 成功
+    TDirectoryStreamBody(std::unique_ptr<TDirectoryWalker> walker, int pageSize);
+    ~TDirectoryStreamBody() override;
+
+    bool open(QString* errorReason) override;
+    QByteArray read(qint64 maxSize) override;
+    bool atEnd() const override;
+    QJsonObject completion() const override;
+    bool waitingForData() const override;
+
+private:
+    struct Producer;
+
+    // 在持有 producer->mutex 时调用：没有任务在运行且缓冲未满时提交生成任务
+    static void schedule(const std::shared_ptr<Producer>& producer);
+    static void produce(const std::shared_ptr<Producer>& producer);
+    static void appendPage(const std::shared_ptr<Producer>& producer, bool last);
+
+    std::shared_ptr<Producer> m_producer;   // 与生成任务共享，流对象提前析构时任务在下一次检查时结束
+};
+
+#endif // TDIRECTORYWALKER_H
@@ -0,0 +1,80 @@
+#ifndef TDISPATCHTABLE_H
+#define TDISPATCHTABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 按函数名原始 UTF-8 字节查找的分发表
+// 函数名前 8 字节按大端打包成 64 位键，表按键有序存放，查找为二分 + memcmp，
+// 查找过程不分配堆内存；条目地址在表的生命周期内保持不变
+template<typename Entry>
+class TDispatchTable
+{
+public:
+    static constexpr std::size_t KeyBytes = 8;
+
+    static constexpr std::uint64_t packKey(const char* name, std::size_t size) {
+        std::uint64_t key = 0;
+        for (std::size_t i = 0; i < KeyBytes; ++i) {
+            key = (key << 8) | (i < size ? static_cast<unsigned char>(name[i]) : 0u);
+        }
+        return key;
+    }
+
+    // 查找已注册的条目，未找到返回 nullptr
+    Entry* find(const char* name, std::size_t size) const {
+        const std::uint64_t key = packKey(name, size);
+        auto it = std::lower_bound(m_slots.begin(), m_slots.end(), key,
+                                   [](const Slot& slot, std::uint64_t k) { return slot.key < k; });
+        for (; it != m_slots.end() && it->key == key; ++it) {
+            if (it->name.size() == size && std::memcmp(it->name.data(), name, size) == 0) {
+                return it->entry.get();
+            }
+        }
+        return nullptr;
+    }
+
+    // 查找条目，不存在时插入一个默认构造的条目（仅在注册阶段调用）
+    Entry& findOrInsert(const char* name, std::size_t size) {
+        if (Entry* entry = find(name, size)) {
+            return *entry;
+        }
+
+        Slot slot;
+        slot.key = packKey(name, size);
+        slot.name.assign(name, size);
+        slot.entry.reset(new Entry());
+
+        auto it = std::lower_bound(m_slots.begin(), m_slots.end(), slot,
+                                   [](const Slot& a, const Slot& b) {
+                                       return a.key < b.key || (a.key == b.key && a.name < b.name);
+                                   });
+        it = m_slots.insert(it, std::move(slot));
+        return *it->entry;
+    }
+
+    std::size_t size() const { return m_slots.size(); }
+
+    // 遍历所有条目：f(const std::string& name, Entry& entry)
+    template<typename Function>
+    void forEach(Function f) const {
+        for (const Slot& slot : m_slots) {
+            f(slot.name, *slot.entry);
+        }
+    }
+
+private:
+    struct Slot {
+        std::uint64_t key = 0;
+        std::string name;
+        std::unique_ptr<Entry> entry;
+    };
+
+    std::vector<Slot> m_slots;
+};
+
+#endif // TDISPATCHTABLE_H
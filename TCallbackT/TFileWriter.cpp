@@ -0,0 +1,529 @@
+#include "TFileWriter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <chrono>
+#include <deque>
+#include <cstring>
+#include "Models.h"
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+// 一轮组提交最多合并的请求数
+constexpr size_t MaxRoundSize = 256;
+
+// 提交任务共用的线程池：任务大多阻塞在落盘上，线程数多于核心数，组提交才有可合并的并发请求
+QThreadPool& commitPool()
+{
+    static QThreadPool* pool = []() {
+        QThreadPool* p = new QThreadPool();
+        p->setMaxThreadCount(qMax(8, 2 * QThread::idealThreadCount()));
+        return p;
+    }();
+    return *pool;
+}
+
+QString errnoString(int error)
+{
+    return QString::fromLocal8Bit(std::strerror(error));
+}
+
+} // namespace
+
+TGroupCommitter& TGroupCommitter::instance()
+{
+    static TGroupCommitter committer;
+    return committer;
+}
+
+TGroupCommitter::TGroupCommitter()
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+TGroupCommitter::~TGroupCommitter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+void TGroupCommitter::setWindow(int usecs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_window = qMax(0, usecs);
+}
+
+bool TGroupCommitter::sync(int fd, int* error)
+{
+    Request request;
+    request.fd = fd;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queue.push_back(&request);
+    m_wake.notify_all();
+    m_done.wait(lock, [&request]() { return request.done; });
+
+    *error = request.error;
+    return request.error == 0;
+}
+
+void TGroupCommitter::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+
+        // 等待并发的写入加入本轮，凑满一轮时提前开始
+        if (m_window > 0) {
+            m_wake.wait_for(lock, std::chrono::microseconds(m_window),
+                            [this]() { return m_stopping || m_queue.size() >= MaxRoundSize; });
+        }
+        std::vector<Request*> round;
+        round.swap(m_queue);
+        lock.unlock();
+
+#ifdef Q_OS_UNIX
+#ifdef Q_OS_LINUX
+        // 先让所有文件同时开始回写，之后的 fdatasync 只需等待，不再逐个排队发起 I/O
+        for (Request* request : round) {
+            ::sync_file_range(request->fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        }
+        for (Request* request : round) {
+            if (::fdatasync(request->fd) != 0) {
+                request->error = errno;
+            }
+        }
+#else
+        for (Request* request : round) {
+            if (::fsync(request->fd) != 0) {
+                request->error = errno;
+            }
+        }
+#endif
+#endif
+
+        lock.lock();
+        for (Request* request : round) {
+            request->done = true;
+        }
+        m_done.notify_all();
+    }
+}
+
+bool TFileWriter::durabilityFromName(const QString& name, Durability* durability)
+{
+    if (name.isEmpty() || name == "none") {
+        *durability = Durability::None;
+    } else if (name == "fdatasync") {
+        *durability = Durability::Data;
+    } else if (name == "group") {
+        *durability = Durability::Group;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+TFileWriter::TFileWriter(const QString& path, bool append, bool atomic, Durability durability)
+    : m_path(path)
+    , m_append(append)
+    , m_atomic(atomic)
+    , m_durability(durability)
+{
+}
+
+TFileWriter::~TFileWriter()
+{
+#ifdef Q_OS_UNIX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    if (m_atomic && !m_committed && !m_tempPath.isEmpty()) {
+        ::unlink(QFile::encodeName(m_tempPath).constData());
+    }
+#endif
+}
+
+bool TFileWriter::open(qint64 expectedSize, QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    const QByteArray path = QFile::encodeName(m_path);
+
+    if (m_atomic) {
+        // 临时文件与目标在同一目录，rename 才是原子的；以 . 开头，目录列表默认不显示
+        static std::atomic<int> counter{0};
+        QFileInfo info(m_path);
+        m_tempPath = info.absolutePath() + QString("/.%1.%2-%3.tmp")
+                         .arg(info.fileName()).arg(::getpid()).arg(counter.fetch_add(1));
+        m_fd = ::open(QFile::encodeName(m_tempPath).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (m_fd < 0) {
+            *errorReason = QString("Cannot create %1: %2").arg(m_tempPath, errnoString(errno));
+            return false;
+        }
+        struct stat target;
+        if (::stat(path.constData(), &target) == 0) {
+            ::fchmod(m_fd, target.st_mode & 07777);
+        }
+    } else {
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (m_append ? 0 : O_TRUNC);
+        m_fd = ::open(path.constData(), flags, 0666);
+        if (m_fd < 0) {
+            *errorReason = QString("Cannot write to file: %1: %2").arg(m_path, errnoString(errno));
+            return false;
+        }
+        if (m_append) {
+            m_base = ::lseek(m_fd, 0, SEEK_END);
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    // 预先分配，避免边写边扩展带来的碎片和元数据更新；文件系统不支持时忽略
+    if (expectedSize > 0) {
+        ::fallocate(m_fd, 0, m_base, expectedSize);
+    }
+#else
+    Q_UNUSED(expectedSize);
+#endif
+    return true;
+#else
+    Q_UNUSED(expectedSize);
+    if (m_atomic) {
+        m_file.reset(new QSaveFile(m_path));
+    } else {
+        m_file.reset(new QFile(m_path));
+    }
+    if (!m_file->open(QIODevice::WriteOnly | (m_append ? QIODevice::Append : QIODevice::Truncate))) {
+        *errorReason = QString("Cannot write to file: %1").arg(m_path);
+        return false;
+    }
+    m_base = m_append ? m_file->size() : 0;
+    return true;
+#endif
+}
+
+bool TFileWriter::write(qint64 offset, const char* data, qint64 size, QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    qint64 written = 0;
+    while (written < size) {
+        ssize_t n = ::pwrite(m_fd, data + written, static_cast<size_t>(size - written),
+                             static_cast<off_t>(m_base + offset + written));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            *errorReason = QString("Write to %1 failed: %2").arg(m_path, errnoString(errno));
+            return false;
+        }
+        written += n;
+    }
+    m_bytesWritten += size;
+    return true;
+#else
+    if (!m_file->seek(m_base + offset) || m_file->write(data, size) != size) {
+        *errorReason = QString("Write to %1 failed: %2").arg(m_path, m_file->errorString());
+        return false;
+    }
+    m_bytesWritten += size;
+    return true;
+#endif
+}
+
+bool TFileWriter::syncDescriptor(int fd, QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    int error = 0;
+    switch (m_durability) {
+    case Durability::None:
+        return true;
+    case Durability::Data:
+#ifdef Q_OS_LINUX
+        if (::fdatasync(fd) != 0) {
+#else
+        if (::fsync(fd) != 0) {
+#endif
+            error = errno;
+        }
+        break;
+    case Durability::Group:
+        TGroupCommitter::instance().sync(fd, &error);
+        break;
+    }
+    if (error != 0) {
+        *errorReason = QString("Sync of %1 failed: %2").arg(m_path, errnoString(error));
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(errorReason);
+    return true;
+#endif
+}
+
+bool TFileWriter::commit(QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    if (!syncDescriptor(m_fd, errorReason)) {
+        return false;
+    }
+    int fd = m_fd;
+    m_fd = -1;
+    if (::close(fd) != 0) {
+        *errorReason = QString("Close of %1 failed: %2").arg(m_path, errnoString(errno));
+        return false;
+    }
+
+    if (m_atomic) {
+        if (::rename(QFile::encodeName(m_tempPath).constData(), QFile::encodeName(m_path).constData()) != 0) {
+            *errorReason = QString("Rename to %1 failed: %2").arg(m_path, errnoString(errno));
+            return false;
+        }
+        m_committed = true;
+
+        // rename 记录在目录中，目录也同步后替换才不会在崩溃后丢失
+        if (m_durability != Durability::None) {
+            int directory = ::open(QFile::encodeName(QFileInfo(m_path).absolutePath()).constData(),
+                                   O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (directory < 0) {
+                *errorReason = QString("Cannot open directory of %1: %2").arg(m_path, errnoString(errno));
+                return false;
+            }
+            bool ok = syncDescriptor(directory, errorReason);
+            ::close(directory);
+            return ok;
+        }
+    }
+    m_committed = true;
+    return true;
+#else
+    bool ok = m_atomic ? static_cast<QSaveFile*>(m_file.get())->commit() : m_file->flush();
+    if (!ok) {
+        *errorReason = QString("Write to %1 failed: %2").arg(m_path, m_file->errorString());
+    }
+    m_file->close();
+    m_committed = ok;
+    return ok;
+#endif
+}
+
+// 与写入任务共享：数据块按到达顺序排队，由线程池中的一个任务依次写入，收齐后由同一任务落盘；
+// context 在会话线程创建和销毁，任务在锁内检查后才向它投递结果
+struct TUploadStreamBody::Commit {
+    std::unique_ptr<TFileWriter> writer;
+    std::mutex mutex;
+    std::condition_variable drained;    // 排队的字节减少或写入失败
+    QObject* context = nullptr;
+    std::deque<std::pair<qint64, QByteArray>> chunks;
+    qint64 queuedBytes = 0;
+    bool running = false;               // 写入任务正在运行
+    bool commitRequested = false;
+    bool cancelled = false;             // 流对象在收齐之前析构，剩余的数据块不再写入，也不落盘
+    QString error;                      // 写入失败的原因
+};
+
+TUploadStreamBody::TUploadStreamBody(std::unique_ptr<TFileWriter> writer, qint64 size)
+    : m_commit(std::make_shared<Commit>())
+    , m_size(size)
+{
+    m_commit->writer = std::move(writer);
+}
+
+TUploadStreamBody::~TUploadStreamBody()
+{
+    std::lock_guard<std::mutex> lock(m_commit->mutex);
+    delete m_commit->context;
+    m_commit->context = nullptr;
+    // 已收齐的上传照常写完并落盘，未收齐的丢弃剩余数据块
+    if (m_state == State::Receiving) {
+        m_commit->cancelled = true;
+        m_commit->chunks.clear();
+        m_commit->queuedBytes = 0;
+    }
+}
+
+bool TUploadStreamBody::open(QString* errorReason)
+{
+    Q_UNUSED(errorReason);
+    {
+        std::lock_guard<std::mutex> lock(m_commit->mutex);
+        m_commit->context = new QObject();
+    }
+    if (m_size == 0) {
+        requestCommit();
+    }
+    return true;
+}
+
+bool TUploadStreamBody::receiveChunk(qint64 offset, const QByteArray& data, bool final)
+{
+    if (m_state != State::Receiving) {
+        return m_state != State::Failed;
+    }
+    // 数据块须按顺序首尾相接：收齐与否按字节数判断，重发或乱序的数据块会在文件中留下空洞
+    if (offset != m_received) {
+        fail(QString("Chunk at offset %1, expected %2").arg(offset).arg(m_received));
+        return false;
+    }
+    if (m_size >= 0 && offset + data.size() > m_size) {
+        fail(QString("Chunk [%1, %2) is outside the declared size %3").arg(offset).arg(offset + data.size()).arg(m_size));
+        return false;
+    }
+
+    if (!data.isEmpty()) {
+        // 磁盘跟不上时在这里等待写入任务追上，由此限制每个上传占用的内存
+        std::unique_lock<std::mutex> lock(m_commit->mutex);
+        m_commit->drained.wait(lock, [this]() {
+            return m_commit->queuedBytes < MaxQueuedBytes || !m_commit->error.isEmpty();
+        });
+        if (!m_commit->error.isEmpty()) {
+            return false;   // 失败已投递给会话线程，流随后以错误结束
+        }
+        // data 只在调用期间有效
+        m_commit->chunks.emplace_back(offset, QByteArray(data.constData(), data.size()));
+        m_commit->queuedBytes += data.size();
+        scheduleWriter();
+    }
+    m_received += data.size();
+    ++m_chunks;
+
+    // 声明了总大小时以收齐为准，否则以 Final 标志为准
+    if (m_size >= 0 && m_received == m_size) {
+        requestCommit();
+    } else if (final) {
+        if (m_size >= 0) {
+            fail(QString("Upload ended after %1 of %2 bytes").arg(m_received).arg(m_size));
+            return false;
+        }
+        requestCommit();
+    }
+    return true;
+}
+
+void TUploadStreamBody::requestCommit()
+{
+    m_state = State::Committing;
+
+    std::lock_guard<std::mutex> lock(m_commit->mutex);
+    m_commit->commitRequested = true;
+    scheduleWriter();
+}
+
+void TUploadStreamBody::scheduleWriter()
+{
+    if (m_commit->running) {
+        return;
+    }
+    m_commit->running = true;
+
+    std::shared_ptr<Commit> commit = m_commit;
+    commitPool().start([this, commit]() {
+        runWriter(commit, this);
+    });
+}
+
+void TUploadStreamBody::runWriter(const std::shared_ptr<Commit>& commit, TUploadStreamBody* body)
+{
+    // 结果投递给会话线程；流对象已析构时 context 为空，投递的调用也随 context 的销毁而取消
+    auto report = [&commit, body](bool ok, const QString& errorReason) {
+        if (commit->context) {
+            QMetaObject::invokeMethod(commit->context, [body, ok, errorReason]() {
+                if (ok) {
+                    body->m_state = State::Done;
+                    body->notifyReadyRead();
+                } else {
+                    body->fail(errorReason);
+                }
+            }, Qt::QueuedConnection);
+        }
+    };
+
+    std::unique_lock<std::mutex> lock(commit->mutex);
+    while (!commit->cancelled && commit->error.isEmpty() && !commit->chunks.empty()) {
+        std::pair<qint64, QByteArray> chunk = std::move(commit->chunks.front());
+        commit->chunks.pop_front();
+        lock.unlock();
+
+        QString errorReason;
+        bool ok = commit->writer->write(chunk.first, chunk.second.constData(), chunk.second.size(), &errorReason);
+
+        lock.lock();
+        commit->queuedBytes -= chunk.second.size();
+        if (!ok) {
+            commit->error = errorReason;
+            commit->chunks.clear();
+            commit->queuedBytes = 0;
+            report(false, errorReason);
+        }
+        commit->drained.notify_all();
+    }
+
+    if (!commit->cancelled && commit->error.isEmpty() && commit->commitRequested) {
+        commit->commitRequested = false;
+        lock.unlock();
+
+        QString errorReason;
+        bool ok = commit->writer->commit(&errorReason);
+
+        lock.lock();
+        if (!ok) {
+            commit->error = errorReason;
+        }
+        report(ok, errorReason);
+    }
+    commit->running = false;
+}
+
+void TUploadStreamBody::fail(const QString& reason)
+{
+    m_state = State::Failed;
+    m_error = reason;
+    notifyReadyRead();
+}
+
+QByteArray TUploadStreamBody::read(qint64 maxSize)
+{
+    Q_UNUSED(maxSize);
+    return QByteArray();
+}
+
+bool TUploadStreamBody::atEnd() const
+{
+    return m_state == State::Done;
+}
+
+QString TUploadStreamBody::errorString() const
+{
+    return m_error;
+}
+
+bool TUploadStreamBody::waitingForData() const
+{
+    return m_state == State::Receiving || m_state == State::Committing;
+}
+
+QJsonObject TUploadStreamBody::completion() const
+{
+    Models::WriteFileResponse result;
+    result.message = "File written successfully";
+    result.bytesWritten = m_commit->writer->bytesWritten();
+    result.chunks = m_chunks;
+    return result.toJsonValue().toObject();
+}
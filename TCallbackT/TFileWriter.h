@@ -0,0 +1,141 @@
+#ifndef TFILEWRITER_H
+#define TFILEWRITER_H
+
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TStreamBody.h"
+
+class QFileDevice;
+
+// 组提交：并发写入的落盘请求合并为一轮，先对本轮所有文件启动回写（sync_file_range），
+// 再逐个 fdatasync；这些 fdatasync 共享同一次日志提交，N 个并发写入的落盘开销接近一次
+class TGroupCommitter
+{
+public:
+    static TGroupCommitter& instance();
+
+    // 收到一轮的第一个请求后再等待 usecs 微秒，让并发的写入加入本轮（默认 500）
+    void setWindow(int usecs);
+
+    // 阻塞直到 fd 的数据落盘，失败时返回 false 并填写 errno
+    bool sync(int fd, int* error);
+
+private:
+    struct Request {
+        int fd = -1;
+        int error = 0;
+        bool done = false;
+    };
+
+    TGroupCommitter();
+    ~TGroupCommitter();
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;     // 有新请求或退出
+    std::condition_variable m_done;     // 一轮结束
+    std::vector<Request*> m_queue;
+    int m_window = 500;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+// 文件写入：按偏移写入已打开的描述符，可选原子替换（同目录临时文件 + rename）和落盘方式
+// "wf" 的整体写入与分块上传共用；非 Unix 平台上经 QFile/QSaveFile 顺序写入，不支持 durability
+class TFileWriter
+{
+public:
+    enum class Durability {
+        None,       // 只写入页缓存
+        Data,       // 提交时 fdatasync
+        Group       // 提交时经 TGroupCommitter 与并发的写入合并落盘
+    };
+
+    // "none"（或空）、"fdatasync"、"group"，无法识别时返回 false
+    static bool durabilityFromName(const QString& name, Durability* durability);
+
+    // atomic 与 append 不能同时使用
+    TFileWriter(const QString& path, bool append, bool atomic, Durability durability);
+    ~TFileWriter();
+
+    TFileWriter(const TFileWriter&) = delete;
+    TFileWriter& operator=(const TFileWriter&) = delete;
+
+    // 打开目标文件（atomic 时为临时文件，目标已存在则沿用其权限），expectedSize >= 0 时预分配空间
+    bool open(qint64 expectedSize, QString* errorReason);
+
+    // 写入到相对起点的 offset 处，append 时起点为原文件末尾；不同区间可以在不同线程并发写入
+    bool write(qint64 offset, const char* data, qint64 size, QString* errorReason);
+
+    // 按 durability 落盘并关闭，atomic 时 rename 替换目标文件并同步所在目录
+    // 会阻塞在磁盘 I/O 上，不要在会话线程调用；未提交就析构时删除临时文件
+    bool commit(QString* errorReason);
+
+    qint64 bytesWritten() const { return m_bytesWritten.load(); }
+
+private:
+    bool syncDescriptor(int fd, QString* errorReason);
+
+    QString m_path;
+    QString m_tempPath;
+    bool m_append;
+    bool m_atomic;
+    Durability m_durability;
+    int m_fd = -1;
+    qint64 m_base = 0;
+    std::atomic<qint64> m_bytesWritten{0};
+    bool m_committed = false;
+    std::unique_ptr<QFileDevice> m_file;    // 非 Unix 平台
+};
+
+// "wf" 分块上传：推送型数据源，本身没有数据要发送，只等待对端的上传数据块帧
+// 数据块须按顺序首尾相接，复制后排队由线程池中的任务依次写入，全部收到后由同一任务落盘和 rename，
+// 之后结束流，完成响应携带写入的字节数；排队的数据超过 MaxQueuedBytes 时会话线程等待写入追上
+class TUploadStreamBody : public TStreamBody
+{
+public:
+    // writer 须已 open() 成功；size < 0 表示以带 Final 标志的数据块结束
+    TUploadStreamBody(std::unique_ptr<TFileWriter> writer, qint64 size);
+    ~TUploadStreamBody() override;
+
+    bool open(QString* errorReason) override;
+    QByteArray read(qint64 maxSize) override;
+    bool atEnd() const override;
+    QString errorString() const override;
+    QJsonObject completion() const override;
+    bool waitingForData() const override;
+    bool needsEventLoop() const override { return true; }
+    bool receiveChunk(qint64 offset, const QByteArray& data, bool final) override;
+
+private:
+    struct Commit;
+
+    // 单个上传排队等待写入的字节上限
+    static constexpr qint64 MaxQueuedBytes = 16 * 1024 * 1024;
+
+    void requestCommit();
+    void scheduleWriter();  // 调用方持有 m_commit->mutex
+    static void runWriter(const std::shared_ptr<Commit>& commit, TUploadStreamBody* body);
+    void fail(const QString& reason);
+
+    enum class State {
+        Receiving,
+        Committing,
+        Done,
+        Failed
+    };
+
+    std::shared_ptr<Commit> m_commit;  // 与写入任务共享，流对象提前析构时已收齐的上传照常落盘
+    qint64 m_size;
+    qint64 m_received = 0;
+    qint64 m_chunks = 0;
+    State m_state = State::Receiving;
+    QString m_error;
+};
+
+#endif // TFILEWRITER_H
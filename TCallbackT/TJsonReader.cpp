@@ -0,0 +1,340 @@
+#include "TJsonReader.h"
+#include <cstring>
+
+TJsonReader::TJsonReader(const char* begin, const char* end)
+    : m_begin(begin)
+    , m_pos(begin)
+    , m_end(end)
+{
+}
+
+TJsonReader::TJsonReader(const QByteArray& data)
+    : TJsonReader(data.constData(), data.constData() + data.size())
+{
+}
+
+QString TJsonReader::errorString() const
+{
+    if (!m_error) {
+        return QString();
+    }
+    return QString("%1 at offset %2").arg(QLatin1String(m_error)).arg(m_pos - m_begin);
+}
+
+void TJsonReader::skipWhitespace()
+{
+    while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r')) {
+        ++m_pos;
+    }
+}
+
+bool TJsonReader::atEnd()
+{
+    skipWhitespace();
+    return m_pos >= m_end;
+}
+
+char TJsonReader::peek()
+{
+    skipWhitespace();
+    return m_pos < m_end ? *m_pos : '\0';
+}
+
+bool TJsonReader::consume(char c)
+{
+    if (m_error || peek() != c) {
+        return false;
+    }
+    ++m_pos;
+    return true;
+}
+
+bool TJsonReader::expect(char c)
+{
+    if (consume(c)) {
+        return true;
+    }
+    return fail("unexpected character");
+}
+
+bool TJsonReader::readKey(const char** begin, const char** end)
+{
+    if (peek() != '"') {
+        return fail("object key expected");
+    }
+    *begin = m_pos + 1;
+    if (!skipString()) {
+        return false;
+    }
+    *end = m_pos - 1;
+    return expect(':');
+}
+
+bool TJsonReader::readRawString(const char** begin, const char** end)
+{
+    if (peek() != '"') {
+        return fail("string expected");
+    }
+    const char* start = m_pos + 1;
+    if (!skipString()) {
+        return false;
+    }
+    if (std::memchr(start, '\\', m_pos - 1 - start)) {
+        return fail("escaped characters not supported here");
+    }
+    *begin = start;
+    *end = m_pos - 1;
+    return true;
+}
+
+bool TJsonReader::readString(QString* out)
+{
+    if (peek() != '"') {
+        return fail("string expected");
+    }
+    ++m_pos;
+
+    // 快速路径：无转义字符时直接解码
+    const char* run = m_pos;
+    while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\') {
+        ++m_pos;
+    }
+    if (m_pos < m_end && *m_pos == '"') {
+        *out = QString::fromUtf8(run, static_cast<int>(m_pos - run));
+        ++m_pos;
+        return true;
+    }
+
+    QString result = QString::fromUtf8(run, static_cast<int>(m_pos - run));
+    while (m_pos < m_end) {
+        char c = *m_pos;
+        if (c == '"') {
+            ++m_pos;
+            *out = result;
+            return true;
+        }
+        if (c != '\\') {
+            run = m_pos;
+            while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\') {
+                ++m_pos;
+            }
+            result += QString::fromUtf8(run, static_cast<int>(m_pos - run));
+            continue;
+        }
+
+        if (m_end - m_pos < 2) {
+            break;
+        }
+        char escaped = m_pos[1];
+        m_pos += 2;
+        switch (escaped) {
+        case '"':  result += QLatin1Char('"'); break;
+        case '\\': result += QLatin1Char('\\'); break;
+        case '/':  result += QLatin1Char('/'); break;
+        case 'b':  result += QLatin1Char('\b'); break;
+        case 'f':  result += QLatin1Char('\f'); break;
+        case 'n':  result += QLatin1Char('\n'); break;
+        case 'r':  result += QLatin1Char('\r'); break;
+        case 't':  result += QLatin1Char('\t'); break;
+        case 'u': {
+            if (m_end - m_pos < 4) {
+                return fail("truncated unicode escape");
+            }
+            bool ok = false;
+            ushort code = QByteArray::fromRawData(m_pos, 4).toUShort(&ok, 16);
+            if (!ok) {
+                return fail("invalid unicode escape");
+            }
+            // 代理对按两个 QChar 追加，QString 会自然组合
+            result += QChar(code);
+            m_pos += 4;
+            break;
+        }
+        default:
+            return fail("invalid escape");
+        }
+    }
+    return fail("unterminated string");
+}
+
+bool TJsonReader::scanNumber(const char** begin, const char** end)
+{
+    skipWhitespace();
+    *begin = m_pos;
+    while (m_pos < m_end && std::strchr("+-0123456789.eE", *m_pos) && *m_pos != '\0') {
+        ++m_pos;
+    }
+    *end = m_pos;
+    if (*begin == *end) {
+        return fail("number expected");
+    }
+    return true;
+}
+
+bool TJsonReader::readDouble(double* out)
+{
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    if (!scanNumber(&begin, &end)) {
+        return false;
+    }
+
+    // QByteArray::toDouble 与 C locale 无关
+    bool ok = false;
+    double value = QByteArray::fromRawData(begin, static_cast<int>(end - begin)).toDouble(&ok);
+    if (!ok) {
+        return fail("invalid number");
+    }
+    *out = value;
+    return true;
+}
+
+bool TJsonReader::readInteger(qint64* out)
+{
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    if (!scanNumber(&begin, &end)) {
+        return false;
+    }
+
+    const char* p = begin;
+    bool negative = false;
+    if (*p == '-') {
+        negative = true;
+        ++p;
+    }
+
+    // 按无符号累加并检查上限，负数可以多到 2^63
+    const quint64 limit = negative ? quint64(1) << 63 : (quint64(1) << 63) - 1;
+    const char* digits = p;
+    quint64 value = 0;
+    bool overflow = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        quint64 digit = static_cast<quint64>(*p - '0');
+        if (value > (limit - digit) / 10) {
+            overflow = true;
+        } else {
+            value = value * 10 + digit;
+        }
+        ++p;
+    }
+    if (p == digits) {
+        // 单独的 "-"，或以 "+"、"."、"e" 开头
+        return fail("invalid number");
+    }
+
+    if (p != end) {
+        // 带小数或指数，回退到浮点解析
+        bool ok = false;
+        double d = QByteArray::fromRawData(begin, static_cast<int>(end - begin)).toDouble(&ok);
+        if (!ok) {
+            return fail("invalid number");
+        }
+        if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0)) {
+            return fail("integer out of range");
+        }
+        *out = static_cast<qint64>(d);
+        return true;
+    }
+
+    if (overflow) {
+        return fail("integer out of range");
+    }
+    *out = negative ? static_cast<qint64>(0 - value) : static_cast<qint64>(value);
+    return true;
+}
+
+bool TJsonReader::readBool(bool* out)
+{
+    skipWhitespace();
+    if (m_end - m_pos >= 4 && std::memcmp(m_pos, "true", 4) == 0) {
+        m_pos += 4;
+        *out = true;
+        return true;
+    }
+    if (m_end - m_pos >= 5 && std::memcmp(m_pos, "false", 5) == 0) {
+        m_pos += 5;
+        *out = false;
+        return true;
+    }
+    return fail("boolean expected");
+}
+
+bool TJsonReader::readNull()
+{
+    skipWhitespace();
+    if (m_end - m_pos >= 4 && std::memcmp(m_pos, "null", 4) == 0) {
+        m_pos += 4;
+        return true;
+    }
+    return fail("null expected");
+}
+
+bool TJsonReader::skipString()
+{
+    // m_pos 指向起始引号
+    ++m_pos;
+    while (m_pos < m_end) {
+        if (*m_pos == '\\') {
+            m_pos += 2;
+            continue;
+        }
+        if (*m_pos == '"') {
+            ++m_pos;
+            return true;
+        }
+        ++m_pos;
+    }
+    m_pos = m_end;
+    return fail("unterminated string");
+}
+
+bool TJsonReader::skipValue()
+{
+    char c = peek();
+
+    if (c == '"') {
+        return skipString();
+    }
+
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        while (m_pos < m_end) {
+            char ch = *m_pos;
+            if (ch == '"') {
+                if (!skipString()) {
+                    return false;
+                }
+                continue;
+            }
+            if (ch == '{' || ch == '[') {
+                ++depth;
+            } else if (ch == '}' || ch == ']') {
+                if (--depth == 0) {
+                    ++m_pos;
+                    return true;
+                }
+            }
+            ++m_pos;
+        }
+        return fail("unterminated container");
+    }
+
+    // 数字、true、false、null
+    const char* start = m_pos;
+    while (m_pos < m_end && !std::strchr(",}] \t\r\n", *m_pos)) {
+        ++m_pos;
+    }
+    if (m_pos == start) {
+        return fail("value expected");
+    }
+    return true;
+}
+
+bool TJsonReader::fail(const char* message)
+{
+    if (!m_error) {
+        m_error = message;
+    }
+    return false;
+}
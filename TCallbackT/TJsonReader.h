@@ -0,0 +1,64 @@
+#ifndef TJSONREADER_H
+#define TJSONREADER_H
+
+#include <QByteArray>
+#include <QString>
+
+// 直接在 UTF-8 字节上工作的轻量 JSON 读取器，不构建 QJsonDocument
+// 只做顺序读取和跳过，调用方负责按结构逐个读取
+class TJsonReader
+{
+public:
+    TJsonReader(const char* begin, const char* end);
+    explicit TJsonReader(const QByteArray& data);
+
+    // 当前读取位置
+    const char* position() const { return m_pos; }
+
+    bool hasError() const { return m_error != nullptr; }
+    QString errorString() const;
+
+    // 跳过空白后是否已到末尾
+    bool atEnd();
+
+    // 跳过空白后返回下一个字符，末尾返回 '\0'
+    char peek();
+
+    // 跳过空白后若下一个字符为 c 则消费并返回 true
+    bool consume(char c);
+
+    // 同 consume，但不匹配时记录错误
+    bool expect(char c);
+
+    // 读取对象的键（原始字节，不处理转义）并消费其后的 ':'
+    bool readKey(const char** begin, const char** end);
+
+    // 读取不含转义的字符串，返回引号内的原始字节；含转义时报错
+    bool readRawString(const char** begin, const char** end);
+
+    // 读取字符串值（处理转义）
+    bool readString(QString* out);
+
+    // 读取数值，带小数或指数时按浮点数解析后截断
+    bool readInteger(qint64* out);
+    bool readDouble(double* out);
+
+    bool readBool(bool* out);
+    bool readNull();
+
+    // 跳过任意一个值（对象、数组会整体跳过，不校验内部结构）
+    bool skipValue();
+
+private:
+    void skipWhitespace();
+    bool skipString();
+    bool scanNumber(const char** begin, const char** end);
+    bool fail(const char* message);
+
+    const char* m_begin;
+    const char* m_pos;
+    const char* m_end;
+    const char* m_error = nullptr;
+};
+
+#endif // TJSONREADER_H
@@ -0,0 +1,173 @@
+#include "TJsonWriter.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <cmath>
+#include <cstring>
+
+TJsonWriter::TJsonWriter(QByteArray* out)
+    : m_out(out)
+{
+}
+
+void TJsonWriter::separator()
+{
+    if (m_needComma) {
+        m_out->append(',');
+    }
+}
+
+void TJsonWriter::beginObject()
+{
+    separator();
+    m_out->append('{');
+    m_needComma = false;
+}
+
+void TJsonWriter::endObject()
+{
+    m_out->append('}');
+    m_needComma = true;
+}
+
+void TJsonWriter::beginArray()
+{
+    separator();
+    m_out->append('[');
+    m_needComma = false;
+}
+
+void TJsonWriter::endArray()
+{
+    m_out->append(']');
+    m_needComma = true;
+}
+
+void TJsonWriter::key(const char* name)
+{
+    separator();
+    m_out->append('"').append(name).append("\":");
+    m_needComma = false;
+}
+
+void TJsonWriter::writeString(const char* data, int size)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    m_out->append('"');
+    const char* run = data;
+    const char* end = data + size;
+    for (const char* p = data; p < end; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        // 先追加前面无需转义的部分
+        m_out->append(run, static_cast<int>(p - run));
+        run = p + 1;
+
+        switch (c) {
+        case '"':  m_out->append("\\\""); break;
+        case '\\': m_out->append("\\\\"); break;
+        case '\b': m_out->append("\\b"); break;
+        case '\f': m_out->append("\\f"); break;
+        case '\n': m_out->append("\\n"); break;
+        case '\r': m_out->append("\\r"); break;
+        case '\t': m_out->append("\\t"); break;
+        default: {
+            char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            m_out->append(escaped, sizeof(escaped));
+            break;
+        }
+        }
+    }
+    m_out->append(run, static_cast<int>(end - run));
+    m_out->append('"');
+}
+
+void TJsonWriter::value(const QString& str)
+{
+    separator();
+    QByteArray utf8 = str.toUtf8();
+    writeString(utf8.constData(), utf8.size());
+    m_needComma = true;
+}
+
+void TJsonWriter::value(const char* utf8)
+{
+    separator();
+    writeString(utf8, static_cast<int>(std::strlen(utf8)));
+    m_needComma = true;
+}
+
+void TJsonWriter::value(bool b)
+{
+    separator();
+    m_out->append(b ? "true" : "false");
+    m_needComma = true;
+}
+
+void TJsonWriter::value(int n)
+{
+    value(static_cast<qint64>(n));
+}
+
+void TJsonWriter::value(qint64 n)
+{
+    separator();
+    m_out->append(QByteArray::number(n));
+    m_needComma = true;
+}
+
+void TJsonWriter::value(double d)
+{
+    separator();
+    // JSON 不支持 inf/nan
+    if (std::isfinite(d)) {
+        // 与 QJsonDocument 一致，输出可精确往返的最短表示
+        m_out->append(QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+    } else {
+        m_out->append("null");
+    }
+    m_needComma = true;
+}
+
+void TJsonWriter::value(const QJsonValue& json)
+{
+    switch (json.type()) {
+    case QJsonValue::Bool:
+        value(json.toBool());
+        break;
+    case QJsonValue::Double:
+        value(json.toDouble());
+        break;
+    case QJsonValue::String:
+        value(json.toString());
+        break;
+    case QJsonValue::Array:
+        raw(QJsonDocument(json.toArray()).toJson(QJsonDocument::Compact));
+        break;
+    case QJsonValue::Object:
+        raw(QJsonDocument(json.toObject()).toJson(QJsonDocument::Compact));
+        break;
+    default:
+        null();
+        break;
+    }
+}
+
+void TJsonWriter::null()
+{
+    separator();
+    m_out->append("null");
+    m_needComma = true;
+}
+
+void TJsonWriter::raw(const QByteArray& json)
+{
+    separator();
+    m_out->append(json);
+    m_needComma = true;
+}
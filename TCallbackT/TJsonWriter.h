@@ -0,0 +1,43 @@
+#ifndef TJSONWRITER_H
+#define TJSONWRITER_H
+
+#include <QByteArray>
+#include <QJsonValue>
+#include <QString>
+
+// 直接向 QByteArray 追加 JSON 文本的写入器，不构建 QJsonObject
+// 逗号由写入器自动插入，调用方只需按顺序写键和值
+class TJsonWriter
+{
+public:
+    explicit TJsonWriter(QByteArray* out);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    // 写入对象键，name 为 ASCII 常量，不做转义
+    void key(const char* name);
+
+    void value(const QString& str);
+    void value(const char* utf8);
+    void value(bool b);
+    void value(int n);
+    void value(qint64 n);
+    void value(double d);
+    void value(const QJsonValue& json);
+    void null();
+
+    // 嵌入已序列化好的 JSON 片段
+    void raw(const QByteArray& json);
+
+private:
+    void separator();
+    void writeString(const char* data, int size);
+
+    QByteArray* m_out;
+    bool m_needComma = false;
+};
+
+#endif // TJSONWRITER_H
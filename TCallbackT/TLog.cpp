@@ -0,0 +1,348 @@
+#include "TLog.h"
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+const char* const kLevelNames[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+
+qint64 currentMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 每个线程一个简短编号，便于区分 socket 线程和线程池线程
+quint32 currentThreadNumber()
+{
+    static std::atomic<quint32> next{1};
+    thread_local quint32 number = next.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+} // namespace
+
+TLog& TLog::instance()
+{
+    static TLog log;
+    return log;
+}
+
+TLog::TLog()
+    : m_slots(new Slot[Capacity])
+{
+    for (int i = 0; i < Capacity; ++i) {
+        m_slots[i].sequence.store(static_cast<std::size_t>(i), std::memory_order_relaxed);
+    }
+}
+
+TLog::~TLog()
+{
+    stop();
+}
+
+void TLog::setLevel(Level level)
+{
+    m_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+TLog::Level TLog::level() const
+{
+    return static_cast<Level>(m_level.load(std::memory_order_relaxed));
+}
+
+TLog::Level TLog::levelFromName(const QString& name, Level fallback)
+{
+    QString lower = name.trimmed().toLower();
+    if (lower == "trace") return Level::Trace;
+    if (lower == "debug") return Level::Debug;
+    if (lower == "info") return Level::Info;
+    if (lower == "warn" || lower == "warning") return Level::Warn;
+    if (lower == "error") return Level::Error;
+    return fallback;
+}
+
+void TLog::setPayloadLimit(int bytes)
+{
+    m_payloadLimit.store(qMax(0, bytes), std::memory_order_relaxed);
+}
+
+int TLog::payloadLimit() const
+{
+    return m_payloadLimit.load(std::memory_order_relaxed);
+}
+
+void TLog::setPayloadSampleRate(int rate)
+{
+    m_payloadSampleRate.store(qMax(1, rate), std::memory_order_relaxed);
+}
+
+bool TLog::samplePayload()
+{
+    int rate = m_payloadSampleRate.load(std::memory_order_relaxed);
+    if (rate <= 1) {
+        return true;
+    }
+    thread_local unsigned counter = 0;
+    return counter++ % static_cast<unsigned>(rate) == 0;
+}
+
+bool TLog::start(const QString& filePath)
+{
+    if (m_running.load()) {
+        return true;
+    }
+
+    m_file = stderr;
+    if (!filePath.isEmpty()) {
+        std::FILE* file = std::fopen(filePath.toLocal8Bit().constData(), "a");
+        if (!file) {
+            return false;
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 64 * 1024);
+        m_file = file;
+    }
+
+    m_running.store(true);
+    m_thread = std::thread([this]() { run(); });
+    return true;
+}
+
+void TLog::stop()
+{
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    m_thread.join();
+
+    // 后台线程已退出，写出其后提交的记录
+    drain();
+    std::fflush(m_file);
+    if (m_file != stderr) {
+        std::fclose(m_file);
+    }
+    m_file = nullptr;
+}
+
+void TLog::submit(Level level, const char* text, int length)
+{
+    // 有界 MPSC 队列：每个槽位的序号表示其状态，生产者只竞争 m_enqueuePos
+    std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &m_slots[pos & (Capacity - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 缓冲区已满
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestamp = currentMicroseconds();
+    slot->thread = currentThreadNumber();
+    slot->level = static_cast<quint8>(level);
+    slot->length = static_cast<quint16>(length);
+    std::memcpy(slot->text, text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool TLog::drain()
+{
+    bool any = false;
+    for (;;) {
+        Slot& slot = m_slots[m_dequeuePos & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1) {
+            break;
+        }
+        writeSlot(slot);
+        slot.sequence.store(m_dequeuePos + Capacity, std::memory_order_release);
+        ++m_dequeuePos;
+        any = true;
+    }
+
+    quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        std::fprintf(m_file, "%s WARN  [log] dropped=%llu reason=\"buffer full\"\n",
+                     m_cachedPrefix, static_cast<unsigned long long>(dropped));
+    }
+    return any;
+}
+
+void TLog::writeSlot(const Slot& slot)
+{
+    qint64 second = slot.timestamp / 1000000;
+    if (second != m_cachedSecond) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm local;
+        localtime_r(&time, &local);
+        std::strftime(m_cachedPrefix, sizeof(m_cachedPrefix), "%Y-%m-%d %H:%M:%S", &local);
+        m_cachedSecond = second;
+    }
+
+    std::fprintf(m_file, "%s.%06d %s [t%u] ", m_cachedPrefix,
+                 static_cast<int>(slot.timestamp % 1000000), kLevelNames[slot.level], slot.thread);
+    std::fwrite(slot.text, 1, slot.length, m_file);
+    std::fputc('\n', m_file);
+}
+
+void TLog::run()
+{
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (!drain()) {
+            // 空闲时刷新文件并短暂休眠，生产者不需要唤醒消费者
+            std::fflush(m_file);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+}
+
+TLogRecord::TLogRecord(TLog::Level level, const char* event)
+    : m_level(level)
+{
+    append(event, std::strlen(event));
+}
+
+TLogRecord::~TLogRecord()
+{
+    TLog::instance().submit(m_level, m_text, m_length);
+}
+
+void TLogRecord::append(const char* data, std::size_t size)
+{
+    std::size_t room = static_cast<std::size_t>(TLog::TextSize - m_length);
+    if (size > room) {
+        size = room;
+    }
+    std::memcpy(m_text + m_length, data, size);
+    m_length += static_cast<int>(size);
+}
+
+void TLogRecord::appendKey(const char* key)
+{
+    append(" ", 1);
+    append(key, std::strlen(key));
+    append("=", 1);
+}
+
+void TLogRecord::appendQuoted(const char* data, std::size_t size)
+{
+    // 一条记录保持一行：转义引号、反斜杠和换行，其它控制字符替换为 '?'
+    append("\"", 1);
+    for (std::size_t i = 0; i < size && m_length < TLog::TextSize; ++i) {
+        char c = data[i];
+        switch (c) {
+        case '"':  append("\\\"", 2); break;
+        case '\\': append("\\\\", 2); break;
+        case '\n': append("\\n", 2); break;
+        case '\r': append("\\r", 2); break;
+        case '\t': append("\\t", 2); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                c = '?';
+            }
+            append(&c, 1);
+            break;
+        }
+    }
+    append("\"", 1);
+}
+
+TLogRecord& TLogRecord::field(const char* key, bool value)
+{
+    appendKey(key);
+    if (value) {
+        append("true", 4);
+    } else {
+        append("false", 5);
+    }
+    return *this;
+}
+
+TLogRecord& TLogRecord::field(const char* key, double value)
+{
+    appendKey(key);
+    char buffer[32];
+    int size = std::snprintf(buffer, sizeof(buffer), "%g", value);
+    append(buffer, static_cast<std::size_t>(qMax(0, size)));
+    return *this;
+}
+
+TLogRecord& TLogRecord::field(const char* key, const char* value)
+{
+    appendKey(key);
+    appendQuoted(value, std::strlen(value));
+    return *this;
+}
+
+TLogRecord& TLogRecord::field(const char* key, const QString& value)
+{
+    appendKey(key);
+    QByteArray utf8 = value.toUtf8();
+    appendQuoted(utf8.constData(), static_cast<std::size_t>(utf8.size()));
+    return *this;
+}
+
+TLogRecord& TLogRecord::field(const char* key, const QByteArray& value)
+{
+    appendKey(key);
+    appendQuoted(value.constData(), static_cast<std::size_t>(value.size()));
+    return *this;
+}
+
+bool TLogRecord::payloadSampled(int* limit)
+{
+    TLog& log = TLog::instance();
+    *limit = log.payloadLimit();
+    return *limit > 0 && log.samplePayload();
+}
+
+void TLogRecord::appendPayload(const char* data, int size, int limit, bool truncated)
+{
+    int shown = qMin(size, limit);
+    // 不在 UTF-8 多字节字符中间截断
+    while (shown < size && shown > 0 && (static_cast<unsigned char>(data[shown]) & 0xC0) == 0x80) {
+        --shown;
+    }
+
+    appendKey("payload");
+    appendQuoted(data, static_cast<std::size_t>(shown));
+    if (truncated || shown < size) {
+        field("truncated", true);
+    }
+}
+
+TLogRecord& TLogRecord::payload(const char* data, int size)
+{
+    field("bytes", size);
+    int limit = 0;
+    if (payloadSampled(&limit)) {
+        appendPayload(data, size, limit, false);
+    }
+    return *this;
+}
+
+TLogRecord& TLogRecord::payload(const QByteArray& data)
+{
+    return payload(data.constData(), data.size());
+}
+
+TLogRecord& TLogRecord::payload(const QString& data)
+{
+    field("chars", data.size());
+    int limit = 0;
+    if (payloadSampled(&limit)) {
+        // 只编码会被记录的前缀，避免为大消息整体转换
+        QByteArray head = data.left(limit).toUtf8();
+        appendPayload(head.constData(), head.size(), limit, data.size() > limit);
+    }
+    return *this;
+}
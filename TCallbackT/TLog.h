@@ -0,0 +1,157 @@
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// 编译期最低日志级别，低于该级别的日志语句整体消除（0=trace 1=debug 2=info 3=warn 4=error）
+#ifndef TLOG_MIN_LEVEL
+#define TLOG_MIN_LEVEL 1
+#endif
+
+// 异步日志：记录在调用线程格式化为一行 "event key=value ..." 文本，
+// 写入无锁有界环形缓冲区（多生产者、单消费者），由后台线程加上时间戳后写入文件
+// 缓冲区满时丢弃记录并计数，调用线程从不阻塞
+class TLog
+{
+public:
+    enum class Level {
+        Trace = 0,
+        Debug = 1,
+        Info = 2,
+        Warn = 3,
+        Error = 4
+    };
+
+    static constexpr int Capacity = 4096;   // 环形缓冲区槽位数（2 的幂）
+    static constexpr int TextSize = 480;    // 单条记录的最大文本长度，超出部分截断
+
+    static TLog& instance();
+
+    // 运行期级别检查，日志宏先检查编译期级别再调用
+    static bool isEnabled(Level level) {
+        return static_cast<int>(level) >= instance().m_level.load(std::memory_order_relaxed);
+    }
+
+    void setLevel(Level level);
+    Level level() const;
+
+    // 按名称解析级别（trace/debug/info/warn/error），无法识别时返回 fallback
+    static Level levelFromName(const QString& name, Level fallback);
+
+    // payload() 记录的最大字节数，超出部分截断
+    void setPayloadLimit(int bytes);
+    int payloadLimit() const;
+
+    // 每个线程每 rate 条 payload 记录一次内容，其余只记录长度；1 表示全部记录
+    void setPayloadSampleRate(int rate);
+    bool samplePayload();
+
+    // 启动后台写入线程，filePath 为空时写到 stderr；start 之前的记录会暂存在缓冲区中
+    bool start(const QString& filePath = QString());
+
+    // 写出剩余记录并停止后台线程
+    void stop();
+
+    // 由 TLogRecord 调用
+    void submit(Level level, const char* text, int length);
+
+private:
+    TLog();
+    ~TLog();
+
+    struct Slot {
+        std::atomic<std::size_t> sequence{0};
+        qint64 timestamp = 0;   // 微秒（系统时钟）
+        quint32 thread = 0;
+        quint8 level = 0;
+        quint16 length = 0;
+        char text[TextSize];
+    };
+
+    bool drain();
+    void writeSlot(const Slot& slot);
+    void run();
+
+    std::atomic<int> m_level{static_cast<int>(Level::Info)};
+    std::atomic<int> m_payloadLimit{256};
+    std::atomic<int> m_payloadSampleRate{1};
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<std::size_t> m_enqueuePos{0};
+    std::size_t m_dequeuePos = 0;                // 仅后台线程访问
+    std::atomic<quint64> m_dropped{0};
+
+    std::FILE* m_file = nullptr;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    // 后台线程缓存的时间戳前缀（精确到秒）
+    qint64 m_cachedSecond = -1;
+    char m_cachedPrefix[32] = {};
+};
+
+// 单条日志记录：在栈上拼接文本，析构时提交到 TLog
+// 通过 TLOG_xxx 宏使用，级别未开启时不会构造
+class TLogRecord
+{
+public:
+    TLogRecord(TLog::Level level, const char* event);
+    ~TLogRecord();
+
+    TLogRecord(const TLogRecord&) = delete;
+    TLogRecord& operator=(const TLogRecord&) = delete;
+
+    template<typename T, typename = std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+    TLogRecord& field(const char* key, T value) {
+        appendKey(key);
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        append(buffer, result.ptr - buffer);
+        return *this;
+    }
+
+    TLogRecord& field(const char* key, bool value);
+    TLogRecord& field(const char* key, double value);
+    TLogRecord& field(const char* key, const char* value);
+    TLogRecord& field(const char* key, const QString& value);
+    TLogRecord& field(const char* key, const QByteArray& value);
+
+    // 消息内容：总是记录字节数，内容按 TLog 的截断长度和采样率记录
+    TLogRecord& payload(const char* data, int size);
+    TLogRecord& payload(const QByteArray& data);
+    TLogRecord& payload(const QString& data);
+
+private:
+    void appendKey(const char* key);
+    void append(const char* data, std::size_t size);
+    void appendQuoted(const char* data, std::size_t size);
+    bool payloadSampled(int* limit);
+    void appendPayload(const char* data, int size, int limit, bool truncated);
+
+    TLog::Level m_level;
+    int m_length = 0;
+    char m_text[TLog::TextSize];
+};
+
+#define TLOG_ENABLED(level) \
+    (static_cast<int>(TLog::Level::level) >= TLOG_MIN_LEVEL && TLog::isEnabled(TLog::Level::level))
+
+// 用法：TLOG_DEBUG("recv").field("seq", sequence).payload(message);
+#define TLOG(level, event) \
+    if (!TLOG_ENABLED(level)) {} else TLogRecord(TLog::Level::level, event)
+
+#define TLOG_TRACE(event) TLOG(Trace, event)
+#define TLOG_DEBUG(event) TLOG(Debug, event)
+#define TLOG_INFO(event)  TLOG(Info, event)
+#define TLOG_WARN(event)  TLOG(Warn, event)
+#define TLOG_ERROR(event) TLOG(Error, event)
+
+#endif // TLOG_H
@@ -0,0 +1,296 @@
+#include "TMetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// 分片只有一个写者：用 load + store 代替 fetch_add，避免带锁前缀的指令
+inline void bump(std::atomic<quint64>& counter, quint64 delta = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+inline int highestBit(quint64 value)
+{
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+Models::MetricsResponse::LatencySummary summarize(const TLatencySummary& summary)
+{
+    // 输出单位为微秒
+    Models::MetricsResponse::LatencySummary result;
+    result.count = static_cast<qint64>(summary.count());
+    result.mean = summary.mean() / 1000.0;
+    result.p50 = summary.percentile(0.50) / 1000.0;
+    result.p90 = summary.percentile(0.90) / 1000.0;
+    result.p99 = summary.percentile(0.99) / 1000.0;
+    result.p999 = summary.percentile(0.999) / 1000.0;
+    result.max = summary.max() / 1000.0;
+    return result;
+}
+
+} // namespace
+
+int TLatencyHistogram::bucketIndex(quint64 value)
+{
+    if (value < static_cast<quint64>(SubBucketCount)) {
+        return static_cast<int>(value);
+    }
+    int exponent = highestBit(value);
+    if (exponent >= MaxExponent) {
+        return BucketCount - 1;
+    }
+    int shift = exponent - SubBucketBits;
+    return (shift + 1) * SubBucketCount + static_cast<int>((value >> shift) & (SubBucketCount - 1));
+}
+
+quint64 TLatencyHistogram::bucketValue(int index)
+{
+    if (index < SubBucketCount) {
+        return static_cast<quint64>(index);
+    }
+    int shift = index / SubBucketCount - 1;
+    quint64 lower = static_cast<quint64>(SubBucketCount + index % SubBucketCount) << shift;
+    return lower + ((quint64(1) << shift) >> 1);
+}
+
+void TLatencyHistogram::record(quint64 value)
+{
+    bump(m_buckets[bucketIndex(value)]);
+    bump(m_count);
+    bump(m_sum, value);
+    if (value > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void TLatencySummary::merge(const TLatencyHistogram& histogram)
+{
+    for (int i = 0; i < TLatencyHistogram::BucketCount; ++i) {
+        m_buckets[i] += histogram.m_buckets[i].load(std::memory_order_relaxed);
+    }
+    m_count += histogram.m_count.load(std::memory_order_relaxed);
+    m_sum += histogram.m_sum.load(std::memory_order_relaxed);
+    m_max = std::max(m_max, histogram.m_max.load(std::memory_order_relaxed));
+}
+
+double TLatencySummary::mean() const
+{
+    return m_count > 0 ? static_cast<double>(m_sum) / m_count : 0.0;
+}
+
+quint64 TLatencySummary::percentile(double q) const
+{
+    // 各桶计数与总数分别读取，按桶累计的总数为准
+    quint64 total = 0;
+    for (quint64 count : m_buckets) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    quint64 target = static_cast<quint64>(std::ceil(q * total));
+    target = std::max<quint64>(1, std::min(target, total));
+
+    quint64 seen = 0;
+    for (int i = 0; i < TLatencyHistogram::BucketCount; ++i) {
+        seen += m_buckets[i];
+        if (seen >= target) {
+            return std::min(TLatencyHistogram::bucketValue(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+QJsonObject TLatencySummary::toJson() const
+{
+    QJsonObject json;
+    json["count"] = static_cast<qint64>(m_count);
+    json["mean"] = mean() / 1000.0;
+    json["p50"] = percentile(0.50) / 1000.0;
+    json["p90"] = percentile(0.90) / 1000.0;
+    json["p99"] = percentile(0.99) / 1000.0;
+    json["p999"] = percentile(0.999) / 1000.0;
+    json["max"] = m_max / 1000.0;
+    return json;
+}
+
+double TLatencySummary::changePercent(double current, double baseline)
+{
+    return baseline != 0.0 ? (current - baseline) / baseline * 100.0 : 0.0;
+}
+
+struct TMetrics::ShardHolder {
+    Shard* shard = nullptr;
+
+    ~ShardHolder() {
+        if (shard) {
+            TMetrics::instance().releaseShard(shard);
+        }
+    }
+};
+
+TMetrics::Shard::~Shard()
+{
+    for (std::atomic<FunctionShard*>& function : functions) {
+        delete function.load(std::memory_order_relaxed);
+    }
+}
+
+TMetrics::FunctionShard* TMetrics::Shard::function(int id)
+{
+    FunctionShard* result = functions[id].load(std::memory_order_relaxed);
+    if (!result) {
+        // 只有所属线程分配；release 保证读者看到初始化完成的对象
+        result = new FunctionShard();
+        functions[id].store(result, std::memory_order_release);
+    }
+    return result;
+}
+
+TMetrics& TMetrics::instance()
+{
+    static TMetrics metrics;
+    return metrics;
+}
+
+qint64 TMetrics::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int TMetrics::registerFunction(const char* name, std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string key(name, size);
+    auto it = std::find(m_names.begin(), m_names.end(), key);
+    if (it != m_names.end()) {
+        return static_cast<int>(it - m_names.begin());
+    }
+    if (static_cast<int>(m_names.size()) >= MaxFunctions) {
+        return -1;
+    }
+    m_names.push_back(key);
+    return static_cast<int>(m_names.size()) - 1;
+}
+
+TMetrics::Shard* TMetrics::shard()
+{
+    thread_local ShardHolder holder;
+    if (!holder.shard) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeShards.empty()) {
+            holder.shard = m_freeShards.back();
+            m_freeShards.pop_back();
+        } else {
+            m_shards.emplace_back(new Shard());
+            holder.shard = m_shards.back().get();
+        }
+    }
+    return holder.shard;
+}
+
+void TMetrics::releaseShard(Shard* shard)
+{
+    // 计数保留在分片中，新线程接手后继续累加
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeShards.push_back(shard);
+}
+
+void TMetrics::recordRequest(int id, qint64 bytesIn)
+{
+    if (id < 0) {
+        return;
+    }
+    FunctionShard* function = shard()->function(id);
+    bump(function->requests);
+    bump(function->bytesIn, static_cast<quint64>(bytesIn));
+}
+
+void TMetrics::recordLatency(int id, Stage stage, qint64 nanoseconds)
+{
+    if (id < 0) {
+        return;
+    }
+    shard()->function(id)->stages[static_cast<int>(stage)].record(static_cast<quint64>(qMax<qint64>(0, nanoseconds)));
+}
+
+void TMetrics::recordResponse(int id, int statusCode, qint64 bytesOut)
+{
+    if (id < 0) {
+        return;
+    }
+    FunctionShard* function = shard()->function(id);
+    bump(function->completed);
+    if (statusCode >= 400) {
+        bump(function->errors);
+    }
+    bump(function->bytesOut, static_cast<quint64>(bytesOut));
+}
+
+void TMetrics::recordNotFound()
+{
+    bump(shard()->notFound);
+}
+
+Models::MetricsResponse TMetrics::report(const QStringList& functions) const
+{
+    Models::MetricsResponse response;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const std::unique_ptr<Shard>& shard : m_shards) {
+        response.notFound += static_cast<qint64>(shard->notFound.load(std::memory_order_relaxed));
+    }
+
+    for (int id = 0; id < static_cast<int>(m_names.size()); ++id) {
+        QString name = QString::fromUtf8(m_names[id].data(), static_cast<int>(m_names[id].size()));
+        if (!functions.isEmpty() && !functions.contains(name)) {
+            continue;
+        }
+
+        quint64 requests = 0;
+        quint64 completed = 0;
+        quint64 errors = 0;
+        quint64 bytesIn = 0;
+        quint64 bytesOut = 0;
+        TLatencySummary stages[static_cast<int>(Stage::Count)];
+
+        for (const std::unique_ptr<Shard>& shard : m_shards) {
+            const FunctionShard* function = shard->functions[id].load(std::memory_order_acquire);
+            if (!function) {
+                continue;
+            }
+            requests += function->requests.load(std::memory_order_relaxed);
+            completed += function->completed.load(std::memory_order_relaxed);
+            errors += function->errors.load(std::memory_order_relaxed);
+            bytesIn += function->bytesIn.load(std::memory_order_relaxed);
+            bytesOut += function->bytesOut.load(std::memory_order_relaxed);
+            for (int stage = 0; stage < static_cast<int>(Stage::Count); ++stage) {
+                stages[stage].merge(function->stages[stage]);
+            }
+        }
+
+        Models::MetricsResponse::FunctionMetrics metrics;
+        metrics.name = name;
+        metrics.requests = static_cast<qint64>(requests);
+        metrics.errors = static_cast<qint64>(errors);
+        // 分片之间没有同步，读取瞬间可能出现 completed 略大于 requests
+        metrics.inFlight = requests > completed ? static_cast<qint64>(requests - completed) : 0;
+        metrics.bytesIn = static_cast<qint64>(bytesIn);
+        metrics.bytesOut = static_cast<qint64>(bytesOut);
+        metrics.queueWait = summarize(stages[static_cast<int>(Stage::QueueWait)]);
+        metrics.handler = summarize(stages[static_cast<int>(Stage::Handler)]);
+        metrics.send = summarize(stages[static_cast<int>(Stage::Send)]);
+        response.functions.append(metrics);
+    }
+
+    return response;
+}
@@ -0,0 +1,136 @@
+#ifndef TMETRICS_H
+#define TMETRICS_H
+
+#include <QStringList>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Models.h"
+
+// HDR 风格的对数-线性延迟直方图（纳秒）：每个 2 的幂区间再线性分为 16 个子桶，
+// 相对误差不超过 1/16；超过 2^40 ns（约 18 分钟）的值计入最后一个桶
+// 只由所属线程写入，读者可以并发读取（宽松原子操作）
+class TLatencyHistogram
+{
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr int SubBucketCount = 1 << SubBucketBits;
+    static constexpr int MaxExponent = 40;
+    static constexpr int BucketCount = (MaxExponent - SubBucketBits + 1) * SubBucketCount;
+
+    static int bucketIndex(quint64 value);
+
+    // 桶内代表值（区间中点）
+    static quint64 bucketValue(int index);
+
+    void record(quint64 value);
+
+private:
+    friend class TLatencySummary;
+
+    std::atomic<quint64> m_buckets[BucketCount] = {};
+    std::atomic<quint64> m_count{0};
+    std::atomic<quint64> m_sum{0};
+    std::atomic<quint64> m_max{0};
+};
+
+// 多个分片合并后的直方图，用于计算分位数
+class TLatencySummary
+{
+public:
+    void merge(const TLatencyHistogram& histogram);
+
+    quint64 count() const { return m_count; }
+    quint64 max() const { return m_max; }
+    double mean() const;
+
+    // q 取 (0, 1]，返回纳秒
+    quint64 percentile(double q) const;
+
+    // 压测报告用的摘要：count、mean、p50、p90、p99、p999、max，单位为微秒
+    QJsonObject toJson() const;
+
+    // 与基线相比的变化百分比，基线为 0 时返回 0
+    static double changePercent(double current, double baseline);
+
+private:
+    std::array<quint64, TLatencyHistogram::BucketCount> m_buckets = {};
+    quint64 m_count = 0;
+    quint64 m_sum = 0;
+    quint64 m_max = 0;
+};
+
+// 进程级请求指标：按函数统计请求数、错误数、进行中数量、收发字节数，
+// 以及排队、回调执行、发送三个阶段的延迟分布
+//
+// 每个线程写自己的分片（首次使用时分配，线程退出后留给新线程复用），
+// report() 读取时合并所有分片，记录路径上没有锁和共享写
+class TMetrics
+{
+public:
+    enum class Stage {
+        QueueWait,  // 收到请求到回调开始执行（含线程池排队）
+        Handler,    // 回调执行
+        Send,       // 序列化并写入 socket
+        Count
+    };
+
+    static constexpr int MaxFunctions = 64;
+
+    static TMetrics& instance();
+
+    // 单调时钟（纳秒）
+    static qint64 now();
+
+    // 注册函数名，返回指标编号；同名返回同一编号，超过 MaxFunctions 返回 -1
+    int registerFunction(const char* name, std::size_t size);
+
+    // 以下记录函数可在任意线程调用，id < 0 时忽略
+    void recordRequest(int id, qint64 bytesIn);
+    void recordLatency(int id, Stage stage, qint64 nanoseconds);
+    void recordResponse(int id, int statusCode, qint64 bytesOut);
+
+    // 请求的函数未注册
+    void recordNotFound();
+
+    // 合并所有分片生成报告，functions 为空表示全部函数
+    Models::MetricsResponse report(const QStringList& functions = QStringList()) const;
+
+private:
+    TMetrics() = default;
+
+    struct FunctionShard {
+        std::atomic<quint64> requests{0};
+        std::atomic<quint64> completed{0};
+        std::atomic<quint64> errors{0};
+        std::atomic<quint64> bytesIn{0};
+        std::atomic<quint64> bytesOut{0};
+        TLatencyHistogram stages[static_cast<int>(Stage::Count)];
+    };
+
+    struct Shard {
+        std::atomic<FunctionShard*> functions[MaxFunctions] = {};
+        std::atomic<quint64> notFound{0};
+
+        ~Shard();
+        FunctionShard* function(int id);
+    };
+
+    // 线程退出时归还分片
+    struct ShardHolder;
+
+    // 当前线程的分片
+    Shard* shard();
+    void releaseShard(Shard* shard);
+
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_names;
+    std::vector<std::unique_ptr<Shard>> m_shards;  // 只增不减
+    std::vector<Shard*> m_freeShards;              // 线程已退出、可复用的分片
+};
+
+#endif // TMETRICS_H
@@ -0,0 +1,345 @@
+#include "TPathCache.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+#include "TLog.h"
+
+#ifdef Q_OS_LINUX
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 同时存在的目录监视上限，超出后新路径不再缓存（inotify 监视数受 max_user_watches 限制）
+constexpr int MaxWatches = 4096;
+
+// 每个条目除结果字节外的估计开销
+constexpr qint64 NodeOverhead = 128;
+
+} // namespace
+
+TPathCache::Ticket::~Ticket()
+{
+    if (cache) {
+        cache->release(*this);
+    }
+}
+
+TPathCache::TPathCache(qint64 maxBytes)
+    : m_maxBytes(maxBytes)
+{
+}
+
+TPathCache::~TPathCache()
+{
+    stop();
+}
+
+bool TPathCache::start()
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        return true;
+    }
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        TLOG_WARN("path_cache_disabled").field("reason", QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+    m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_thread = std::thread([this]() { run(); });
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TPathCache::stop()
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd < 0) {
+        return;
+    }
+    quint64 one = 1;
+    ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+    Q_UNUSED(written);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    clearLocked();
+    ::close(m_inotifyFd);
+    ::close(m_wakeFd);
+    m_inotifyFd = -1;
+    m_wakeFd = -1;
+#endif
+}
+
+bool TPathCache::lookupFile(const QString& path, QByteArray* result, Ticket* ticket)
+{
+    if (!QDir::isAbsolutePath(path)) {
+        return false;
+    }
+    QString cleanPath = QDir::cleanPath(path);
+    QFileInfo info(cleanPath);
+    return lookup(QLatin1String("rf\n") + cleanPath, info.path(), info.fileName(), result, ticket);
+}
+
+bool TPathCache::lookupDirectory(const QString& path, const QByteArray& variant, QByteArray* result, Ticket* ticket)
+{
+    if (!QDir::isAbsolutePath(path)) {
+        return false;
+    }
+    QString cleanPath = QDir::cleanPath(path);
+    return lookup(QLatin1String("ld\n") + cleanPath + QLatin1Char('\n') + QString::fromUtf8(variant),
+                  cleanPath, QString(), result, ticket);
+}
+
+bool TPathCache::lookup(const QString& key, const QString& directory, const QString& name,
+                        QByteArray* result, Ticket* ticket)
+{
+#ifdef Q_OS_LINUX
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_inotifyFd < 0) {
+        return false;
+    }
+
+    auto it = m_nodes.constFind(key);
+    if (it != m_nodes.constEnd()) {
+        // 移到表头，结果字节隐式共享，不复制
+        m_lru.splice(m_lru.begin(), m_lru, it.value());
+        *result = it.value()->result;
+        ++m_hits;
+        return true;
+    }
+    ++m_misses;
+
+    int watch = m_watchByDirectory.value(directory, -1);
+    if (watch < 0) {
+        if (m_watches.size() >= MaxWatches) {
+            return false;
+        }
+        // 目录内的增删、改名、写入和属性变化都会改变 "ld" 的结果或 "rf" 的内容
+        quint32 mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE
+                       | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+        watch = ::inotify_add_watch(m_inotifyFd, QFile::encodeName(directory).constData(), mask);
+        if (watch < 0) {
+            return false;
+        }
+        Watch& entry = m_watches[watch];
+        entry.directory = directory;
+        m_watchByDirectory.insert(directory, watch);
+    }
+
+    Watch& entry = m_watches[watch];
+    ++entry.tickets;
+    ticket->key = key;
+    ticket->name = name;
+    ticket->watch = watch;
+    ticket->generation = entry.generation;
+    ticket->cache = this;
+    return false;
+#else
+    Q_UNUSED(key);
+    Q_UNUSED(directory);
+    Q_UNUSED(name);
+    Q_UNUSED(result);
+    Q_UNUSED(ticket);
+    return false;
+#endif
+}
+
+void TPathCache::insert(const Ticket& ticket, const QByteArray& result)
+{
+    if (ticket.watch < 0) {
+        return;
+    }
+    qint64 cost = result.size() + ticket.key.size() * 2 + NodeOverhead;
+    if (cost > m_maxBytes / 4) {
+        // 单个条目不超过预算的四分之一，避免一次放入清空整个缓存
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto watch = m_watches.find(ticket.watch);
+    if (watch == m_watches.end() || watch->generation != ticket.generation) {
+        // 读取期间目录有变化，结果可能已过期
+        return;
+    }
+
+    auto existing = m_nodes.constFind(ticket.key);
+    if (existing != m_nodes.constEnd()) {
+        removeNode(existing.value());
+    }
+
+    Node node;
+    node.key = ticket.key;
+    node.result = result;
+    node.name = ticket.name;
+    node.watch = ticket.watch;
+    node.cost = cost;
+    m_lru.push_front(node);
+    m_nodes.insert(ticket.key, m_lru.begin());
+    watch->keys.insert(ticket.key);
+    m_bytes += cost;
+
+    while (m_bytes > m_maxBytes && !m_lru.empty()) {
+        removeNode(std::prev(m_lru.end()));
+        ++m_evictions;
+    }
+}
+
+void TPathCache::release(const Ticket& ticket)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto watch = m_watches.find(ticket.watch);
+    if (watch == m_watches.end()) {
+        // 期间目录有变化或缓存已清空，监视已被移除
+        return;
+    }
+    if (--watch->tickets <= 0 && watch->keys.isEmpty()) {
+        dropWatch(ticket.watch);
+    }
+}
+
+Models::MetricsResponse::CacheStats TPathCache::stats() const
+{
+    Models::MetricsResponse::CacheStats stats;
+    stats.hits = static_cast<qint64>(m_hits.load());
+    stats.misses = static_cast<qint64>(m_misses.load());
+    stats.invalidations = static_cast<qint64>(m_invalidations.load());
+    stats.evictions = static_cast<qint64>(m_evictions.load());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.entries = m_nodes.size();
+    stats.bytes = m_bytes;
+    stats.watches = m_watches.size();
+    return stats;
+}
+
+void TPathCache::removeNode(std::list<Node>::iterator it)
+{
+    auto watch = m_watches.find(it->watch);
+    if (watch != m_watches.end()) {
+        watch->keys.remove(it->key);
+        if (watch->keys.isEmpty() && watch->tickets <= 0) {
+            dropWatch(it->watch);
+        }
+    }
+    m_bytes -= it->cost;
+    m_nodes.remove(it->key);
+    m_lru.erase(it);
+}
+
+void TPathCache::dropWatch(int watch)
+{
+#ifdef Q_OS_LINUX
+    auto it = m_watches.find(watch);
+    if (it == m_watches.end()) {
+        return;
+    }
+    m_watchByDirectory.remove(it->directory);
+    m_watches.erase(it);
+    ::inotify_rm_watch(m_inotifyFd, watch);
+#else
+    Q_UNUSED(watch);
+#endif
+}
+
+void TPathCache::clearLocked()
+{
+#ifdef Q_OS_LINUX
+    for (auto it = m_watches.constBegin(); it != m_watches.constEnd(); ++it) {
+        ::inotify_rm_watch(m_inotifyFd, it.key());
+    }
+#endif
+    m_watches.clear();
+    m_watchByDirectory.clear();
+    m_nodes.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+void TPathCache::onEvent(int watch, quint32 mask, const QString& name)
+{
+#ifdef Q_OS_LINUX
+    if (mask & IN_Q_OVERFLOW) {
+        // 丢失了事件，无法判断哪些条目过期
+        m_invalidations += static_cast<quint64>(m_nodes.size());
+        clearLocked();
+        return;
+    }
+
+    auto it = m_watches.find(watch);
+    if (it == m_watches.end()) {
+        return;
+    }
+    ++it->generation;
+
+    bool directoryGone = mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED);
+    const QSet<QString> keys = it->keys;
+    for (const QString& key : keys) {
+        auto node = m_nodes.constFind(key);
+        if (node == m_nodes.constEnd()) {
+            continue;
+        }
+        // "ld" 条目受目录中任何变化影响，"rf" 条目只受同名文件影响
+        if (directoryGone || node.value()->name.isEmpty() || node.value()->name == name) {
+            removeNode(node.value());
+            ++m_invalidations;
+        }
+    }
+
+    // 没有条目依附、也没有令牌的监视不再保留（removeNode 可能已经删除了它）；
+    // 目录已不存在时一并移除，尚未放入结果的令牌会在 insert() 中因找不到监视而作废
+    auto remaining = m_watches.find(watch);
+    if (remaining != m_watches.end() && (directoryGone || (remaining->keys.isEmpty() && remaining->tickets <= 0))) {
+        dropWatch(watch);
+    }
+#else
+    Q_UNUSED(watch);
+    Q_UNUSED(mask);
+    Q_UNUSED(name);
+#endif
+}
+
+void TPathCache::run()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+    for (;;) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            TLOG_ERROR("path_cache_poll_failed").field("errno", errno);
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+
+        for (;;) {
+            ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                QString name = event->len > 0 ? QFile::decodeName(event->name) : QString();
+                onEvent(event->wd, event->mask, name);
+            }
+        }
+    }
+#endif
+}
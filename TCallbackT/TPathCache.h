@@ -0,0 +1,111 @@
+#ifndef TPATHCACHE_H
+#define TPATHCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <thread>
+#include "Models.h"
+
+// 按路径缓存 "ld"/"rf" 已序列化好的结果（响应中的 r），重复请求直接复用字节，
+// 不访问文件系统也不重新序列化
+//
+// 失效由 inotify 精确驱动：每个条目依附于一个目录监视（"ld" 监视目录本身，"rf" 监视文件所在目录，
+// 以便覆盖写入临时文件再 rename 的更新方式），目录中的任何变化使该目录的 "ld" 条目和对应名称的
+// "rf" 条目失效。每个监视带一个代数，查找未命中时记下代数，读取期间有变化则不放入缓存，
+// 避免把读取之前的旧内容缓存下来。总大小超出预算时按 LRU 淘汰
+//
+// 仅在 Linux 上启用，其它平台上 lookup() 总是未命中且不发放令牌
+class TPathCache
+{
+public:
+    // lookup() 未命中时发放，insert() 凭它放入结果
+    // 析构时归还：没有放入任何结果的监视随最后一个令牌一起移除，不占用 inotify 监视数
+    struct Ticket {
+        QString key;
+        QString name;               // "rf" 的文件名，"ld" 为空
+        int watch = -1;             // < 0 表示不可缓存
+        quint64 generation = 0;
+        TPathCache* cache = nullptr;
+
+        Ticket() = default;
+        ~Ticket();
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+    };
+
+    explicit TPathCache(qint64 maxBytes = 64 * 1024 * 1024);
+    ~TPathCache();
+
+    TPathCache(const TPathCache&) = delete;
+    TPathCache& operator=(const TPathCache&) = delete;
+
+    // 创建 inotify 实例并启动事件线程，失败时缓存保持禁用
+    bool start();
+    void stop();
+
+    // "rf" 只缓存不超过该大小的文件内容（字节）
+    void setMaxFileSize(qint64 bytes) { m_maxFileSize = bytes; }
+    qint64 maxFileSize() const { return m_maxFileSize; }
+
+    // 任意线程调用。variant 区分同一路径的不同请求参数；path 须为绝对路径，否则不缓存
+    bool lookupFile(const QString& path, QByteArray* result, Ticket* ticket);
+    bool lookupDirectory(const QString& path, const QByteArray& variant, QByteArray* result, Ticket* ticket);
+
+    // 放入结果；令牌发放后目录有变化时丢弃
+    void insert(const Ticket& ticket, const QByteArray& result);
+
+    Models::MetricsResponse::CacheStats stats() const;
+
+private:
+    struct Node {
+        QString key;
+        QByteArray result;
+        QString name;
+        int watch = -1;
+        qint64 cost = 0;
+    };
+
+    struct Watch {
+        QString directory;
+        quint64 generation = 0;
+        QSet<QString> keys;
+        int tickets = 0;            // 尚未归还的令牌数
+    };
+
+    bool lookup(const QString& key, const QString& directory, const QString& name,
+                QByteArray* result, Ticket* ticket);
+    void run();
+    void release(const Ticket& ticket);
+
+    // 以下在持有 m_mutex 时调用
+    void removeNode(std::list<Node>::iterator it);
+    void dropWatch(int watch);
+    void onEvent(int watch, quint32 mask, const QString& name);
+    void clearLocked();
+
+    const qint64 m_maxBytes;
+    std::atomic<qint64> m_maxFileSize{1024 * 1024};
+
+    int m_inotifyFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::list<Node> m_lru;          // 表头为最近使用
+    QHash<QString, std::list<Node>::iterator> m_nodes;
+    QHash<int, Watch> m_watches;
+    QHash<QString, int> m_watchByDirectory;
+    qint64 m_bytes = 0;
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_invalidations{0};
+    std::atomic<quint64> m_evictions{0};
+};
+
+#endif // TPATHCACHE_H
@@ -0,0 +1,77 @@
+#include "TSessionPool.h"
+#include <QThread>
+#include "TCoreSession.h"
+#include "TLog.h"
+
+TSessionPool::TSessionPool(int size)
+    : TSessionPool(std::make_shared<TCallbackRegistry>(), size)
+{
+}
+
+TSessionPool::TSessionPool(std::shared_ptr<TCallbackRegistry> registry, int size)
+    : m_registry(std::move(registry))
+    , m_size(size > 0 ? size : QThread::idealThreadCount())
+{
+}
+
+TSessionPool::~TSessionPool()
+{
+    stop();
+}
+
+void TSessionPool::setSessionInitializer(std::function<void(TCoreSession&)> initializer)
+{
+    m_initializer = std::move(initializer);
+}
+
+void TSessionPool::start(const QString& url)
+{
+    if (!m_sessions.empty()) {
+        return;
+    }
+
+    TLOG_INFO("session_pool_start").field("size", m_size).field("url", url);
+
+    for (int i = 0; i < m_size; ++i) {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("TCallbackT-session-%1").arg(i));
+
+        // 每个会话自带线程池，默认按会话数平分 CPU 核心，避免线程总数成倍增长
+        TCoreSession* session = new TCoreSession(m_registry);
+        session->setMaxThreadCount(qMax(2, QThread::idealThreadCount() / m_size));
+        if (m_initializer) {
+            m_initializer(*session);
+        }
+
+        // 会话及其子对象（socket、定时器）整体移入线程，之后只在该线程中访问
+        session->moveToThread(thread);
+        thread->start();
+        QMetaObject::invokeMethod(session, [session, url]() {
+            session->connectToServer(url);
+        }, Qt::QueuedConnection);
+
+        m_threads.push_back(thread);
+        m_sessions.push_back(session);
+    }
+}
+
+void TSessionPool::stop()
+{
+    for (std::size_t i = 0; i < m_sessions.size(); ++i) {
+        TCoreSession* session = m_sessions[i];
+        QMetaObject::invokeMethod(session, [session]() { delete session; }, Qt::BlockingQueuedConnection);
+        m_threads[i]->quit();
+        m_threads[i]->wait();
+        delete m_threads[i];
+    }
+    m_sessions.clear();
+    m_threads.clear();
+}
+
+void TSessionPool::forEachSession(const std::function<void(TCoreSession&)>& function)
+{
+    for (TCoreSession* session : m_sessions) {
+        QMetaObject::invokeMethod(session, [session, &function]() { function(*session); },
+                                  Qt::BlockingQueuedConnection);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef TSESSIONPOOL_H
+#define TSESSIONPOOL_H
+
+#include <QString>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "TCallbackRegistry.h"
+
+class QThread;
+class TCoreSession;
+
+// 会话池：建立 N 个到服务器的连接，每个连接的会话在独立的 QThread 中运行自己的事件循环，
+// 所有会话共享同一个回调注册表；服务器按连接分发请求，解析和收发的工作随之分散到各个线程
+class TSessionPool
+{
+public:
+    // size <= 0 时取 CPU 核心数
+    explicit TSessionPool(int size = 0);
+    TSessionPool(std::shared_ptr<TCallbackRegistry> registry, int size);
+    ~TSessionPool();
+
+    TSessionPool(const TSessionPool&) = delete;
+    TSessionPool& operator=(const TSessionPool&) = delete;
+
+    int size() const { return m_size; }
+
+    // 共享的回调注册表，须在 start() 之前完成注册
+    TCallbackRegistry& registry() { return *m_registry; }
+    std::shared_ptr<TCallbackRegistry> sharedRegistry() const { return m_registry; }
+
+    template<typename PayloadType, typename Callback>
+    void registerCallback(Callback callback) {
+        m_registry->registerCallback<PayloadType>(std::move(callback));
+    }
+
+    void setConcurrencyLimit(const QString& functionName, int limit) {
+        m_registry->setConcurrencyLimit(functionName, limit);
+    }
+
+    // 每个会话创建后、移入其线程之前调用，用于设置执行模式、合并发送等会话级选项
+    void setSessionInitializer(std::function<void(TCoreSession&)> initializer);
+
+    // 创建线程和会话并连接到 url
+    void start(const QString& url);
+
+    // 在各会话所属线程中销毁会话并结束线程
+    // stop() 和 forEachSession() 会阻塞等待会话线程，不能在会话线程中调用
+    void stop();
+
+    // 在每个会话所属线程中执行 function，全部执行完后返回
+    void forEachSession(const std::function<void(TCoreSession&)>& function);
+
+private:
+    std::shared_ptr<TCallbackRegistry> m_registry;
+    int m_size;
+    std::function<void(TCoreSession&)> m_initializer;
+    std::vector<QThread*> m_threads;
+    std::vector<TCoreSession*> m_sessions;
+};
+
+#endif // TSESSIONPOOL_H
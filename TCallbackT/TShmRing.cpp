@@ -0,0 +1,190 @@
+#include "TShmRing.h"
+#include <QtGlobal>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr quint32 RingMagic = 0x54534852;   // "TSHR"
+constexpr quint32 RingVersion = 1;
+
+} // namespace
+
+// 共享内存开头的控制块，tail 单独占一个缓存行
+struct TShmRing::Header {
+    quint32 magic;
+    quint32 version;
+    quint64 capacity;
+    alignas(64) std::atomic<quint64> tail;
+};
+
+static_assert(std::atomic<quint64>::is_always_lock_free, "shared memory ring needs lock-free 64-bit atomics");
+
+TShmRing::~TShmRing()
+{
+#ifdef Q_OS_UNIX
+    if (m_header) {
+        ::munmap(m_header, static_cast<size_t>(m_mappedSize));
+    }
+    if (m_owner) {
+        // 对端已 attach 时名称已被删除，这里只处理对端未连上的情况
+        ::shm_unlink(m_name.constData());
+    }
+#endif
+}
+
+std::unique_ptr<TShmRing> TShmRing::create(qint64 capacity, QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    static std::atomic<int> counter{0};
+
+    std::unique_ptr<TShmRing> ring(new TShmRing());
+    ring->m_capacity = capacity;
+    ring->m_name = QByteArray("/tcallbackt-") + QByteArray::number(static_cast<qint64>(::getpid()))
+                   + '-' + QByteArray::number(counter.fetch_add(1));
+
+    int fd = ::shm_open(ring->m_name.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        *errorReason = QString("shm_open %1 failed: %2").arg(QString::fromLatin1(ring->m_name.constData()), QString::fromLocal8Bit(std::strerror(errno)));
+        return nullptr;
+    }
+    ring->m_owner = true;
+
+    bool ok = ::ftruncate(fd, HeaderSize + capacity) == 0;
+    if (!ok) {
+        *errorReason = QString("ftruncate failed: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+    }
+    ok = ok && ring->map(fd, true, errorReason);
+    ::close(fd);
+    return ok ? std::move(ring) : nullptr;
+#else
+    Q_UNUSED(capacity);
+    *errorReason = "Shared memory rings are not supported on this platform";
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<TShmRing> TShmRing::attach(const QByteArray& name, qint64 capacity, QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    std::unique_ptr<TShmRing> ring(new TShmRing());
+    ring->m_capacity = capacity;
+    ring->m_name = name;
+
+    int fd = ::shm_open(name.constData(), O_RDWR, 0);
+    if (fd < 0) {
+        *errorReason = QString("shm_open %1 failed: %2").arg(QString::fromLatin1(name.constData()), QString::fromLocal8Bit(std::strerror(errno)));
+        return nullptr;
+    }
+    // 双方都已映射，名称不再需要
+    ::shm_unlink(name.constData());
+
+    struct stat info;
+    bool ok = ::fstat(fd, &info) == 0 && info.st_size == HeaderSize + capacity;
+    if (!ok) {
+        *errorReason = QString("Shared memory %1 has unexpected size").arg(QString::fromLatin1(name.constData()));
+    }
+    ok = ok && ring->map(fd, false, errorReason);
+    ::close(fd);
+    if (ok && (ring->m_header->magic != RingMagic || ring->m_header->version != RingVersion
+               || ring->m_header->capacity != static_cast<quint64>(capacity))) {
+        *errorReason = QString("Shared memory %1 is not a ring of %2 bytes").arg(QString::fromLatin1(name.constData())).arg(capacity);
+        ok = false;
+    }
+    return ok ? std::move(ring) : nullptr;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(capacity);
+    *errorReason = "Shared memory rings are not supported on this platform";
+    return nullptr;
+#endif
+}
+
+bool TShmRing::map(int fd, bool initialize, QString* errorReason)
+{
+#ifdef Q_OS_UNIX
+    static_assert(sizeof(Header) <= HeaderSize, "ring header does not fit");
+
+    m_mappedSize = HeaderSize + m_capacity;
+    void* address = ::mmap(nullptr, static_cast<size_t>(m_mappedSize), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        *errorReason = QString("mmap failed: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+    m_header = static_cast<Header*>(address);
+    m_data = static_cast<char*>(address) + HeaderSize;
+
+    if (initialize) {
+        // ftruncate 得到的内存已清零，std::atomic 的初始状态即为 0
+        m_header->magic = RingMagic;
+        m_header->version = RingVersion;
+        m_header->capacity = static_cast<quint64>(m_capacity);
+        m_header->tail.store(0, std::memory_order_release);
+    }
+    return true;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(initialize);
+    Q_UNUSED(errorReason);
+    return false;
+#endif
+}
+
+char* TShmRing::reserve(qint64 size, quint64* position)
+{
+    if (size <= 0 || size > m_capacity) {
+        return nullptr;
+    }
+
+    quint64 capacity = static_cast<quint64>(m_capacity);
+    quint64 start = m_head;
+    quint64 index = start % capacity;
+    if (index + static_cast<quint64>(size) > capacity) {
+        // 环尾放不下，从环头开始，跳过的部分随这条消息一起释放
+        start += capacity - index;
+        index = 0;
+    }
+
+    quint64 tail = m_header->tail.load(std::memory_order_acquire);
+    if (start + static_cast<quint64>(size) - tail > capacity) {
+        return nullptr;
+    }
+
+    *position = start;
+    return m_data + index;
+}
+
+void TShmRing::commit(quint64 position, qint64 size)
+{
+    if (size > 0) {
+        m_head = position + static_cast<quint64>(size);
+    }
+}
+
+qint64 TShmRing::pendingBytes() const
+{
+    return static_cast<qint64>(m_head - m_header->tail.load(std::memory_order_acquire));
+}
+
+const char* TShmRing::data(quint64 position, qint64 size) const
+{
+    quint64 capacity = static_cast<quint64>(m_capacity);
+    quint64 index = position % capacity;
+    if (size < 0 || index + static_cast<quint64>(size) > capacity) {
+        return nullptr;
+    }
+    return m_data + index;
+}
+
+void TShmRing::release(quint64 end)
+{
+    m_header->tail.store(end, std::memory_order_release);
+}
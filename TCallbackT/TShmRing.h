@@ -0,0 +1,64 @@
+#ifndef TSHMRING_H
+#define TSHMRING_H
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+// 单生产者单消费者的共享内存环形缓冲区（POSIX shm），用于同机进程间传递大消息
+//
+// 写端 create() 创建并映射一段共享内存，把名称告诉对端；读端 attach() 映射后立即删除名称，
+// 之后这段内存只存在于两个进程的映射中。消息在环中连续存放（放不下时跳过环尾），
+// 位置和长度另经控制通道通知读端；读端处理完后推进共享的 tail，写端据此回收空间
+//
+// 位置是单调递增的字节序号，环内偏移为 position % capacity
+class TShmRing
+{
+public:
+    // 控制块大小，数据区从这里开始
+    static constexpr qint64 HeaderSize = 128;
+
+    ~TShmRing();
+
+    TShmRing(const TShmRing&) = delete;
+    TShmRing& operator=(const TShmRing&) = delete;
+
+    // 写端：创建容量为 capacity 字节的环，失败时返回空并填写原因
+    static std::unique_ptr<TShmRing> create(qint64 capacity, QString* errorReason);
+
+    // 读端：按名称映射写端创建的环，并删除名称
+    static std::unique_ptr<TShmRing> attach(const QByteArray& name, qint64 capacity, QString* errorReason);
+
+    const QByteArray& name() const { return m_name; }
+    qint64 capacity() const { return m_capacity; }
+
+    // 写端：预留 size 字节的连续空间，空间不足时返回 nullptr
+    // 预留后必须调用 commit()（size 可小于预留值，0 表示放弃），期间不能再次预留
+    char* reserve(qint64 size, quint64* position);
+    void commit(quint64 position, qint64 size);
+
+    // 写端：已提交、对端尚未释放的字节数（含跳过的环尾）
+    qint64 pendingBytes() const;
+
+    // 读端：返回 [position, position + size) 对应的数据，越界时返回 nullptr
+    const char* data(quint64 position, qint64 size) const;
+
+    // 读端：数据已处理完，释放到 end（不含）为止的空间
+    void release(quint64 end);
+
+private:
+    struct Header;
+
+    TShmRing() = default;
+    bool map(int fd, bool initialize, QString* errorReason);
+
+    QByteArray m_name;
+    qint64 m_capacity = 0;
+    Header* m_header = nullptr;
+    char* m_data = nullptr;
+    qint64 m_mappedSize = 0;
+    quint64 m_head = 0;         // 写端下一个可写位置
+    bool m_owner = false;       // 写端，析构时删除尚未被对端删除的名称
+};
+
+#endif // TSHMRING_H
@@ -0,0 +1,197 @@
+#include "TStreamBody.h"
+#include <cstring>
+
+qint64 TStreamBody::readInto(char* buffer, qint64 maxSize)
+{
+    QByteArray data = read(maxSize);
+    std::memcpy(buffer, data.constData(), static_cast<size_t>(data.size()));
+    return data.size();
+}
+
+TFileStreamBody::TFileStreamBody(const QString& filePath, qint64 offset, qint64 length, int chunkSize)
+    : m_filePath(filePath)
+    , m_offset(offset)
+    , m_length(length)
+    , m_chunkSize(boundedChunkSize(chunkSize))
+{
+}
+
+bool TFileStreamBody::open(QString* errorReason)
+{
+    m_file.reset(new QFile(m_filePath));
+
+    if (!m_file->open(QIODevice::ReadOnly)) {
+        *errorReason = QString("Cannot read file: %1").arg(m_filePath);
+        return false;
+    }
+
+    m_fileSize = m_file->size();
+    if (m_offset < 0 || m_offset > m_fileSize) {
+        *errorReason = QString("Offset %1 out of range, file size: %2").arg(m_offset).arg(m_fileSize);
+        return false;
+    }
+
+    if (!m_file->seek(m_offset)) {
+        *errorReason = QString("Cannot seek to offset %1: %2").arg(m_offset).arg(m_filePath);
+        return false;
+    }
+
+    qint64 available = m_fileSize - m_offset;
+    m_remaining = m_length < 0 ? available : qMin(m_length, available);
+    return true;
+}
+
+QByteArray TFileStreamBody::read(qint64 maxSize)
+{
+    QByteArray data(static_cast<int>(qMin(maxSize, m_remaining)), Qt::Uninitialized);
+    data.resize(static_cast<int>(readInto(data.data(), data.size())));
+    return data;
+}
+
+qint64 TFileStreamBody::readInto(char* buffer, qint64 maxSize)
+{
+    qint64 size = m_file->read(buffer, qMin(maxSize, m_remaining));
+    if (size < 0) {
+        m_error = QString("Cannot read file %1: %2").arg(m_filePath, m_file->errorString());
+        return 0;
+    }
+    if (size == 0 && m_remaining > 0) {
+        // 打开后文件被截短
+        m_error = QString("File %1 ended early, %2 bytes missing").arg(m_filePath).arg(m_remaining);
+        return 0;
+    }
+    m_remaining -= size;
+    return size;
+}
+
+bool TFileStreamBody::atEnd() const
+{
+    return m_remaining <= 0;
+}
+
+qint64 TFileStreamBody::startOffset() const
+{
+    return m_offset;
+}
+
+int TFileStreamBody::preferredChunkSize() const
+{
+    return m_chunkSize;
+}
+
+QString TFileStreamBody::errorString() const
+{
+    return m_error;
+}
+
+QJsonObject TFileStreamBody::completion() const
+{
+    QJsonObject obj;
+    obj["fileSize"] = m_fileSize;
+    obj["readPath"] = "stream";
+    return obj;
+}
+
+bool TFileStreamBody::fileRange(int* fd, qint64* offset, qint64* length) const
+{
+    if (!m_file || m_file->handle() < 0) {
+        return false;
+    }
+    *fd = m_file->handle();
+    *offset = m_file->pos();
+    *length = m_remaining;
+    return true;
+}
+
+TMappedFileStreamBody::TMappedFileStreamBody(const QString& filePath, qint64 offset, qint64 length, int chunkSize)
+    : m_filePath(filePath)
+    , m_offset(offset)
+    , m_length(length)
+    , m_chunkSize(boundedChunkSize(chunkSize))
+{
+}
+
+TMappedFileStreamBody::~TMappedFileStreamBody()
+{
+    // 数据块是 fromRawData 引用，会话发送时已拷贝进帧，此处可以安全解除映射
+    if (m_mapped) {
+        m_file->unmap(m_mapped);
+    }
+}
+
+bool TMappedFileStreamBody::open(QString* errorReason)
+{
+    m_file.reset(new QFile(m_filePath));
+
+    if (!m_file->open(QIODevice::ReadOnly)) {
+        *errorReason = QString("Cannot read file: %1").arg(m_filePath);
+        return false;
+    }
+
+    m_fileSize = m_file->size();
+    if (m_offset < 0 || m_offset > m_fileSize) {
+        *errorReason = QString("Offset %1 out of range, file size: %2").arg(m_offset).arg(m_fileSize);
+        return false;
+    }
+
+    qint64 available = m_fileSize - m_offset;
+    m_mappedSize = m_length < 0 ? available : qMin(m_length, available);
+    if (m_mappedSize == 0) {
+        return true;
+    }
+
+    m_mapped = m_file->map(m_offset, m_mappedSize);
+    if (!m_mapped) {
+        *errorReason = QString("Cannot map file: %1 (%2)").arg(m_filePath, m_file->errorString());
+        return false;
+    }
+    return true;
+}
+
+QByteArray TMappedFileStreamBody::read(qint64 maxSize)
+{
+    qint64 size = qMin(maxSize, m_mappedSize - m_position);
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(m_mapped + m_position),
+                                              static_cast<int>(size));
+    m_position += size;
+    return data;
+}
+
+bool TMappedFileStreamBody::atEnd() const
+{
+    return m_position >= m_mappedSize;
+}
+
+qint64 TMappedFileStreamBody::startOffset() const
+{
+    return m_offset;
+}
+
+int TMappedFileStreamBody::preferredChunkSize() const
+{
+    return m_chunkSize;
+}
+
+QString TMappedFileStreamBody::errorString() const
+{
+    return m_file ? m_file->errorString() : QString();
+}
+
+QJsonObject TMappedFileStreamBody::completion() const
+{
+    QJsonObject obj;
+    obj["fileSize"] = m_fileSize;
+    obj["readPath"] = "mmap";
+    return obj;
+}
+
+bool TMappedFileStreamBody::fileRange(int* fd, qint64* offset, qint64* length) const
+{
+    if (!m_file || m_file->handle() < 0) {
+        return false;
+    }
+    *fd = m_file->handle();
+    *offset = m_offset + m_position;
+    *length = m_mappedSize - m_position;
+    return true;
+}
@@ -0,0 +1,153 @@
+#ifndef TSTREAMBODY_H
+#define TSTREAMBODY_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+#include <functional>
+#include <memory>
+
+// 流式响应体：回调返回后，由 TCoreSession 在 socket 所在线程按块拉取，
+// 以二进制数据块帧发送，最后发送一条完成响应
+class TStreamBody
+{
+public:
+    virtual ~TStreamBody() = default;
+
+    // 开始发送前调用（socket 所在线程），失败时填写错误原因
+    virtual bool open(QString* errorReason) = 0;
+
+    // 读取至多 maxSize 字节，失败时返回空
+    virtual QByteArray read(qint64 maxSize) = 0;
+
+    // 读取至多 maxSize 字节到 buffer（如传输的共享内存），返回读到的字节数，失败时返回 0
+    // 默认经由 read() 复制一次，文件流直接读入 buffer
+    virtual qint64 readInto(char* buffer, qint64 maxSize);
+
+    // 数据是否已全部读取
+    virtual bool atEnd() const = 0;
+
+    // 第一个数据块的偏移
+    virtual qint64 startOffset() const { return 0; }
+
+    // 期望的块大小，<= 0 使用会话默认值；会话发送时限制在 [MinChunkSize, MaxChunkSize]
+    virtual int preferredChunkSize() const { return 0; }
+
+    // 对端可以指定块大小（如 "rf" 的 chunkSize），上限避免一次请求分配整个文件或超出传输的帧长度
+    static constexpr int MinChunkSize = 4 * 1024;
+    static constexpr int MaxChunkSize = 4 * 1024 * 1024;
+
+    // <= 0 保持为 0（使用会话默认值），其余限制在 [MinChunkSize, MaxChunkSize]
+    static int boundedChunkSize(int size) { return size <= 0 ? 0 : qBound(MinChunkSize, size, MaxChunkSize); }
+
+    // 读取失败时的错误原因
+    virtual QString errorString() const { return QString(); }
+
+    // 附加到完成响应 r 中的字段
+    virtual QJsonObject completion() const { return QJsonObject(); }
+
+    // 上一次 read() 返回的数据所属通道（写入数据块帧头），如命令的 stdout/stderr
+    virtual quint8 channel() const { return 0; }
+
+    // 推送型数据源：read() 暂无数据但尚未结束时返回 true，
+    // 会话会挂起该流，直到数据源调用 notifyReadyRead()
+    virtual bool waitingForData() const { return false; }
+
+    // 推送型数据源是否依赖会话线程的 Qt 事件循环（如 QProcess、QSocketNotifier、上传数据块帧）；
+    // 没有事件循环的调用方（如 HTTP 反应器）不能驱动这类数据源
+    virtual bool needsEventLoop() const { return false; }
+
+    // 上传型数据源：对端以上传数据块帧发来的数据（在 socket 所在线程调用），不接受上传时返回 false
+    // data 只在调用期间有效，需要保留时自行复制
+    // 写入失败时记录错误并通知会话，流随后以错误结束
+    virtual bool receiveChunk(qint64 /*offset*/, const QByteArray& /*data*/, bool /*final*/) { return false; }
+
+    // 以文件描述符表示的剩余数据范围，可直接 sendfile；不是普通文件时返回 false
+    // 描述符归流对象所有，调用方只在流对象存活期间使用
+    virtual bool fileRange(int* /*fd*/, qint64* /*offset*/, qint64* /*length*/) const { return false; }
+
+    // 由会话设置，在 socket 所在线程调用
+    void setReadyReadHandler(std::function<void()> handler) {
+        m_readyRead = std::move(handler);
+        m_threadSafeReadyRead = false;
+    }
+
+    // 由没有事件循环的调用方在 open() 之前设置：数据源在产生数据的线程直接调用，handler 须线程安全
+    void setThreadSafeReadyReadHandler(std::function<void()> handler) {
+        m_readyRead = std::move(handler);
+        m_threadSafeReadyRead = true;
+    }
+    bool hasThreadSafeReadyReadHandler() const { return m_threadSafeReadyRead; }
+
+protected:
+    // 有新数据或数据源结束时调用
+    void notifyReadyRead() {
+        if (m_readyRead) {
+            m_readyRead();
+        }
+    }
+
+private:
+    std::function<void()> m_readyRead;
+    bool m_threadSafeReadyRead = false;
+};
+
+// 文件流：按字节范围读取文件
+class TFileStreamBody : public TStreamBody
+{
+public:
+    // length < 0 表示读到文件末尾
+    TFileStreamBody(const QString& filePath, qint64 offset = 0, qint64 length = -1, int chunkSize = 0);
+
+    bool open(QString* errorReason) override;
+    QByteArray read(qint64 maxSize) override;
+    qint64 readInto(char* buffer, qint64 maxSize) override;
+    bool atEnd() const override;
+    qint64 startOffset() const override;
+    int preferredChunkSize() const override;
+    QString errorString() const override;
+    QJsonObject completion() const override;
+    bool fileRange(int* fd, qint64* offset, qint64* length) const override;
+
+private:
+    QString m_filePath;
+    qint64 m_offset;
+    qint64 m_length;
+    int m_chunkSize;
+    qint64 m_remaining = 0;
+    qint64 m_fileSize = 0;
+    std::unique_ptr<QFile> m_file;  // 在 open() 中创建，归属 socket 所在线程
+    QString m_error;                // 读取失败或文件提前结束的原因
+};
+
+// 内存映射文件流：通过 QFile::map 映射文件，数据块直接引用映射页，不做文本解码
+class TMappedFileStreamBody : public TStreamBody
+{
+public:
+    // length < 0 表示映射到文件末尾
+    TMappedFileStreamBody(const QString& filePath, qint64 offset = 0, qint64 length = -1, int chunkSize = 0);
+    ~TMappedFileStreamBody() override;
+
+    bool open(QString* errorReason) override;
+    QByteArray read(qint64 maxSize) override;
+    bool atEnd() const override;
+    qint64 startOffset() const override;
+    int preferredChunkSize() const override;
+    QString errorString() const override;
+    QJsonObject completion() const override;
+    bool fileRange(int* fd, qint64* offset, qint64* length) const override;
+
+private:
+    QString m_filePath;
+    qint64 m_offset;
+    qint64 m_length;
+    int m_chunkSize;
+    qint64 m_mappedSize = 0;
+    qint64 m_position = 0;
+    qint64 m_fileSize = 0;
+    uchar* m_mapped = nullptr;
+    std::unique_ptr<QFile> m_file;
+};
+
+#endif // TSTREAMBODY_H
@@ -0,0 +1,180 @@
+#include "TSystemSampler.h"
+#include <QDateTime>
+#include <QSysInfo>
+#include <QTimer>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 读取 /proc 下的小文件到 buffer，返回读取的字节数，失败返回 0（结果以 '\0' 结尾）
+int readProcFile(const char* path, char* buffer, int size)
+{
+#ifdef Q_OS_LINUX
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t n = ::read(fd, buffer, size - 1);
+    ::close(fd);
+    if (n <= 0) {
+        return 0;
+    }
+    buffer[n] = '\0';
+    return static_cast<int>(n);
+#else
+    Q_UNUSED(path);
+    Q_UNUSED(buffer);
+    Q_UNUSED(size);
+    return 0;
+#endif
+}
+
+// 在 /proc/meminfo 内容中查找 "Key:  123 kB"，返回字节数
+qint64 meminfoValue(const char* text, const char* key)
+{
+    const char* line = std::strstr(text, key);
+    if (!line) {
+        return 0;
+    }
+    return static_cast<qint64>(std::strtoull(line + std::strlen(key), nullptr, 10)) * 1024;
+}
+
+} // namespace
+
+TSystemSampler::TSystemSampler()
+    : m_mounts(QStringList() << "/")
+    , m_osName(QSysInfo::productType())
+    , m_osVersion(QSysInfo::productVersion())
+    , m_cpuArchitecture(QSysInfo::currentCpuArchitecture())
+    , m_cpuCount(QThread::idealThreadCount())
+{
+}
+
+TSystemSampler::~TSystemSampler()
+{
+    stop();
+}
+
+void TSystemSampler::setMounts(const QStringList& mounts)
+{
+    m_mounts = mounts.mid(0, MaxMounts);
+}
+
+void TSystemSampler::start(int intervalMs)
+{
+    if (m_thread.isRunning()) {
+        return;
+    }
+
+    // 先同步采样一次，保证启动后快照立即可用
+    sample();
+
+    m_timer = new QTimer();
+    m_timer->setInterval(intervalMs);
+    m_timer->moveToThread(&m_thread);
+
+    QObject::connect(m_timer, &QTimer::timeout, m_timer, [this]() {
+        sample();
+    });
+    QObject::connect(&m_thread, &QThread::started, m_timer, [this]() {
+        m_timer->start();
+    });
+    QObject::connect(&m_thread, &QThread::finished, m_timer, &QObject::deleteLater);
+
+    m_thread.start();
+}
+
+void TSystemSampler::stop()
+{
+    if (!m_thread.isRunning()) {
+        return;
+    }
+    m_thread.quit();
+    m_thread.wait();
+    m_timer = nullptr;
+}
+
+TSystemSampler::Snapshot TSystemSampler::snapshot() const
+{
+    Snapshot result;
+    quint32 before = 0;
+    quint32 after = 0;
+    do {
+        before = m_sequence.load(std::memory_order_acquire);
+        std::memcpy(static_cast<void*>(&result), &m_snapshot, sizeof(Snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = m_sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return result;
+}
+
+void TSystemSampler::publish(const Snapshot& snapshot)
+{
+    // 只有采样线程写入
+    quint32 sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void*>(&m_snapshot), &snapshot, sizeof(Snapshot));
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void TSystemSampler::sample()
+{
+    Snapshot snapshot;
+    snapshot.sampledAt = QDateTime::currentMSecsSinceEpoch();
+
+    char buffer[4096];
+
+    if (readProcFile("/proc/meminfo", buffer, sizeof(buffer)) > 0) {
+        snapshot.totalMemory = meminfoValue(buffer, "MemTotal:");
+        snapshot.availableMemory = meminfoValue(buffer, "MemAvailable:");
+    }
+
+    // 第一行：cpu user nice system idle iowait irq softirq steal ...
+    if (readProcFile("/proc/stat", buffer, sizeof(buffer)) > 0 && std::strncmp(buffer, "cpu ", 4) == 0) {
+        quint64 values[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        char* p = buffer + 4;
+        for (quint64& value : values) {
+            value = std::strtoull(p, &p, 10);
+        }
+
+        quint64 total = 0;
+        for (quint64 value : values) {
+            total += value;
+        }
+        quint64 idle = values[3] + values[4];
+        quint64 busy = total - idle;
+
+        if (m_lastCpuTotal != 0 && total > m_lastCpuTotal) {
+            snapshot.cpuUsage = static_cast<double>(busy - m_lastCpuBusy) / (total - m_lastCpuTotal);
+        }
+        m_lastCpuBusy = busy;
+        m_lastCpuTotal = total;
+    }
+
+    if (readProcFile("/proc/loadavg", buffer, sizeof(buffer)) > 0) {
+        std::sscanf(buffer, "%lf %lf %lf",
+                    &snapshot.loadAverage[0], &snapshot.loadAverage[1], &snapshot.loadAverage[2]);
+    }
+
+#ifdef Q_OS_UNIX
+    for (const QString& mount : m_mounts) {
+        DiskUsage& disk = snapshot.disks[snapshot.diskCount++];
+        struct statvfs info;
+        if (::statvfs(mount.toLocal8Bit().constData(), &info) == 0) {
+            disk.total = static_cast<qint64>(info.f_blocks) * info.f_frsize;
+            disk.available = static_cast<qint64>(info.f_bavail) * info.f_frsize;
+        }
+    }
+#endif
+
+    publish(snapshot);
+}
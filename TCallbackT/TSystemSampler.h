@@ -0,0 +1,78 @@
+#ifndef TSYSTEMSAMPLER_H
+#define TSYSTEMSAMPLER_H
+
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <atomic>
+
+class QTimer;
+
+// 系统指标采样器：在后台线程按固定周期读取 /proc/meminfo、/proc/stat、/proc/loadavg
+// 以及配置的挂载点的 statvfs，结果以无锁快照发布（seqlock），
+// 读取快照只是一次内存拷贝，不产生系统调用
+class TSystemSampler
+{
+public:
+    static constexpr int MaxMounts = 8;
+
+    struct DiskUsage {
+        qint64 total = 0;
+        qint64 available = 0;
+    };
+
+    // 平凡可复制，按字节拷贝发布
+    struct Snapshot {
+        qint64 sampledAt = 0;         // 毫秒时间戳，0 表示尚未采样
+        qint64 totalMemory = 0;
+        qint64 availableMemory = 0;
+        double cpuUsage = 0.0;        // 最近一个采样周期的 CPU 利用率，0~1
+        double loadAverage[3] = {0.0, 0.0, 0.0};
+        int diskCount = 0;            // 与 mounts() 的前 diskCount 项一一对应
+        DiskUsage disks[MaxMounts];
+    };
+
+    TSystemSampler();
+    ~TSystemSampler();
+
+    // 需要统计的挂载点，默认 "/"；只能在 start() 之前设置，超过 MaxMounts 的部分忽略
+    void setMounts(const QStringList& mounts);
+    const QStringList& mounts() const { return m_mounts; }
+
+    // 同步采样一次后启动后台线程，intervalMs 为采样周期
+    void start(int intervalMs = 1000);
+    void stop();
+
+    // 任意线程调用，返回最近一次发布的快照
+    Snapshot snapshot() const;
+
+    // 进程生命周期内不变的信息，构造时确定
+    const QString& osName() const { return m_osName; }
+    const QString& osVersion() const { return m_osVersion; }
+    const QString& cpuArchitecture() const { return m_cpuArchitecture; }
+    int cpuCount() const { return m_cpuCount; }
+
+private:
+    // 在采样线程中调用
+    void sample();
+    void publish(const Snapshot& snapshot);
+
+    QStringList m_mounts;
+    QString m_osName;
+    QString m_osVersion;
+    QString m_cpuArchitecture;
+    int m_cpuCount = 0;
+
+    // 上一次 /proc/stat 的累计值，用于计算利用率（仅采样线程访问）
+    quint64 m_lastCpuBusy = 0;
+    quint64 m_lastCpuTotal = 0;
+
+    // seqlock：写入期间序号为奇数，读者在序号变化时重试
+    std::atomic<quint32> m_sequence{0};
+    Snapshot m_snapshot;
+
+    QThread m_thread;
+    QTimer* m_timer = nullptr;  // 归属采样线程
+};
+
+#endif // TSYSTEMSAMPLER_H
@@ -0,0 +1,422 @@
+#include "TTransport.h"
+#include <QLocalSocket>
+#include <QTimer>
+#include <QUrlQuery>
+#include <QUrl>
+#include <QWebSocket>
+#include <QtEndian>
+#include <cstring>
+#include "TLog.h"
+#include "TShmRing.h"
+
+namespace {
+
+TTransport::State fromSocketState(QAbstractSocket::SocketState state)
+{
+    switch (state) {
+    case QAbstractSocket::ConnectedState:
+        return TTransport::State::Connected;
+    case QAbstractSocket::HostLookupState:
+    case QAbstractSocket::ConnectingState:
+        return TTransport::State::Connecting;
+    default:
+        return TTransport::State::Unconnected;
+    }
+}
+
+} // namespace
+
+TTransport* TTransport::create(const QString& url, QObject* parent)
+{
+    if (url.startsWith(QLatin1String("local:"))) {
+        return new TLocalSocketTransport(parent);
+    }
+    return new TWebSocketTransport(parent);
+}
+
+// =================== TWebSocketTransport ===================
+
+TWebSocketTransport::TWebSocketTransport(QObject* parent)
+    : TTransport(parent)
+    , m_socket(new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this))
+{
+    attach();
+}
+
+TWebSocketTransport::TWebSocketTransport(QWebSocket* socket, QObject* parent)
+    : TTransport(parent)
+    , m_socket(socket)
+{
+    m_socket->setParent(this);
+    attach();
+}
+
+void TWebSocketTransport::attach()
+{
+    connect(m_socket, &QWebSocket::connected, this, &TTransport::connected);
+    connect(m_socket, &QWebSocket::disconnected, this, &TTransport::disconnected);
+    connect(m_socket, &QWebSocket::textMessageReceived, this, [this](const QString& message) {
+        emit messageReceived(message.toUtf8(), false);
+    });
+    connect(m_socket, &QWebSocket::binaryMessageReceived, this, [this](const QByteArray& message) {
+        emit messageReceived(message, true);
+    });
+    connect(m_socket, &QWebSocket::bytesWritten, this, &TTransport::bytesWritten);
+    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QWebSocket::error),
+            this, &TTransport::errorOccurred);
+}
+
+bool TWebSocketTransport::supports(const QString& url) const
+{
+    return !url.startsWith(QLatin1String("local:"));
+}
+
+void TWebSocketTransport::open(const QString& url)
+{
+    m_socket->open(QUrl(url));
+}
+
+void TWebSocketTransport::close()
+{
+    if (m_socket->state() == QAbstractSocket::ConnectedState) {
+        m_socket->close();
+    }
+}
+
+TTransport::State TWebSocketTransport::state() const
+{
+    return fromSocketState(m_socket->state());
+}
+
+qint64 TWebSocketTransport::bytesToWrite() const
+{
+    return m_socket->bytesToWrite();
+}
+
+void TWebSocketTransport::sendMessage(const QByteArray& data, bool binary)
+{
+    if (binary) {
+        m_socket->sendBinaryMessage(data);
+    } else {
+        m_socket->sendTextMessage(QString::fromUtf8(data));
+    }
+}
+
+QString TWebSocketTransport::errorString() const
+{
+    return m_socket->errorString();
+}
+
+// =================== TLocalSocketTransport ===================
+
+TLocalSocketTransport::TLocalSocketTransport(QObject* parent)
+    : TTransport(parent)
+    , m_socket(new QLocalSocket(this))
+    , m_ringPollTimer(new QTimer(this))
+{
+    attach();
+}
+
+TLocalSocketTransport::TLocalSocketTransport(QLocalSocket* socket, QObject* parent)
+    : TTransport(parent)
+    , m_socket(socket)
+    , m_ringPollTimer(new QTimer(this))
+{
+    m_socket->setParent(this);
+    attach();
+
+    // 接受连接时可能已经有数据到达
+    if (m_socket->bytesAvailable() > 0) {
+        onReadyRead();
+    }
+}
+
+TLocalSocketTransport::~TLocalSocketTransport() = default;
+
+void TLocalSocketTransport::attach()
+{
+    connect(m_socket, &QLocalSocket::connected, this, [this]() {
+        m_buffer.clear();
+        m_bufferOffset = 0;
+        m_protocolError.clear();
+        announceRing();
+        emit connected();
+    });
+    connect(m_socket, &QLocalSocket::disconnected, this, [this]() {
+        // 环与连接同生命周期，重连后重新协商
+        resetRings();
+        emit disconnected();
+    });
+    connect(m_socket, &QLocalSocket::readyRead, this, &TLocalSocketTransport::onReadyRead);
+    connect(m_socket, &QLocalSocket::bytesWritten, this, &TTransport::bytesWritten);
+    connect(m_socket, &QLocalSocket::errorOccurred, this, &TTransport::errorOccurred);
+
+    m_ringPollTimer->setInterval(RingPollInterval);
+    m_ringPollTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_ringPollTimer, &QTimer::timeout, this, &TLocalSocketTransport::pollRingRelease);
+}
+
+QString TLocalSocketTransport::serverName(const QString& url)
+{
+    int query = url.indexOf('?');
+    return url.mid(6, query < 0 ? -1 : query - 6);
+}
+
+void TLocalSocketTransport::setSharedMemorySize(qint64 bytes)
+{
+    m_sharedMemorySize = qMax<qint64>(0, bytes);
+    m_sendRing.reset();
+    m_sendRingReady = false;
+    m_ringPollTimer->stop();
+    m_ringReported = 0;
+    if (m_socket->state() == QLocalSocket::ConnectedState) {
+        announceRing();
+    }
+}
+
+bool TLocalSocketTransport::supports(const QString& url) const
+{
+    return url.startsWith(QLatin1String("local:"));
+}
+
+void TLocalSocketTransport::open(const QString& url)
+{
+    int query = url.indexOf('?');
+    if (query >= 0) {
+        QUrlQuery options(url.mid(query + 1));
+        m_sharedMemorySize = options.queryItemValue("shm").toLongLong() * 1024 * 1024;
+    }
+    m_socket->connectToServer(serverName(url));
+}
+
+void TLocalSocketTransport::close()
+{
+    if (m_socket->state() == QLocalSocket::ConnectedState) {
+        m_socket->disconnectFromServer();
+    }
+}
+
+TTransport::State TLocalSocketTransport::state() const
+{
+    switch (m_socket->state()) {
+    case QLocalSocket::ConnectedState:
+        return State::Connected;
+    case QLocalSocket::ConnectingState:
+        return State::Connecting;
+    default:
+        return State::Unconnected;
+    }
+}
+
+qint64 TLocalSocketTransport::bytesToWrite() const
+{
+    return m_socket->bytesToWrite();
+}
+
+void TLocalSocketTransport::sendMessage(const QByteArray& data, bool binary)
+{
+    m_sendError.clear();
+    if (data.size() > MaxFrameSize) {
+        // 对端收到超长的帧头会断开连接，在本端丢弃这条消息并报告错误
+        m_sendError = QString("Message of %1 bytes exceeds the frame limit of %2 bytes").arg(data.size()).arg(MaxFrameSize);
+        TLOG_WARN("local_message_too_large").field("bytes", static_cast<qint64>(data.size()));
+        emit errorOccurred();
+        return;
+    }
+    if (data.size() >= SharedMemoryThreshold) {
+        if (char* buffer = reserveMessage(data.size())) {
+            std::memcpy(buffer, data.constData(), static_cast<size_t>(data.size()));
+            commitMessage(data.size(), binary);
+            return;
+        }
+    }
+    writeFrame(binary ? BinaryFrame : TextFrame, data.constData(), data.size());
+}
+
+char* TLocalSocketTransport::reserveMessage(qint64 size)
+{
+    if (!m_sendRingReady || size > MaxFrameSize) {
+        return nullptr;
+    }
+    return m_sendRing->reserve(size, &m_reservedPosition);
+}
+
+void TLocalSocketTransport::commitMessage(qint64 size, bool binary)
+{
+    if (size <= 0) {
+        return;
+    }
+    m_sendRing->commit(m_reservedPosition, size);
+
+    char descriptor[13];
+    qToBigEndian<quint64>(m_reservedPosition, descriptor);
+    qToBigEndian<quint32>(static_cast<quint32>(size), descriptor + 8);
+    descriptor[12] = binary ? 1 : 0;
+    writeFrame(RingMessageFrame, descriptor, sizeof(descriptor));
+
+    m_ringReported = m_sendRing->pendingBytes();
+    if (!m_ringPollTimer->isActive()) {
+        m_ringPollTimer->start();
+    }
+}
+
+qint64 TLocalSocketTransport::sharedBytesInFlight() const
+{
+    return m_sendRing ? m_sendRing->pendingBytes() : 0;
+}
+
+void TLocalSocketTransport::pollRingRelease()
+{
+    qint64 pending = sharedBytesInFlight();
+    qint64 released = m_ringReported - pending;
+    m_ringReported = pending;
+    if (pending == 0) {
+        m_ringPollTimer->stop();
+    }
+    if (released > 0) {
+        emit bytesWritten(released);
+    }
+}
+
+void TLocalSocketTransport::writeFrame(FrameKind kind, const char* data, qint64 size)
+{
+    // 帧头和数据分两次写入 socket 的写缓冲区，不拼接消息
+    char header[HeaderSize];
+    qToBigEndian<quint32>(static_cast<quint32>(size), header);
+    header[4] = static_cast<char>(kind);
+    m_socket->write(header, HeaderSize);
+    m_socket->write(data, size);
+}
+
+void TLocalSocketTransport::announceRing()
+{
+    if (m_sharedMemorySize <= 0) {
+        return;
+    }
+
+    QString errorReason;
+    m_sendRing = TShmRing::create(m_sharedMemorySize, &errorReason);
+    if (!m_sendRing) {
+        // 没有共享内存时所有消息照常走 socket
+        TLOG_WARN("shm_ring_create_failed").field("reason", errorReason);
+        return;
+    }
+
+    QByteArray announce(8, '\0');
+    qToBigEndian<quint64>(static_cast<quint64>(m_sharedMemorySize), announce.data());
+    announce.append(m_sendRing->name());
+    writeFrame(RingAnnounceFrame, announce.constData(), announce.size());
+}
+
+bool TLocalSocketTransport::handleRingFrame(FrameKind kind, const char* data, quint32 length)
+{
+    switch (kind) {
+    case RingAnnounceFrame: {
+        if (length <= 8) {
+            failProtocol("Invalid ring announcement");
+            return false;
+        }
+        qint64 capacity = static_cast<qint64>(qFromBigEndian<quint64>(data));
+        QByteArray name(data + 8, static_cast<int>(length - 8));
+        QString errorReason;
+        m_receiveRing = TShmRing::attach(name, capacity, &errorReason);
+        if (!m_receiveRing) {
+            // 不确认，对端继续走 socket
+            TLOG_WARN("shm_ring_attach_failed").field("reason", errorReason);
+            return true;
+        }
+        writeFrame(RingReadyFrame, nullptr, 0);
+        return true;
+    }
+    case RingReadyFrame:
+        m_sendRingReady = m_sendRing != nullptr;
+        return true;
+    case RingMessageFrame: {
+        if (length != 13 || !m_receiveRing) {
+            failProtocol("Unexpected ring message");
+            return false;
+        }
+        quint64 position = qFromBigEndian<quint64>(data);
+        quint32 size = qFromBigEndian<quint32>(data + 8);
+        bool binary = data[12] == 1;
+        const char* message = size <= MaxFrameSize ? m_receiveRing->data(position, size) : nullptr;
+        if (!message) {
+            failProtocol(QString("Ring message out of bounds (position %1, length %2)").arg(position).arg(size));
+            return false;
+        }
+        // 复制出环后立即释放空间，消息可能被转交给其它线程
+        QByteArray copy(message, static_cast<int>(size));
+        m_receiveRing->release(position + size);
+        emit messageReceived(copy, binary);
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+void TLocalSocketTransport::resetRings()
+{
+    m_sendRing.reset();
+    m_sendRingReady = false;
+    m_receiveRing.reset();
+    m_ringPollTimer->stop();
+    m_ringReported = 0;
+}
+
+void TLocalSocketTransport::failProtocol(const QString& reason)
+{
+    // 帧边界已不可信，只能断开连接
+    m_protocolError = reason;
+    m_buffer.clear();
+    m_bufferOffset = 0;
+    emit errorOccurred();
+    m_socket->abort();
+}
+
+QString TLocalSocketTransport::errorString() const
+{
+    if (!m_protocolError.isEmpty()) {
+        return m_protocolError;
+    }
+    return m_sendError.isEmpty() ? m_socket->errorString() : m_sendError;
+}
+
+void TLocalSocketTransport::onReadyRead()
+{
+    m_buffer.append(m_socket->readAll());
+
+    while (m_buffer.size() - m_bufferOffset >= HeaderSize) {
+        const char* header = m_buffer.constData() + m_bufferOffset;
+        quint32 length = qFromBigEndian<quint32>(header);
+        quint8 kind = static_cast<quint8>(header[4]);
+        if (length > MaxFrameSize || kind > RingMessageFrame) {
+            failProtocol(QString("Invalid frame header (length %1, kind %2)").arg(length).arg(kind));
+            return;
+        }
+        if (m_buffer.size() - m_bufferOffset < HeaderSize + static_cast<int>(length)) {
+            break;
+        }
+
+        const char* data = header + HeaderSize;
+        int frameOffset = m_bufferOffset;
+        m_bufferOffset += HeaderSize + static_cast<int>(length);
+        if (kind > BinaryFrame) {
+            if (!handleRingFrame(static_cast<FrameKind>(kind), data, length)) {
+                return;
+            }
+            continue;
+        }
+        QByteArray message = m_buffer.mid(frameOffset + HeaderSize, static_cast<int>(length));
+        emit messageReceived(message, kind == BinaryFrame);
+    }
+
+    // 已处理的帧从缓冲区移除；整块消费时直接清空，避免逐帧搬移
+    if (m_bufferOffset == m_buffer.size()) {
+        m_buffer.clear();
+        m_bufferOffset = 0;
+    } else if (m_bufferOffset > 0) {
+        m_buffer.remove(0, m_bufferOffset);
+        m_bufferOffset = 0;
+    }
+}
@@ -0,0 +1,170 @@
+#ifndef TTRANSPORT_H
+#define TTRANSPORT_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <limits>
+#include <memory>
+
+class QLocalSocket;
+class QTimer;
+class TShmRing;
+class QWebSocket;
+
+// 消息传输层：TCoreSession 只通过它收发完整的消息（JSON 文本或 CBOR/数据块二进制），
+// 不关心底层是 WebSocket 还是本机的 Unix 域套接字
+class TTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State {
+        Unconnected,
+        Connecting,
+        Connected
+    };
+
+    using QObject::QObject;
+
+    // 按 URL 选择传输：ws:// 或 wss:// 为 WebSocket，local:<名称或路径> 为本机套接字
+    static TTransport* create(const QString& url, QObject* parent = nullptr);
+
+    // url 与当前传输是否为同一种（重连时可复用）
+    virtual bool supports(const QString& url) const = 0;
+
+    virtual void open(const QString& url) = 0;
+    virtual void close() = 0;
+    virtual State state() const = 0;
+    bool isConnected() const { return state() == State::Connected; }
+
+    // 已交给传输但尚未写入内核的字节数
+    virtual qint64 bytesToWrite() const = 0;
+
+    // 发送一条消息，binary 为 false 时 data 为 UTF-8 文本
+    virtual void sendMessage(const QByteArray& data, bool binary) = 0;
+
+    // 直接在传输的共享内存中构造一条消息：预留 size 字节，调用方填写后用 commitMessage 发出
+    // （size 可小于预留值，0 表示放弃）。不支持或空间不足时返回 nullptr，调用方改用 sendMessage
+    virtual char* reserveMessage(qint64 size) { Q_UNUSED(size); return nullptr; }
+    virtual void commitMessage(qint64 size, bool binary) { Q_UNUSED(size); Q_UNUSED(binary); }
+
+    // 已写入共享内存、对端尚未处理完的字节数；对端释放空间后同样发出 bytesWritten
+    virtual qint64 sharedBytesInFlight() const { return 0; }
+
+    // 单条消息的上限，更大的消息会被传输拒绝；默认不限制
+    virtual qint64 maxMessageSize() const { return std::numeric_limits<qint64>::max(); }
+
+    virtual QString errorString() const = 0;
+
+signals:
+    void connected();
+    void disconnected();
+    void messageReceived(const QByteArray& message, bool binary);
+    void bytesWritten(qint64 bytes);
+    void errorOccurred();
+};
+
+// WebSocket 传输，文本消息在这里与 UTF-8 字节互相转换
+class TWebSocketTransport : public TTransport
+{
+    Q_OBJECT
+
+public:
+    explicit TWebSocketTransport(QObject* parent = nullptr);
+
+    // 包装已建立的连接（如 QWebSocketServer 接受的连接），socket 的父对象改为本对象
+    explicit TWebSocketTransport(QWebSocket* socket, QObject* parent = nullptr);
+
+    bool supports(const QString& url) const override;
+    void open(const QString& url) override;
+    void close() override;
+    State state() const override;
+    qint64 bytesToWrite() const override;
+    void sendMessage(const QByteArray& data, bool binary) override;
+    QString errorString() const override;
+
+private:
+    void attach();
+
+    QWebSocket* m_socket;
+};
+
+// 本机传输：QLocalSocket（Unix 域套接字 / Windows 命名管道）上的长度前缀帧，
+// 每条消息一帧：[length:u32 大端][kind:u8][data...]，kind 0 为文本，1 为二进制
+//
+// 启用共享内存（URL 写作 local:<名称>?shm=<MiB>，或调用 setSharedMemorySize）后，
+// 每个方向的发送端各创建一个 TShmRing，不小于 SharedMemoryThreshold 的消息写入环中，
+// socket 上只发送 13 字节的描述帧 [position:u64][length:u32][binary:u8]；
+// 环满或对端尚未确认时照常走 socket。双方都需启用，旧版本对端会因未知帧类型断开
+class TLocalSocketTransport : public TTransport
+{
+    Q_OBJECT
+
+public:
+    static constexpr int HeaderSize = 5;
+    static constexpr qint64 MaxFrameSize = 64 * 1024 * 1024;      // 更大的消息在发送端被拒绝并发出 errorOccurred
+    static constexpr qint64 SharedMemoryThreshold = 64 * 1024;
+
+    enum FrameKind : quint8 {
+        TextFrame = 0,
+        BinaryFrame = 1,
+        RingAnnounceFrame = 2,      // [capacity:u64][名称]，发送端创建了环
+        RingReadyFrame = 3,         // 接收端已映射对端的环
+        RingMessageFrame = 4        // 环中的一条消息
+    };
+
+    explicit TLocalSocketTransport(QObject* parent = nullptr);
+
+    // 包装已建立的连接（如 QLocalServer 接受的连接），socket 的父对象改为本对象
+    explicit TLocalSocketTransport(QLocalSocket* socket, QObject* parent = nullptr);
+    ~TLocalSocketTransport() override;
+
+    // 发送方向共享内存环的容量，0 关闭；已连接时立即通知对端
+    void setSharedMemorySize(qint64 bytes);
+    qint64 sharedMemorySize() const { return m_sharedMemorySize; }
+
+    bool supports(const QString& url) const override;
+    void open(const QString& url) override;
+    void close() override;
+    State state() const override;
+    qint64 bytesToWrite() const override;
+    void sendMessage(const QByteArray& data, bool binary) override;
+    char* reserveMessage(qint64 size) override;
+    void commitMessage(qint64 size, bool binary) override;
+    qint64 sharedBytesInFlight() const override;
+    qint64 maxMessageSize() const override { return MaxFrameSize; }
+    QString errorString() const override;
+
+    // local: 之后、? 之前的服务器名称
+    static QString serverName(const QString& url);
+
+private:
+    void attach();
+    void onReadyRead();
+    void writeFrame(FrameKind kind, const char* data, qint64 size);
+    void announceRing();
+    bool handleRingFrame(FrameKind kind, const char* data, quint32 length);
+    void resetRings();
+    void pollRingRelease();
+    void failProtocol(const QString& reason);
+
+    QLocalSocket* m_socket;
+    QByteArray m_buffer;
+    int m_bufferOffset = 0;
+    QString m_protocolError;
+    QString m_sendError;            // 最近一次 sendMessage 被本端拒绝的原因
+
+    qint64 m_sharedMemorySize = 0;
+    std::unique_ptr<TShmRing> m_sendRing;   // 本端写、对端读
+    bool m_sendRingReady = false;           // 对端已确认映射
+    quint64 m_reservedPosition = 0;
+    std::unique_ptr<TShmRing> m_receiveRing;
+
+    // 对端释放环空间时不经 socket 通知，环中有未释放数据时定时检查 tail
+    static constexpr int RingPollInterval = 2;
+    QTimer* m_ringPollTimer;
+    qint64 m_ringReported = 0;      // 上次检查时环中未释放的字节数
+};
+
+#endif // TTRANSPORT_H
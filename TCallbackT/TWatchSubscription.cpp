@@ -0,0 +1,528 @@
+#include "TWatchSubscription.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QEvent>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <cstring>
+#include "TJsonWriter.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 未发送的批超过该字节数（对端消费过慢）时不再累积事件，改为通知 overflow
+constexpr int MaxReadyBytes = 4 * 1024 * 1024;
+
+// 单个订阅的目录监视上限，递归订阅超大目录树时其余部分以 overflow 通知
+constexpr int MaxWatches = 8192;
+
+#ifdef Q_OS_LINUX
+constexpr quint32 WatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB
+                              | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+// 同一路径在一批内的多个事件合并为一个：先建后删相互抵消（返回空），
+// 先删后建（如写临时文件再 rename 覆盖）视为修改，属性变化不覆盖其它类型
+QString mergeEventType(const QString& previous, const QString& next)
+{
+    if (previous.isEmpty()) {
+        return next;
+    }
+    if (previous == "overflow" || next == "overflow") {
+        return "overflow";
+    }
+    if (previous == "created") {
+        return next == "deleted" ? QString() : previous;
+    }
+    if (previous == "deleted") {
+        return next == "created" ? QString("modified") : next;
+    }
+    if (next == "attrib") {
+        return previous;
+    }
+    return next;
+}
+
+// inotify 描述符的读就绪通知：直接处理 SockAct 事件，
+// 避开 activated 信号在 Qt 5.15（int 与 QSocketDescriptor 两个重载）与 Qt 6 之间的差异
+class InotifyNotifier : public QSocketNotifier
+{
+public:
+    InotifyNotifier(int fd, std::function<void()> handler)
+        : QSocketNotifier(fd, QSocketNotifier::Read)
+        , m_handler(std::move(handler))
+    {
+    }
+
+protected:
+    bool event(QEvent* event) override
+    {
+        if (event->type() == QEvent::SockAct) {
+            m_handler();
+            return true;
+        }
+        return QSocketNotifier::event(event);
+    }
+
+private:
+    std::function<void()> m_handler;
+};
+
+} // namespace
+
+TSubscriptionRegistry& TSubscriptionRegistry::instance()
+{
+    static TSubscriptionRegistry registry;
+    return registry;
+}
+
+void TSubscriptionRegistry::setMaxSubscriptions(int count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxSubscriptions = qMax(1, count);
+}
+
+bool TSubscriptionRegistry::reserve(const QString& id, QString* errorReason)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.contains(id)) {
+        *errorReason = QString("Subscription id already in use: %1").arg(id);
+        return false;
+    }
+    if (m_entries.size() >= m_maxSubscriptions) {
+        *errorReason = QString("Too many subscriptions (limit %1)").arg(m_maxSubscriptions);
+        return false;
+    }
+    m_entries.insert(id, Entry());
+    return true;
+}
+
+bool TSubscriptionRegistry::attach(TWatchStreamBody* body)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(body->m_key);
+    if (it == m_entries.end() || it.value().cancelled) {
+        return false;
+    }
+    it.value().body = body;
+    return true;
+}
+
+void TSubscriptionRegistry::remove(TWatchStreamBody* body)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 标识由该流对象占用：已关联到它，或尚未关联（每个标识只有一个流对象）
+    auto it = m_entries.find(body->m_key);
+    if (it != m_entries.end() && (it.value().body == body || !it.value().body)) {
+        m_entries.erase(it);
+    }
+}
+
+bool TSubscriptionRegistry::cancel(const QString& id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(id);
+    if (it == m_entries.end() || it.value().cancelled) {
+        return false;
+    }
+    TWatchStreamBody* body = it.value().body;
+    if (!body) {
+        // 流还在等待回调返回或在会话线程中排队，打开时再结束
+        it.value().cancelled = true;
+        return true;
+    }
+
+    // 以 notifier 为上下文投递：流对象先于执行被销毁时，该调用随 notifier 一起取消
+    QMetaObject::invokeMethod(body->m_notifier, [body]() {
+        body->finish("unsubscribed");
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+QString TSubscriptionRegistry::sessionKey(quint64 session, const QString& id)
+{
+    // 以换行分隔，不会与对端给出的单行标识相同
+    return QString("session\n%1\n%2").arg(session).arg(id);
+}
+
+TWatchStreamBody::TWatchStreamBody(const QString& id, const QString& key, const QStringList& paths,
+                                   bool recursive, int debounceMs, int maxBatch)
+    : m_id(id)
+    , m_key(key)
+    , m_paths(paths)
+    , m_recursive(recursive)
+    , m_debounce(qMax(0, debounceMs))
+    , m_maxBatch(qMax(1, maxBatch))
+{
+}
+
+TWatchStreamBody::~TWatchStreamBody()
+{
+    if (m_registered) {
+        TSubscriptionRegistry::instance().remove(this);
+    }
+    // 计时器是 notifier 的子对象，一起销毁
+    delete m_notifier;
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+bool TWatchStreamBody::open(QString* errorReason)
+{
+#ifdef Q_OS_LINUX
+    if (m_paths.isEmpty()) {
+        *errorReason = "No paths to watch";
+        return false;
+    }
+
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        *errorReason = QString("inotify_init1 failed: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+
+    // 在 socket 所在线程创建，事件在该线程的事件循环中读取，不阻塞会话
+    m_notifier = new InotifyNotifier(m_fd, [this]() {
+        onReadable();
+    });
+    m_timer = new QTimer(m_notifier);
+    m_timer->setSingleShot(true);
+    QObject::connect(m_timer, &QTimer::timeout, m_notifier, [this]() {
+        flushBatch();
+    });
+
+    for (const QString& path : m_paths) {
+        QFileInfo info(path);
+        if (info.isDir()) {
+            QString directory = QDir::cleanPath(info.absoluteFilePath());
+            if (!addWatch(directory, QString(), m_recursive, errorReason)) {
+                return false;
+            }
+            if (m_recursive) {
+                addTree(directory, false);
+            }
+        } else {
+            // 文件通过所在目录监视，覆盖写临时文件再 rename 的更新方式，文件尚不存在时也能收到创建事件
+            if (!addWatch(QDir::cleanPath(info.absolutePath()), info.fileName(), false, errorReason)) {
+                return false;
+            }
+        }
+    }
+
+    // 回调返回后、打开之前已被 "unsub" 取消：照常打开，随后立即以完成响应结束
+    if (!TSubscriptionRegistry::instance().attach(this)) {
+        finish("unsubscribed");
+    }
+    return true;
+#else
+    *errorReason = "File watching is not supported on this platform";
+    return false;
+#endif
+}
+
+bool TWatchStreamBody::addWatch(const QString& directory, const QString& name, bool recursive, QString* errorReason)
+{
+#ifdef Q_OS_LINUX
+    // errorReason 为空表示订阅已建立，失败时通知对端而不是报错
+    if (m_watches.size() >= MaxWatches) {
+        if (errorReason) {
+            *errorReason = QString("Too many watched directories (limit %1)").arg(MaxWatches);
+        } else {
+            queue(directory, "overflow", true);
+        }
+        return false;
+    }
+
+    int wd = ::inotify_add_watch(m_fd, QFile::encodeName(directory).constData(), WatchMask);
+    if (wd < 0) {
+        int error = errno;
+        if (errorReason) {
+            *errorReason = QString("Cannot watch %1: %2").arg(directory, QString::fromLocal8Bit(std::strerror(error)));
+        } else if (error != ENOENT && error != ENOTDIR) {
+            // 目录已被删除时无需通知，其它失败（如达到 max_user_watches）意味着漏掉变化
+            queue(directory, "overflow", true);
+        }
+        return false;
+    }
+
+    // 同一目录重复添加时内核返回同一个描述符
+    Watch& watch = m_watches[wd];
+    watch.path = directory;
+    if (name.isEmpty()) {
+        watch.all = true;
+    } else {
+        watch.names.insert(name);
+    }
+    watch.recursive = watch.recursive || recursive;
+    return true;
+#else
+    Q_UNUSED(directory);
+    Q_UNUSED(name);
+    Q_UNUSED(recursive);
+    Q_UNUSED(errorReason);
+    return false;
+#endif
+}
+
+void TWatchStreamBody::addTree(const QString& directory, bool reportExisting)
+{
+    // 新建的目录在加入监视前可能已有内容，reportExisting 时补报为 created
+    QDirIterator it(directory, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QFileInfo info = it.fileInfo();
+        bool isDirectory = info.isDir() && !info.isSymLink();
+        if (reportExisting) {
+            queue(path, "created", isDirectory);
+        }
+        if (isDirectory) {
+            addWatch(path, QString(), true, nullptr);
+        }
+    }
+}
+
+void TWatchStreamBody::removeTree(const QString& directory)
+{
+#ifdef Q_OS_LINUX
+    // 移出订阅范围的子树：监视跟随 inode，路径已失效，之后移回时重新添加
+    const QString prefix = directory + QLatin1Char('/');
+    for (auto it = m_watches.begin(); it != m_watches.end();) {
+        if (it->path == directory || it->path.startsWith(prefix)) {
+            ::inotify_rm_watch(m_fd, it.key());
+            it = m_watches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#else
+    Q_UNUSED(directory);
+#endif
+}
+
+void TWatchStreamBody::onReadable()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    for (;;) {
+        ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 内核队列溢出，丢失的事件无法恢复，对端需要重新读取订阅的路径
+                for (const QString& path : m_paths) {
+                    QFileInfo info(path);
+                    queue(QDir::cleanPath(info.absoluteFilePath()), "overflow", info.isDir());
+                }
+                continue;
+            }
+
+            auto it = m_watches.find(event->wd);
+            if (it == m_watches.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_watches.erase(it);
+                continue;
+            }
+            // 复制一份：下面添加监视可能使 m_watches 重新分配
+            const Watch watch = it.value();
+
+            if (event->len == 0) {
+                // 目录自身被删除或移走；子目录也会由父目录的事件报告，在批内合并
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    if (watch.all) {
+                        queue(watch.path, "deleted", true);
+                    }
+                    removeTree(watch.path);
+                }
+                continue;
+            }
+
+            QString name = QFile::decodeName(event->name);
+            if (!watch.all && !watch.names.contains(name)) {
+                continue;
+            }
+            QString path = watch.path + QLatin1Char('/') + name;
+            bool isDirectory = event->mask & IN_ISDIR;
+
+            QString type;
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                type = "created";
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                type = "deleted";
+            } else if (event->mask & IN_MODIFY) {
+                type = "modified";
+            } else {
+                type = "attrib";
+            }
+            queue(path, type, isDirectory);
+
+            if (isDirectory && watch.recursive) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    if (addWatch(path, QString(), true, nullptr)) {
+                        addTree(path, true);
+                    }
+                } else if (event->mask & IN_MOVED_FROM) {
+                    removeTree(path);
+                }
+            }
+        }
+    }
+
+    // 订阅的路径全部消失（所在目录被删除或移走）后结束
+    if (m_watches.isEmpty()) {
+        finish("deleted");
+    }
+#endif
+}
+
+void TWatchStreamBody::queue(const QString& path, const QString& type, bool isDirectory)
+{
+    if (m_finished) {
+        return;
+    }
+    if (m_batch.empty()) {
+        m_batchAge.start();
+    }
+
+    auto it = m_batchIndex.constFind(path);
+    if (it != m_batchIndex.constEnd()) {
+        Models::SubscribeResponse::Event& event = m_batch[it.value()];
+        event.type = mergeEventType(event.type, type);
+        event.isDirectory = isDirectory;
+    } else {
+        Models::SubscribeResponse::Event event;
+        event.path = path;
+        event.type = type;
+        event.isDirectory = isDirectory;
+        m_batchIndex.insert(path, static_cast<int>(m_batch.size()));
+        m_batch.push_back(event);
+    }
+
+    if (static_cast<int>(m_batch.size()) >= m_maxBatch) {
+        flushBatch();
+        return;
+    }
+    // 事件停止 m_debounce 毫秒后发出；持续有事件时自本批第一个事件起最长等待 4 倍
+    qint64 remaining = qMax<qint64>(0, 4 * m_debounce - m_batchAge.elapsed());
+    m_timer->start(static_cast<int>(qMin<qint64>(m_debounce, remaining)));
+}
+
+void TWatchStreamBody::flushBatch()
+{
+    m_timer->stop();
+    if (m_batch.empty()) {
+        return;
+    }
+
+    QByteArray line;
+    TJsonWriter writer(&line);
+    writer.beginArray();
+    int count = 0;
+    if (m_ready.size() < MaxReadyBytes) {
+        m_overflowed = false;
+        for (const Models::SubscribeResponse::Event& event : m_batch) {
+            if (!event.type.isEmpty()) {
+                Models::FieldCodec<Models::SubscribeResponse::Event>::write(writer, event);
+                ++count;
+            }
+        }
+    } else if (!m_overflowed) {
+        // 对端跟不上：丢弃本批及之后的事件，直到积压回落，只通知一次 overflow
+        m_overflowed = true;
+        for (const QString& path : m_paths) {
+            QFileInfo info(path);
+            Models::SubscribeResponse::Event event;
+            event.path = QDir::cleanPath(info.absoluteFilePath());
+            event.type = "overflow";
+            event.isDirectory = info.isDir();
+            Models::FieldCodec<Models::SubscribeResponse::Event>::write(writer, event);
+            ++count;
+        }
+    }
+    writer.endArray();
+    m_batch.clear();
+    m_batchIndex.clear();
+
+    // 批内事件全部抵消时不发送
+    if (count == 0) {
+        return;
+    }
+    line.append('\n');
+    m_ready.append(line);
+    m_events += count;
+    ++m_batches;
+    notifyReadyRead();
+}
+
+void TWatchStreamBody::finish(const QString& reason)
+{
+    if (m_finished) {
+        return;
+    }
+    // 尚未发出的事件先于完成响应发送
+    flushBatch();
+    m_finished = true;
+    m_reason = reason;
+    m_notifier->setEnabled(false);
+    if (m_registered) {
+        TSubscriptionRegistry::instance().remove(this);
+        m_registered = false;
+    }
+    notifyReadyRead();
+}
+
+QByteArray TWatchStreamBody::read(qint64 maxSize)
+{
+    if (m_ready.size() <= maxSize) {
+        QByteArray data = m_ready;
+        m_ready.clear();
+        return data;
+    }
+    // 尽量在行尾切分，使每个数据块都由完整的批组成
+    int cut = m_ready.lastIndexOf('\n', static_cast<int>(maxSize) - 1) + 1;
+    if (cut <= 0) {
+        cut = static_cast<int>(maxSize);
+    }
+    QByteArray data = m_ready.left(cut);
+    m_ready.remove(0, cut);
+    return data;
+}
+
+bool TWatchStreamBody::atEnd() const
+{
+    return m_finished && m_ready.isEmpty();
+}
+
+bool TWatchStreamBody::waitingForData() const
+{
+    return !m_finished;
+}
+
+QJsonObject TWatchStreamBody::completion() const
+{
+    Models::SubscribeResponse result;
+    result.id = m_id;
+    result.events = m_events;
+    result.batches = m_batches;
+    result.watches = m_watches.size();
+    result.reason = m_reason;
+    return result.toJsonValue().toObject();
+}
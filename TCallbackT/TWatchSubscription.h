@@ -0,0 +1,123 @@
+#ifndef TWATCHSUBSCRIPTION_H
+#define TWATCHSUBSCRIPTION_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <mutex>
+#include <vector>
+#include "Models.h"
+#include "TStreamBody.h"
+
+class QSocketNotifier;
+class QTimer;
+class TWatchStreamBody;
+
+// 全局订阅表："unsub" 按标识找到订阅并取消，可被多个会话线程共享
+// 显式给出的标识在整个进程内唯一，不区分会话：任何会话都能取消它，不同会话使用相同标识时后者被拒绝；
+// 未给出标识时以请求的 sequence 作为标识，只在本会话内有效（表中以 sessionKey() 保存），
+// 各会话的 sequence 各自编号，不会互相冲突
+// 每个订阅占用一个 inotify 实例（受 fs.inotify.max_user_instances 限制，默认 128），因此限制总数
+//
+// "sub" 回调中先 reserve() 占用标识，流在会话线程 open() 时再 attach()；
+// 两者之间到达的 "unsub" 记为已取消，流打开后立即结束
+class TSubscriptionRegistry
+{
+public:
+    static TSubscriptionRegistry& instance();
+
+    // 同时存在的最大订阅数（默认 64）
+    void setMaxSubscriptions(int count);
+
+    // 占用标识，已被占用或超出上限时返回 false 并填写原因
+    bool reserve(const QString& id, QString* errorReason);
+
+    // 流已打开：关联到占用的标识，期间已被取消时返回 false
+    bool attach(TWatchStreamBody* body);
+
+    // 释放标识（流对象析构或结束时调用）
+    void remove(TWatchStreamBody* body);
+
+    // 取消订阅：流已打开时投递到其会话线程执行，尚未打开时记为已取消；找不到时返回 false
+    bool cancel(const QString& id);
+
+    // 会话内默认标识在表中的键
+    static QString sessionKey(quint64 session, const QString& id);
+
+private:
+    TSubscriptionRegistry() = default;
+
+    struct Entry {
+        TWatchStreamBody* body = nullptr;   // 流尚未打开时为空
+        bool cancelled = false;
+    };
+
+    std::mutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    int m_maxSubscriptions = 64;
+};
+
+// 文件变化订阅流：推送型数据源，inotify 描述符由会话线程的事件循环监听，
+// 事件在一批内按路径合并，安静 debounceMs 或累计到 maxBatch 个后作为一行 JSON 数组发出
+class TWatchStreamBody : public TStreamBody
+{
+public:
+    // key 须已由 TSubscriptionRegistry::reserve() 占用，析构时释放；id 为对端看到的标识
+    TWatchStreamBody(const QString& id, const QString& key, const QStringList& paths, bool recursive,
+                     int debounceMs, int maxBatch);
+    ~TWatchStreamBody() override;
+
+    bool open(QString* errorReason) override;
+    QByteArray read(qint64 maxSize) override;
+    bool atEnd() const override;
+    QJsonObject completion() const override;
+    bool waitingForData() const override;
+    bool needsEventLoop() const override { return true; }
+
+private:
+    friend class TSubscriptionRegistry;
+
+    // 同一目录在一个 inotify 实例中只有一个监视，多个订阅路径合并到一起
+    struct Watch {
+        QString path;
+        QSet<QString> names;        // 只关注这些条目（订阅的是文件），all 为 true 时不过滤
+        bool all = false;
+        bool recursive = false;
+    };
+
+    bool addWatch(const QString& directory, const QString& name, bool recursive, QString* errorReason);
+    void addTree(const QString& directory, bool reportExisting);
+    void removeTree(const QString& directory);
+    void onReadable();
+    void queue(const QString& path, const QString& type, bool isDirectory);
+    void flushBatch();
+    void finish(const QString& reason);
+
+    QString m_id;
+    QString m_key;                  // 订阅表中的键
+    QStringList m_paths;
+    bool m_recursive;
+    int m_debounce;
+    int m_maxBatch;
+
+    int m_fd = -1;
+    QSocketNotifier* m_notifier = nullptr;  // 在 open() 中创建，归属会话线程，也是跨线程取消的上下文
+    QTimer* m_timer = nullptr;
+    QHash<int, Watch> m_watches;
+    bool m_registered = true;       // 仍占用订阅标识
+
+    std::vector<Models::SubscribeResponse::Event> m_batch;  // type 为空表示已在批内抵消
+    QHash<QString, int> m_batchIndex;                        // 路径 -> m_batch 下标
+    QElapsedTimer m_batchAge;                                // 本批第一个事件的时间
+
+    QByteArray m_ready;             // 已序列化、尚未发送的批
+    bool m_overflowed = false;      // m_ready 超出上限后丢弃事件，已发出 overflow
+    bool m_finished = false;
+    QString m_reason;
+    qint64 m_events = 0;
+    qint64 m_batches = 0;
+};
+
+#endif // TWATCHSUBSCRIPTION_H
@@ -0,0 +1,94 @@
+// 函数分发微基准：对比旧的 unordered_map<QString, std::function> 与 TDispatchTable
+//
+// 旧路径：每个请求从 UTF-8 字节构造 QString，哈希查找，再经过两层 std::function
+// 新路径：直接用 UTF-8 字节查有序表，经一个函数指针调用按类型实例化的入口
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include "../TDispatchTable.h"
+
+namespace {
+
+const char* const kNames[] = { "rf", "wf", "ld", "ec", "gsi" };
+const int kNameCount = sizeof(kNames) / sizeof(kNames[0]);
+
+using OldCallback = std::function<int(int sequence, int payload)>;
+
+struct NewEntry {
+    int (*invoke)(void* target, int sequence, int payload) = nullptr;
+    void* target = nullptr;
+};
+
+struct Handler {
+    int operator()(int sequence, int payload) const { return sequence ^ payload; }
+};
+
+int invokeHandler(void* target, int sequence, int payload)
+{
+    return (*static_cast<Handler*>(target))(sequence, payload);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    const int iterations = argc > 1 ? QString(argv[1]).toInt() : 10000000;
+
+    // 旧实现：用户回调包在内部 std::function 中
+    std::unordered_map<QString, OldCallback> oldTable;
+    for (const char* name : kNames) {
+        OldCallback user = Handler();
+        oldTable[QString(name)] = [user](int sequence, int payload) { return user(sequence, payload); };
+    }
+
+    // 新实现
+    Handler handler;
+    TDispatchTable<NewEntry> newTable;
+    for (const char* name : kNames) {
+        NewEntry& entry = newTable.findOrInsert(name, std::strlen(name));
+        entry.invoke = &invokeHandler;
+        entry.target = &handler;
+    }
+
+    // 预先准备请求中的函数名字节
+    size_t nameSizes[kNameCount];
+    for (int i = 0; i < kNameCount; ++i) {
+        nameSizes[i] = std::strlen(kNames[i]);
+    }
+
+    QElapsedTimer timer;
+    volatile int sink = 0;
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        int index = i % kNameCount;
+        QString name = QString::fromUtf8(kNames[index], static_cast<int>(nameSizes[index]));
+        auto it = oldTable.find(name);
+        sink = sink + it->second(i, index);
+    }
+    qint64 oldNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        int index = i % kNameCount;
+        NewEntry* entry = newTable.find(kNames[index], nameSizes[index]);
+        sink = sink + entry->invoke(entry->target, i, index);
+    }
+    qint64 newNs = timer.nsecsElapsed();
+
+    out << "iterations: " << iterations << "\n";
+    out << "unordered_map<QString, std::function>: "
+        << static_cast<double>(oldNs) / iterations << " ns/dispatch\n";
+    out << "TDispatchTable + invoker:              "
+        << static_cast<double>(newNs) / iterations << " ns/dispatch\n";
+
+    return 0;
+}
@@ -0,0 +1,538 @@
+// 负载生成器：内置一个 QWebSocketServer（或 --transport local 时的 QLocalServer）代替 PaaS 服务器，启动若干 TCoreSession
+// （各自在独立线程中）连接进来，按请求配比和流水线深度持续发送请求，
+// 按 sequence 匹配响应统计延迟，结束后把吞吐量和延迟分布写入 JSON 文件
+//
+// 用法：
+//   loadgen --connections 4 --depth 16 --requests 200000 --mix rf=4,wf=1,ld=1,gsi=4 \
+//           --payload-size 4096 --output results.json --baseline previous.json
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Handlers.h"
+#include "TCoreSession.h"
+#include "TJsonReader.h"
+#include "TMetrics.h"
+#include "TSessionPool.h"
+#include "TSystemSampler.h"
+#include "TTransport.h"
+
+namespace {
+
+struct Options {
+    int connections = 1;
+    int depth = 8;              // 每个连接上未完成请求的上限
+    qint64 requests = 100000;   // 请求总数，0 表示只按时长
+    int durationSeconds = 0;    // 运行时长，0 表示只按请求数
+    QString mix = "rf=4,wf=1,ld=1,gsi=4";
+    QString transport = "ws";   // ws 或 local
+    int payloadSize = 1024;     // rf 文件大小与 wf 写入内容大小
+    int requestBatch = 1;       // 每个请求帧中的请求数，大于 1 时发送数组帧（depth 应不小于该值）
+    int batchBytes = 0;         // 会话合并响应的阈值，0 表示不合并
+    int batchDelayMs = 2;
+    QString outputPath = "loadgen-results.json";
+    QString baselinePath;
+};
+
+// 一种请求及其统计
+struct Workload {
+    QString name;
+    int weight = 0;
+    QByteArray prefix;          // 请求 JSON 中 "s" 的值之前的部分
+    TLatencyHistogram latency;  // 纳秒
+    quint64 completed = 0;
+    quint64 errors = 0;
+};
+
+struct Pending {
+    qint64 sentAt = 0;
+    Workload* workload = nullptr;
+};
+
+struct Connection {
+    TTransport* transport = nullptr;
+    QHash<int, Pending> pending;
+};
+
+// 构造请求前缀：{"n":...,"p":...,"s":
+QByteArray requestPrefix(const QString& name, const QJsonValue& payload)
+{
+    QJsonObject object;
+    object["n"] = name;
+    object["p"] = payload;
+    QByteArray json = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    json.chop(1);
+    json.append(",\"s\":");
+    return json;
+}
+
+// 从一个响应对象中读取 c 和 s，其它字段跳过
+bool parseResponse(TJsonReader& reader, int* status, int* sequence)
+{
+    if (!reader.expect('{')) {
+        return false;
+    }
+    bool hasSequence = false;
+    do {
+        const char* keyBegin = nullptr;
+        const char* keyEnd = nullptr;
+        if (!reader.readKey(&keyBegin, &keyEnd)) {
+            return false;
+        }
+        qint64 value = 0;
+        if (keyEnd - keyBegin == 1 && (*keyBegin == 'c' || *keyBegin == 's')) {
+            if (!reader.readInteger(&value)) {
+                return false;
+            }
+            if (*keyBegin == 'c') {
+                *status = static_cast<int>(value);
+            } else {
+                *sequence = static_cast<int>(value);
+                hasSequence = true;
+            }
+        } else if (!reader.skipValue()) {
+            return false;
+        }
+    } while (reader.consume(','));
+    return reader.expect('}') && hasSequence;
+}
+
+class LoadDriver
+{
+public:
+    LoadDriver(const Options& options, std::vector<std::unique_ptr<Workload>>* workloads)
+        : m_options(options)
+        , m_workloads(workloads)
+    {
+        // 按权重展开成固定的发送顺序，保证各次运行的请求序列一致
+        for (const std::unique_ptr<Workload>& workload : *m_workloads) {
+            for (int i = 0; i < workload->weight; ++i) {
+                m_schedule.push_back(workload.get());
+            }
+        }
+    }
+
+    void addConnection(TTransport* transport)
+    {
+        m_connections.emplace_back(new Connection());
+        Connection* connection = m_connections.back().get();
+        connection->transport = transport;
+
+        QObject::connect(transport, &TTransport::messageReceived, transport,
+                         [this, connection](const QByteArray& message, bool binary) {
+            if (!binary) {
+                onResponse(connection, message);
+                return;
+            }
+            // 流式响应的数据块帧，完成响应到达时才计入延迟
+            if (!message.isEmpty() && static_cast<quint8>(message[0]) == 0x01) {
+                m_chunkBytes += message.size() - 16;
+            }
+        });
+
+        QObject::connect(transport, &TTransport::disconnected, transport, [this, connection]() {
+            // 会话意外断开：停止发送，放弃该连接上未完成的请求
+            m_stopping = true;
+            m_abandoned += connection->pending.size();
+            connection->pending.clear();
+            checkFinished();
+        });
+
+        if (static_cast<int>(m_connections.size()) == m_options.connections) {
+            start();
+        }
+    }
+
+    // 结束回调：所有请求完成或超时后调用
+    std::function<void()> finished;
+
+    qint64 elapsedNs() const { return m_elapsedNs; }
+    quint64 chunkBytes() const { return m_chunkBytes; }
+    quint64 abandoned() const { return m_abandoned; }
+    quint64 frames() const { return m_frames; }
+
+private:
+    void start()
+    {
+        m_clock.start();
+        if (m_options.durationSeconds > 0) {
+            QTimer::singleShot(m_options.durationSeconds * 1000, [this]() { m_stopping = true; });
+        }
+        for (const std::unique_ptr<Connection>& connection : m_connections) {
+            fill(connection.get());
+        }
+    }
+
+    bool canSend() const
+    {
+        return !m_stopping && (m_options.requests <= 0 || m_sent < m_options.requests);
+    }
+
+    void fill(Connection* connection)
+    {
+        while (connection->pending.size() < m_options.depth && canSend()) {
+            // 一帧最多 requestBatch 个请求，多于一个时以数组帧发送
+            QByteArray frame;
+            int count = 0;
+            qint64 sentAt = m_clock.nsecsElapsed();
+            while (count < m_options.requestBatch
+                   && connection->pending.size() < m_options.depth && canSend()) {
+                Workload* workload = m_schedule[m_sent % m_schedule.size()];
+                int sequence = ++m_sequence;
+
+                frame.append(count == 0 ? "" : ",");
+                frame.append(workload->prefix);
+                frame.append(QByteArray::number(sequence));
+                frame.append('}');
+
+                Pending pending;
+                pending.sentAt = sentAt;
+                pending.workload = workload;
+                connection->pending.insert(sequence, pending);
+                ++m_sent;
+                ++count;
+            }
+
+            if (m_options.requestBatch > 1) {
+                frame.prepend('[');
+                frame.append(']');
+            }
+            connection->transport->sendMessage(frame, false);
+            ++m_frames;
+        }
+        checkFinished();
+    }
+
+    void onResponse(Connection* connection, const QByteArray& message)
+    {
+        // 会话开启合并时，多个响应以 JSON 数组的形式到达
+        TJsonReader reader(message);
+        int status = 0;
+        int sequence = 0;
+        if (reader.consume('[')) {
+            do {
+                if (!parseResponse(reader, &status, &sequence)) {
+                    break;
+                }
+                complete(connection, status, sequence);
+            } while (reader.consume(','));
+        } else if (parseResponse(reader, &status, &sequence)) {
+            complete(connection, status, sequence);
+        }
+
+        fill(connection);
+    }
+
+    void complete(Connection* connection, int status, int sequence)
+    {
+        auto it = connection->pending.find(sequence);
+        if (it == connection->pending.end()) {
+            return;
+        }
+        Workload* workload = it->workload;
+        workload->latency.record(static_cast<quint64>(m_clock.nsecsElapsed() - it->sentAt));
+        ++workload->completed;
+        if (status >= 400) {
+            ++workload->errors;
+        }
+        connection->pending.erase(it);
+    }
+
+    void checkFinished()
+    {
+        if (m_done || canSend()) {
+            return;
+        }
+        for (const std::unique_ptr<Connection>& connection : m_connections) {
+            if (!connection->pending.isEmpty()) {
+                return;
+            }
+        }
+        m_done = true;
+        m_elapsedNs = m_clock.nsecsElapsed();
+        if (finished) {
+            finished();
+        }
+    }
+
+    const Options m_options;
+    std::vector<std::unique_ptr<Workload>>* m_workloads;
+    std::vector<Workload*> m_schedule;
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    QElapsedTimer m_clock;
+    qint64 m_sent = 0;
+    int m_sequence = 0;
+    bool m_stopping = false;
+    bool m_done = false;
+    qint64 m_elapsedNs = 0;
+    quint64 m_chunkBytes = 0;
+    quint64 m_abandoned = 0;
+    quint64 m_frames = 0;
+};
+
+// 准备 rf/ld 读取的文件，返回各函数的请求前缀
+bool buildWorkloads(const Options& options, const QDir& dir,
+                    std::vector<std::unique_ptr<Workload>>* workloads, QString* errorReason)
+{
+    QString readPath = dir.filePath("read.txt");
+    QFile readFile(readPath);
+    if (!readFile.open(QIODevice::WriteOnly)) {
+        *errorReason = QString("Cannot create %1").arg(readPath);
+        return false;
+    }
+    readFile.write(QByteArray(options.payloadSize, 'r'));
+    readFile.close();
+
+    QString listPath = dir.filePath("list");
+    dir.mkpath("list");
+    for (int i = 0; i < 64; ++i) {
+        QFile file(QDir(listPath).filePath(QString("file-%1.txt").arg(i)));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write("x");
+        }
+    }
+
+    const QStringList entries = options.mix.split(',', Qt::SkipEmptyParts);
+    for (const QString& entry : entries) {
+        QStringList parts = entry.split('=');
+        auto workload = std::make_unique<Workload>();
+        workload->name = parts.value(0).trimmed();
+        workload->weight = parts.size() > 1 ? parts[1].toInt() : 1;
+        if (workload->weight <= 0) {
+            continue;
+        }
+
+        if (workload->name == "rf") {
+            workload->prefix = requestPrefix("rf", readPath);
+        } else if (workload->name == "wf") {
+            QJsonObject payload;
+            payload["path"] = dir.filePath("write.txt");
+            payload["content"] = QString(options.payloadSize, QLatin1Char('w'));
+            payload["append"] = false;
+            workload->prefix = requestPrefix("wf", payload);
+        } else if (workload->name == "ld") {
+            QJsonObject payload;
+            payload["path"] = listPath;
+            workload->prefix = requestPrefix("ld", payload);
+        } else if (workload->name == "gsi" || workload->name == "metrics") {
+            workload->prefix = requestPrefix(workload->name, QJsonValue::Null);
+        } else {
+            *errorReason = QString("Unknown function in mix: %1").arg(workload->name);
+            return false;
+        }
+        workloads->push_back(std::move(workload));
+    }
+
+    if (workloads->empty()) {
+        *errorReason = "Empty request mix";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("TCallbackT load generator");
+    parser.addHelpOption();
+    QCommandLineOption connectionsOption("connections", "Number of sessions.", "n", "1");
+    QCommandLineOption depthOption("depth", "Outstanding requests per session.", "n", "8");
+    QCommandLineOption requestsOption("requests", "Total requests, 0 for duration only.", "n", "100000");
+    QCommandLineOption durationOption("duration", "Run time in seconds, 0 for request count only.", "seconds", "0");
+    QCommandLineOption transportOption("transport", "Session transport: ws or local.", "transport", "ws");
+    QCommandLineOption mixOption("mix", "Request mix, e.g. rf=4,wf=1,ld=1,gsi=4.", "mix", "rf=4,wf=1,ld=1,gsi=4");
+    QCommandLineOption payloadOption("payload-size", "rf file size and wf content size in bytes.", "bytes", "1024");
+    QCommandLineOption requestBatchOption("request-batch", "Requests per frame, sent as an array when above 1.", "n", "1");
+    QCommandLineOption batchBytesOption("batch-bytes", "Session response batching threshold, 0 to disable.", "bytes", "0");
+    QCommandLineOption batchDelayOption("batch-delay", "Session response batching delay.", "ms", "2");
+    QCommandLineOption outputOption("output", "Result JSON file.", "path", "loadgen-results.json");
+    QCommandLineOption baselineOption("baseline", "Previous result JSON to compare against.", "path");
+    parser.addOptions({connectionsOption, depthOption, requestsOption, durationOption, transportOption,
+                       mixOption, payloadOption, requestBatchOption, batchBytesOption, batchDelayOption,
+                       outputOption, baselineOption});
+    parser.process(app);
+
+    Options options;
+    options.connections = qMax(1, parser.value(connectionsOption).toInt());
+    options.depth = qMax(1, parser.value(depthOption).toInt());
+    options.requests = qMax<qint64>(0, parser.value(requestsOption).toLongLong());
+    options.durationSeconds = qMax(0, parser.value(durationOption).toInt());
+    options.mix = parser.value(mixOption);
+    options.transport = parser.value(transportOption);
+    if (options.transport != "ws" && options.transport != "local") {
+        out << "error: unknown transport " << options.transport << "\n";
+        return 1;
+    }
+    options.payloadSize = qMax(0, parser.value(payloadOption).toInt());
+    options.requestBatch = qBound(1, parser.value(requestBatchOption).toInt(), 1024);
+    options.batchBytes = qMax(0, parser.value(batchBytesOption).toInt());
+    options.batchDelayMs = qMax(0, parser.value(batchDelayOption).toInt());
+    options.outputPath = parser.value(outputOption);
+    options.baselinePath = parser.value(baselineOption);
+    if (options.requests == 0 && options.durationSeconds == 0) {
+        options.durationSeconds = 10;
+    }
+
+    QTemporaryDir tempDir;
+    std::vector<std::unique_ptr<Workload>> workloads;
+    QString errorReason;
+    if (!tempDir.isValid() || !buildWorkloads(options, QDir(tempDir.path()), &workloads, &errorReason)) {
+        out << "error: " << (errorReason.isEmpty() ? QString("Cannot create temporary directory") : errorReason) << "\n";
+        return 1;
+    }
+
+    LoadDriver driver(options, &workloads);
+    QWebSocketServer server("loadgen", QWebSocketServer::NonSecureMode);
+    QLocalServer localServer;
+    QString url;
+    if (options.transport == "local") {
+        // 本机套接字放在临时目录中，避免与其它进程的服务器名冲突
+        QString socketPath = QDir(tempDir.path()).filePath("loadgen.sock");
+        if (!localServer.listen(socketPath)) {
+            out << "error: " << localServer.errorString() << "\n";
+            return 1;
+        }
+        url = "local:" + socketPath;
+        QObject::connect(&localServer, &QLocalServer::newConnection, &localServer, [&localServer, &driver]() {
+            while (QLocalSocket* socket = localServer.nextPendingConnection()) {
+                driver.addConnection(new TLocalSocketTransport(socket, &localServer));
+            }
+        });
+    } else {
+        if (!server.listen(QHostAddress::LocalHost, 0)) {
+            out << "error: " << server.errorString() << "\n";
+            return 1;
+        }
+        url = QString("ws://127.0.0.1:%1").arg(server.serverPort());
+        QObject::connect(&server, &QWebSocketServer::newConnection, &server, [&server, &driver]() {
+            while (QWebSocket* socket = server.nextPendingConnection()) {
+                driver.addConnection(new TWebSocketTransport(socket, &server));
+            }
+        });
+    }
+
+    // 被测会话：与主程序相同的会话池和回调，每个会话一个线程
+    TSystemSampler sampler;
+    sampler.start(1000);
+
+    TSessionPool pool(options.connections);
+    registerDefaultHandlers(pool.registry(), sampler);
+    pool.setSessionInitializer([&options](TCoreSession& session) {
+        session.setExecutionMode(TCoreSession::ExecutionMode::ThreadPool);
+        session.setResponseBatching(options.batchBytes, options.batchDelayMs);
+    });
+    pool.start(url);
+
+    driver.finished = [&app]() { app.quit(); };
+    app.exec();
+
+    pool.stop();
+
+    // 汇总
+    double elapsedSeconds = driver.elapsedNs() / 1e9;
+    TLatencySummary total;
+    quint64 completed = 0;
+    quint64 errors = 0;
+    QJsonObject functions;
+    for (const std::unique_ptr<Workload>& workload : workloads) {
+        TLatencySummary summary;
+        summary.merge(workload->latency);
+        total.merge(workload->latency);
+        completed += workload->completed;
+        errors += workload->errors;
+
+        QJsonObject function;
+        function["completed"] = static_cast<qint64>(workload->completed);
+        function["errors"] = static_cast<qint64>(workload->errors);
+        function["throughput"] = elapsedSeconds > 0 ? workload->completed / elapsedSeconds : 0.0;
+        function["latency"] = summary.toJson();
+        functions[workload->name] = function;
+    }
+
+    QJsonObject config;
+    config["connections"] = options.connections;
+    config["depth"] = options.depth;
+    config["transport"] = options.transport;
+    config["requests"] = options.requests;
+    config["duration"] = options.durationSeconds;
+    config["mix"] = options.mix;
+    config["payloadSize"] = options.payloadSize;
+    config["requestBatch"] = options.requestBatch;
+    config["batchBytes"] = options.batchBytes;
+    config["batchDelay"] = options.batchDelayMs;
+
+    QJsonObject result;
+    result["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    result["config"] = config;
+    result["elapsedSeconds"] = elapsedSeconds;
+    result["completed"] = static_cast<qint64>(completed);
+    result["errors"] = static_cast<qint64>(errors);
+    result["throughput"] = elapsedSeconds > 0 ? completed / elapsedSeconds : 0.0;
+    result["chunkBytes"] = static_cast<qint64>(driver.chunkBytes());
+    result["abandoned"] = static_cast<qint64>(driver.abandoned());
+    result["requestFrames"] = static_cast<qint64>(driver.frames());
+    result["latency"] = total.toJson();
+    result["functions"] = functions;
+
+    out << QString("completed %1 requests (%2 errors) in %3 s, %4 req/s\n")
+               .arg(completed).arg(errors).arg(elapsedSeconds, 0, 'f', 3)
+               .arg(result["throughput"].toDouble(), 0, 'f', 0);
+    out << QString("latency us: p50 %1  p90 %2  p99 %3  p999 %4  max %5\n")
+               .arg(total.percentile(0.50) / 1000.0, 0, 'f', 1)
+               .arg(total.percentile(0.90) / 1000.0, 0, 'f', 1)
+               .arg(total.percentile(0.99) / 1000.0, 0, 'f', 1)
+               .arg(total.percentile(0.999) / 1000.0, 0, 'f', 1)
+               .arg(total.max() / 1000.0, 0, 'f', 1);
+
+    // 与上一次结果比较，便于发现回退
+    if (!options.baselinePath.isEmpty()) {
+        QFile baselineFile(options.baselinePath);
+        if (baselineFile.open(QIODevice::ReadOnly)) {
+            QJsonObject baseline = QJsonDocument::fromJson(baselineFile.readAll()).object();
+            QJsonObject comparison;
+            comparison["path"] = options.baselinePath;
+            comparison["throughputChange"] = TLatencySummary::changePercent(
+                result["throughput"].toDouble(), baseline["throughput"].toDouble());
+            comparison["p99Change"] = TLatencySummary::changePercent(
+                result["latency"].toObject()["p99"].toDouble(), baseline["latency"].toObject()["p99"].toDouble());
+            result["baseline"] = comparison;
+            out << QString("vs baseline: throughput %1%, p99 %2%\n")
+                       .arg(comparison["throughputChange"].toDouble(), 0, 'f', 1)
+                       .arg(comparison["p99Change"].toDouble(), 0, 'f', 1);
+        } else {
+            out << "warning: cannot read baseline " << options.baselinePath << "\n";
+        }
+    }
+
+    QFile outputFile(options.outputPath);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        out << "error: cannot write " << options.outputPath << "\n";
+        return 1;
+    }
+    outputFile.write(QJsonDocument(result).toJson(QJsonDocument::Indented));
+    out << "results written to " << options.outputPath << "\n";
+
+    return errors > 0 || driver.abandoned() > 0 ? 2 : 0;
+}
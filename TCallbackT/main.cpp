@@ -1,146 +1,53 @@
 #include <QCoreApplication>
-#include <QDebug>
-#include <QTimer>
-#include <QFile>
-#include <QTextStream>
-#include <QDir>
-#include <QFileInfo>
-#include <QProcess>
-#include <QSysInfo>
+#include "Handlers.h"
+#include "TBatchReader.h"
 #include "TCoreSession.h"
-#include "Models.h"
+#include "TLog.h"
+#include "TPathCache.h"
+#include "TSessionPool.h"
+#include "TSystemSampler.h"
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
+    
+    // 日志异步写入，级别和文件可通过环境变量配置，默认 info 级别写到 stderr
+    TLog& log = TLog::instance();
+    log.setLevel(TLog::levelFromName(QString::fromLocal8Bit(qgetenv("TCALLBACKT_LOG_LEVEL")), TLog::Level::Info));
+    if (!log.start(QString::fromLocal8Bit(qgetenv("TCALLBACKT_LOG_FILE")))) {
+        log.start();
+        TLOG_WARN("log_file_open_failed").field("path", QString::fromLocal8Bit(qgetenv("TCALLBACKT_LOG_FILE")));
+    }
 
-    // 创建核心会话
-    TCoreSession session;
+    // 系统指标由后台线程定期采样，供 "gsi" 读取
+    TSystemSampler sampler;
+    sampler.start(1000);
+    
+    // "rf"/"ld" 结果缓存，默认 64 MiB，TCALLBACKT_CACHE_MB=0 时禁用
+    // 先于会话池创建：会话池先析构，回调线程结束后才销毁缓存
+    int cacheMegabytes = qEnvironmentVariableIsSet("TCALLBACKT_CACHE_MB")
+        ? qEnvironmentVariableIntValue("TCALLBACKT_CACHE_MB") : 64;
+    TPathCache cache(qint64(cacheMegabytes) * 1024 * 1024);
+    bool cacheEnabled = cacheMegabytes > 0 && cache.start();
     
-    // 1. 注册读取文件的回调函数
-    session.registerCallback<Models::ReadFileRequest>( 
-        [](int sequence, const Models::ReadFileRequest& request) -> Models::Response {
-            qDebug() << "处理读取文件请求，序列号:" << sequence << "文件路径:" << request.filePath;
-            
-            Models::Response response;
-            response.sequence = sequence;
-            
-            QFile file(request.filePath);
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QTextStream in(&file);
-                QString content = in.readAll();
-                
-                Models::ReadFileResponse fileResponse;
-                fileResponse.content = content;
-                
-                response.statusCode = 200;
-                response.result = fileResponse.toJsonValue();
-            } else {
-                response.statusCode = 500;
-                response.error = "File read error";
-                response.errorReason = QString("Cannot read file: %1").arg(request.filePath);
-            }
-            
-            return response;
-        });
+    // 会话池：默认每个 CPU 核心一个连接，可通过 TCALLBACKT_CONNECTIONS 指定
+    TSessionPool pool(qEnvironmentVariableIntValue("TCALLBACKT_CONNECTIONS"));
     
-    // 2. 注册写入文件的回调函数
-    session.registerCallback<Models::WriteFileRequest>(
-        [](int sequence, const Models::WriteFileRequest& request) -> Models::Response {
-            qDebug() << "处理写入文件请求，序列号:" << sequence << "文件路径:" << request.filePath;
-            
-            Models::Response response;
-            response.sequence = sequence;
-            
-            QFile file(request.filePath);
-            QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Text;
-            if (request.append) {
-                mode |= QIODevice::Append;
-            }
-            
-            if (file.open(mode)) {
-                QTextStream out(&file);
-                out << request.content;
-                
-                Models::WriteFileResponse writeResponse;
-                writeResponse.message = "File written successfully";
-                writeResponse.bytesWritten = request.content.toUtf8().size();
-                
-                response.statusCode = 200;
-                response.result = writeResponse.toJsonValue();
-            } else {
-                response.statusCode = 500;
-                response.error = "File write error";
-                response.errorReason = QString("Cannot write to file: %1").arg(request.filePath);
-            }
-            
-            return response;
-        });
+    registerDefaultHandlers(pool.registry(), sampler, 16 * 1024 * 1024, cacheEnabled ? &cache : nullptr);
     
-    // 3. 注册列出目录的回调函数
-    session.registerCallback<Models::ListDirectoryRequest>(
-        [](int sequence, const Models::ListDirectoryRequest& request) -> Models::Response {
-            qDebug() << "处理列出目录请求，序列号:" << sequence << "目录路径:" << request.directoryPath;
-            
-            Models::Response response;
-            response.sequence = sequence;
-            
-            QDir dir(request.directoryPath);
-            if (dir.exists()) {
-                Models::ListDirectoryResponse dirResponse;
-                
-                QDir::Filters filters = QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot;
-                if (request.includeHidden) {
-                    filters |= QDir::Hidden;
-                }
-                
-                QFileInfoList entries = dir.entryInfoList(filters);
-                for (const QFileInfo& info : entries) {
-                    Models::ListDirectoryResponse::FileInfo fileInfo;
-                    fileInfo.name = info.fileName();
-                    fileInfo.type = info.isDir() ? "directory" : "file";
-                    fileInfo.size = info.size();
-                    fileInfo.lastModified = info.lastModified().toString(Qt::ISODate);
-                    dirResponse.files.append(fileInfo);
-                }
-                
-                response.statusCode = 200;
-                response.result = dirResponse.toJsonValue();
-            } else {
-                response.statusCode = 404;
-                response.error = "Directory not found";
-                response.errorReason = QString("Directory does not exist: %1").arg(request.directoryPath);
-            }
-            
-            return response;
-        });
+    // "rfs" 默认经 io_uring 读取，TCALLBACKT_IO_URING=0 时改用线程池
+    if (qEnvironmentVariableIsSet("TCALLBACKT_IO_URING") && qEnvironmentVariableIntValue("TCALLBACKT_IO_URING") == 0) {
+        TBatchReader::setIoUringEnabled(false);
+    }
     
-    // 4. 注册获取系统信息的回调函数
-    session.registerCallback<Models::GetSystemInfoRequest>(
-        [](int sequence, const Models::GetSystemInfoRequest& request) -> Models::Response {
-            qDebug() << "处理获取系统信息请求，序列号:" << sequence;
-            
-            Models::Response response;
-            response.sequence = sequence;
-            
-            Models::GetSystemInfoResponse sysResponse;
-            sysResponse.systemInfo.osName = QSysInfo::productType();
-            sysResponse.systemInfo.osVersion = QSysInfo::productVersion();
-            sysResponse.systemInfo.cpuInfo = QSysInfo::currentCpuArchitecture();
-            // 注意：获取内存和磁盘信息需要平台特定的代码，这里用示例值
-            sysResponse.systemInfo.totalMemory = 8589934592; // 8GB 示例
-            sysResponse.systemInfo.availableMemory = 4294967296; // 4GB 示例
-            sysResponse.systemInfo.totalDisk = 1099511627776; // 1TB 示例
-            sysResponse.systemInfo.availableDisk = 549755813888; // 512GB 示例
-            
-            response.statusCode = 200;
-            response.result = sysResponse.toJsonValue();
-            
-            return response;
-        });
+    // 回调在线程池中执行，慢请求不阻塞其它请求
+    pool.setSessionInitializer([](TCoreSession& session) {
+        session.setExecutionMode(TCoreSession::ExecutionMode::ThreadPool);
+    });
     
-    // 连接到测试服务器
-    session.connectToServer("ws://localhost:8765");
+    // 连接到测试服务器；同机部署时可设 TCALLBACKT_URL=local:<名称> 走本机套接字
+    QString url = QString::fromLocal8Bit(qgetenv("TCALLBACKT_URL"));
+    pool.start(url.isEmpty() ? QString("ws://localhost:8765") : url);
     
     return a.exec();
 }
@@ -3,12 +3,19 @@ import asyncio
 import websockets
 import json
 import os
+import struct
+
+try:
+    import cbor2  # 可选：用于测试 CBOR 二进制协议
+except ImportError:
+    cbor2 = None
 
 class PaaSServer:
     def __init__(self):
         self.sequence_counter = 1000
         self.responses_received = 0
         self.total_tests = 0
+        self.stream_chunks = {}  # sequence -> 已收到的数据块字节数
         
     async def handle_client(self, websocket):
         print(f"客户端已连接: {websocket.remote_address}")
@@ -48,9 +55,27 @@ class PaaSServer:
         # 3. 测试列出目录功能
         await self.test_list_directory(websocket)
         
-        # 4. 测试获取系统信息功能
+        # 4. 测试执行命令功能
+        await self.test_execute_command(websocket)
+        
+        # 5. 测试获取系统信息功能
         await self.test_get_system_info(websocket)
         
+        # 6. 测试 CBOR 二进制协议
+        await self.test_cbor(websocket)
+        
+        # 7. 测试批量请求帧
+        await self.test_batch(websocket)
+        
+        # 8. 测试运行指标
+        await self.test_metrics(websocket)
+        
+        # 9. 测试文件变化订阅
+        await self.test_subscribe(websocket)
+        
+        # 10. 测试批量读取文件
+        await self.test_read_files(websocket)
+        
         print(f"📤 已发送 {self.total_tests} 个测试请求，等待响应...")
         print("-" * 60)
 
@@ -86,6 +111,25 @@ class PaaSServer:
         await websocket.send(json.dumps(error_request))
         self.sequence_counter += 1
         self.total_tests += 1
+        
+        await asyncio.sleep(0.1)
+        
+        # 3. 测试流式读取文件的字节范围
+        stream_request = {
+            "n": "rf",
+            "p": {
+                "path": os.path.abspath(test_file_path),
+                "stream": True,
+                "offset": 3,
+                "length": 16,
+                "chunkSize": 8
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  📄 发送流式读取文件请求: {stream_request['p']['path']}")
+        await websocket.send(json.dumps(stream_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
 
     async def test_write_file(self, websocket):
         """测试写入文件功能"""
@@ -122,6 +166,33 @@ class PaaSServer:
         await websocket.send(json.dumps(append_request))
         self.sequence_counter += 1
         self.total_tests += 1
+        
+        await asyncio.sleep(0.1)
+        
+        # 3. 测试分块上传：数据块帧 [0x02][flags][reserved:2][sequence:i32][offset:i64][data]，
+        #    不必等待请求的响应；原子替换并以组提交落盘
+        payload = "分块上传的内容\n".encode("utf-8") * 4096
+        upload_sequence = self.sequence_counter
+        upload_request = {
+            "n": "wf",
+            "p": {
+                "path": os.path.abspath("test_upload.txt"),
+                "chunked": True,
+                "size": len(payload),
+                "atomic": True,
+                "durability": "group"
+            },
+            "s": upload_sequence
+        }
+        print(f"  📤 发送分块上传请求: {upload_request['p']['path']}（{len(payload)} 字节）")
+        await websocket.send(json.dumps(upload_request))
+        chunk_size = 16 * 1024
+        for offset in range(0, len(payload), chunk_size):
+            final = 0x01 if offset + chunk_size >= len(payload) else 0
+            header = struct.pack(">BBxxiq", 0x02, final, upload_sequence, offset)
+            await websocket.send(header + payload[offset:offset + chunk_size])
+        self.sequence_counter += 1
+        self.total_tests += 1
 
     async def test_list_directory(self, websocket):
         """测试列出目录功能"""
@@ -153,6 +224,91 @@ class PaaSServer:
         await websocket.send(json.dumps(error_list_request))
         self.sequence_counter += 1
         self.total_tests += 1
+        
+        # 3. 测试递归、过滤和分页：只要名称和类型，每页 2 条，响应中带 nextCursor
+        paged_request = {
+            "n": "ld",
+            "p": {
+                "path": os.path.abspath("."),
+                "depth": -1,
+                "patterns": ["*.cpp", "*.h"],
+                "fields": ["type"],
+                "pageSize": 2
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  📂 发送分页列出目录请求: depth={paged_request['p']['depth']}, pageSize={paged_request['p']['pageSize']}")
+        await websocket.send(json.dumps(paged_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+        
+        # 4. 测试从游标续传
+        cursor_request = {
+            "n": "ld",
+            "p": {
+                "path": os.path.abspath("."),
+                "depth": -1,
+                "fields": ["type"],
+                "pageSize": 2,
+                "cursor": "bench"
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  📂 发送续传列出目录请求: cursor={cursor_request['p']['cursor']}")
+        await websocket.send(json.dumps(cursor_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+        
+        # 5. 测试流式返回：每页一行 JSON 数组，以数据块帧发送
+        stream_request = {
+            "n": "ld",
+            "p": {
+                "path": os.path.abspath(".."),
+                "depth": 2,
+                "pageSize": 50,
+                "stream": True
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  📂 发送流式列出目录请求: {stream_request['p']['path']}")
+        await websocket.send(json.dumps(stream_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+
+    async def test_execute_command(self, websocket):
+        """测试执行命令功能"""
+        print("⚙️ 测试执行命令功能...")
+        
+        # 1. 测试流式输出 stdout 与 stderr
+        exec_request = {
+            "n": "ec",
+            "p": {
+                "command": "sh",
+                "arguments": ["-c", "echo out; echo err 1>&2; sleep 0.2; echo done"]
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  ⚙️ 发送执行命令请求: {exec_request['p']['command']}")
+        await websocket.send(json.dumps(exec_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+        
+        await asyncio.sleep(0.1)
+        
+        # 2. 测试超时终止
+        timeout_request = {
+            "n": "ec",
+            "p": {
+                "command": "sleep",
+                "arguments": ["10"],
+                "timeoutMs": 300
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  ⏱️ 发送超时命令请求: {timeout_request['p']['command']}")
+        await websocket.send(json.dumps(timeout_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
 
     async def test_get_system_info(self, websocket):
         """测试获取系统信息功能"""
@@ -182,12 +338,167 @@ class PaaSServer:
         self.sequence_counter += 1
         self.total_tests += 1
 
+    async def test_cbor(self, websocket):
+        """测试 CBOR 二进制协议"""
+        if cbor2 is None:
+            print("⚠️ 未安装 cbor2，跳过 CBOR 测试")
+            return
+        
+        print("📦 测试 CBOR 二进制协议...")
+        
+        cbor_request = {
+            "n": "gsi",
+            "p": ["os"],
+            "s": self.sequence_counter
+        }
+        print(f"  📦 发送 CBOR 获取系统信息请求")
+        await websocket.send(cbor2.dumps(cbor_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+
+    async def test_batch(self, websocket):
+        """测试批量请求帧：一个数组帧中包含多个请求，响应以数组帧返回"""
+        print("📚 测试批量请求帧...")
+        
+        batch = []
+        for sections in (["os"], ["cpu"], ["memory"], ["load"]):
+            batch.append({"n": "gsi", "p": sections, "s": self.sequence_counter})
+            self.sequence_counter += 1
+        batch.append({"n": "ld", "p": {"path": "."}, "s": self.sequence_counter})
+        self.sequence_counter += 1
+        batch.append({"n": "no_such_function", "p": None, "s": self.sequence_counter})
+        self.sequence_counter += 1
+        
+        print(f"  📚 发送包含 {len(batch)} 个请求的批量帧")
+        await websocket.send(json.dumps(batch))
+        self.total_tests += len(batch)
+
+    async def test_metrics(self, websocket):
+        """测试运行指标功能"""
+        print("📈 测试运行指标功能...")
+        
+        # 等前面的请求处理完，指标中才有数据
+        await asyncio.sleep(0.5)
+        
+        metrics_request = {
+            "n": "metrics",
+            "p": None,
+            "s": self.sequence_counter
+        }
+        print(f"  📈 发送运行指标请求")
+        await websocket.send(json.dumps(metrics_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+
+    async def test_subscribe(self, websocket):
+        """测试文件变化订阅：事件以数据块帧推送，取消后收到完成响应"""
+        print("👀 测试文件变化订阅...")
+        
+        watch_dir = os.path.abspath("watch_test")
+        os.makedirs(watch_dir, exist_ok=True)
+        
+        subscribe_request = {
+            "n": "sub",
+            "p": {
+                "id": "test-watch",
+                "paths": [watch_dir],
+                "recursive": True,
+                "debounceMs": 50
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  👀 发送订阅请求: {watch_dir}")
+        await websocket.send(json.dumps(subscribe_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+        
+        # 产生几个变化：同一文件的多次写入在一批内合并
+        await asyncio.sleep(0.3)
+        os.makedirs(os.path.join(watch_dir, "sub"), exist_ok=True)
+        for i in range(5):
+            with open(os.path.join(watch_dir, "sub", "a.txt"), "a") as f:
+                f.write(f"line {i}\n")
+        await asyncio.sleep(0.3)
+        
+        unsubscribe_request = {
+            "n": "unsub",
+            "p": {"id": "test-watch"},
+            "s": self.sequence_counter
+        }
+        print(f"  🛑 发送取消订阅请求")
+        await websocket.send(json.dumps(unsubscribe_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+
+    async def test_read_files(self, websocket):
+        """测试批量读取：一个请求读取多个文件，各文件的结果按请求顺序返回"""
+        print("📚 测试批量读取文件...")
+        
+        batch_dir = os.path.abspath("batch_test")
+        os.makedirs(batch_dir, exist_ok=True)
+        paths = []
+        for i in range(100):
+            path = os.path.join(batch_dir, f"file_{i}.txt")
+            with open(path, "w", encoding="utf-8") as f:
+                f.write(f"批量文件 {i}\n")
+            paths.append(path)
+        
+        # 字符串元素即为路径，对象元素可以指定字节范围；不存在的文件和目录在各自的结果中报告错误
+        read_request = {
+            "n": "rfs",
+            "p": {
+                "files": paths + [{"path": paths[0], "offset": 0, "length": 6},
+                                  os.path.join(batch_dir, "missing.txt"),
+                                  batch_dir],
+                "queueDepth": 64
+            },
+            "s": self.sequence_counter
+        }
+        print(f"  📚 发送批量读取请求: {len(read_request['p']['files'])} 个文件")
+        await websocket.send(json.dumps(read_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+        
+        await asyncio.sleep(0.1)
+        
+        # 只 stat，不读取内容
+        stat_request = {
+            "n": "rfs",
+            "p": {"files": paths[:10], "content": False},
+            "s": self.sequence_counter
+        }
+        print(f"  📚 发送批量 stat 请求: {len(stat_request['p']['files'])} 个文件")
+        await websocket.send(json.dumps(stat_request))
+        self.sequence_counter += 1
+        self.total_tests += 1
+
+    def handle_chunk(self, message):
+        """处理流式响应的数据块帧: [type][channel][reserved:2][sequence:i32][offset:i64][data]"""
+        _, channel, sequence, offset = struct.unpack(">BBxxiq", message[:16])
+        data = message[16:]
+        self.stream_chunks[sequence] = self.stream_chunks.get(sequence, 0) + len(data)
+        print(f"📦 数据块: 请求 {sequence} 通道 {channel} 偏移 {offset} 长度 {len(data)}")
+
     async def handle_response(self, message):
         """处理收到的响应"""
-        print(f"📨 收到响应: {message}")
+        if isinstance(message, bytes) and message[:1] == b"\x01":
+            self.handle_chunk(message)
+            return
+        
+        if isinstance(message, bytes):
+            print(f"📨 收到二进制响应: {len(message)} 字节")
+        else:
+            print(f"📨 收到响应: {message}")
         
         try:
-            response = json.loads(message)
+            parsed = cbor2.loads(message) if isinstance(message, bytes) else json.loads(message)
+        except ValueError:
+            print(f"❌ 无效的响应: {message}")
+            return
+        
+        # 会话开启响应合并时，多个响应放在同一个数组帧中
+        responses = parsed if isinstance(parsed, list) else [parsed]
+        for response in responses:
             sequence = response.get("s", "unknown")
             status_code = response.get("c", 0)
             
@@ -204,15 +515,29 @@ class PaaSServer:
             self.responses_received += 1
             print(f"   (已完成 {self.responses_received}/{self.total_tests} 个测试)")
             print("-" * 40)
-                
-        except json.JSONDecodeError:
-            print(f"❌ 无效的 JSON 响应: {message}")
 
     def print_result_details(self, result):
         """打印响应结果的详细信息"""
         if isinstance(result, dict):
+            # 流式响应
+            if result.get("streamed"):
+                print(f"   📦 流式发送完成: 偏移 {result['offset']}，共 {result['bytes']} 字节")
+                if "chunks" in result:
+                    print(f"   📤 上传完成: {result['chunks']} 个数据块，写入 {result['bytesWritten']} 字节")
+                if "exitCode" in result:
+                    print(f"   ⚙️ 退出码: {result['exitCode']} ({result['exitStatus']})，超时: {result['timedOut']}")
+            
+            # 批量读取响应
+            elif "engine" in result:
+                files = result["files"]
+                failed = [f for f in files if f["status"] != 200]
+                print(f"   📚 {len(files)} 个文件，{len(failed)} 个失败，"
+                      f"引擎 {result['engine']}，io_uring_enter {result['submissions']} 次")
+                for f in failed:
+                    print(f"      {f['path']}: {f['status']} {f.get('error')}")
+            
             # 读取文件响应
-            if "content" in result:
+            elif "content" in result:
                 content = result["content"]
                 print(f"   📄 文件内容: {repr(content[:100])}" + ("..." if len(content) > 100 else ""))
             
@@ -231,12 +556,26 @@ class PaaSServer:
                     print(f"      ... 还有 {len(files) - 5} 个项目")
             
             # 系统信息响应
-            elif "osName" in result:
-                print(f"   🖥️ 系统信息:")
-                print(f"      操作系统: {result.get('osName')} {result.get('osVersion')}")
-                print(f"      CPU架构: {result.get('cpuInfo')}")
-                print(f"      内存: {result.get('availableMemory', 0) // (1024**3)}GB / {result.get('totalMemory', 0) // (1024**3)}GB")
-                print(f"      磁盘: {result.get('availableDisk', 0) // (1024**3)}GB / {result.get('totalDisk', 0) // (1024**3)}GB")
+            elif "sampledAt" in result:
+                print(f"   🖥️ 系统信息（只包含请求的部分）:")
+                if "osName" in result:
+                    print(f"      操作系统: {result.get('osName')} {result.get('osVersion')}")
+                if "cpuInfo" in result:
+                    print(f"      CPU: {result.get('cpuInfo')} x{result.get('cpuCount')}，利用率 {result.get('cpuUsage', 0):.1%}")
+                if "totalMemory" in result:
+                    print(f"      内存: {result.get('availableMemory', 0) // (1024**3)}GB / {result.get('totalMemory', 0) // (1024**3)}GB")
+                if "totalDisk" in result:
+                    print(f"      磁盘: {result.get('availableDisk', 0) // (1024**3)}GB / {result.get('totalDisk', 0) // (1024**3)}GB")
+                if "loadAverage" in result:
+                    print(f"      负载: {result['loadAverage']}")
+            
+            # 运行指标响应
+            elif "notFound" in result:
+                print(f"   📈 运行指标（延迟单位微秒），未注册函数请求 {result['notFound']} 次:")
+                for metrics in result["functions"]:
+                    handler = metrics["handler"]
+                    print(f"      {metrics['name']}: 请求 {metrics['requests']}，错误 {metrics['errors']}，"
+                          f"进行中 {metrics['inFlight']}，回调 p50 {handler['p50']:.1f} p99 {handler['p99']:.1f}")
             
             else:
                 print(f"   📋 结果: {result}")
@@ -0,0 +1,596 @@
+#include "THttpLoadClient.h"
+#include <QThread>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include "THttpResponse.h"
+
+namespace {
+
+constexpr int ReadBufferSize = 64 * 1024;
+constexpr int MaxEvents = 256;
+constexpr quint64 TimerToken = ~quint64(0);     // 其余 epoll data.u64 为连接下标
+constexpr qint64 ReconnectIntervalNs = 100000000LL;
+
+} // namespace
+
+// 工作线程：一个 epoll 循环驱动分配给它的连接
+// 全局请求序号 j 按工作线程交错分配（j = index, index + workers, ...），
+// 开环模式下第 j 个请求的计划发送时间为 start + j / rate
+class THttpLoadWorker
+{
+public:
+    THttpLoadWorker(const THttpLoadClient::Options& options, const std::vector<THttpLoadClient::Workload>& workloads,
+                    const std::vector<int>& schedule, int index, int workerCount, int connections, qint64 quota);
+    ~THttpLoadWorker();
+
+    bool open(QString* errorReason);
+    void start(qint64 startNs);
+    void join();
+
+    // 以下在 join() 之后读取
+    const std::vector<std::unique_ptr<TLatencyHistogram>>& latency() const { return m_latency; }
+    const std::vector<quint64>& completed() const { return m_completed; }
+    const std::vector<quint64>& errors() const { return m_errors; }
+    qint64 finishedAt() const { return m_finishedAt; }
+    quint64 sent() const { return m_sent; }
+    quint64 abandoned() const { return m_abandoned; }
+    quint64 reconnects() const { return m_reconnects; }
+    quint64 bodyBytes() const { return m_bodyBytes; }
+    quint64 maxBacklog() const { return m_maxBacklog; }
+    const QString& stopReason() const { return m_stopReason; }
+
+private:
+    struct Pending {
+        qint64 intendedAt = 0;
+        int workload = 0;
+    };
+
+    struct Connection {
+        int fd = -1;
+        QByteArray output;
+        int outputOffset = 0;
+        QByteArray input;
+        THttpResponseParser parser;
+        std::deque<Pending> inflight;
+        bool writeBlocked = false;
+        quint32 events = EPOLLIN;
+    };
+
+    bool connectSocket(Connection* conn, QString* errorReason);
+    bool reconnect(Connection* conn, int index, QString* errorReason);
+    bool ensureConnected(qint64 now);
+    void run(qint64 startNs);
+    bool canSend(qint64 now) const;
+    Pending nextRequest(qint64 intendedAt);
+    void submit(Connection* conn, const Pending& pending);
+    void assignBacklog();
+    void flush(Connection* conn);
+    void readConnection(Connection* conn, int index);
+    void resetConnection(Connection* conn, int index);
+    void updateEvents(Connection* conn, int index);
+    void armTimer(qint64 now, qint64 at);
+
+    const THttpLoadClient::Options& m_options;
+    const std::vector<THttpLoadClient::Workload>& m_workloads;
+    const std::vector<int>& m_schedule;
+    int m_workerCount;
+    qint64 m_quota;                 // 本线程的请求数上限，0 表示不限
+    double m_intervalNs = 0.0;      // 开环模式下相邻全局请求的间隔
+
+    int m_epoll = -1;
+    int m_timer = -1;
+    std::vector<Connection> m_connections;
+    std::deque<Pending> m_backlog;  // 开环模式下已到计划时间、但没有连接可用的请求
+    std::thread m_thread;
+
+    qint64 m_sequence = 0;          // 下一个全局请求序号
+    qint64 m_startNs = 0;
+    qint64 m_stopAt = 0;
+    qint64 m_finishedAt = 0;
+    qint64 m_disconnectedAt = 0;    // 所有连接都断开的时刻，0 表示至少有一个连接
+    qint64 m_nextReconnectAt = 0;
+    QString m_connectError;         // 最近一次重连失败的原因
+    QString m_stopReason;
+
+    std::vector<std::unique_ptr<TLatencyHistogram>> m_latency;
+    std::vector<quint64> m_completed;
+    std::vector<quint64> m_errors;
+    quint64 m_sent = 0;
+    quint64 m_abandoned = 0;
+    quint64 m_reconnects = 0;
+    quint64 m_bodyBytes = 0;
+    quint64 m_maxBacklog = 0;
+};
+
+THttpLoadWorker::THttpLoadWorker(const THttpLoadClient::Options& options,
+                                 const std::vector<THttpLoadClient::Workload>& workloads,
+                                 const std::vector<int>& schedule, int index, int workerCount,
+                                 int connections, qint64 quota)
+    : m_options(options)
+    , m_workloads(workloads)
+    , m_schedule(schedule)
+    , m_workerCount(workerCount)
+    , m_quota(quota)
+    , m_connections(static_cast<std::size_t>(connections))
+    , m_sequence(index)
+    , m_completed(workloads.size(), 0)
+    , m_errors(workloads.size(), 0)
+{
+    if (options.rate > 0.0) {
+        m_intervalNs = 1e9 / options.rate;
+    }
+    for (std::size_t i = 0; i < workloads.size(); ++i) {
+        m_latency.emplace_back(new TLatencyHistogram());
+    }
+}
+
+THttpLoadWorker::~THttpLoadWorker()
+{
+    join();
+    for (Connection& conn : m_connections) {
+        if (conn.fd >= 0) {
+            ::close(conn.fd);
+        }
+    }
+    if (m_timer >= 0) {
+        ::close(m_timer);
+    }
+    if (m_epoll >= 0) {
+        ::close(m_epoll);
+    }
+}
+
+bool THttpLoadWorker::open(QString* errorReason)
+{
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    m_timer = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_epoll < 0 || m_timer < 0) {
+        *errorReason = QString("Cannot create event loop: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+
+    epoll_event timerEvent = {};
+    timerEvent.events = EPOLLIN;
+    timerEvent.data.u64 = TimerToken;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_timer, &timerEvent);
+
+    for (std::size_t i = 0; i < m_connections.size(); ++i) {
+        if (!connectSocket(&m_connections[i], errorReason)) {
+            return false;
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_connections[i].fd, &event);
+    }
+    return true;
+}
+
+// 连接本机服务器，握手很快，直接阻塞等待后再切换为非阻塞
+bool THttpLoadWorker::connectSocket(Connection* conn, QString* errorReason)
+{
+    conn->fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(m_options.address);
+    addr.sin_port = htons(m_options.port);
+    if (conn->fd < 0 || ::connect(conn->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        *errorReason = QString("Cannot connect to port %1: %2")
+                           .arg(m_options.port).arg(QString::fromLocal8Bit(std::strerror(errno)));
+        if (conn->fd >= 0) {
+            ::close(conn->fd);
+            conn->fd = -1;
+        }
+        return false;
+    }
+
+    int one = 1;
+    ::setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::fcntl(conn->fd, F_SETFL, ::fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// 重新建立断开的连接并加入 epoll
+bool THttpLoadWorker::reconnect(Connection* conn, int index, QString* errorReason)
+{
+    if (!connectSocket(conn, errorReason)) {
+        return false;
+    }
+    ++m_reconnects;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<quint64>(index);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, conn->fd, &event);
+    return true;
+}
+
+// 所有连接都断开时每隔 ReconnectIntervalNs 重连一次；断开超过 drainTimeoutMs 仍连不上时返回 false
+bool THttpLoadWorker::ensureConnected(qint64 now)
+{
+    for (const Connection& conn : m_connections) {
+        if (conn.fd >= 0) {
+            m_disconnectedAt = 0;
+            return true;
+        }
+    }
+    if (m_disconnectedAt == 0) {
+        m_disconnectedAt = now;
+    }
+    if (now >= m_nextReconnectAt) {
+        m_nextReconnectAt = now + ReconnectIntervalNs;
+        bool connected = false;
+        for (std::size_t i = 0; i < m_connections.size(); ++i) {
+            connected = reconnect(&m_connections[i], static_cast<int>(i), &m_connectError) || connected;
+        }
+        if (connected) {
+            m_disconnectedAt = 0;
+            return true;
+        }
+    }
+    if (now - m_disconnectedAt < qint64(m_options.drainTimeoutMs) * 1000000LL) {
+        return true;
+    }
+    m_stopReason = m_connectError;
+    return false;
+}
+
+void THttpLoadWorker::start(qint64 startNs)
+{
+    m_thread = std::thread([this, startNs]() { run(startNs); });
+}
+
+void THttpLoadWorker::join()
+{
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool THttpLoadWorker::canSend(qint64 now) const
+{
+    if (m_stopAt > 0 && now >= m_stopAt) {
+        return false;
+    }
+    return m_quota <= 0 || static_cast<qint64>(m_sent) < m_quota;
+}
+
+THttpLoadWorker::Pending THttpLoadWorker::nextRequest(qint64 intendedAt)
+{
+    Pending pending;
+    pending.intendedAt = intendedAt;
+    pending.workload = m_schedule[static_cast<std::size_t>(m_sequence) % m_schedule.size()];
+    m_sequence += m_workerCount;
+    ++m_sent;
+    return pending;
+}
+
+void THttpLoadWorker::submit(Connection* conn, const Pending& pending)
+{
+    conn->output.append(m_workloads[static_cast<std::size_t>(pending.workload)].request);
+    conn->inflight.push_back(pending);
+}
+
+// 把排队的请求交给流水线未满的连接，优先未完成请求最少的连接
+void THttpLoadWorker::assignBacklog()
+{
+    while (!m_backlog.empty()) {
+        Connection* best = nullptr;
+        for (Connection& conn : m_connections) {
+            if (conn.fd >= 0 && static_cast<int>(conn.inflight.size()) < m_options.depth
+                && (!best || conn.inflight.size() < best->inflight.size())) {
+                best = &conn;
+            }
+        }
+        if (!best) {
+            return;
+        }
+        submit(best, m_backlog.front());
+        m_backlog.pop_front();
+    }
+}
+
+void THttpLoadWorker::run(qint64 startNs)
+{
+    m_startNs = startNs;
+    m_stopAt = m_options.durationSeconds > 0 ? startNs + qint64(m_options.durationSeconds) * 1000000000LL : 0;
+    const bool openLoop = m_intervalNs > 0.0;
+    qint64 drainDeadline = 0;
+    epoll_event events[MaxEvents];
+
+    for (;;) {
+        qint64 now = TMetrics::now();
+        bool sending = canSend(now);
+
+        // 服务器不可达：排队的请求和配额中尚未发出的请求都计为放弃，不再空转
+        if (sending && !ensureConnected(now)) {
+            m_abandoned += m_backlog.size();
+            m_backlog.clear();
+            if (m_quota > 0) {
+                m_abandoned += static_cast<quint64>(m_quota) - m_sent;
+            }
+            break;
+        }
+
+        if (sending) {
+            if (openLoop) {
+                // 计划时间已到的请求全部入队，与连接是否空闲无关
+                qint64 intendedAt = m_startNs + static_cast<qint64>(m_sequence * m_intervalNs);
+                while (intendedAt <= now && canSend(now)) {
+                    Pending pending = nextRequest(intendedAt);
+                    if (static_cast<qint64>(m_backlog.size()) < m_options.maxBacklog) {
+                        m_backlog.push_back(pending);
+                    } else {
+                        ++m_abandoned;
+                    }
+                    intendedAt = m_startNs + static_cast<qint64>(m_sequence * m_intervalNs);
+                }
+                m_maxBacklog = qMax<quint64>(m_maxBacklog, m_backlog.size());
+                assignBacklog();
+                if (canSend(now)) {
+                    armTimer(now, intendedAt);
+                }
+            } else {
+                for (Connection& conn : m_connections) {
+                    while (conn.fd >= 0 && static_cast<int>(conn.inflight.size()) < m_options.depth && canSend(now)) {
+                        submit(&conn, nextRequest(now));
+                    }
+                }
+            }
+        } else if (openLoop) {
+            assignBacklog();
+        }
+
+        for (std::size_t i = 0; i < m_connections.size(); ++i) {
+            Connection& conn = m_connections[i];
+            if (conn.fd >= 0 && !conn.writeBlocked && conn.outputOffset < conn.output.size()) {
+                flush(&conn);
+                updateEvents(&conn, static_cast<int>(i));
+            }
+        }
+
+        // 停止发送后等待未完成的请求，超时后计为放弃
+        if (!canSend(now)) {
+            bool idle = m_backlog.empty();
+            for (const Connection& conn : m_connections) {
+                idle = idle && conn.inflight.empty();
+            }
+            if (idle) {
+                break;
+            }
+            if (drainDeadline == 0) {
+                drainDeadline = now + qint64(m_options.drainTimeoutMs) * 1000000LL;
+            } else if (now >= drainDeadline) {
+                m_abandoned += m_backlog.size();
+                for (const Connection& conn : m_connections) {
+                    m_abandoned += conn.inflight.size();
+                }
+                break;
+            }
+        }
+
+        int count = ::epoll_wait(m_epoll, events, MaxEvents, 10);
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == TimerToken) {
+                quint64 expirations;
+                ssize_t drained = ::read(m_timer, &expirations, sizeof(expirations));
+                Q_UNUSED(drained);
+                continue;
+            }
+            int index = static_cast<int>(events[i].data.u64);
+            Connection& conn = m_connections[static_cast<std::size_t>(index)];
+            if (conn.fd < 0) {
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                conn.writeBlocked = false;
+                flush(&conn);
+            }
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                readConnection(&conn, index);
+            }
+            if (conn.fd >= 0) {
+                updateEvents(&conn, index);
+            }
+        }
+    }
+
+    m_finishedAt = TMetrics::now();
+}
+
+void THttpLoadWorker::flush(Connection* conn)
+{
+    while (conn->outputOffset < conn->output.size()) {
+        ssize_t n = ::send(conn->fd, conn->output.constData() + conn->outputOffset,
+                           static_cast<std::size_t>(conn->output.size() - conn->outputOffset), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->writeBlocked = true;
+            }
+            // 其它错误在随后的读事件中发现
+            break;
+        }
+        conn->outputOffset += static_cast<int>(n);
+    }
+    if (conn->outputOffset == conn->output.size()) {
+        conn->output.clear();
+        conn->outputOffset = 0;
+    }
+}
+
+void THttpLoadWorker::readConnection(Connection* conn, int index)
+{
+    char buffer[ReadBufferSize];
+    bool closed = false;
+    for (;;) {
+        ssize_t n = ::recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn->input.append(buffer, static_cast<int>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    // 逐条解析响应，按发送顺序与 inflight 队首匹配
+    int offset = 0;
+    qint64 now = TMetrics::now();
+    while (offset < conn->input.size()) {
+        int consumed = 0;
+        THttpResponseParser::Status status = conn->parser.parse(conn->input.constData() + offset,
+                                                               conn->input.size() - offset, &consumed);
+        offset += consumed;
+        if (status == THttpResponseParser::Status::NeedMore) {
+            break;
+        }
+        if (status == THttpResponseParser::Status::Error || conn->inflight.empty()) {
+            closed = true;
+            break;
+        }
+
+        Pending pending = conn->inflight.front();
+        conn->inflight.pop_front();
+        std::size_t workload = static_cast<std::size_t>(pending.workload);
+        m_latency[workload]->record(static_cast<quint64>(qMax<qint64>(0, now - pending.intendedAt)));
+        ++m_completed[workload];
+        if (conn->parser.statusCode() >= 400) {
+            ++m_errors[workload];
+        }
+        m_bodyBytes += static_cast<quint64>(conn->parser.bodyBytes());
+
+        if (!conn->parser.keepAlive()) {
+            closed = true;
+            break;
+        }
+    }
+    conn->input.remove(0, offset);
+
+    if (closed) {
+        resetConnection(conn, index);
+    }
+}
+
+// 连接断开：已发出但未收到响应的请求计为放弃，仍在发送阶段时重新连接
+void THttpLoadWorker::resetConnection(Connection* conn, int index)
+{
+    m_abandoned += conn->inflight.size();
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, conn->fd, nullptr);
+    ::close(conn->fd);
+    *conn = Connection();
+
+    if (!canSend(TMetrics::now())) {
+        return;
+    }
+    QString errorReason;
+    reconnect(conn, index, &errorReason);
+}
+
+void THttpLoadWorker::updateEvents(Connection* conn, int index)
+{
+    quint32 events = EPOLLIN | (conn->writeBlocked ? EPOLLOUT : 0u);
+    if (events == conn->events) {
+        return;
+    }
+    conn->events = events;
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = static_cast<quint64>(index);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+void THttpLoadWorker::armTimer(qint64 now, qint64 at)
+{
+    qint64 delay = qMax<qint64>(1, at - now);
+    itimerspec spec = {};
+    spec.it_value.tv_sec = static_cast<time_t>(delay / 1000000000LL);
+    spec.it_value.tv_nsec = static_cast<long>(delay % 1000000000LL);
+    ::timerfd_settime(m_timer, 0, &spec, nullptr);
+}
+
+// =================== THttpLoadClient ===================
+
+THttpLoadClient::THttpLoadClient(const Options& options, std::vector<Workload> workloads)
+    : m_options(options)
+    , m_workloads(std::move(workloads))
+{
+    // 按权重展开成固定的发送顺序，保证各次运行的请求序列一致
+    for (std::size_t i = 0; i < m_workloads.size(); ++i) {
+        for (int j = 0; j < m_workloads[i].weight; ++j) {
+            m_schedule.push_back(static_cast<int>(i));
+        }
+    }
+}
+
+THttpLoadClient::~THttpLoadClient() = default;
+
+bool THttpLoadClient::run(QString* errorReason)
+{
+    if (m_schedule.empty()) {
+        *errorReason = "Empty request mix";
+        return false;
+    }
+
+    int connections = qMax(1, m_options.connections);
+    int threads = m_options.threads > 0 ? m_options.threads : QThread::idealThreadCount();
+    threads = qBound(1, threads, connections);
+    if (m_options.requests > 0) {
+        threads = static_cast<int>(qMin<qint64>(threads, m_options.requests));
+    }
+
+    std::vector<std::unique_ptr<THttpLoadWorker>> workers;
+    for (int i = 0; i < threads; ++i) {
+        // 连接和请求数尽量平均分配，余数给前面的线程
+        int workerConnections = connections / threads + (i < connections % threads ? 1 : 0);
+        qint64 quota = m_options.requests > 0
+            ? m_options.requests / threads + (i < m_options.requests % threads ? 1 : 0)
+            : 0;
+        workers.emplace_back(new THttpLoadWorker(m_options, m_workloads, m_schedule, i, threads,
+                                                 workerConnections, quota));
+        if (!workers.back()->open(errorReason)) {
+            return false;
+        }
+    }
+
+    qint64 start = TMetrics::now();
+    for (const auto& worker : workers) {
+        worker->start(start);
+    }
+
+    m_results.assign(m_workloads.size(), WorkloadResult());
+    qint64 finishedAt = start;
+    for (const auto& worker : workers) {
+        worker->join();
+        for (std::size_t i = 0; i < m_workloads.size(); ++i) {
+            m_results[i].latency.merge(*worker->latency()[i]);
+            m_latency.merge(*worker->latency()[i]);
+            m_results[i].completed += worker->completed()[i];
+            m_results[i].errors += worker->errors()[i];
+        }
+        finishedAt = qMax(finishedAt, worker->finishedAt());
+        m_sent += worker->sent();
+        m_abandoned += worker->abandoned();
+        m_reconnects += worker->reconnects();
+        m_bodyBytes += worker->bodyBytes();
+        m_maxBacklog = qMax(m_maxBacklog, worker->maxBacklog());
+        if (m_stopReason.isEmpty()) {
+            m_stopReason = worker->stopReason();
+        }
+    }
+    m_elapsedNs = finishedAt - start;
+    return true;
+}
@@ -0,0 +1,84 @@
+#ifndef THTTPLOADCLIENT_H
+#define THTTPLOADCLIENT_H
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "TMetrics.h"
+
+class THttpLoadWorker;
+
+// HTTP 负载客户端：若干工作线程各自用一个 epoll 循环驱动一组 keep-alive 连接，
+// 请求在连接上流水线发送，响应按顺序匹配
+//
+// 两种模式：
+//   闭环（rate = 0）：每个连接保持 depth 个未完成请求，响应返回后立即补发
+//   开环（rate > 0）：按固定到达率安排请求的计划发送时间，与响应快慢无关；
+//     连接都已达到 depth 时请求在本地排队，延迟从计划发送时间算起，避免协调遗漏
+class THttpLoadClient
+{
+public:
+    struct Options {
+        quint32 address = 0x7f000001;   // IPv4，主机字节序
+        quint16 port = 8080;
+        int connections = 8;
+        int threads = 0;                // <= 0 时取 min(connections, CPU 核心数)
+        int depth = 1;                  // 每个连接上流水线的最大请求数
+        double rate = 0.0;              // 开环模式的总请求速率（次/秒），0 为闭环
+        qint64 requests = 0;            // 请求总数，0 表示只按时长
+        int durationSeconds = 10;       // 发送时长，0 表示只按请求数
+        int drainTimeoutMs = 5000;      // 停止发送后等待未完成请求的时间，超时计为放弃；
+                                        // 也是所有连接断开后重连的最长时间，超时后剩余请求计为放弃
+        int maxBacklog = 100000;        // 开环模式下每个工作线程本地排队的上限，超出的请求计为放弃
+    };
+
+    // 一种请求：完整的 HTTP 请求字节和在请求配比中的权重
+    struct Workload {
+        QString name;
+        int weight = 1;
+        QByteArray request;
+    };
+
+    struct WorkloadResult {
+        TLatencySummary latency;        // 纳秒
+        quint64 completed = 0;
+        quint64 errors = 0;             // 状态码 >= 400
+    };
+
+    THttpLoadClient(const Options& options, std::vector<Workload> workloads);
+    ~THttpLoadClient();
+
+    // 建立连接并运行到结束，阻塞调用线程；无法建立连接时返回 false
+    bool run(QString* errorReason);
+
+    qint64 elapsedNs() const { return m_elapsedNs; }
+    const std::vector<WorkloadResult>& results() const { return m_results; }
+    const TLatencySummary& latency() const { return m_latency; }   // 所有请求
+
+    quint64 sent() const { return m_sent; }
+    quint64 abandoned() const { return m_abandoned; }       // 结束时仍未完成或因连接断开丢失的请求
+    quint64 reconnects() const { return m_reconnects; }
+    quint64 bodyBytes() const { return m_bodyBytes; }
+    quint64 maxBacklog() const { return m_maxBacklog; }     // 开环模式下本地排队的最大请求数
+
+    // 非空时表示因所有连接断开且无法重连而提前结束
+    const QString& stopReason() const { return m_stopReason; }
+
+private:
+    Options m_options;
+    std::vector<Workload> m_workloads;
+    std::vector<int> m_schedule;        // 按权重展开的请求顺序（m_workloads 下标）
+
+    std::vector<WorkloadResult> m_results;
+    TLatencySummary m_latency;
+    qint64 m_elapsedNs = 0;
+    quint64 m_sent = 0;
+    quint64 m_abandoned = 0;
+    quint64 m_reconnects = 0;
+    quint64 m_bodyBytes = 0;
+    quint64 m_maxBacklog = 0;
+    QString m_stopReason;
+};
+
+#endif // THTTPLOADCLIENT_H
@@ -0,0 +1,183 @@
+#include "THttpResponse.h"
+#include <cstring>
+
+namespace {
+
+const char* findHeaderEnd(const char* data, int size)
+{
+    for (int i = 3; i < size; ++i) {
+        if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+            return data + i - 3;
+        }
+    }
+    return nullptr;
+}
+
+// 不区分大小写比较请求头名称，name 为小写
+bool headerIs(const char* begin, const char* end, const char* name)
+{
+    std::size_t length = std::strlen(name);
+    if (static_cast<std::size_t>(end - begin) != length) {
+        return false;
+    }
+    for (std::size_t i = 0; i < length; ++i) {
+        char c = begin[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+THttpResponseParser::Status THttpResponseParser::parse(const char* data, int size, int* consumed)
+{
+    *consumed = 0;
+    if (m_state == State::Done) {
+        m_state = State::Head;
+    }
+
+    for (;;) {
+        const char* position = data + *consumed;
+        int available = size - *consumed;
+
+        switch (m_state) {
+        case State::Head: {
+            const char* headEnd = findHeaderEnd(position, qMin(available, MaxHeaderSize + 4));
+            if (!headEnd) {
+                return available > MaxHeaderSize ? Status::Error : Status::NeedMore;
+            }
+            if (!parseHead(position, static_cast<int>(headEnd - position))) {
+                return Status::Error;
+            }
+            *consumed += static_cast<int>(headEnd - position) + 4;
+            break;
+        }
+        case State::Body:
+        case State::ChunkData: {
+            int take = static_cast<int>(qMin<qint64>(m_remaining, available));
+            *consumed += take;
+            m_remaining -= take;
+            m_bodyBytes += take;
+            if (m_remaining > 0) {
+                return Status::NeedMore;
+            }
+            m_state = m_state == State::Body ? State::Done : State::ChunkDataEnd;
+            break;
+        }
+        case State::ChunkSize: {
+            const char* lineEnd = static_cast<const char*>(std::memchr(position, '\n', static_cast<std::size_t>(available)));
+            if (!lineEnd) {
+                return available > 1024 ? Status::Error : Status::NeedMore;
+            }
+            // 块长度为十六进制，可能带有 ";扩展"
+            qint64 chunkSize = 0;
+            int digits = 0;
+            for (const char* p = position; p < lineEnd && *p != ';' && *p != '\r'; ++p, ++digits) {
+                int value = (*p >= '0' && *p <= '9') ? *p - '0'
+                          : (*p >= 'a' && *p <= 'f') ? *p - 'a' + 10
+                          : (*p >= 'A' && *p <= 'F') ? *p - 'A' + 10 : -1;
+                if (value < 0 || digits >= 15) {
+                    return Status::Error;
+                }
+                chunkSize = chunkSize * 16 + value;
+            }
+            if (digits == 0) {
+                return Status::Error;
+            }
+            *consumed += static_cast<int>(lineEnd - position) + 1;
+            m_remaining = chunkSize;
+            m_state = chunkSize == 0 ? State::Trailer : State::ChunkData;
+            break;
+        }
+        case State::ChunkDataEnd:
+            if (available < 2) {
+                return Status::NeedMore;
+            }
+            if (position[0] != '\r' || position[1] != '\n') {
+                return Status::Error;
+            }
+            *consumed += 2;
+            m_state = State::ChunkSize;
+            break;
+        case State::Trailer: {
+            const char* lineEnd = static_cast<const char*>(std::memchr(position, '\n', static_cast<std::size_t>(available)));
+            if (!lineEnd) {
+                return available > MaxHeaderSize ? Status::Error : Status::NeedMore;
+            }
+            bool empty = lineEnd == position || (lineEnd == position + 1 && *position == '\r');
+            *consumed += static_cast<int>(lineEnd - position) + 1;
+            if (empty) {
+                m_state = State::Done;
+            }
+            break;
+        }
+        case State::Done:
+            return Status::Complete;
+        }
+    }
+}
+
+bool THttpResponseParser::parseHead(const char* data, int size)
+{
+    // 状态行：HTTP/1.x SP 状态码 SP 原因
+    if (size < 12 || std::memcmp(data, "HTTP/1.", 7) != 0 || data[8] != ' ') {
+        return false;
+    }
+    m_keepAlive = data[7] == '1';
+    m_statusCode = 0;
+    for (int i = 9; i < 12; ++i) {
+        if (data[i] < '0' || data[i] > '9') {
+            return false;
+        }
+        m_statusCode = m_statusCode * 10 + (data[i] - '0');
+    }
+
+    qint64 contentLength = 0;
+    bool chunked = false;
+    const char* end = data + size;
+    const char* line = static_cast<const char*>(std::memchr(data, '\n', static_cast<std::size_t>(size)));
+    line = line ? line + 1 : end;
+    while (line < end) {
+        const char* next = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+        const char* lineEnd = next ? next : end;
+        if (lineEnd > line && lineEnd[-1] == '\r') {
+            --lineEnd;
+        }
+        const char* colon = static_cast<const char*>(std::memchr(line, ':', static_cast<std::size_t>(lineEnd - line)));
+        if (colon) {
+            QByteArray value = QByteArray(colon + 1, static_cast<int>(lineEnd - colon - 1)).trimmed().toLower();
+            if (headerIs(line, colon, "content-length")) {
+                bool ok = false;
+                contentLength = value.toLongLong(&ok);
+                if (!ok || contentLength < 0) {
+                    return false;
+                }
+            } else if (headerIs(line, colon, "transfer-encoding")) {
+                chunked = value.contains("chunked");
+            } else if (headerIs(line, colon, "connection")) {
+                if (value.contains("close")) {
+                    m_keepAlive = false;
+                } else if (value.contains("keep-alive")) {
+                    m_keepAlive = true;
+                }
+            }
+        }
+        line = next ? next + 1 : end;
+    }
+
+    m_bodyBytes = 0;
+    if (m_statusCode == 204 || m_statusCode == 304 || (m_statusCode >= 100 && m_statusCode < 200)) {
+        m_state = State::Done;
+    } else if (chunked) {
+        m_state = State::ChunkSize;
+    } else {
+        m_remaining = contentLength;
+        m_state = contentLength > 0 ? State::Body : State::Done;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef THTTPRESPONSE_H
+#define THTTPRESPONSE_H
+
+#include <QByteArray>
+
+// 增量响应解析器：每个连接一个，按顺序解析流水线上的响应
+// 支持 Content-Length 与分块编码的响应体，响应体只计数不保存
+class THttpResponseParser
+{
+public:
+    enum class Status {
+        NeedMore,   // 数据不足
+        Complete,   // 解析完一条响应
+        Error       // 协议错误，连接应关闭
+    };
+
+    static constexpr int MaxHeaderSize = 64 * 1024;
+
+    // 从 data 开头继续解析，*consumed 返回本次消耗的字节数
+    Status parse(const char* data, int size, int* consumed);
+
+    // 以下在 Complete 之后读取，下一次 parse 开始新的响应
+    int statusCode() const { return m_statusCode; }
+    bool keepAlive() const { return m_keepAlive; }
+    qint64 bodyBytes() const { return m_bodyBytes; }
+
+private:
+    enum class State {
+        Head,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailer,
+        Done
+    };
+
+    bool parseHead(const char* data, int size);
+
+    State m_state = State::Head;
+    int m_statusCode = 0;
+    bool m_keepAlive = true;
+    qint64 m_remaining = 0;
+    qint64 m_bodyBytes = 0;
+};
+
+#endif // THTTPRESPONSE_H
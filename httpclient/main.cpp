@@ -1,19 +1,288 @@
+// HTTP 负载客户端：对本机的 httpserver 网关发送请求，统计吞吐量和延迟分布，
+// 结束后把结果写入 JSON 文件，可与上一次的结果比较
+//
+// 用法：
+//   httpclient --port 8080 --connections 16 --depth 4 --rate 50000 --duration 30
+//              --mix rf=4,wf=1,ld=1,gsi=4 --output results.json --baseline previous.json
+//
+// --rate 为 0 时按闭环方式运行（每个连接保持 depth 个未完成请求）
+
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include "THttpLoadClient.h"
+#include "TMetrics.h"
+
+namespace {
+
+struct Options {
+    QString address = "127.0.0.1";
+    int port = 8080;
+    int connections = 8;
+    int threads = 0;
+    int depth = 1;
+    double rate = 0.0;
+    qint64 requests = 0;
+    int durationSeconds = 10;
+    QString mix = "rf=4,wf=1,ld=1,gsi=4";
+    int payloadSize = 1024;     // rf 文件大小与 wf 写入内容大小
+    QString outputPath = "httpclient-results.json";
+    QString baselinePath;
+};
+
+// POST /<函数名>，请求体为 JSON 负载
+QByteArray postRequest(const QString& function, const QJsonObject& payload, const QString& host)
+{
+    QByteArray body = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+    QByteArray request;
+    request.append("POST /").append(function.toUtf8()).append(" HTTP/1.1\r\nHost: ").append(host.toUtf8());
+    request.append("\r\nContent-Type: application/json\r\nContent-Length: ").append(QByteArray::number(body.size()));
+    request.append("\r\n\r\n").append(body);
+    return request;
+}
+
+// 准备 rf/ld 读取的文件（服务器在同一台机器上，直接按路径访问），返回各函数的请求
+bool buildWorkloads(const Options& options, const QDir& dir,
+                    std::vector<THttpLoadClient::Workload>* workloads, QString* errorReason)
+{
+    QString host = QString("%1:%2").arg(options.address).arg(options.port);
+
+    QString readPath = dir.filePath("read.txt");
+    QFile readFile(readPath);
+    if (!readFile.open(QIODevice::WriteOnly)) {
+        *errorReason = QString("Cannot create %1").arg(readPath);
+        return false;
+    }
+    readFile.write(QByteArray(options.payloadSize, 'r'));
+    readFile.close();
+
+    QString listPath = dir.filePath("list");
+    dir.mkpath("list");
+    for (int i = 0; i < 64; ++i) {
+        QFile file(QDir(listPath).filePath(QString("file-%1.txt").arg(i)));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write("x");
+        }
+    }
+
+    const QStringList entries = options.mix.split(',', Qt::SkipEmptyParts);
+    for (const QString& entry : entries) {
+        QStringList parts = entry.split('=');
+        THttpLoadClient::Workload workload;
+        workload.name = parts.value(0).trimmed();
+        workload.weight = parts.size() > 1 ? parts[1].toInt() : 1;
+        if (workload.weight <= 0) {
+            continue;
+        }
+
+        QJsonObject payload;
+        if (workload.name == "rf") {
+            payload["path"] = readPath;
+        } else if (workload.name == "wf") {
+            payload["path"] = dir.filePath("write.txt");
+            payload["content"] = QString(options.payloadSize, QLatin1Char('w'));
+            payload["append"] = false;
+        } else if (workload.name == "ld") {
+            payload["path"] = listPath;
+        } else if (workload.name != "gsi" && workload.name != "metrics") {
+            *errorReason = QString("Unknown function in mix: %1").arg(workload.name);
+            return false;
+        }
+        workload.request = postRequest(workload.name, payload, host);
+        workloads->push_back(std::move(workload));
+    }
+
+    if (workloads->empty()) {
+        *errorReason = "Empty request mix";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
-    QCoreApplication a(argc, argv);
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("HTTP load client for the httpserver gateway");
+    parser.addHelpOption();
+    QCommandLineOption addressOption("address", "Server address, must be a loopback address.", "address", "127.0.0.1");
+    QCommandLineOption portOption("port", "Server port.", "port", "8080");
+    QCommandLineOption connectionsOption("connections", "Keep-alive connections in the pool.", "n", "8");
+    QCommandLineOption threadsOption("threads", "Client event loop threads, 0 for one per core.", "n", "0");
+    QCommandLineOption depthOption("depth", "Pipelined requests per connection.", "n", "1");
+    QCommandLineOption rateOption("rate", "Open-loop arrival rate in requests/s, 0 for closed loop.", "rate", "0");
+    QCommandLineOption requestsOption("requests", "Total requests, 0 for duration only.", "n", "0");
+    QCommandLineOption durationOption("duration", "Send duration in seconds, 0 for request count only.", "seconds", "10");
+    QCommandLineOption mixOption("mix", "Request mix, e.g. rf=4,wf=1,ld=1,gsi=4.", "mix", "rf=4,wf=1,ld=1,gsi=4");
+    QCommandLineOption payloadOption("payload-size", "rf file size and wf content size in bytes.", "bytes", "1024");
+    QCommandLineOption outputOption("output", "Result JSON file.", "path", "httpclient-results.json");
+    QCommandLineOption baselineOption("baseline", "Previous result JSON to compare against.", "path");
+    parser.addOptions({addressOption, portOption, connectionsOption, threadsOption, depthOption, rateOption,
+                       requestsOption, durationOption, mixOption, payloadOption, outputOption, baselineOption});
+    parser.process(app);
+
+    Options options;
+    options.address = parser.value(addressOption);
+    options.port = qBound(1, parser.value(portOption).toInt(), 65535);
+    options.connections = qMax(1, parser.value(connectionsOption).toInt());
+    options.threads = qMax(0, parser.value(threadsOption).toInt());
+    options.depth = qMax(1, parser.value(depthOption).toInt());
+    options.rate = qMax(0.0, parser.value(rateOption).toDouble());
+    options.requests = qMax<qint64>(0, parser.value(requestsOption).toLongLong());
+    options.durationSeconds = qMax(0, parser.value(durationOption).toInt());
+    options.mix = parser.value(mixOption);
+    options.payloadSize = qMax(0, parser.value(payloadOption).toInt());
+    options.outputPath = parser.value(outputOption);
+    options.baselinePath = parser.value(baselineOption);
+    if (options.requests == 0 && options.durationSeconds == 0) {
+        options.durationSeconds = 10;
+    }
+
+    // rf/ld 的文件由客户端在本地创建，服务器必须在同一台机器上
+    QHostAddress address(options.address);
+    bool isIPv4 = false;
+    quint32 ipv4 = address.toIPv4Address(&isIPv4);
+    if (!isIPv4 || !address.isLoopback()) {
+        out << "error: " << options.address << " is not an IPv4 loopback address\n";
+        return 1;
+    }
+
+    QTemporaryDir tempDir;
+    std::vector<THttpLoadClient::Workload> workloads;
+    QString errorReason;
+    if (!tempDir.isValid() || !buildWorkloads(options, QDir(tempDir.path()), &workloads, &errorReason)) {
+        out << "error: " << (errorReason.isEmpty() ? QString("Cannot create temporary directory") : errorReason) << "\n";
+        return 1;
+    }
+    std::vector<QString> names;
+    for (const THttpLoadClient::Workload& workload : workloads) {
+        names.push_back(workload.name);
+    }
+
+    THttpLoadClient::Options clientOptions;
+    clientOptions.address = ipv4;
+    clientOptions.port = static_cast<quint16>(options.port);
+    clientOptions.connections = options.connections;
+    clientOptions.threads = options.threads;
+    clientOptions.depth = options.depth;
+    clientOptions.rate = options.rate;
+    clientOptions.requests = options.requests;
+    clientOptions.durationSeconds = options.durationSeconds;
+
+    THttpLoadClient client(clientOptions, std::move(workloads));
+    if (!client.run(&errorReason)) {
+        out << "error: " << errorReason << "\n";
+        return 1;
+    }
+
+    // 汇总
+    double elapsedSeconds = client.elapsedNs() / 1e9;
+    const TLatencySummary& total = client.latency();
+    quint64 completed = 0;
+    quint64 errors = 0;
+    QJsonObject functions;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        const THttpLoadClient::WorkloadResult& workload = client.results()[i];
+        completed += workload.completed;
+        errors += workload.errors;
+
+        QJsonObject function;
+        function["completed"] = static_cast<qint64>(workload.completed);
+        function["errors"] = static_cast<qint64>(workload.errors);
+        function["throughput"] = elapsedSeconds > 0 ? workload.completed / elapsedSeconds : 0.0;
+        function["latency"] = workload.latency.toJson();
+        functions[names[i]] = function;
+    }
+
+    QJsonObject config;
+    config["address"] = options.address;
+    config["port"] = options.port;
+    config["connections"] = options.connections;
+    config["threads"] = options.threads;
+    config["depth"] = options.depth;
+    config["mode"] = options.rate > 0 ? "open" : "closed";
+    config["rate"] = options.rate;
+    config["requests"] = options.requests;
+    config["duration"] = options.durationSeconds;
+    config["mix"] = options.mix;
+    config["payloadSize"] = options.payloadSize;
+
+    QJsonObject result;
+    result["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    result["config"] = config;
+    result["elapsedSeconds"] = elapsedSeconds;
+    result["sent"] = static_cast<qint64>(client.sent());
+    result["completed"] = static_cast<qint64>(completed);
+    result["errors"] = static_cast<qint64>(errors);
+    result["throughput"] = elapsedSeconds > 0 ? completed / elapsedSeconds : 0.0;
+    result["bodyBytes"] = static_cast<qint64>(client.bodyBytes());
+    result["abandoned"] = static_cast<qint64>(client.abandoned());
+    result["reconnects"] = static_cast<qint64>(client.reconnects());
+    result["maxBacklog"] = static_cast<qint64>(client.maxBacklog());
+    if (!client.stopReason().isEmpty()) {
+        result["stopReason"] = client.stopReason();
+    }
+    result["latency"] = total.toJson();
+    result["functions"] = functions;
+
+    out << QString("completed %1 of %2 requests (%3 errors) in %4 s, %5 req/s\n")
+               .arg(completed).arg(client.sent()).arg(errors).arg(elapsedSeconds, 0, 'f', 3)
+               .arg(result["throughput"].toDouble(), 0, 'f', 0);
+    out << QString("latency us: p50 %1  p90 %2  p99 %3  p999 %4  max %5\n")
+               .arg(total.percentile(0.50) / 1000.0, 0, 'f', 1)
+               .arg(total.percentile(0.90) / 1000.0, 0, 'f', 1)
+               .arg(total.percentile(0.99) / 1000.0, 0, 'f', 1)
+               .arg(total.percentile(0.999) / 1000.0, 0, 'f', 1)
+               .arg(total.max() / 1000.0, 0, 'f', 1);
+    if (!client.stopReason().isEmpty()) {
+        out << "warning: stopped early, server unreachable: " << client.stopReason() << "\n";
+    }
+    if (options.rate > 0 && client.maxBacklog() > 0) {
+        // 开环模式下出现本地排队，说明服务器跟不上目标速率，延迟中包含排队时间
+        out << QString("warning: up to %1 requests queued locally, server did not keep up with %2 req/s\n")
+                   .arg(client.maxBacklog()).arg(options.rate, 0, 'f', 0);
+    }
 
-    // Set up code that uses the Qt event loop here.
-    // Call a.quit() or a.exit() to quit the application.
-    // A not very useful example would be including
-    // #include <QTimer>
-    // near the top of the file and calling
-    // QTimer::singleShot(5000, &a, &QCoreApplication::quit);
-    // which quits the application after 5 seconds.
+    // 与上一次结果比较，便于发现回退
+    if (!options.baselinePath.isEmpty()) {
+        QFile baselineFile(options.baselinePath);
+        if (baselineFile.open(QIODevice::ReadOnly)) {
+            QJsonObject baseline = QJsonDocument::fromJson(baselineFile.readAll()).object();
+            QJsonObject comparison;
+            comparison["path"] = options.baselinePath;
+            comparison["sameConfig"] = baseline["config"].toObject() == config;
+            comparison["throughputChange"] = TLatencySummary::changePercent(
+                result["throughput"].toDouble(), baseline["throughput"].toDouble());
+            comparison["p99Change"] = TLatencySummary::changePercent(
+                result["latency"].toObject()["p99"].toDouble(), baseline["latency"].toObject()["p99"].toDouble());
+            result["baseline"] = comparison;
+            out << QString("vs baseline: throughput %1%, p99 %2%%3\n")
+                       .arg(comparison["throughputChange"].toDouble(), 0, 'f', 1)
+                       .arg(comparison["p99Change"].toDouble(), 0, 'f', 1)
+                       .arg(comparison["sameConfig"].toBool() ? QString() : QString(" (different config)"));
+        } else {
+            out << "warning: cannot read baseline " << options.baselinePath << "\n";
+        }
+    }
 
-    // If you do not need a running Qt event loop, remove the call
-    // to a.exec() or use the Non-Qt Plain C++ Application template.
+    QFile outputFile(options.outputPath);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        out << "error: cannot write " << options.outputPath << "\n";
+        return 1;
+    }
+    outputFile.write(QJsonDocument(result).toJson(QJsonDocument::Indented));
+    out << "results written to " << options.outputPath << "\n";
 
-    return a.exec();
+    return errors > 0 || client.abandoned() > 0 ? 2 : 0;
 }
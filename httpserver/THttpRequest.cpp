@@ -0,0 +1,216 @@
+#include "THttpRequest.h"
+#include <cstring>
+#include "TMetrics.h"
+
+namespace {
+
+// 按 Content-Length 预留的主体缓冲上限
+constexpr qint64 InitialBodyReserve = 64 * 1024;
+
+const char* findHeaderEnd(const char* data, int size)
+{
+    for (int i = 3; i < size; ++i) {
+        if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+            return data + i - 3;
+        }
+    }
+    return nullptr;
+}
+
+QByteArray trimmed(const char* begin, const char* end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+    return QByteArray(begin, static_cast<int>(end - begin));
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+} // namespace
+
+QByteArray THttpRequest::header(const QByteArray& lowerName) const
+{
+    for (const auto& header : headers) {
+        if (header.first == lowerName) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
+THttpRequestParser::THttpRequestParser(qint64 maxBodySize)
+    : m_maxBodySize(maxBodySize)
+{
+}
+
+THttpRequestParser::Status THttpRequestParser::parse(const char* data, int size, THttpRequest* request, int* consumed)
+{
+    *consumed = 0;
+
+    if (!m_headParsed) {
+        const char* headEnd = findHeaderEnd(data, qMin(size, MaxHeaderSize + 4));
+        if (!headEnd) {
+            if (size > MaxHeaderSize) {
+                return fail(431, "Request header too large");
+            }
+            return Status::NeedMore;
+        }
+
+        if (!parseHead(data, static_cast<int>(headEnd - data))) {
+            return Status::Error;
+        }
+        *consumed = static_cast<int>(headEnd - data) + 4;
+        data += *consumed;
+        size -= *consumed;
+        m_headParsed = true;
+    }
+
+    if (m_bodyRemaining > 0) {
+        int take = static_cast<int>(qMin<qint64>(m_bodyRemaining, size));
+        m_pending.body.append(data, take);
+        m_bodyRemaining -= take;
+        *consumed += take;
+        if (m_bodyRemaining > 0) {
+            return Status::NeedMore;
+        }
+    }
+
+    *request = std::move(m_pending);
+    m_pending = THttpRequest();
+    m_headParsed = false;
+    return Status::Complete;
+}
+
+THttpRequestParser::Status THttpRequestParser::fail(int status, const char* reason)
+{
+    m_errorStatus = status;
+    m_errorReason = reason;
+    return Status::Error;
+}
+
+bool THttpRequestParser::parseHead(const char* data, int size)
+{
+    const char* end = data + size;
+    const char* lineEnd = static_cast<const char*>(std::memchr(data, '\r', static_cast<std::size_t>(size)));
+    if (!lineEnd) {
+        lineEnd = end;
+    }
+
+    // 请求行：METHOD SP request-target SP HTTP-version
+    const char* methodEnd = static_cast<const char*>(std::memchr(data, ' ', static_cast<std::size_t>(lineEnd - data)));
+    const char* targetBegin = methodEnd ? methodEnd + 1 : nullptr;
+    const char* targetEnd = targetBegin
+        ? static_cast<const char*>(std::memchr(targetBegin, ' ', static_cast<std::size_t>(lineEnd - targetBegin)))
+        : nullptr;
+    if (!methodEnd || methodEnd == data || !targetEnd || targetEnd == targetBegin || *targetBegin != '/') {
+        fail(400, "Malformed request line");
+        return false;
+    }
+
+    THttpRequest request;
+    request.receivedAt = TMetrics::now();
+    request.method = QByteArray(data, static_cast<int>(methodEnd - data));
+
+    QByteArray version(targetEnd + 1, static_cast<int>(lineEnd - targetEnd - 1));
+    if (version == "HTTP/1.1") {
+        request.keepAlive = true;
+    } else if (version == "HTTP/1.0") {
+        request.keepAlive = false;
+    } else {
+        fail(505, "HTTP version not supported");
+        return false;
+    }
+
+    const char* queryBegin = static_cast<const char*>(
+        std::memchr(targetBegin, '?', static_cast<std::size_t>(targetEnd - targetBegin)));
+    const char* pathEnd = queryBegin ? queryBegin : targetEnd;
+    request.path = percentDecode(targetBegin, static_cast<int>(pathEnd - targetBegin), false);
+    if (queryBegin) {
+        request.query = QByteArray(queryBegin + 1, static_cast<int>(targetEnd - queryBegin - 1));
+    }
+
+    // 请求头
+    qint64 contentLength = 0;
+    const char* line = lineEnd + 2;
+    while (line < end) {
+        const char* next = static_cast<const char*>(std::memchr(line, '\r', static_cast<std::size_t>(end - line)));
+        if (!next) {
+            next = end;
+        }
+        const char* colon = static_cast<const char*>(std::memchr(line, ':', static_cast<std::size_t>(next - line)));
+        if (!colon || colon == line) {
+            fail(400, "Malformed header line");
+            return false;
+        }
+
+        QByteArray name = QByteArray(line, static_cast<int>(colon - line)).toLower();
+        QByteArray value = trimmed(colon + 1, next);
+
+        if (name == "content-length") {
+            bool ok = false;
+            contentLength = value.toLongLong(&ok);
+            if (!ok || contentLength < 0) {
+                fail(400, "Invalid Content-Length");
+                return false;
+            }
+        } else if (name == "transfer-encoding") {
+            fail(501, "Request Transfer-Encoding not supported");
+            return false;
+        } else if (name == "connection") {
+            QByteArray lower = value.toLower();
+            if (lower.contains("close")) {
+                request.keepAlive = false;
+            } else if (lower.contains("keep-alive")) {
+                request.keepAlive = true;
+            }
+        }
+
+        request.headers.append(qMakePair(name, value));
+        line = next + 2;
+    }
+
+    if (contentLength > m_maxBodySize) {
+        fail(413, "Request body too large");
+        return false;
+    }
+
+    // 只按头部声明预留一小块，其余随数据到达增长，避免未发送主体的连接各占用 maxBodySize
+    request.body.reserve(static_cast<int>(qMin<qint64>(contentLength, InitialBodyReserve)));
+    m_bodyRemaining = contentLength;
+    m_pending = std::move(request);
+    return true;
+}
+
+QByteArray THttpRequestParser::percentDecode(const char* data, int size, bool plusAsSpace)
+{
+    QByteArray out;
+    out.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        char c = data[i];
+        if (c == '%' && i + 2 < size && hexValue(data[i + 1]) >= 0 && hexValue(data[i + 2]) >= 0) {
+            out.append(static_cast<char>(hexValue(data[i + 1]) * 16 + hexValue(data[i + 2])));
+            i += 2;
+        } else if (c == '+' && plusAsSpace) {
+            out.append(' ');
+        } else {
+            out.append(c);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,57 @@
+#ifndef THTTPREQUEST_H
+#define THTTPREQUEST_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+// 一条已解析的 HTTP/1.x 请求
+struct THttpRequest {
+    QByteArray method;
+    QByteArray path;        // 已做百分号解码，不含查询串
+    QByteArray query;       // '?' 之后的原始查询串
+    QByteArray body;
+    QList<QPair<QByteArray, QByteArray>> headers;  // 名称已转为小写
+    bool keepAlive = true;
+    qint64 receivedAt = 0;  // TMetrics::now()
+
+    QByteArray header(const QByteArray& lowerName) const;
+};
+
+// 增量请求解析器：每个连接一个，按到达顺序逐条解析流水线中的请求
+// 只支持 Content-Length 请求体，请求带 Transfer-Encoding 时返回 501
+class THttpRequestParser
+{
+public:
+    enum class Status {
+        NeedMore,   // 数据不足，等待更多字节
+        Complete,   // 解析出一条请求
+        Error       // 协议错误，连接应在回复 errorStatus() 后关闭
+    };
+
+    static constexpr int MaxHeaderSize = 16 * 1024;
+
+    explicit THttpRequestParser(qint64 maxBodySize = 64 * 1024 * 1024);
+
+    // 从 data 开头解析一条请求，*consumed 返回本次消耗的字节数（NeedMore 时可能已消耗请求头）
+    Status parse(const char* data, int size, THttpRequest* request, int* consumed);
+
+    int errorStatus() const { return m_errorStatus; }
+    const char* errorReason() const { return m_errorReason; }
+
+    // 百分号解码，plusAsSpace 用于查询串
+    static QByteArray percentDecode(const char* data, int size, bool plusAsSpace);
+
+private:
+    Status fail(int status, const char* reason);
+    bool parseHead(const char* data, int size);
+
+    qint64 m_maxBodySize;
+    THttpRequest m_pending;         // 请求头已解析、等待请求体的请求
+    bool m_headParsed = false;
+    qint64 m_bodyRemaining = 0;
+    int m_errorStatus = 0;
+    const char* m_errorReason = "";
+};
+
+#endif // THTTPREQUEST_H
@@ -0,0 +1,925 @@
+#include "THttpServer.h"
+#include <QThread>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include "THttpRequest.h"
+#include "TJsonWriter.h"
+#include "TLog.h"
+#include "TMetrics.h"
+#include "TStreamBody.h"
+
+namespace {
+
+constexpr int ChunkSize = 64 * 1024;            // 分块编码每块的大小
+constexpr qint64 SendfileChunk = 1024 * 1024;   // 每次 sendfile 的最大字节数
+constexpr int ReadBufferSize = 64 * 1024;
+constexpr int MaxBufferedInput = 256 * 1024;    // 单次可读事件最多读入的字节数，解析后再继续读
+constexpr int MaxEvents = 256;
+
+// epoll 事件的 data.u64：0 为监听 socket，1 为 eventfd，其余为连接编号
+constexpr quint64 ListenToken = 0;
+constexpr quint64 WakeToken = 1;
+
+const char* reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    default: return status < 400 ? "OK" : "Error";
+    }
+}
+
+QByteArray statusLine(int status, bool keepAlive)
+{
+    // 回调返回的状态码不一定是合法的 HTTP 状态码，超出范围时按 500 处理；
+    // 1xx 是临时响应，客户端会继续等待最终响应，同样不能直接使用
+    int httpStatus = status >= 200 && status <= 599 ? status : 500;
+    QByteArray head;
+    head.reserve(160);
+    head.append("HTTP/1.1 ").append(QByteArray::number(httpStatus)).append(' ').append(reasonPhrase(httpStatus));
+    head.append(keepAlive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n");
+    return head;
+}
+
+// 非 2xx 响应的主体：{"error": e, "reason": er}
+QByteArray errorBody(const Models::Response& response)
+{
+    QByteArray body;
+    TJsonWriter writer(&body);
+    writer.beginObject();
+    writer.key("error");
+    writer.value(response.error);
+    writer.key("reason");
+    if (response.errorReason.isEmpty()) {
+        writer.null();
+    } else {
+        writer.value(response.errorReason);
+    }
+    writer.endObject();
+    return body;
+}
+
+// 成功响应的主体即 r 本身
+QByteArray resultBody(const Models::Response& response)
+{
+    return response.resultJsonBytes();
+}
+
+Models::Response errorResponse(int status, const QString& error, const QString& reason)
+{
+    Models::Response response;
+    response.statusCode = status;
+    response.error = error;
+    response.errorReason = reason;
+    return response;
+}
+
+} // namespace
+
+// 连接上的一个流水线请求，响应在回调完成后按请求顺序写出
+struct THttpExchange {
+    bool ready = false;             // 响应已就绪，只在反应器线程读写
+    bool keepAlive = true;
+    int metricsId = -1;
+    int statusCode = 200;
+    qint64 sendStart = 0;
+    qint64 bytesOut = 0;
+
+    QByteArray buffer;              // 待写出的字节：响应头和主体，或当前的分块
+    int bufferOffset = 0;
+
+    std::shared_ptr<TStreamBody> stream;
+    bool chunked = false;           // 非文件流按块读取并以分块编码发送；推送型数据源暂无数据时挂起
+    bool finished = false;          // 分块编码的结束块已放入 buffer
+    int fileFd = -1;                // 文件流以 sendfile 发送，描述符归 stream 所有
+    qint64 fileOffset = 0;
+    qint64 fileRemaining = 0;
+
+    // 由回调结果生成响应头（及主体），流式响应在此打开数据源；在工作线程中调用
+    // readyRead 在推送型数据源产生新数据时由数据源所在线程调用，用于唤醒反应器
+    void prepare(Models::Response response, std::function<void()> readyRead = {});
+};
+
+void THttpExchange::prepare(Models::Response response, std::function<void()> readyRead)
+{
+    if (response.stream) {
+        QString reason;
+        if (response.stream->needsEventLoop()) {
+            // 反应器线程没有 Qt 事件循环，这类数据源等不到数据；在 open() 之前拒绝，不启动数据源
+            response = errorResponse(501, "Not implemented", "This stream needs the session event loop, "
+                                                             "which only WebSocket and local sessions run");
+        } else {
+            response.stream->setThreadSafeReadyReadHandler(std::move(readyRead));
+            if (!response.stream->open(&reason)) {
+                response = errorResponse(500, "Stream open failed", reason);
+            }
+        }
+    }
+    statusCode = response.statusCode;
+    buffer = statusLine(response.statusCode, keepAlive);
+
+    if (response.stream) {
+        stream = std::move(response.stream);
+        if (stream->fileRange(&fileFd, &fileOffset, &fileRemaining)) {
+            buffer.append("Content-Type: application/octet-stream\r\nContent-Length: ");
+            buffer.append(QByteArray::number(fileRemaining));
+        } else {
+            chunked = true;
+            buffer.append("Content-Type: application/octet-stream\r\nTransfer-Encoding: chunked");
+        }
+        buffer.append("\r\nX-Stream-Offset: ").append(QByteArray::number(stream->startOffset()));
+        buffer.append("\r\n\r\n");
+        return;
+    }
+
+    QByteArray body = response.statusCode >= 200 && response.statusCode < 300
+        ? resultBody(response) : errorBody(response);
+    buffer.reserve(buffer.size() + body.size() + 64);
+    buffer.append("Content-Type: application/json\r\nContent-Length: ");
+    buffer.append(QByteArray::number(body.size()));
+    buffer.append("\r\n\r\n");
+    buffer.append(body);
+}
+
+// 反应器：一个线程、一个 epoll 实例、一个监听 socket，以及分配到它的连接
+class THttpReactor
+{
+public:
+    THttpReactor(THttpServer* server, int index);
+    ~THttpReactor();
+
+    // 创建 epoll、eventfd 和监听 socket；*port 为 0 时回填系统分配的端口
+    bool open(quint32 address, quint16* port, QString* errorString);
+    void start();
+    void stop();
+
+    // 工作线程完成回调后调用（任意线程）
+    void post(quint64 connectionId, std::shared_ptr<THttpExchange> exchange);
+
+    // 推送型数据源有新数据时调用（任意线程）；只比较地址，交换已结束时忽略
+    void resume(quint64 connectionId, const THttpExchange* exchange);
+
+private:
+    struct Connection {
+        int fd = -1;
+        quint64 id = 0;
+        QByteArray input;
+        int inputOffset = 0;            // input 中已解析的字节数
+        THttpRequestParser parser;
+        std::deque<std::shared_ptr<THttpExchange>> exchanges;
+        bool closing = false;           // 不再读取新请求，写完已有响应后关闭
+        bool writeBlocked = false;
+        quint32 events = 0;
+        qint64 lastActive = 0;
+
+        explicit Connection(qint64 maxBodySize) : parser(maxBodySize) {}
+        ~Connection() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+
+    enum class WriteResult {
+        Done,
+        Blocked,
+        Waiting,        // 推送型数据源暂无数据，等 resume()
+        Failed
+    };
+
+    void run();
+    void acceptConnections();
+    void readConnection(Connection* conn);
+    bool service(Connection* conn);
+    void dispatch(Connection* conn, THttpRequest request);
+    WriteResult writeExchange(Connection* conn, THttpExchange* exchange);
+    void updateEvents(Connection* conn);
+    void closeConnection(Connection* conn);
+    void drainCompletions();
+    void sweepIdle();
+
+    THttpServer* m_server;
+    int m_index;
+    int m_epoll = -1;
+    int m_wake = -1;
+    int m_listen = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    quint64 m_nextId = WakeToken + 1;
+    std::unordered_map<quint64, std::unique_ptr<Connection>> m_connections;
+
+    std::mutex m_completionMutex;
+    std::vector<std::pair<quint64, std::shared_ptr<THttpExchange>>> m_completions;
+    std::vector<std::pair<quint64, const THttpExchange*>> m_resumes;
+};
+
+THttpReactor::THttpReactor(THttpServer* server, int index)
+    : m_server(server)
+    , m_index(index)
+{
+}
+
+THttpReactor::~THttpReactor()
+{
+    stop();
+    m_connections.clear();
+    if (m_listen >= 0) {
+        ::close(m_listen);
+    }
+    if (m_wake >= 0) {
+        ::close(m_wake);
+    }
+    if (m_epoll >= 0) {
+        ::close(m_epoll);
+    }
+}
+
+bool THttpReactor::open(quint32 address, quint16* port, QString* errorString)
+{
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_listen = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_epoll < 0 || m_wake < 0 || m_listen < 0) {
+        *errorString = QString("Cannot create reactor: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+
+    // 所有反应器绑定同一端口，由内核按连接做负载均衡
+    int one = 1;
+    ::setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    ::setsockopt(m_listen, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(address);
+    addr.sin_port = htons(*port);
+    if (::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(m_listen, SOMAXCONN) < 0) {
+        *errorString = QString("Cannot listen on port %1: %2").arg(*port).arg(QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+
+    if (*port == 0) {
+        socklen_t length = sizeof(addr);
+        ::getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &length);
+        *port = ntohs(addr.sin_port);
+    }
+
+    epoll_event listenEvent = {};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.u64 = ListenToken;
+    epoll_event wakeEvent = {};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.u64 = WakeToken;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listen, &listenEvent);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &wakeEvent);
+    return true;
+}
+
+void THttpReactor::start()
+{
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread([this]() { run(); });
+}
+
+void THttpReactor::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_running.store(false, std::memory_order_release);
+    quint64 one = 1;
+    ssize_t written = ::write(m_wake, &one, sizeof(one));
+    Q_UNUSED(written);
+    m_thread.join();
+}
+
+void THttpReactor::post(quint64 connectionId, std::shared_ptr<THttpExchange> exchange)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        wasEmpty = m_completions.empty() && m_resumes.empty();
+        m_completions.emplace_back(connectionId, std::move(exchange));
+    }
+    // 队列原本非空时反应器已被唤醒，无需再写 eventfd
+    if (wasEmpty) {
+        quint64 one = 1;
+        ssize_t written = ::write(m_wake, &one, sizeof(one));
+        Q_UNUSED(written);
+    }
+}
+
+void THttpReactor::resume(quint64 connectionId, const THttpExchange* exchange)
+{
+    // 不持有交换的引用：数据源在自己的锁内调用，最后一个引用在这里释放会在锁内析构数据源
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        wasEmpty = m_completions.empty() && m_resumes.empty();
+        m_resumes.emplace_back(connectionId, exchange);
+    }
+    if (wasEmpty) {
+        quint64 one = 1;
+        ssize_t written = ::write(m_wake, &one, sizeof(one));
+        Q_UNUSED(written);
+    }
+}
+
+void THttpReactor::run()
+{
+    epoll_event events[MaxEvents];
+    qint64 lastSweep = TMetrics::now();
+
+    while (m_running.load(std::memory_order_acquire)) {
+        int count = ::epoll_wait(m_epoll, events, MaxEvents, 1000);
+        if (count < 0 && errno != EINTR) {
+            TLOG_ERROR("http_epoll_failed").field("reactor", m_index).field("errno", errno);
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            quint64 token = events[i].data.u64;
+            if (token == ListenToken) {
+                acceptConnections();
+                continue;
+            }
+            if (token == WakeToken) {
+                quint64 value;
+                ssize_t drained = ::read(m_wake, &value, sizeof(value));
+                Q_UNUSED(drained);
+                drainCompletions();
+                continue;
+            }
+
+            auto it = m_connections.find(token);
+            if (it == m_connections.end()) {
+                continue;
+            }
+            Connection* conn = it->second.get();
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(conn);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                conn->writeBlocked = false;
+            }
+            if (events[i].events & EPOLLIN) {
+                readConnection(conn);
+            } else {
+                service(conn);
+            }
+        }
+
+        qint64 now = TMetrics::now();
+        if (now - lastSweep >= 1000000000LL) {
+            lastSweep = now;
+            sweepIdle();
+        }
+    }
+}
+
+void THttpReactor::acceptConnections()
+{
+    for (;;) {
+        int fd = ::accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                TLOG_WARN("http_accept_failed").field("reactor", m_index).field("errno", errno);
+            }
+            return;
+        }
+
+        // 响应头和小响应体各自一次写出，关闭 Nagle 避免与延迟确认叠加
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_unique<Connection>(m_server->m_maxBodySize);
+        conn->fd = fd;
+        conn->id = m_nextId++;
+        conn->events = EPOLLIN;
+        conn->lastActive = TMetrics::now();
+
+        epoll_event event = {};
+        event.events = conn->events;
+        event.data.u64 = conn->id;
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ::close(fd);
+            continue;
+        }
+        TLOG_DEBUG("http_accept").field("reactor", m_index).field("conn", conn->id);
+        m_connections.emplace(conn->id, std::move(conn));
+    }
+}
+
+void THttpReactor::readConnection(Connection* conn)
+{
+    char buffer[ReadBufferSize];
+    bool peerClosed = false;
+
+    while (conn->input.size() - conn->inputOffset < MaxBufferedInput) {
+        ssize_t n = ::recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn->input.append(buffer, static_cast<int>(n));
+            continue;
+        }
+        if (n == 0) {
+            peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            closeConnection(conn);
+            return;
+        }
+        break;
+    }
+    conn->lastActive = TMetrics::now();
+
+    if (peerClosed) {
+        // 对端关闭写方向：解析已收到的请求，写完响应后关闭
+        if (!service(conn)) {
+            return;
+        }
+        conn->closing = true;
+        if (conn->exchanges.empty()) {
+            closeConnection(conn);
+        } else {
+            updateEvents(conn);
+        }
+        return;
+    }
+    service(conn);
+}
+
+// 解析缓冲区中的请求并写出已就绪的响应，直到无法继续；连接被关闭时返回 false
+bool THttpReactor::service(Connection* conn)
+{
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        // 解析：流水线中的请求数达到上限时暂停
+        while (!conn->closing && static_cast<int>(conn->exchanges.size()) < m_server->m_maxPipelined
+               && conn->inputOffset < conn->input.size()) {
+            THttpRequest request;
+            int consumed = 0;
+            THttpRequestParser::Status status = conn->parser.parse(conn->input.constData() + conn->inputOffset,
+                                                                   conn->input.size() - conn->inputOffset,
+                                                                   &request, &consumed);
+            conn->inputOffset += consumed;
+            if (status == THttpRequestParser::Status::NeedMore) {
+                break;
+            }
+            if (status == THttpRequestParser::Status::Error) {
+                auto exchange = std::make_shared<THttpExchange>();
+                exchange->keepAlive = false;
+                exchange->prepare(errorResponse(conn->parser.errorStatus(), "Bad request",
+                                                QString::fromLatin1(conn->parser.errorReason())));
+                exchange->ready = true;
+                conn->exchanges.push_back(std::move(exchange));
+                conn->closing = true;
+                conn->inputOffset = conn->input.size();
+                break;
+            }
+            dispatch(conn, std::move(request));
+        }
+        if (conn->inputOffset > 0) {
+            conn->input.remove(0, conn->inputOffset);
+            conn->inputOffset = 0;
+        }
+
+        // 写出：只写队首已就绪的响应，保证流水线顺序
+        if (conn->writeBlocked) {
+            break;
+        }
+        while (!conn->exchanges.empty() && conn->exchanges.front()->ready) {
+            THttpExchange* exchange = conn->exchanges.front().get();
+            if (exchange->sendStart == 0) {
+                exchange->sendStart = TMetrics::now();
+            }
+
+            WriteResult result = writeExchange(conn, exchange);
+            if (result == WriteResult::Failed) {
+                closeConnection(conn);
+                return false;
+            }
+            if (result == WriteResult::Blocked) {
+                conn->writeBlocked = true;
+                break;
+            }
+            if (result == WriteResult::Waiting) {
+                break;
+            }
+
+            TMetrics& metrics = TMetrics::instance();
+            metrics.recordLatency(exchange->metricsId, TMetrics::Stage::Send, TMetrics::now() - exchange->sendStart);
+            metrics.recordResponse(exchange->metricsId, exchange->statusCode, exchange->bytesOut);
+
+            bool keepAlive = exchange->keepAlive;
+            conn->exchanges.pop_front();
+            conn->lastActive = TMetrics::now();
+            if (!keepAlive) {
+                closeConnection(conn);
+                return false;
+            }
+            progress = true;
+        }
+    }
+
+    if (conn->closing && conn->exchanges.empty()) {
+        closeConnection(conn);
+        return false;
+    }
+    updateEvents(conn);
+    return true;
+}
+
+void THttpReactor::dispatch(Connection* conn, THttpRequest request)
+{
+    auto exchange = std::make_shared<THttpExchange>();
+    exchange->keepAlive = request.keepAlive;
+    conn->exchanges.push_back(exchange);
+    if (!request.keepAlive) {
+        conn->closing = true;
+    }
+
+    const TCallbackRegistry::Entry* entry = nullptr;
+    Models::Payload payload;
+    Models::Response error;
+    if (!m_server->route(request, &entry, &payload, &error)) {
+        exchange->prepare(std::move(error));
+        exchange->ready = true;
+        return;
+    }
+
+    int sequence = m_server->m_nextSequence.fetch_add(1, std::memory_order_relaxed);
+    int metricsId = entry->metricsId;
+    qint64 receivedAt = request.receivedAt;
+    exchange->metricsId = metricsId;
+    TMetrics::instance().recordRequest(metricsId, request.body.size());
+    TLOG_DEBUG("http_request").field("conn", conn->id).field("seq", sequence).field("path", request.path);
+
+    quint64 connectionId = conn->id;
+    TCallbackRegistry::Invoker invoke = entry->invoke;
+    std::shared_ptr<void> target = entry->target;
+    m_server->m_workers.start([this, connectionId, exchange, invoke, target, payload, sequence, metricsId, receivedAt]() {
+        TMetrics& metrics = TMetrics::instance();
+        qint64 start = TMetrics::now();
+        metrics.recordLatency(metricsId, TMetrics::Stage::QueueWait, start - receivedAt);
+        Models::Response response = invoke(target.get(), sequence, payload);
+        metrics.recordLatency(metricsId, TMetrics::Stage::Handler, TMetrics::now() - start);
+
+        const THttpExchange* raw = exchange.get();
+        exchange->prepare(std::move(response), [this, connectionId, raw]() {
+            resume(connectionId, raw);
+        });
+        post(connectionId, exchange);
+    });
+}
+
+THttpReactor::WriteResult THttpReactor::writeExchange(Connection* conn, THttpExchange* exchange)
+{
+    for (;;) {
+        if (exchange->bufferOffset < exchange->buffer.size()) {
+            ssize_t n = ::send(conn->fd, exchange->buffer.constData() + exchange->bufferOffset,
+                               static_cast<std::size_t>(exchange->buffer.size() - exchange->bufferOffset), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK ? WriteResult::Blocked : WriteResult::Failed;
+            }
+            exchange->bufferOffset += static_cast<int>(n);
+            exchange->bytesOut += n;
+            continue;
+        }
+
+        // 文件流：内核直接从页缓存发送，不经过用户态
+        if (exchange->fileRemaining > 0) {
+            off_t offset = static_cast<off_t>(exchange->fileOffset);
+            ssize_t n = ::sendfile(conn->fd, exchange->fileFd, &offset,
+                                   static_cast<std::size_t>(qMin(exchange->fileRemaining, SendfileChunk)));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK ? WriteResult::Blocked : WriteResult::Failed;
+            }
+            if (n == 0) {
+                // 文件在发送过程中被截断，已承诺的 Content-Length 无法满足，只能断开连接
+                TLOG_WARN("http_sendfile_truncated").field("conn", conn->id).field("remaining", exchange->fileRemaining);
+                return WriteResult::Failed;
+            }
+            exchange->fileOffset = offset;
+            exchange->fileRemaining -= n;
+            exchange->bytesOut += n;
+            continue;
+        }
+
+        // 非文件流：读取下一块并加上分块编码的长度行
+        if (exchange->chunked && !exchange->finished) {
+            exchange->bufferOffset = 0;
+            if (exchange->stream->atEnd()) {
+                exchange->buffer = QByteArray("0\r\n\r\n");
+                exchange->finished = true;
+                continue;
+            }
+
+            int chunkSize = exchange->stream->preferredChunkSize() > 0 ? exchange->stream->preferredChunkSize() : ChunkSize;
+            chunkSize = qBound(TStreamBody::MinChunkSize, chunkSize, TStreamBody::MaxChunkSize);
+            QByteArray data = exchange->stream->read(chunkSize);
+            if (data.isEmpty() && exchange->stream->waitingForData()) {
+                // 推送型数据源暂无数据：挂起，取空之后产生的数据会经 resume() 唤醒
+                return WriteResult::Waiting;
+            }
+            if (data.isEmpty()) {
+                // 响应头已发出，无法再改状态码；不发送结束块，客户端据此判断响应不完整
+                TLOG_WARN("http_stream_read_failed").field("conn", conn->id).field("reason", exchange->stream->errorString());
+                return WriteResult::Failed;
+            }
+            exchange->buffer = QByteArray::number(data.size(), 16);
+            exchange->buffer.reserve(exchange->buffer.size() + data.size() + 4);
+            exchange->buffer.append("\r\n").append(data).append("\r\n");
+            continue;
+        }
+
+        return WriteResult::Done;
+    }
+}
+
+void THttpReactor::updateEvents(Connection* conn)
+{
+    quint32 events = 0;
+    if (!conn->closing && static_cast<int>(conn->exchanges.size()) < m_server->m_maxPipelined) {
+        events |= EPOLLIN;
+    }
+    if (conn->writeBlocked) {
+        events |= EPOLLOUT;
+    }
+    if (events == conn->events) {
+        return;
+    }
+
+    conn->events = events;
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = conn->id;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+void THttpReactor::closeConnection(Connection* conn)
+{
+    TLOG_DEBUG("http_close").field("reactor", m_index).field("conn", conn->id);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, conn->fd, nullptr);
+    // 仍在工作线程中的请求完成后找不到连接，其响应直接丢弃
+    m_connections.erase(conn->id);
+}
+
+void THttpReactor::drainCompletions()
+{
+    std::vector<std::pair<quint64, std::shared_ptr<THttpExchange>>> completions;
+    std::vector<std::pair<quint64, const THttpExchange*>> resumes;
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        completions.swap(m_completions);
+        resumes.swap(m_resumes);
+    }
+
+    for (const auto& completion : completions) {
+        auto it = m_connections.find(completion.first);
+        if (it == m_connections.end()) {
+            continue;
+        }
+        // 工作线程写入的响应内容经互斥锁对反应器可见；只有队首就绪时才需要写出
+        completion.second->ready = true;
+        Connection* conn = it->second.get();
+        if (!conn->exchanges.empty() && conn->exchanges.front() == completion.second) {
+            service(conn);
+        }
+    }
+
+    // 挂起的流只会是队首；地址不匹配说明交换已写完或连接已关闭
+    for (const auto& resumed : resumes) {
+        auto it = m_connections.find(resumed.first);
+        if (it == m_connections.end()) {
+            continue;
+        }
+        Connection* conn = it->second.get();
+        if (!conn->exchanges.empty() && conn->exchanges.front().get() == resumed.second
+            && conn->exchanges.front()->ready) {
+            service(conn);
+        }
+    }
+}
+
+void THttpReactor::sweepIdle()
+{
+    qint64 now = TMetrics::now();
+    qint64 timeout = static_cast<qint64>(m_server->m_idleTimeout) * 1000000;
+
+    std::vector<Connection*> idle;
+    for (const auto& item : m_connections) {
+        Connection* conn = item.second.get();
+        if (conn->exchanges.empty() && now - conn->lastActive > timeout) {
+            idle.push_back(conn);
+        }
+    }
+    for (Connection* conn : idle) {
+        closeConnection(conn);
+    }
+}
+
+// =================== THttpServer ===================
+
+THttpServer::THttpServer(std::shared_ptr<TCallbackRegistry> registry)
+    : m_registry(std::move(registry))
+{
+    setExposedFunctions({Models::READ_file, Models::write_file, Models::list_directory,
+                         Models::get_system_info, Models::get_metrics});
+    m_streamFunctions.append(Models::READ_file);
+    setWorkerThreads(0);
+}
+
+THttpServer::~THttpServer()
+{
+    close();
+}
+
+void THttpServer::setExposedFunctions(const QStringList& functions)
+{
+    m_exposed.clear();
+    for (const QString& function : functions) {
+        m_exposed.append(function.toUtf8());
+    }
+}
+
+void THttpServer::setWorkerThreads(int count)
+{
+    m_workers.setMaxThreadCount(count > 0 ? count : QThread::idealThreadCount() * 2);
+}
+
+void THttpServer::setIdleTimeout(int milliseconds)
+{
+    m_idleTimeout = qMax(1000, milliseconds);
+}
+
+void THttpServer::setMaxPipelined(int count)
+{
+    m_maxPipelined = qMax(1, count);
+}
+
+void THttpServer::setMaxBodySize(qint64 bytes)
+{
+    m_maxBodySize = qMax<qint64>(0, bytes);
+}
+
+bool THttpServer::listen(const QHostAddress& address, quint16 port, int reactors)
+{
+    bool ok = false;
+    quint32 ipv4 = address.toIPv4Address(&ok);
+    if (!ok) {
+        m_errorString = QString("Only IPv4 addresses are supported: %1").arg(address.toString());
+        return false;
+    }
+
+    int count = reactors > 0 ? reactors : QThread::idealThreadCount();
+    for (int i = 0; i < count; ++i) {
+        auto reactor = std::make_unique<THttpReactor>(this, i);
+        if (!reactor->open(ipv4, &port, &m_errorString)) {
+            m_reactors.clear();
+            return false;
+        }
+        m_reactors.push_back(std::move(reactor));
+    }
+
+    m_port = port;
+    for (const auto& reactor : m_reactors) {
+        reactor->start();
+    }
+    TLOG_INFO("http_listen").field("address", address.toString()).field("port", static_cast<int>(port))
+        .field("reactors", count).field("workers", m_workers.maxThreadCount());
+    return true;
+}
+
+void THttpServer::close()
+{
+    // 先停反应器，再等回调结束：回调完成时投递到的反应器对象仍然存在，只是不再处理
+    for (const auto& reactor : m_reactors) {
+        reactor->stop();
+    }
+    m_workers.waitForDone();
+    m_reactors.clear();
+}
+
+bool THttpServer::route(const THttpRequest& request, const TCallbackRegistry::Entry** entry,
+                        Models::Payload* payload, Models::Response* error) const
+{
+    QByteArray name = request.path.mid(1);
+    *entry = m_exposed.contains(name) ? m_registry->find(name.constData(), name.size()) : nullptr;
+    if (!*entry || !(*entry)->invoke) {
+        TMetrics::instance().recordNotFound();
+        *error = errorResponse(404, "Unknown function", QString("No function is exposed at %1")
+                               .arg(QString::fromUtf8(request.path)));
+        return false;
+    }
+
+    if (request.method == "GET") {
+        QJsonObject query = queryToJson(request.query);
+        if ((*entry)->coerceQuery) {
+            (*entry)->coerceQuery(&query);
+        }
+        *payload = Models::Payload(query);
+    } else if (request.method == "POST") {
+        *payload = request.body.isEmpty()
+            ? Models::Payload(QJsonObject())
+            : Models::Payload::fromJsonSpan(request.body, 0, request.body.size());
+    } else {
+        *error = errorResponse(405, "Method not allowed", "Use GET with query parameters or POST with a JSON body");
+        return false;
+    }
+
+    // 分块上传的数据经上传数据块帧到达，HTTP 连接上没有这种帧：在回调打开（并截断）目标文件之前拒绝
+    if (name == Models::write_file) {
+        bool ok = false;
+        QJsonValue value = payload->toJsonValue(&ok);
+        if (ok && value.toObject().value("chunked").toBool()) {
+            *error = errorResponse(501, "Not implemented",
+                                   "Chunked uploads need upload frames, which only WebSocket and local sessions carry");
+            return false;
+        }
+    }
+
+    // 文件内容以流的形式返回，才能走 sendfile；调用方显式传入 "stream": false 时保持原样
+    if (m_streamFunctions.contains(name)) {
+        bool ok = false;
+        QJsonValue value = payload->toJsonValue(&ok);
+        if (!ok) {
+            *error = errorResponse(400, "Invalid payload", "Request body is not valid JSON");
+            return false;
+        }
+        QJsonObject object = value.isString() ? QJsonObject{{"path", value}} : value.toObject();
+        if (!object.contains("stream")) {
+            object["stream"] = true;
+        }
+        *payload = Models::Payload(object);
+    }
+    return true;
+}
+
+QJsonObject THttpServer::queryToJson(const QByteArray& query)
+{
+    QJsonObject object;
+    for (const QByteArray& pair : query.split('&')) {
+        if (pair.isEmpty()) {
+            continue;
+        }
+        int eq = pair.indexOf('=');
+        QByteArray rawKey = eq < 0 ? pair : pair.left(eq);
+        QByteArray rawValue = eq < 0 ? QByteArray() : pair.mid(eq + 1);
+        QString key = QString::fromUtf8(THttpRequestParser::percentDecode(rawKey.constData(), rawKey.size(), true));
+        QByteArray text = THttpRequestParser::percentDecode(rawValue.constData(), rawValue.size(), true);
+
+        QJsonValue value = QString::fromUtf8(text);
+
+        if (!object.contains(key)) {
+            object.insert(key, value);
+        } else {
+            QJsonValue existing = object.value(key);
+            QJsonArray array;
+            if (existing.isArray()) {
+                array = existing.toArray();
+            } else {
+                array.append(existing);
+            }
+            array.append(value);
+            object.insert(key, array);
+        }
+    }
+    return object;
+}
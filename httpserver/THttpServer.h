@@ -0,0 +1,87 @@
+#ifndef THTTPSERVER_H
+#define THTTPSERVER_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Models.h"
+#include "TCallbackRegistry.h"
+
+struct THttpRequest;
+class THttpReactor;
+
+// HTTP/1.1 网关：把回调注册表中的函数以 HTTP 方式暴露给不支持 WebSocket 的工具
+//
+//   POST /<函数名>   请求体为 JSON 负载（即 WebSocket 请求中的 p）
+//   GET  /<函数名>?k=v&...   查询参数组成 JSON 对象作为负载
+//
+// 每个反应器线程运行一个 epoll 循环，持有自己的 SO_REUSEPORT 监听 socket，由内核在反应器间分配连接；
+// 连接支持 keep-alive 和流水线，响应按请求顺序写出。回调在工作线程池中执行，
+// 文件流（rf）以 sendfile 零拷贝发送，其它流式响应（如 ld 的 stream）使用分块传输编码；
+// 推送型数据源暂无数据时挂起该响应，数据源产生数据后经 eventfd 唤醒反应器继续发送
+class THttpServer
+{
+public:
+    explicit THttpServer(std::shared_ptr<TCallbackRegistry> registry);
+    ~THttpServer();
+
+    THttpServer(const THttpServer&) = delete;
+    THttpServer& operator=(const THttpServer&) = delete;
+
+    // 以下设置须在 listen() 之前调用
+
+    // 可访问的函数，默认 rf、wf、ld、gsi、metrics（ec 依赖 Qt 事件循环，不在反应器模型中提供）
+    void setExposedFunctions(const QStringList& functions);
+
+    // 回调执行线程数，<= 0 时取 CPU 核心数的两倍
+    void setWorkerThreads(int count);
+
+    // 空闲连接的超时时间（毫秒）
+    void setIdleTimeout(int milliseconds);
+
+    // 每个连接最多同时处理的流水线请求数，达到上限后暂停读取
+    void setMaxPipelined(int count);
+
+    // 请求体上限（字节），超出返回 413
+    void setMaxBodySize(qint64 bytes);
+
+    // 启动 reactors 个反应器（<= 0 时取 CPU 核心数），仅支持 IPv4 地址；port 为 0 时由系统分配
+    bool listen(const QHostAddress& address, quint16 port, int reactors = 0);
+
+    // 停止所有反应器并等待进行中的回调结束
+    void close();
+
+    bool isListening() const { return !m_reactors.empty(); }
+    quint16 serverPort() const { return m_port; }
+    QString errorString() const { return m_errorString; }
+
+private:
+    friend class THttpReactor;
+
+    // 由反应器调用：解析路由和负载，失败时填写错误响应
+    bool route(const THttpRequest& request, const TCallbackRegistry::Entry** entry,
+               Models::Payload* payload, Models::Response* error) const;
+
+    // GET 查询串转为 JSON 对象：值都是字符串，重复的键合并为数组；数值和布尔字段由 route() 按负载类型转换
+    static QJsonObject queryToJson(const QByteArray& query);
+
+    std::shared_ptr<TCallbackRegistry> m_registry;
+    QList<QByteArray> m_exposed;
+    QList<QByteArray> m_streamFunctions;    // 负载自动加上 "stream": true 的函数
+    int m_idleTimeout = 60000;
+    int m_maxPipelined = 64;
+    qint64 m_maxBodySize = 64 * 1024 * 1024;
+
+    QThreadPool m_workers;
+    std::vector<std::unique_ptr<THttpReactor>> m_reactors;
+    std::atomic<int> m_nextSequence{1};
+    quint16 m_port = 0;
+    QString m_errorString;
+};
+
+#endif // THTTPSERVER_H
@@ -1,19 +1,56 @@
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QHostAddress>
+#include "Handlers.h"
+#include "THttpServer.h"
+#include "TLog.h"
+#include "TPathCache.h"
+#include "TSystemSampler.h"
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
 
-    // Set up code that uses the Qt event loop here.
-    // Call a.quit() or a.exit() to quit the application.
-    // A not very useful example would be including
-    // #include <QTimer>
-    // near the top of the file and calling
-    // QTimer::singleShot(5000, &a, &QCoreApplication::quit);
-    // which quits the application after 5 seconds.
+    QCommandLineParser parser;
+    parser.setApplicationDescription("HTTP/1.1 gateway for the TCallbackT callbacks");
+    parser.addHelpOption();
+    QCommandLineOption addressOption("address", "IPv4 address to listen on.", "address", "0.0.0.0");
+    QCommandLineOption portOption("port", "TCP port to listen on.", "port", "8080");
+    QCommandLineOption reactorsOption("reactors", "Number of epoll reactor threads (0 = one per core).", "count", "0");
+    QCommandLineOption workersOption("workers", "Number of callback worker threads (0 = two per core).", "count", "0");
+    QCommandLineOption cacheOption("cache-mb", "Size of the rf/ld result cache in MiB (0 = disabled).", "MiB", "64");
+    parser.addOptions({addressOption, portOption, reactorsOption, workersOption, cacheOption});
+    parser.process(a);
 
-    // If you do not need a running Qt event loop, remove the call
-    // to a.exec() or use the Non-Qt Plain C++ Application template.
+    // 日志配置与 TCallbackT 相同
+    TLog& log = TLog::instance();
+    log.setLevel(TLog::levelFromName(QString::fromLocal8Bit(qgetenv("TCALLBACKT_LOG_LEVEL")), TLog::Level::Info));
+    if (!log.start(QString::fromLocal8Bit(qgetenv("TCALLBACKT_LOG_FILE")))) {
+        log.start();
+        TLOG_WARN("log_file_open_failed").field("path", QString::fromLocal8Bit(qgetenv("TCALLBACKT_LOG_FILE")));
+    }
 
-    return a.exec();
+    TSystemSampler sampler;
+    sampler.start(1000);
+
+    // 与 WebSocket 会话相同的内置回调
+    int cacheMegabytes = parser.value(cacheOption).toInt();
+    TPathCache cache(qint64(cacheMegabytes) * 1024 * 1024);
+    bool cacheEnabled = cacheMegabytes > 0 && cache.start();
+    auto registry = std::make_shared<TCallbackRegistry>();
+    registerDefaultHandlers(*registry, sampler, 16 * 1024 * 1024, cacheEnabled ? &cache : nullptr);
+
+    THttpServer server(registry);
+    server.setWorkerThreads(parser.value(workersOption).toInt());
+    if (!server.listen(QHostAddress(parser.value(addressOption)), static_cast<quint16>(parser.value(portOption).toInt()),
+                       parser.value(reactorsOption).toInt())) {
+        TLOG_ERROR("http_listen_failed").field("reason", server.errorString());
+        log.stop();
+        return 1;
+    }
+
+    int result = a.exec();
+    server.close();
+    log.stop();
+    return result;
 }
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# httpserver 的接口测试：先启动 httpserver（默认端口 8080），再运行本脚本
+#
+#   ./httpserver --port 8080 &
+#   python3 test.py [--host localhost] [--port 8080]
+import argparse
+import http.client
+import json
+import os
+import sys
+import tempfile
+import urllib.parse
+
+
+class HttpTester:
+    def __init__(self, host, port):
+        self.host = host
+        self.port = port
+        self.passed = 0
+        self.failed = 0
+
+    def request(self, method, path, body=None):
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=30)
+        try:
+            headers = {"Content-Type": "application/json"} if body is not None else {}
+            conn.request(method, path, body=body, headers=headers)
+            response = conn.getresponse()
+            # http.client 已按分块编码拼接好主体
+            return response.status, dict(response.getheaders()), response.read()
+        finally:
+            conn.close()
+
+    def check(self, name, condition, detail=""):
+        if condition:
+            self.passed += 1
+            print(f"✅ {name}")
+        else:
+            self.failed += 1
+            print(f"❌ {name}: {detail}")
+
+    def test_list_directory_stream(self, directory, expected):
+        """GET /ld?stream=true：推送型数据源以分块编码发出，每页一行 JSON 数组"""
+        query = urllib.parse.urlencode({"path": directory, "depth": -1, "stream": "true", "pageSize": 7})
+        status, headers, body = self.request("GET", f"/ld?{query}")
+        self.check("ld stream 状态码", status == 200, f"{status} {body[:200]!r}")
+        self.check("ld stream 使用分块编码", headers.get("Transfer-Encoding") == "chunked", headers)
+        if status != 200:
+            return
+
+        names = set()
+        pages = body.decode("utf-8").splitlines()
+        for page in pages:
+            for info in json.loads(page):
+                names.add(info["name"])
+        self.check("ld stream 分页", len(pages) >= len(expected) // 7, f"{len(pages)} 页")
+        self.check("ld stream 列出全部条目", expected <= names, sorted(expected - names)[:5])
+
+    def test_list_directory_post(self, directory, expected):
+        """POST /ld：请求体中的 stream 同样以分块编码返回"""
+        body = json.dumps({"path": directory, "depth": -1, "stream": True})
+        status, headers, data = self.request("POST", "/ld", body)
+        self.check("ld POST stream 状态码", status == 200, f"{status} {data[:200]!r}")
+        if status == 200:
+            names = {info["name"] for line in data.decode("utf-8").splitlines() for info in json.loads(line)}
+            self.check("ld POST stream 列出全部条目", expected <= names, sorted(expected - names)[:5])
+
+    def run(self):
+        with tempfile.TemporaryDirectory() as directory:
+            # 若干子目录和文件，条目数超过一页，让流式列表跨多个分块
+            expected = set()
+            for d in range(5):
+                sub = os.path.join(directory, f"dir{d}")
+                os.mkdir(sub)
+                expected.add(f"dir{d}")
+                for i in range(20):
+                    with open(os.path.join(sub, f"file{i}.txt"), "w") as f:
+                        f.write("x" * i)
+                    expected.add(f"dir{d}/file{i}.txt")
+
+            self.test_list_directory_stream(directory, expected)
+            self.test_list_directory_post(directory, expected)
+
+        print("=" * 60)
+        print(f"通过 {self.passed}，失败 {self.failed}")
+        return self.failed == 0
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="httpserver 接口测试")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=8080)
+    args = parser.parse_args()
+    sys.exit(0 if HttpTester(args.host, args.port).run() else 1)
@@ -1,19 +1,338 @@
+// 本机对端：在 QLocalServer（Unix 域套接字 / Windows 命名管道）上等待 TCallbackT 连接，
+// 以与 PaaS 服务器相同的 n/p/s 消息格式发送请求，统计往返延迟
+//
+// 用法：
+//   namedpipe --name tcallbackt --function gsi --payload '{}' --requests 10000 --depth 1
+//   TCALLBACKT_URL=local:tcallbackt TCallbackT
+//
+// --transport ws 时改为在 ws://127.0.0.1:<port> 上等待连接，用同样的请求比较两种传输的往返延迟
+// --shm <MiB> 时本端发送的大消息经共享内存环传递；对端的环由 TCALLBACKT_URL=local:tcallbackt?shm=<MiB> 开启
+
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "TJsonReader.h"
+#include "Models.h"
+#include "TMetrics.h"
+#include "TTransport.h"
+
+namespace {
+
+struct Options {
+    QString transport = "local";    // local 或 ws
+    QString name = "tcallbackt";    // 本机服务器名称
+    int port = 8765;                // ws 监听端口
+    QString function = "gsi";
+    QJsonValue payload = QJsonObject();
+    qint64 requests = 10000;        // 所有连接合计
+    int depth = 1;                  // 每个连接上的未完成请求数
+    qint64 sharedMemorySize = 0;    // 本端发送方向的共享内存环，字节
+    bool print = false;             // 打印每个响应
+    QString outputPath;
+};
+
+struct Peer {
+    TTransport* transport = nullptr;
+    QHash<int, qint64> pending;     // 序号 -> 发送时间
+};
+
+// 从一个响应对象中读取 c 和 s，其它字段跳过
+bool parseResponse(TJsonReader& reader, int* status, int* sequence)
+{
+    if (!reader.expect('{')) {
+        return false;
+    }
+    bool hasSequence = false;
+    do {
+        const char* keyBegin = nullptr;
+        const char* keyEnd = nullptr;
+        if (!reader.readKey(&keyBegin, &keyEnd)) {
+            return false;
+        }
+        qint64 value = 0;
+        if (keyEnd - keyBegin == 1 && (*keyBegin == 'c' || *keyBegin == 's')) {
+            if (!reader.readInteger(&value)) {
+                return false;
+            }
+            if (*keyBegin == 'c') {
+                *status = static_cast<int>(value);
+            } else {
+                *sequence = static_cast<int>(value);
+                hasSequence = true;
+            }
+        } else if (!reader.skipValue()) {
+            return false;
+        }
+    } while (reader.consume(','));
+    return reader.expect('}') && hasSequence;
+}
+
+// 向已连接的会话发送请求并匹配响应
+class RoundTripDriver
+{
+public:
+    explicit RoundTripDriver(const Options& options)
+        : m_options(options)
+    {
+        QJsonObject object;
+        object["n"] = options.function;
+        object["p"] = options.payload;
+        m_prefix = QJsonDocument(object).toJson(QJsonDocument::Compact);
+        m_prefix.chop(1);
+        m_prefix.append(",\"s\":");
+    }
+
+    std::function<void()> finished;
+
+    void addPeer(TTransport* transport)
+    {
+        m_peers.emplace_back(new Peer());
+        Peer* peer = m_peers.back().get();
+        peer->transport = transport;
+
+        QObject::connect(transport, &TTransport::messageReceived, transport,
+                         [this, peer](const QByteArray& message, bool binary) {
+            // 流式响应的数据块帧不计入往返延迟，完成响应到达时才算一次往返
+            if (!binary) {
+                onResponse(peer, message);
+            } else if (message.size() > Models::Frame::HeaderSize
+                       && static_cast<quint8>(message[0]) == Models::Frame::Chunk) {
+                m_chunkBytes += static_cast<quint64>(message.size() - Models::Frame::HeaderSize);
+            }
+        });
+        QObject::connect(transport, &TTransport::disconnected, transport, [this, peer]() {
+            m_abandoned += static_cast<quint64>(peer->pending.size());
+            peer->pending.clear();
+            checkFinished();
+        });
+
+        if (!m_clock.isValid()) {
+            m_clock.start();
+        }
+        fill(peer);
+    }
+
+    TLatencySummary latency() const
+    {
+        TLatencySummary summary;
+        summary.merge(m_latency);
+        return summary;
+    }
+    quint64 errors() const { return m_errors; }
+    quint64 abandoned() const { return m_abandoned; }
+    quint64 chunkBytes() const { return m_chunkBytes; }
+    qint64 elapsedNs() const { return m_elapsedNs; }
+
+private:
+    void fill(Peer* peer)
+    {
+        while (m_sent < m_options.requests && peer->pending.size() < m_options.depth) {
+            int sequence = ++m_sequence;
+            QByteArray frame = m_prefix;
+            frame.append(QByteArray::number(sequence));
+            frame.append('}');
+            peer->pending.insert(sequence, m_clock.nsecsElapsed());
+            peer->transport->sendMessage(frame, false);
+            ++m_sent;
+        }
+    }
+
+    void onResponse(Peer* peer, const QByteArray& message)
+    {
+        // 会话开启合并时，多个响应以 JSON 数组的形式到达
+        TJsonReader reader(message);
+        int status = 0;
+        int sequence = 0;
+        if (reader.consume('[')) {
+            do {
+                if (!parseResponse(reader, &status, &sequence)) {
+                    break;
+                }
+                complete(peer, status, sequence);
+            } while (reader.consume(','));
+        } else if (parseResponse(reader, &status, &sequence)) {
+            complete(peer, status, sequence);
+        }
+
+        if (m_options.print) {
+            QTextStream(stdout) << message << "\n";
+        }
+
+        fill(peer);
+        checkFinished();
+    }
+
+    void complete(Peer* peer, int status, int sequence)
+    {
+        auto it = peer->pending.find(sequence);
+        if (it == peer->pending.end()) {
+            return;
+        }
+        m_latency.record(static_cast<quint64>(m_clock.nsecsElapsed() - it.value()));
+        if (status >= 400) {
+            ++m_errors;
+        }
+        peer->pending.erase(it);
+    }
+
+    void checkFinished()
+    {
+        if (m_done || m_sent < m_options.requests) {
+            return;
+        }
+        for (const std::unique_ptr<Peer>& peer : m_peers) {
+            if (!peer->pending.isEmpty()) {
+                return;
+            }
+        }
+        m_done = true;
+        m_elapsedNs = m_clock.nsecsElapsed();
+        if (finished) {
+            finished();
+        }
+    }
+
+    const Options m_options;
+    QByteArray m_prefix;
+    std::vector<std::unique_ptr<Peer>> m_peers;
+    QElapsedTimer m_clock;
+    TLatencyHistogram m_latency;    // 纳秒
+    qint64 m_sent = 0;
+    int m_sequence = 0;
+    quint64 m_errors = 0;
+    quint64 m_abandoned = 0;
+    quint64 m_chunkBytes = 0;
+    bool m_done = false;
+    qint64 m_elapsedNs = 0;
+};
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local peer for TCallbackT sessions: sends requests and measures round trips.");
+    parser.addHelpOption();
+    QCommandLineOption transportOption("transport", "Listen transport: local or ws.", "transport", "local");
+    QCommandLineOption nameOption("name", "Local server name or socket path.", "name", "tcallbackt");
+    QCommandLineOption portOption("port", "WebSocket port when --transport ws.", "port", "8765");
+    QCommandLineOption functionOption("function", "Function to call.", "name", "gsi");
+    QCommandLineOption payloadOption("payload", "JSON payload.", "json", "{}");
+    QCommandLineOption requestsOption("requests", "Total requests.", "n", "10000");
+    QCommandLineOption depthOption("depth", "Outstanding requests per session.", "n", "1");
+    QCommandLineOption shmOption("shm", "Shared-memory ring size in MiB for large messages (local only).", "MiB", "0");
+    QCommandLineOption printOption("print", "Print every response.");
+    QCommandLineOption outputOption("output", "Write the latency summary as JSON.", "path");
+    parser.addOptions({transportOption, nameOption, portOption, functionOption, payloadOption,
+                       requestsOption, depthOption, shmOption, printOption, outputOption});
+    parser.process(a);
+
+    Options options;
+    options.transport = parser.value(transportOption);
+    options.name = parser.value(nameOption);
+    options.port = parser.value(portOption).toInt();
+    options.function = parser.value(functionOption);
+    options.requests = qMax<qint64>(1, parser.value(requestsOption).toLongLong());
+    options.depth = qMax(1, parser.value(depthOption).toInt());
+    options.sharedMemorySize = qMax<qint64>(0, parser.value(shmOption).toLongLong()) * 1024 * 1024;
+    options.print = parser.isSet(printOption);
+    options.outputPath = parser.value(outputOption);
+
+    QJsonParseError parseError;
+    QJsonDocument payload = QJsonDocument::fromJson(parser.value(payloadOption).toUtf8(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        out << "error: invalid payload: " << parseError.errorString() << "\n";
+        return 1;
+    }
+    options.payload = payload.isArray() ? QJsonValue(payload.array()) : QJsonValue(payload.object());
+
+    RoundTripDriver driver(options);
+    QLocalServer localServer;
+    QWebSocketServer webSocketServer("namedpipe", QWebSocketServer::NonSecureMode);
+    QString url;
+    if (options.transport == "local") {
+        // 上次异常退出留下的套接字文件会使 listen 失败
+        QLocalServer::removeServer(options.name);
+        if (!localServer.listen(options.name)) {
+            out << "error: " << localServer.errorString() << "\n";
+            return 1;
+        }
+        url = "local:" + options.name;
+        QObject::connect(&localServer, &QLocalServer::newConnection, &localServer, [&localServer, &driver, &options]() {
+            while (QLocalSocket* socket = localServer.nextPendingConnection()) {
+                TLocalSocketTransport* transport = new TLocalSocketTransport(socket, &localServer);
+                transport->setSharedMemorySize(options.sharedMemorySize);
+                driver.addPeer(transport);
+            }
+        });
+    } else if (options.transport == "ws") {
+        if (!webSocketServer.listen(QHostAddress::LocalHost, static_cast<quint16>(options.port))) {
+            out << "error: " << webSocketServer.errorString() << "\n";
+            return 1;
+        }
+        url = QString("ws://127.0.0.1:%1").arg(webSocketServer.serverPort());
+        QObject::connect(&webSocketServer, &QWebSocketServer::newConnection, &webSocketServer,
+                         [&webSocketServer, &driver]() {
+            while (QWebSocket* socket = webSocketServer.nextPendingConnection()) {
+                driver.addPeer(new TWebSocketTransport(socket, &webSocketServer));
+            }
+        });
+    } else {
+        out << "error: unknown transport " << options.transport << "\n";
+        return 1;
+    }
+    out << "waiting for sessions on " << url << " (TCALLBACKT_URL=" << url << ")\n";
+    out.flush();
 
-    // Set up code that uses the Qt event loop here.
-    // Call a.quit() or a.exit() to quit the application.
-    // A not very useful example would be including
-    // #include <QTimer>
-    // near the top of the file and calling
-    // QTimer::singleShot(5000, &a, &QCoreApplication::quit);
-    // which quits the application after 5 seconds.
+    driver.finished = [&a]() { a.quit(); };
+    a.exec();
 
-    // If you do not need a running Qt event loop, remove the call
-    // to a.exec() or use the Non-Qt Plain C++ Application template.
+    TLatencySummary latency = driver.latency();
+    double seconds = driver.elapsedNs() / 1e9;
+    out << "transport " << options.transport << ", " << latency.count() << " round trips in "
+        << QString::number(seconds, 'f', 3) << " s (" << QString::number(latency.count() / qMax(seconds, 1e-9), 'f', 0)
+        << "/s), errors " << driver.errors() << ", abandoned " << driver.abandoned()
+        << ", streamed " << driver.chunkBytes() << " bytes\n";
+    out << "round trip us: mean " << QString::number(latency.mean() / 1000.0, 'f', 1)
+        << ", p50 " << QString::number(latency.percentile(0.50) / 1000.0, 'f', 1)
+        << ", p99 " << QString::number(latency.percentile(0.99) / 1000.0, 'f', 1)
+        << ", max " << QString::number(latency.max() / 1000.0, 'f', 1) << "\n";
 
-    return a.exec();
+    if (!options.outputPath.isEmpty()) {
+        QJsonObject result;
+        result["transport"] = options.transport;
+        result["function"] = options.function;
+        result["requests"] = options.requests;
+        result["depth"] = options.depth;
+        result["seconds"] = seconds;
+        result["errors"] = static_cast<qint64>(driver.errors());
+        result["abandoned"] = static_cast<qint64>(driver.abandoned());
+        result["chunkBytes"] = static_cast<qint64>(driver.chunkBytes());
+        result["sharedMemory"] = options.sharedMemorySize;
+        result["latency"] = latency.toJson();
+        QFile file(options.outputPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out << "error: cannot write " << options.outputPath << "\n";
+            return 1;
+        }
+        file.write(QJsonDocument(result).toJson());
+    }
+    return 0;
 }